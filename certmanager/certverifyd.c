@@ -0,0 +1,624 @@
+/* certverifyd.c
+ *
+ * Copyright (C) 2006-2018 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Certificate verification service. One WOLFSSL_CERT_MANAGER is loaded with
+ * the CA set and then only read. The main thread acts as the front end and
+ * queues DER leaf certificates, worker threads take them off the queue and
+ * verify them with wolfSSL_CertManagerVerifyBuffer(). Results are cached by
+ * the SHA-256 of the leaf for a TTL so a client presenting the same
+ * certificate again isn't verified again.
+ *
+ * Each thread count is run twice, without and with the cache, and the
+ * verifies per second, per core and the cache hit rate are printed.
+ */
+/*
+./configure && make && sudo make install
+gcc -o certverifyd certverifyd.c -lwolfssl -lpthread
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+#define DEF_VERIFIES    20000   /* requests per run */
+#define DEF_CACHE_SZ    4096    /* cache entries */
+#define DEF_TTL         60.0    /* seconds a cached result is used */
+#define DEF_QUEUE_SZ    1024
+#define MAX_THREADS     64
+#define MAX_CAS         16
+#define MAX_LEAVES      256
+#define MAX_CERT_SZ     16384   /* largest leaf file, PEM or DER */
+#define CACHE_SHARDS    16      /* separately locked parts of the cache */
+#define CACHE_PROBES    8       /* slots searched per lookup */
+
+#if !defined(NO_SHA256) && !defined(SINGLE_THREADED)
+
+typedef struct Leaf {
+    const char* file;
+    byte*       der;
+    int         derSz;
+} Leaf;
+
+/* Bounded queue of requests between the front end and the workers */
+typedef struct Queue {
+    const Leaf**    items;
+    int             size;
+    int             head;
+    int             count;
+    int             closed;
+    pthread_mutex_t lock;
+    pthread_cond_t  notEmpty;
+    pthread_cond_t  notFull;
+} Queue;
+
+typedef struct CacheEntry {
+    byte   hash[WC_SHA256_DIGEST_SIZE];
+    int    used;
+    int    result;  /* return of wolfSSL_CertManagerVerifyBuffer() */
+    double expires;
+} CacheEntry;
+
+typedef struct CacheShard {
+    pthread_mutex_t lock;
+    CacheEntry*     slots;
+    int             numSlots;
+} CacheShard;
+
+typedef struct Cache {
+    CacheShard shard[CACHE_SHARDS];
+    double     ttl;
+} Cache;
+
+typedef struct Service {
+    WOLFSSL_CERT_MANAGER* cm;   /* shared, read only once the CAs are in */
+    Leaf                  leaves[MAX_LEAVES];
+    int                   numLeaves;
+    Queue                 queue;
+    Cache                 cache;
+    int                   useCache;
+} Service;
+
+typedef struct Worker {
+    Service*  svc;
+    pthread_t tid;
+    long      done;
+    long      hits;
+    long      failed;
+} Worker;
+
+static int allowDates = 0;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+/* With -d the test certificates are accepted outside their validity dates */
+static int VerifyCb(int preverify, WOLFSSL_X509_STORE_CTX* store)
+{
+    if (!preverify && allowDates && (store->error == ASN_AFTER_DATE_E ||
+            store->error == ASN_BEFORE_DATE_E)) {
+        return 1;
+    }
+    return preverify;
+}
+
+static int queue_init(Queue* q, int size)
+{
+    memset(q, 0, sizeof(Queue));
+    q->items = (const Leaf**)malloc(sizeof(Leaf*) * size);
+    if (q->items == NULL)
+        return MEMORY_E;
+    q->size = size;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->notEmpty, NULL);
+    pthread_cond_init(&q->notFull, NULL);
+    return 0;
+}
+
+static void queue_free(Queue* q)
+{
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->notEmpty);
+    pthread_cond_destroy(&q->notFull);
+    free(q->items);
+}
+
+static void queue_push(Queue* q, const Leaf* leaf)
+{
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->size)
+        pthread_cond_wait(&q->notFull, &q->lock);
+    q->items[(q->head + q->count) % q->size] = leaf;
+    q->count++;
+    pthread_cond_signal(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* returns NULL once the queue is closed and empty */
+static const Leaf* queue_pop(Queue* q)
+{
+    const Leaf* leaf = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed)
+        pthread_cond_wait(&q->notEmpty, &q->lock);
+    if (q->count > 0) {
+        leaf = q->items[q->head];
+        q->head = (q->head + 1) % q->size;
+        q->count--;
+        pthread_cond_signal(&q->notFull);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return leaf;
+}
+
+static void queue_close(Queue* q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static int cache_init(Cache* c, int entries, double ttl)
+{
+    int i;
+    int perShard = (entries + CACHE_SHARDS - 1) / CACHE_SHARDS;
+
+    memset(c, 0, sizeof(Cache));
+    c->ttl = ttl;
+    for (i = 0; i < CACHE_SHARDS; i++) {
+        c->shard[i].slots = (CacheEntry*)calloc(perShard, sizeof(CacheEntry));
+        if (c->shard[i].slots == NULL)
+            return MEMORY_E;
+        c->shard[i].numSlots = perShard;
+        pthread_mutex_init(&c->shard[i].lock, NULL);
+    }
+    return 0;
+}
+
+static void cache_free(Cache* c)
+{
+    int i;
+
+    for (i = 0; i < CACHE_SHARDS; i++) {
+        if (c->shard[i].slots == NULL)
+            continue;
+        pthread_mutex_destroy(&c->shard[i].lock);
+        free(c->shard[i].slots);
+    }
+}
+
+static void cache_clear(Cache* c)
+{
+    int i;
+
+    for (i = 0; i < CACHE_SHARDS; i++) {
+        memset(c->shard[i].slots, 0,
+            sizeof(CacheEntry) * c->shard[i].numSlots);
+    }
+}
+
+static CacheShard* cache_shard(Cache* c, const byte* hash, int* idx)
+{
+    CacheShard* s = &c->shard[hash[0] % CACHE_SHARDS];
+    word32 h = ((word32)hash[1] << 24) | ((word32)hash[2] << 16) |
+               ((word32)hash[3] << 8) | hash[4];
+
+    *idx = (int)(h % (word32)s->numSlots);
+    return s;
+}
+
+/* returns 1 and the cached result when present and not expired */
+static int cache_get(Cache* c, const byte* hash, double now, int* result)
+{
+    int i, idx, found = 0;
+    CacheEntry* e;
+    CacheShard* s = cache_shard(c, hash, &idx);
+
+    pthread_mutex_lock(&s->lock);
+    for (i = 0; i < CACHE_PROBES && i < s->numSlots; i++) {
+        e = &s->slots[(idx + i) % s->numSlots];
+        if (!e->used)
+            break;
+        if (memcmp(e->hash, hash, WC_SHA256_DIGEST_SIZE) == 0) {
+            if (e->expires > now) {
+                *result = e->result;
+                found = 1;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return found;
+}
+
+/* Stores in the slot for the same leaf, a free or expired one, otherwise
+ * replaces the first slot probed. Slots are never emptied so a lookup can
+ * stop at the first unused one. */
+static void cache_put(Cache* c, const byte* hash, double now, int result)
+{
+    int i, idx;
+    CacheEntry* e;
+    CacheEntry* slot = NULL;
+    CacheShard* s = cache_shard(c, hash, &idx);
+
+    pthread_mutex_lock(&s->lock);
+    for (i = 0; i < CACHE_PROBES && i < s->numSlots; i++) {
+        e = &s->slots[(idx + i) % s->numSlots];
+        if (!e->used ||
+                memcmp(e->hash, hash, WC_SHA256_DIGEST_SIZE) == 0) {
+            slot = e;
+            break;
+        }
+        if (slot == NULL && e->expires <= now)
+            slot = e;
+    }
+    if (slot == NULL)
+        slot = &s->slots[idx];
+    memcpy(slot->hash, hash, WC_SHA256_DIGEST_SIZE);
+    slot->used = 1;
+    slot->result = result;
+    slot->expires = now + c->ttl;
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void* verify_thread(void* arg)
+{
+    Worker* w = (Worker*)arg;
+    Service* svc = w->svc;
+    const Leaf* leaf;
+    byte hash[WC_SHA256_DIGEST_SIZE];
+    double now = 0;
+    int ret;
+    int cacheable;
+
+    while ((leaf = queue_pop(&svc->queue)) != NULL) {
+        cacheable = 0;
+        if (svc->useCache) {
+            now = current_time();
+            cacheable = (wc_Sha256Hash(leaf->der, (word32)leaf->derSz,
+                hash) == 0);
+        }
+        if (cacheable && cache_get(&svc->cache, hash, now, &ret)) {
+            w->hits++;
+        }
+        else {
+            ret = wolfSSL_CertManagerVerifyBuffer(svc->cm, leaf->der,
+                leaf->derSz, WOLFSSL_FILETYPE_ASN1);
+            if (cacheable)
+                cache_put(&svc->cache, hash, now, ret);
+        }
+        w->done++;
+        if (ret != WOLFSSL_SUCCESS)
+            w->failed++;
+    }
+
+    return NULL;
+}
+
+/* Queue totalVerifies requests over numThreads workers, returns verifies per
+ * second */
+static double run_service(Service* svc, int numThreads, int totalVerifies,
+    double* hitRate, long* failed)
+{
+    Worker workers[MAX_THREADS];
+    int i, started = 0;
+    long done = 0, hits = 0;
+    double start, elapsed;
+
+    svc->queue.head = 0;
+    svc->queue.count = 0;
+    svc->queue.closed = 0;
+    if (svc->useCache)
+        cache_clear(&svc->cache);
+
+    memset(workers, 0, sizeof(workers));
+    for (i = 0; i < numThreads; i++) {
+        workers[i].svc = svc;
+        if (pthread_create(&workers[i].tid, NULL, verify_thread,
+                           &workers[i]) != 0)
+            break;
+        started++;
+    }
+
+    /* the workers wait on the empty queue until requests arrive */
+    start = current_time();
+    for (i = 0; started > 0 && i < totalVerifies; i++)
+        queue_push(&svc->queue, &svc->leaves[i % svc->numLeaves]);
+    queue_close(&svc->queue);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i].tid, NULL);
+        done += workers[i].done;
+        hits += workers[i].hits;
+        *failed += workers[i].failed;
+    }
+    elapsed = current_time() - start;
+
+    if (started < numThreads || done != totalVerifies)
+        return -1;
+    *hitRate = (done > 0) ? 100.0 * hits / done : 0;
+    return done / elapsed;
+}
+
+static int load_leaf(Leaf* leaf, const char* file)
+{
+    int ret = 0;
+    int sz;
+    FILE* f;
+    byte* buf;
+
+    leaf->file = file;
+    /* one extra byte to NUL terminate PEM for strstr */
+    buf = (byte*)malloc(MAX_CERT_SZ + 1);
+    leaf->der = (byte*)malloc(MAX_CERT_SZ);
+    if (buf == NULL || leaf->der == NULL) {
+        free(buf);
+        return MEMORY_E;
+    }
+
+    f = fopen(file, "rb");
+    if (f == NULL) {
+        printf("Unable to open %s\n", file);
+        free(buf);
+        return -1;
+    }
+    sz = (int)fread(buf, 1, MAX_CERT_SZ, f);
+    fclose(f);
+    if (sz == MAX_CERT_SZ) {
+        printf("Certificate file %s must be smaller than %d bytes\n", file,
+               MAX_CERT_SZ);
+        free(buf);
+        return -1;
+    }
+    buf[sz] = '\0';
+
+    /* the queue carries DER, convert PEM files once here */
+    if (sz > 0 && strstr((const char*)buf, "-----BEGIN") != NULL) {
+        ret = wolfSSL_CertPemToDer(buf, sz, leaf->der, MAX_CERT_SZ,
+            CERT_TYPE);
+        if (ret > 0) {
+            leaf->derSz = ret;
+            ret = 0;
+        }
+    }
+    else if (sz > 0) {
+        memcpy(leaf->der, buf, sz);
+        leaf->derSz = sz;
+    }
+    else {
+        ret = -1;
+    }
+    if (ret != 0)
+        printf("Unable to load certificate %s (%d)\n", file, ret);
+
+    free(buf);
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("certverifyd [options] [leaf cert files]\n");
+    printf("-A <file>   CA certificate, may be repeated, default "
+           "../certs/ca-cert.pem and ../certs/ca-ecc-cert.pem\n");
+    printf("-n <num>    Verifications per run, default %d\n", DEF_VERIFIES);
+    printf("-t <num>    Maximum threads, default online CPUs\n");
+    printf("-c <num>    Cache entries, 0 for no cache run, default %d\n",
+           DEF_CACHE_SZ);
+    printf("-T <sec>    Cache TTL, default %.0f\n", DEF_TTL);
+    printf("-q <num>    Queue depth, default %d\n", DEF_QUEUE_SZ);
+    printf("-d          Accept certificates outside their validity dates\n");
+}
+#endif
+
+int main(int argc, char** argv)
+{
+#if !defined(NO_SHA256) && !defined(SINGLE_THREADED)
+    int ret = 0, ch, t, i;
+    const char* cas[MAX_CAS];
+    int numCas = 0;
+    const char* leafFiles[MAX_LEAVES];
+    int numLeafFiles = 0;
+    static const char* defCas[] = {
+        "../certs/ca-cert.pem", "../certs/ca-ecc-cert.pem"
+    };
+    static const char* defLeaves[] = {
+        "../certs/server-cert.pem", "../certs/server-ecc.pem",
+        "../certs/server-ecc-rsa.pem"
+    };
+    int totalVerifies = DEF_VERIFIES;
+    int maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int cacheSz = DEF_CACHE_SZ;
+    int queueSz = DEF_QUEUE_SZ;
+    double ttl = DEF_TTL;
+    double uncached, cached, hitRate;
+    long failed, cachedFailed;
+    Service* svc;
+
+    while ((ch = getopt(argc, argv, "?A:n:t:c:T:q:d")) != -1) {
+        switch (ch) {
+            case 'A':
+                if (numCas == MAX_CAS) {
+                    Usage();
+                    return -1;
+                }
+                cas[numCas++] = optarg;
+                break;
+            case 'n':
+                totalVerifies = atoi(optarg);
+                break;
+            case 't':
+                maxThreads = atoi(optarg);
+                break;
+            case 'c':
+                cacheSz = atoi(optarg);
+                break;
+            case 'T':
+                ttl = atof(optarg);
+                break;
+            case 'q':
+                queueSz = atoi(optarg);
+                break;
+            case 'd':
+                allowDates = 1;
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (maxThreads > MAX_THREADS)
+        maxThreads = MAX_THREADS;
+    if (totalVerifies <= 0 || maxThreads <= 0 || cacheSz < 0 ||
+            queueSz <= 0 || ttl < 0 || argc - optind > MAX_LEAVES) {
+        Usage();
+        return -1;
+    }
+    if (numCas == 0) {
+        for (i = 0; i < (int)(sizeof(defCas) / sizeof(defCas[0])); i++)
+            cas[numCas++] = defCas[i];
+    }
+    for (i = optind; i < argc; i++)
+        leafFiles[numLeafFiles++] = argv[i];
+    if (numLeafFiles == 0) {
+        for (i = 0; i < (int)(sizeof(defLeaves) / sizeof(defLeaves[0])); i++)
+            leafFiles[numLeafFiles++] = defLeaves[i];
+    }
+
+    svc = (Service*)calloc(1, sizeof(Service));
+    if (svc == NULL)
+        return -1;
+
+    wolfSSL_Init();
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    svc->cm = wolfSSL_CertManagerNew();
+    if (svc->cm == NULL) {
+        printf("wolfSSL_CertManagerNew() failed\n");
+        ret = -1; goto exit;
+    }
+    wolfSSL_CertManagerSetVerify(svc->cm, VerifyCb);
+
+    for (i = 0; i < numCas; i++) {
+        ret = wolfSSL_CertManagerLoadCA(svc->cm, cas[i], NULL);
+        if (ret != WOLFSSL_SUCCESS) {
+            printf("wolfSSL_CertManagerLoadCA() %s failed (%d): %s\n",
+                    cas[i], ret, wolfSSL_ERR_reason_error_string(ret));
+            ret = -1; goto exit;
+        }
+        printf("CA:   %s\n", cas[i]);
+    }
+
+    /* Check every leaf once so failures are visible before timing */
+    for (i = 0; i < numLeafFiles; i++) {
+        Leaf* leaf = &svc->leaves[svc->numLeaves];
+
+        ret = load_leaf(leaf, leafFiles[i]);
+        svc->numLeaves++;
+        if (ret != 0) {
+            ret = -1; goto exit;
+        }
+        ret = wolfSSL_CertManagerVerifyBuffer(svc->cm, leaf->der,
+            leaf->derSz, WOLFSSL_FILETYPE_ASN1);
+        if (ret == WOLFSSL_SUCCESS)
+            printf("Leaf: %s: OK\n", leaf->file);
+        else
+            printf("Leaf: %s: failed (%d): %s\n", leaf->file, ret,
+                    wolfSSL_ERR_reason_error_string(ret));
+        if (ret == ASN_AFTER_DATE_E || ret == ASN_BEFORE_DATE_E)
+            printf("      use -d to accept the test certificate dates\n");
+    }
+    ret = 0;
+
+    if (queue_init(&svc->queue, queueSz) != 0 || (cacheSz > 0 &&
+            cache_init(&svc->cache, cacheSz, ttl) != 0)) {
+        printf("Out of memory\n");
+        ret = -1; goto exit;
+    }
+
+    printf("%d leaves, %d verifications per run, queue %d, cache %d "
+           "entries, TTL %g s\n\n", svc->numLeaves, totalVerifies, queueSz,
+           cacheSz, ttl);
+    /* failed: requests rejected per run, the same in both runs */
+    printf("%8s %14s %14s %14s %14s %8s %8s\n", "threads", "verifies/s",
+           "per core", "cached/s", "per core", "hit %", "failed");
+
+    for (t = 1; ret == 0; t *= 2) {
+        if (t > maxThreads)
+            t = maxThreads;
+
+        failed = 0;
+        cachedFailed = 0;
+        svc->useCache = 0;
+        uncached = run_service(svc, t, totalVerifies, &hitRate, &failed);
+        cached = 0;
+        hitRate = 0;
+        if (cacheSz > 0 && uncached >= 0) {
+            svc->useCache = 1;
+            cached = run_service(svc, t, totalVerifies, &hitRate,
+                &cachedFailed);
+        }
+        if (uncached < 0 || cached < 0) {
+            printf("Run with %d threads failed\n", t);
+            ret = -1;
+            break;
+        }
+        printf("%8d %14.0f %14.0f %14.0f %14.0f %7.1f%% %8ld\n", t, uncached,
+               uncached / t, cached, cached / t, hitRate, failed);
+
+        if (t == maxThreads)
+            break;
+    }
+
+exit:
+    if (svc->queue.items != NULL)
+        queue_free(&svc->queue);
+    cache_free(&svc->cache);
+    for (i = 0; i < svc->numLeaves; i++)
+        free(svc->leaves[i].der);
+    wolfSSL_CertManagerFree(svc->cm);
+    wolfSSL_Cleanup();
+    free(svc);
+
+    return ret;
+#else
+    printf("wolfSSL requires SHA256 and thread support\n");
+    return -1;
+#endif
+}
@@ -21,8 +21,12 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include <wolfssl/options.h>
+#include <wolfssl/version.h>
 #include <wolfssl/wolfcrypt/dh.h>
+#include <wolfssl/wolfcrypt/random.h>
 
 #include "dh-params.h"
 
@@ -66,6 +70,16 @@ void print_data(char *name, unsigned char *data, int len)
     printf("};\n");
 }
 
+/* Print DH parameters as buffers */
+void print_dh_raw(const unsigned char* p, word32 p_len, const unsigned char* g,
+                  word32 g_len, const unsigned char* q, word32 q_len)
+{
+    printf("\n");
+    print_data("dh_p", (unsigned char*)p, p_len);
+    print_data("dh_g", (unsigned char*)g, g_len);
+    print_data("dh_q", (unsigned char*)q, q_len);
+}
+
 /* Print the DH parameters */
 void print_dh(DhKey *key)
 {
@@ -85,11 +99,384 @@ void print_dh(DhKey *key)
         return;
     }
 
-    /* Print out parameters. */
-    printf("\n");
-    print_data("dh_p", p, p_len);
-    print_data("dh_g", g, g_len);
-    print_data("dh_q", q, q_len);
+    print_dh_raw(p, p_len, g, g_len, q, q_len);
+}
+
+/* Benchmark: each step is repeated up to the number of checks, stopping
+ * early once BENCH_MAX_SECS have passed. */
+
+#define BENCH_MAX_SECS    1.0
+#define DEF_BENCH_PARAMS  2
+
+#if defined(LIBWOLFSSL_VERSION_HEX) && LIBWOLFSSL_VERSION_HEX >= 0x04004000
+    /* wc_DhGeneratePublic() needed for full length private exponents */
+    #define BENCH_FULL_EXP
+#endif
+
+/* Private exponent */
+enum {
+    EXP_FULL,       /* random, the length of p */
+    EXP_DEFAULT,    /* no q set, wolfSSL picks the length from the size of p */
+    EXP_Q           /* q set, private key is less than q (SP 800-56A) */
+};
+
+typedef struct BenchParams {
+    const char*          name;
+    const unsigned char* p;
+    word32               p_len;
+    const unsigned char* g;
+    word32               g_len;
+    const unsigned char* q;
+    word32               q_len;
+} BenchParams;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int bench_done(int cnt, int maxOps, double start)
+{
+    return cnt >= maxOps || (cnt > 0 &&
+                             current_time() - start >= BENCH_MAX_SECS);
+}
+
+static int bench_set_key(DhKey* key, const BenchParams* bp, int exp)
+{
+    if (exp == EXP_Q) {
+        return wc_DhSetKey_ex(key, bp->p, bp->p_len, bp->g, bp->g_len,
+                              bp->q, bp->q_len);
+    }
+    return wc_DhSetKey(key, bp->p, bp->p_len, bp->g, bp->g_len);
+}
+
+static int bench_key_pair(DhKey* key, const BenchParams* bp, int exp,
+                          WC_RNG* rng, unsigned char* priv, word32* priv_len,
+                          unsigned char* pub, word32* pub_len)
+{
+#ifdef BENCH_FULL_EXP
+    if (exp == EXP_FULL) {
+        int ret;
+
+        /* One byte shorter than p so that it is less than p - 1 */
+        *priv_len = bp->p_len - 1;
+        ret = wc_RNG_GenerateBlock(rng, priv, *priv_len);
+        if (ret != 0) {
+            return ret;
+        }
+        priv[0] |= 0x80;
+        return wc_DhGeneratePublic(key, priv, *priv_len, pub, pub_len);
+    }
+#endif
+    (void)bp;
+    (void)exp;
+    return wc_DhGenerateKeyPair(key, rng, priv, priv_len, pub, pub_len);
+}
+
+/* Measure the steps of a DHE key exchange with one set of parameters and
+ * private exponent and print a row of the table. */
+static int bench_row(int bits, const BenchParams* bp, int exp, int maxOps,
+                     WC_RNG* rng)
+{
+    int ret = 0;
+    int cnt;
+    double start;
+    double setOps, checkOps, genOps, agreeOps, pubOps;
+    double hs, hsChk;
+    DhKey key;
+    static unsigned char priv1[MAX_DH_BITS/8];
+    static unsigned char priv2[MAX_DH_BITS/8];
+    static unsigned char pub1[MAX_DH_BITS/8];
+    static unsigned char pub2[MAX_DH_BITS/8];
+    static unsigned char secret1[MAX_DH_BITS/8];
+    static unsigned char secret2[MAX_DH_BITS/8];
+    word32 priv1_len, priv2_len, pub1_len, pub2_len;
+    word32 secret1_len, secret2_len;
+    const char* expName = exp == EXP_FULL ? "full" :
+                          exp == EXP_DEFAULT ? "default" : "q";
+
+    /* Set the parameters, trusted */
+    start = current_time();
+    for (cnt = 0; ret == 0 && !bench_done(cnt, maxOps, start); cnt++) {
+        ret = wc_InitDhKey(&key);
+        if (ret == 0) {
+            ret = bench_set_key(&key, bp, exp);
+            wc_FreeDhKey(&key);
+        }
+    }
+    setOps = cnt / (current_time() - start);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to set DH params: %d\n", ret);
+        return ret;
+    }
+
+    /* Set the parameters, not trusted - p is checked for primality */
+    start = current_time();
+    for (cnt = 0; ret == 0 && !bench_done(cnt, maxOps, start); cnt++) {
+        ret = wc_InitDhKey(&key);
+        if (ret == 0) {
+            ret = wc_DhSetCheckKey(&key, bp->p, bp->p_len, bp->g, bp->g_len,
+                                   exp == EXP_Q ? bp->q : NULL,
+                                   exp == EXP_Q ? bp->q_len : 0, 0, rng);
+            wc_FreeDhKey(&key);
+        }
+    }
+    checkOps = cnt / (current_time() - start);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to set/check DH params: %d\n", ret);
+        return ret;
+    }
+
+    ret = wc_InitDhKey(&key);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to initialize DH key\n");
+        return ret;
+    }
+    ret = bench_set_key(&key, bp, exp);
+
+    /* Generate key pairs */
+    start = current_time();
+    for (cnt = 0; ret == 0 && !bench_done(cnt, maxOps, start); cnt++) {
+        priv1_len = sizeof(priv1);
+        pub1_len = sizeof(pub1);
+        ret = bench_key_pair(&key, bp, exp, rng, priv1, &priv1_len, pub1,
+                             &pub1_len);
+    }
+    genOps = cnt / (current_time() - start);
+    if (ret == 0) {
+        priv2_len = sizeof(priv2);
+        pub2_len = sizeof(pub2);
+        ret = bench_key_pair(&key, bp, exp, rng, priv2, &priv2_len, pub2,
+                             &pub2_len);
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Failed to generate key pair: %d\n", ret);
+        goto exit;
+    }
+
+    /* Check the peer's public value, against q when available */
+    start = current_time();
+    for (cnt = 0; ret == 0 && !bench_done(cnt, maxOps, start); cnt++) {
+        if (bp->q != NULL) {
+            ret = wc_DhCheckPubKey_ex(&key, pub2, pub2_len, bp->q,
+                                      bp->q_len);
+        }
+        else {
+            ret = wc_DhCheckPubKey(&key, pub2, pub2_len);
+        }
+    }
+    pubOps = cnt / (current_time() - start);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to check public key: %d\n", ret);
+        goto exit;
+    }
+
+    /* Calculate the secret */
+    start = current_time();
+    for (cnt = 0; ret == 0 && !bench_done(cnt, maxOps, start); cnt++) {
+        secret1_len = sizeof(secret1);
+        ret = wc_DhAgree(&key, secret1, &secret1_len, priv1, priv1_len,
+                         pub2, pub2_len);
+    }
+    agreeOps = cnt / (current_time() - start);
+    if (ret == 0) {
+        secret2_len = sizeof(secret2);
+        ret = wc_DhAgree(&key, secret2, &secret2_len, priv2, priv2_len,
+                         pub1, pub1_len);
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Failed to calculate secret: %d\n", ret);
+        goto exit;
+    }
+    if ((secret1_len != secret2_len) || (XMEMCMP(secret1, secret2,
+                                                 secret1_len) != 0)) {
+        fprintf(stderr, "Secrets different\n");
+        ret = -1;
+        goto exit;
+    }
+
+    /* One side of a handshake: key pair and secret, and with validation of
+     * the parameters and the peer's public value */
+    hs = 1.0 / (1.0 / genOps + 1.0 / agreeOps);
+    hsChk = 1.0 / (1.0 / checkOps + 1.0 / genOps + 1.0 / pubOps +
+                   1.0 / agreeOps);
+
+    printf("%5d %-9s %-8s %7d %10.0f %9.2f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+           bits, bp->name, expName, priv1_len * 8, setOps, checkOps, genOps,
+           pubOps, agreeOps, hs, hsChk);
+
+exit:
+    wc_FreeDhKey(&key);
+    return ret;
+}
+
+/* Run the rows for one set of parameters */
+static int bench_params(int bits, const BenchParams* bp, int maxOps,
+                        WC_RNG* rng)
+{
+    int ret = 0;
+
+#ifdef BENCH_FULL_EXP
+    ret = bench_row(bits, bp, EXP_FULL, maxOps, rng);
+#endif
+    if (ret == 0) {
+        ret = bench_row(bits, bp, EXP_DEFAULT, maxOps, rng);
+    }
+    if (ret == 0 && bp->q != NULL) {
+        ret = bench_row(bits, bp, EXP_Q, maxOps, rng);
+    }
+    return ret;
+}
+
+/* Generate parameters, timing the generation, then benchmark the last set
+ * generated and the FFDHE group of the same size. */
+static int bench_bits(int bits, int numParams, int maxOps, WC_RNG* rng)
+{
+    int ret = 0;
+    int cnt;
+    double start, elapsed;
+    static DhKey key;
+    static unsigned char p[MAX_DH_BITS/8];
+    static unsigned char g[MAX_DH_BITS/8];
+    static unsigned char q[MAX_DH_Q_SIZE/8];
+    word32 p_len, g_len, q_len;
+    BenchParams bp;
+    const DhParams* dhparams = NULL;
+
+    if (bits == 4096 && numParams > 0) {
+        /* wc_DhGenerateParams() only generates up to 3072 bits */
+        printf("%5d %-9s skipped, wolfSSL cannot generate 4096-bit "
+               "parameters\n", bits, "generated");
+    }
+    else if (numParams > 0) {
+        ret = wc_InitDhKey(&key);
+        if (ret != 0) {
+            fprintf(stderr, "Failed to initialize DH key\n");
+            return ret;
+        }
+
+        start = current_time();
+        for (cnt = 0; ret == 0 && cnt < numParams; cnt++) {
+            ret = wc_DhGenerateParams(rng, bits, &key);
+        }
+        elapsed = current_time() - start;
+        if (ret == 0) {
+            p_len = sizeof(p);
+            q_len = sizeof(q);
+            g_len = sizeof(g);
+            ret = wc_DhExportParamsRaw(&key, p, &p_len, q, &q_len, g, &g_len);
+        }
+        wc_FreeDhKey(&key);
+        if (ret != 0) {
+            fprintf(stderr, "Failed to generate DH params: %d\n", ret);
+            return ret;
+        }
+        printf("%5d %-9s paramgen %.2f s (average of %d)\n", bits,
+               "generated", elapsed / numParams, numParams);
+
+        bp.name = "generated";
+        bp.p = p;
+        bp.p_len = p_len;
+        bp.g = g;
+        bp.g_len = g_len;
+        bp.q = q;
+        bp.q_len = q_len;
+        ret = bench_params(bits, &bp, maxOps, rng);
+        if (ret != 0) {
+            print_dh_raw(p, p_len, g, g_len, q, q_len);
+            return ret;
+        }
+    }
+
+    if (0) {
+    }
+#ifdef HAVE_FFDHE_2048
+    else if (bits == 2048) {
+        dhparams = wc_Dh_ffdhe2048_Get();
+    }
+#endif
+#ifdef HAVE_FFDHE_3072
+    else if (bits == 3072) {
+        dhparams = wc_Dh_ffdhe3072_Get();
+    }
+#endif
+#ifdef HAVE_FFDHE_4096
+    else if (bits == 4096) {
+        dhparams = wc_Dh_ffdhe4096_Get();
+    }
+#endif
+    if (dhparams == NULL) {
+        printf("%5d %-9s not compiled in\n", bits, "ffdhe");
+        return 0;
+    }
+
+    bp.name = "ffdhe";
+    bp.p = dhparams->p;
+    bp.p_len = dhparams->p_len;
+    bp.g = dhparams->g;
+    bp.g_len = dhparams->g_len;
+#ifdef HAVE_FFDHE_Q
+    bp.q = dhparams->q;
+    bp.q_len = dhparams->q_len;
+#else
+    bp.q = NULL;
+    bp.q_len = 0;
+#endif
+    return bench_params(bits, &bp, maxOps, rng);
+}
+
+/* Benchmark the sizes, all of 2048/3072/4096 when bits is 0 */
+static int run_bench(int bits, int numParams, int maxOps)
+{
+    /* sizes the math library supports, zero terminated */
+    static const int benchBits[] = {
+    #if !defined(WOLFSSL_SP_MATH) || !defined(WOLFSSL_SP_NO_2048)
+        2048,
+    #endif
+    #if !defined(WOLFSSL_SP_MATH) || !defined(WOLFSSL_SP_NO_3072)
+        3072,
+    #endif
+    #if !defined(WOLFSSL_SP_MATH) || defined(WOLFSSL_SP_4096)
+        4096,
+    #endif
+        0
+    };
+    int ret = 0;
+    int i;
+    int ran = 0;
+    WC_RNG rng;
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to initialize random\n");
+        return 1;
+    }
+
+    printf("Max ops per step: %d (or %.0f s)\n", maxOps, BENCH_MAX_SECS);
+    printf("\n%5s %-9s %-8s %7s %10s %9s %9s %9s %9s %9s %9s\n", "Bits",
+           "Params", "Exponent", "ExpBits", "set/s", "check/s", "keygen/s",
+           "pubchk/s", "agree/s", "hs/s", "hs-chk/s");
+
+    for (i = 0; benchBits[i] != 0; i++) {
+        if (bits != 0 && bits != benchBits[i]) {
+            continue;
+        }
+        ran++;
+        ret = bench_bits(benchBits[i], numParams, maxOps, &rng);
+        if (ret != 0) {
+            break;
+        }
+    }
+    if (ran == 0) {
+        fprintf(stderr, "Bit size not supported with SP_MATH: %d\n", bits);
+        ret = 1;
+    }
+
+    wc_FreeRng(&rng);
+    return ret == 0 ? 0 : 1;
 }
 
 /* Show usage information */
@@ -101,6 +488,8 @@ void usage()
     fprintf(stderr, "  -num-gen <num>   Number of params to generate\n");
     fprintf(stderr, "  -checks <num>    Number of key exchanges to do\n");
     fprintf(stderr, "  -ffdhe           Used pre-defined FFDHE params\n");
+    fprintf(stderr, "  -bench           Time generated and FFDHE params,\n");
+    fprintf(stderr, "                   2048/3072/4096 unless -bits given\n");
     fprintf(stderr, "\n");
 }
 
@@ -130,6 +519,10 @@ int main(int argc, char *argv[])
     int checks = DEF_KA_CHECKS;
     int gen_params = 1;
     int load_params = 0;
+    int bench = 0;
+    int bits_set = 0;
+    int num_gen_set = 0;
+    int checks_set = 0;
 
     /* Skip the program name */
     --argc;
@@ -151,6 +544,7 @@ int main(int argc, char *argv[])
                 return 1;
             }
             bits = atoi(*argv);
+            bits_set = 1;
         }
         /* Number of DH parameters to generate */
         else if (XSTRNCMP(*argv, "-num-gen", 9) == 0) {
@@ -161,6 +555,7 @@ int main(int argc, char *argv[])
                 return 1;
             }
             numParams = atoi(*argv);
+            num_gen_set = 1;
         }
         /* Number of key agreement checks to perform */
         else if (XSTRNCMP(*argv, "-checks", 7) == 0) {
@@ -171,11 +566,16 @@ int main(int argc, char *argv[])
                 return 1;
             }
             checks = atoi(*argv);
+            checks_set = 1;
         }
         /* Use the pre-defined FFDHE parameters */
         else if (XSTRNCMP(*argv, "-ffdhe", 7) == 0) {
             gen_params = 0;
         }
+        /* Benchmark generated and FFDHE parameters */
+        else if (XSTRNCMP(*argv, "-bench", 7) == 0) {
+            bench = 1;
+        }
         /* Display usage information */
         else if (XSTRNCMP(*argv, "-help", 6) == 0) {
             usage();
@@ -191,6 +591,22 @@ int main(int argc, char *argv[])
         ++argv;
     }
 
+    if (bench) {
+        if (bits_set && bits != 2048 && bits != 3072 && bits != 4096) {
+            fprintf(stderr, "Bits out of range (2048, 3072 or 4096): %d\n",
+                    bits);
+            usage();
+            return 1;
+        }
+        if (numParams < 0 || checks < 1) {
+            usage();
+            return 1;
+        }
+        return run_bench(bits_set ? bits : 0,
+                         num_gen_set ? numParams : DEF_BENCH_PARAMS,
+                         checks_set ? checks : DEF_KA_CHECKS);
+    }
+
     /* Check bits are valid */
     if (bits != 1024 && bits != 2048 && bits != 3072 && bits != 4096) {
         fprintf(stderr, "Bits out of range (1024, 2048, 3072 or 4086): %d\n",
@@ -433,9 +849,9 @@ int main(int argc, char *argv[])
 
     /* Free allocated items */
     wc_FreeDhKey(&key1);
-    wc_FreeDhKey(&key1);
+    wc_FreeDhKey(&key2);
     wc_FreeRng(&rng);
 
-    return 0;
+    return ec;
 }
 
@@ -0,0 +1,434 @@
+/* ecc_verify_batch.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Example of batch ECDSA P-256 verification from a small set of keys,
+ * spread over threads.
+ *
+ * Three ways of verifying are compared:
+ * - cold: the key is imported and, with FP_ECC, the fixed point cache is
+ *   emptied before every verification. This is the baseline without any
+ *   caching.
+ * - reimport: each verification imports the public key from its X9.63
+ *   encoding, as ecc_verify.c does for its single signature. The fixed
+ *   point cache is keyed by point, so it still hits.
+ * - cached: each thread imports every key once at startup and reuses the
+ *   ecc_key for all verifications.
+ * The speedup column is cached against cold, the gain from both caches.
+ *
+ * When wolfSSL is built with FP_ECC, the fixed point cache keeps
+ * precomputed tables for the base point and the recently used public key
+ * points (per thread), and ECC_SHAMIR combines the two multiplications of
+ * a verification. With the SP math implementation the base point table is
+ * built in. The example prints which of these are compiled in.
+ */
+/*
+./configure --enable-ecc --enable-fpecc && make && sudo make install
+gcc -o ecc_verify_batch ecc_verify_batch.c -lwolfssl -lpthread
+*/
+
+#ifndef WOLFSSL_USER_SETTINGS
+    #include <wolfssl/options.h>
+#endif
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define ECC_CURVE_SZ 32 /* SECP256R1 curve size in bytes */
+#define ECC_CURVE_ID ECC_SECP256R1
+
+#define DEF_KEYS        4
+#define DEF_SIGS        64      /* signatures per key */
+#define DEF_VERIFIES    20000   /* verifications per run */
+#define MAX_KEYS        64
+#define MAX_THREADS     64
+#define PUB_SZ          (1 + 2 * ECC_CURVE_SZ)
+/* verifications between checks for a failure in another thread */
+#define FAIL_CHECK      64
+
+/* verification modes */
+#define MODE_COLD       0
+#define MODE_REIMPORT   1
+#define MODE_CACHED     2
+
+#if defined(HAVE_ECC) && defined(HAVE_ECC_VERIFY) && defined(HAVE_ECC_SIGN) \
+    && !defined(NO_SHA256)
+
+typedef struct SignedMsg {
+    int     keyIdx;
+    byte    hash[WC_SHA256_DIGEST_SIZE];
+    byte    sig[ECC_MAX_SIG_SIZE];
+    word32  sigSz;
+} SignedMsg;
+
+typedef struct Batch {
+    int         numKeys;
+    byte        pub[MAX_KEYS][PUB_SZ];   /* X9.63 uncompressed public keys */
+    word32      pubSz[MAX_KEYS];
+    SignedMsg*  msgs;
+    int         numMsgs;
+    int         mode;                    /* MODE_COLD, _REIMPORT, _CACHED */
+    int         verifies;                /* per thread */
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             ready;               /* threads done with setup */
+    int             go;
+    int             failed;
+} Batch;
+
+typedef struct Worker {
+    Batch*      batch;
+    int         id;
+    pthread_t   tid;
+} Worker;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int import_key(ecc_key* key, const byte* pub, word32 pubSz)
+{
+    int ret;
+
+    ret = wc_ecc_init(key);
+    if (ret == 0) {
+        ret = wc_ecc_import_x963_ex(pub, pubSz, key, ECC_CURVE_ID);
+        if (ret != 0)
+            wc_ecc_free(key);
+    }
+    return ret;
+}
+
+static int verify_msg(ecc_key* key, const SignedMsg* m)
+{
+    int ret, res = 0;
+
+    ret = wc_ecc_verify_hash(m->sig, m->sigSz, m->hash, sizeof(m->hash), &res,
+                             key);
+    if (ret == 0 && res != 1)
+        ret = SIG_VERIFY_E;
+    return ret;
+}
+
+static int batch_failed(Batch* b)
+{
+    int failed;
+
+    pthread_mutex_lock(&b->lock);
+    failed = b->failed;
+    pthread_mutex_unlock(&b->lock);
+    return failed;
+}
+
+static void* verify_thread(void* arg)
+{
+    Worker* w = (Worker*)arg;
+    Batch* b = w->batch;
+    ecc_key* keys = NULL;
+    ecc_key key;
+    int ret = 0, i, n, imported = 0;
+    const SignedMsg* m;
+
+    /* cached mode: import every key once, before the timed run */
+    if (b->mode == MODE_CACHED) {
+        keys = (ecc_key*)malloc(sizeof(ecc_key) * b->numKeys);
+        if (keys == NULL)
+            ret = MEMORY_E;
+        for (n = 0; n < b->numKeys && ret == 0; n++) {
+            ret = import_key(&keys[n], b->pub[n], b->pubSz[n]);
+            if (ret == 0)
+                imported++;
+        }
+    }
+
+    pthread_mutex_lock(&b->lock);
+    if (ret != 0)
+        b->failed = ret;
+    b->ready++;
+    pthread_cond_broadcast(&b->cond);
+    while (!b->go)
+        pthread_cond_wait(&b->cond, &b->lock);
+    pthread_mutex_unlock(&b->lock);
+
+    for (i = 0; i < b->verifies && ret == 0; i++) {
+        if ((i % FAIL_CHECK) == 0 && batch_failed(b))
+            break;
+        m = &b->msgs[(w->id * 7919 + i) % b->numMsgs];
+        if (b->mode == MODE_CACHED) {
+            ret = verify_msg(&keys[m->keyIdx], m);
+        }
+        else {
+        #ifdef FP_ECC
+            if (b->mode == MODE_COLD)
+                wc_ecc_fp_free();
+        #endif
+            ret = import_key(&key, b->pub[m->keyIdx], b->pubSz[m->keyIdx]);
+            if (ret == 0) {
+                ret = verify_msg(&key, m);
+                wc_ecc_free(&key);
+            }
+        }
+    }
+    if (ret != 0) {
+        printf("Verify failed %d: %s\n", ret, wc_GetErrorString(ret));
+        pthread_mutex_lock(&b->lock);
+        b->failed = ret;
+        pthread_mutex_unlock(&b->lock);
+    }
+
+    if (keys != NULL) {
+        for (n = 0; n < imported; n++)
+            wc_ecc_free(&keys[n]);
+        free(keys);
+    }
+#ifdef FP_ECC
+    wc_ecc_fp_free();   /* the fixed point cache is per thread */
+#endif
+
+    return NULL;
+}
+
+/* run the batch on numThreads threads, returns verifications per second */
+static double run_batch(Batch* b, int numThreads, int totalVerifies)
+{
+    Worker workers[MAX_THREADS];
+    int i, started = 0;
+    double start, elapsed;
+
+    b->verifies = (totalVerifies + numThreads - 1) / numThreads;
+    b->ready = 0;
+    b->go = 0;
+    b->failed = 0;
+
+    for (i = 0; i < numThreads; i++) {
+        workers[i].batch = b;
+        workers[i].id = i;
+        if (pthread_create(&workers[i].tid, NULL, verify_thread,
+                           &workers[i]) != 0)
+            break;
+        started++;
+    }
+
+    /* start timing once all threads have done their setup */
+    pthread_mutex_lock(&b->lock);
+    while (b->ready < started)
+        pthread_cond_wait(&b->cond, &b->lock);
+    if (started < numThreads)
+        b->failed = -1;
+    start = current_time();
+    b->go = 1;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i].tid, NULL);
+    elapsed = current_time() - start;
+
+    if (b->failed)
+        return -1;
+    return (double)b->verifies * numThreads / elapsed;
+}
+
+/* create the keys and a pool of signed messages */
+static int make_batch(Batch* b, int numKeys, int sigsPerKey)
+{
+    int ret = 0, k, i, n = 0;
+    WC_RNG rng;
+    ecc_key key;
+    byte msg[64];
+
+    b->numKeys = numKeys;
+    b->numMsgs = numKeys * sigsPerKey;
+    b->msgs = (SignedMsg*)malloc(sizeof(SignedMsg) * b->numMsgs);
+    if (b->msgs == NULL)
+        return MEMORY_E;
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0)
+        return ret;
+
+    for (k = 0; k < numKeys && ret == 0; k++) {
+        ret = wc_ecc_init(&key);
+        if (ret != 0)
+            break;
+        ret = wc_ecc_make_key_ex(&rng, ECC_CURVE_SZ, &key, ECC_CURVE_ID);
+        if (ret == 0) {
+            b->pubSz[k] = PUB_SZ;
+            ret = wc_ecc_export_x963(&key, b->pub[k], &b->pubSz[k]);
+        }
+        for (i = 0; i < sigsPerKey && ret == 0; i++, n++) {
+            SignedMsg* m = &b->msgs[n];
+
+            ret = wc_RNG_GenerateBlock(&rng, msg, sizeof(msg));
+            if (ret == 0)
+                ret = wc_Sha256Hash(msg, sizeof(msg), m->hash);
+            if (ret == 0) {
+                m->keyIdx = k;
+                m->sigSz = sizeof(m->sig);
+                ret = wc_ecc_sign_hash(m->hash, sizeof(m->hash), m->sig,
+                                       &m->sigSz, &rng, &key);
+            }
+        }
+        wc_ecc_free(&key);
+    }
+
+    wc_FreeRng(&rng);
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("ecc_verify_batch [options]\n");
+    printf("-k <num>    Number of P-256 keys, default %d\n", DEF_KEYS);
+    printf("-s <num>    Signatures per key, default %d\n", DEF_SIGS);
+    printf("-n <num>    Verifications per run, default %d\n", DEF_VERIFIES);
+    printf("-t <num>    Maximum threads, default online CPUs\n");
+}
+#endif
+
+int main(int argc, char** argv)
+{
+#if defined(HAVE_ECC) && defined(HAVE_ECC_VERIFY) && defined(HAVE_ECC_SIGN) \
+    && !defined(NO_SHA256)
+    int ret, ch, t;
+    int numKeys = DEF_KEYS, sigsPerKey = DEF_SIGS;
+    int totalVerifies = DEF_VERIFIES;
+    int maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double cold, reimport, cached;
+    Batch batch;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?k:s:n:t:")) != -1) {
+        switch (ch) {
+            case 'k':
+                numKeys = atoi(optarg);
+                break;
+            case 's':
+                sigsPerKey = atoi(optarg);
+                break;
+            case 'n':
+                totalVerifies = atoi(optarg);
+                break;
+            case 't':
+                maxThreads = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (maxThreads > MAX_THREADS)
+        maxThreads = MAX_THREADS;
+    if (numKeys <= 0 || numKeys > MAX_KEYS || sigsPerKey <= 0 ||
+            totalVerifies <= 0 || maxThreads <= 0) {
+        Usage();
+        return -1;
+    }
+
+    wolfCrypt_Init();
+
+    memset(&batch, 0, sizeof(batch));
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.cond, NULL);
+
+    ret = make_batch(&batch, numKeys, sigsPerKey);
+    if (ret != 0) {
+        printf("Failure %d: %s\n", ret, wc_GetErrorString(ret));
+        free(batch.msgs);
+        return -1;
+    }
+
+    printf("Build: SP ECC %s, FP_ECC %s, ECC_SHAMIR %s\n",
+    #ifdef WOLFSSL_HAVE_SP_ECC
+           "yes",
+    #else
+           "no",
+    #endif
+    #ifdef FP_ECC
+           "yes",
+    #else
+           "no",
+    #endif
+    #ifdef ECC_SHAMIR
+           "yes"
+    #else
+           "no"
+    #endif
+          );
+    printf("%d P-256 keys, %d signatures, %d verifications per run\n\n",
+           numKeys, batch.numMsgs, totalVerifies);
+#ifndef FP_ECC
+    printf("No fixed point cache, cold is the same as reimport\n");
+#endif
+    printf("%8s %14s %14s %14s %14s %8s\n", "threads", "cold/s",
+           "reimport/s", "cached/s", "cached/s/core", "speedup");
+
+    for (t = 1; ret == 0; t *= 2) {
+        if (t > maxThreads)
+            t = maxThreads;
+
+        batch.mode = MODE_COLD;
+        cold = run_batch(&batch, t, totalVerifies);
+        batch.mode = MODE_REIMPORT;
+        reimport = run_batch(&batch, t, totalVerifies);
+        batch.mode = MODE_CACHED;
+        cached = run_batch(&batch, t, totalVerifies);
+        if (cold < 0 || reimport < 0 || cached < 0) {
+            ret = -1;
+            break;
+        }
+        printf("%8d %14.0f %14.0f %14.0f %14.0f %7.2fx\n", t, cold,
+               reimport, cached, cached / t, cached / cold);
+
+        if (t == maxThreads)
+            break;
+    }
+
+    pthread_mutex_destroy(&batch.lock);
+    pthread_cond_destroy(&batch.cond);
+    free(batch.msgs);
+    wolfCrypt_Cleanup();
+
+    return ret;
+#else
+    printf("wolfSSL requires ECC sign/verify and SHA256\n");
+    return -1;
+#endif
+}
@@ -0,0 +1,598 @@
+/* ecdh_keypool.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Pool of pre-generated ephemeral X25519 / P-256 key pairs.
+ *
+ * A low priority refill thread keeps up to K key pairs generated. Each
+ * exchange pops a ready key pair without taking a lock, uses it once for the
+ * shared secret and hands it back to be regenerated. When the pool is empty
+ * the key pair is generated on demand, as ecdh_gen_secret.c does.
+ *
+ * The benchmark handles a stream of requests, one every -i microseconds,
+ * and reports the latency of key pair + shared secret with and without the
+ * pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/curve25519.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+#define ECC_256_BIT_FIELD 32 // 256-bit curve field
+
+#define DEF_POOL_SIZE   64
+#define DEF_REQUESTS    2000
+#define DEF_INTERVAL_US 1000
+#define NUM_PEERS       16
+/* refill thread poll interval when no key pair needs regenerating */
+#define REFILL_IDLE_US  200
+
+#if defined(HAVE_ECC) || defined(HAVE_CURVE25519)
+
+enum {
+    POOL_X25519,
+    POOL_P256
+};
+
+typedef struct PoolKey {
+    int type;
+    union {
+    #ifdef HAVE_CURVE25519
+        curve25519_key x25519;
+    #endif
+    #ifdef HAVE_ECC
+        ecc_key        ecc;
+    #endif
+    } k;
+} PoolKey;
+
+/* Bounded multi-producer multi-consumer queue of key pointers. Each cell
+ * carries a sequence number telling whether it is ready to be written
+ * (seq == pos) or read (seq == pos + 1) for a given position, so push and
+ * pop only need a compare-and-swap on the position. */
+typedef struct QueueCell {
+    atomic_size_t seq;
+    PoolKey*      key;
+} QueueCell;
+
+typedef struct KeyQueue {
+    QueueCell*    cells;
+    size_t        mask;
+    atomic_size_t enqPos;
+    atomic_size_t deqPos;
+} KeyQueue;
+
+typedef struct KeyPool {
+    int          type;
+    int          size;
+    PoolKey*     keys;
+    KeyQueue     ready;     /* generated, waiting to be used */
+    KeyQueue     used;      /* handed back, waiting to be regenerated */
+    atomic_int   readyCnt;
+    atomic_int   stop;
+    atomic_int   refillErr;
+    pthread_t    tid;
+} KeyPool;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static void sleep_until(double t)
+{
+    struct timespec ts;
+    double now = current_time();
+
+    if (t <= now)
+        return;
+    t -= now;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1000000000.0);
+    nanosleep(&ts, NULL);
+}
+
+static const char* pool_type_name(int type)
+{
+    return type == POOL_X25519 ? "X25519" : "P-256";
+}
+
+static int queue_init(KeyQueue* q, int minSize)
+{
+    size_t i, n = 1;
+
+    while (n < (size_t)minSize)
+        n <<= 1;
+    q->cells = malloc(n * sizeof(QueueCell));
+    if (q->cells == NULL)
+        return MEMORY_E;
+    for (i = 0; i < n; i++) {
+        atomic_init(&q->cells[i].seq, i);
+        q->cells[i].key = NULL;
+    }
+    q->mask = n - 1;
+    atomic_init(&q->enqPos, 0);
+    atomic_init(&q->deqPos, 0);
+
+    return 0;
+}
+
+/* returns 0 when the queue is full */
+static int queue_push(KeyQueue* q, PoolKey* key)
+{
+    QueueCell* cell;
+    size_t pos = atomic_load_explicit(&q->enqPos, memory_order_relaxed);
+
+    for (;;) {
+        size_t seq;
+        intptr_t diff;
+
+        cell = &q->cells[pos & q->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->enqPos, &pos,
+                    pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+            return 0;
+        }
+        else {
+            pos = atomic_load_explicit(&q->enqPos, memory_order_relaxed);
+        }
+    }
+    cell->key = key;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    return 1;
+}
+
+/* returns NULL when the queue is empty */
+static PoolKey* queue_pop(KeyQueue* q)
+{
+    QueueCell* cell;
+    PoolKey* key;
+    size_t pos = atomic_load_explicit(&q->deqPos, memory_order_relaxed);
+
+    for (;;) {
+        size_t seq;
+        intptr_t diff;
+
+        cell = &q->cells[pos & q->mask];
+        seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->deqPos, &pos,
+                    pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0) {
+            return NULL;
+        }
+        else {
+            pos = atomic_load_explicit(&q->deqPos, memory_order_relaxed);
+        }
+    }
+    key = cell->key;
+    atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release);
+
+    return key;
+}
+
+static int poolkey_make(PoolKey* pk, int type, WC_RNG* rng)
+{
+    int ret = -1;
+
+    pk->type = type;
+#ifdef HAVE_CURVE25519
+    if (type == POOL_X25519) {
+        ret = wc_curve25519_init(&pk->k.x25519);
+        if (ret == 0)
+            ret = wc_curve25519_make_key(rng, CURVE25519_KEYSIZE,
+                &pk->k.x25519);
+    }
+#endif
+#ifdef HAVE_ECC
+    if (type == POOL_P256) {
+        ret = wc_ecc_init(&pk->k.ecc);
+        if (ret == 0)
+            ret = wc_ecc_make_key(rng, ECC_256_BIT_FIELD, &pk->k.ecc);
+    }
+#endif
+
+    return ret;
+}
+
+static void poolkey_free(PoolKey* pk)
+{
+#ifdef HAVE_CURVE25519
+    if (pk->type == POOL_X25519)
+        wc_curve25519_free(&pk->k.x25519);
+#endif
+#ifdef HAVE_ECC
+    if (pk->type == POOL_P256)
+        wc_ecc_free(&pk->k.ecc);
+#endif
+}
+
+/* rng is the calling thread's, used for blinding of the private key */
+static int poolkey_secret(PoolKey* priv, PoolKey* peer, byte* out,
+    word32* outSz, WC_RNG* rng)
+{
+    int ret = -1;
+
+#ifdef HAVE_CURVE25519
+    if (priv->type == POOL_X25519)
+        ret = wc_curve25519_shared_secret(&priv->k.x25519, &peer->k.x25519,
+            out, outSz);
+#endif
+#ifdef HAVE_ECC
+    if (priv->type == POOL_P256) {
+    #if defined(ECC_TIMING_RESISTANT) && !defined(HAVE_FIPS)
+        ret = wc_ecc_set_rng(&priv->k.ecc, rng);
+        if (ret != 0)
+            return ret;
+    #endif
+        ret = wc_ecc_shared_secret(&priv->k.ecc, &peer->k.ecc, out, outSz);
+    }
+#endif
+    (void)rng;
+
+    return ret;
+}
+
+static void* refill_thread(void* arg)
+{
+    KeyPool* pool = (KeyPool*)arg;
+    PoolKey* pk;
+    WC_RNG rng;
+    int ret;
+#ifdef SCHED_IDLE
+    struct sched_param param;
+
+    /* only run when a CPU would otherwise be idle */
+    memset(&param, 0, sizeof(param));
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        atomic_store(&pool->refillErr, ret);
+        return NULL;
+    }
+
+    while (!atomic_load(&pool->stop)) {
+        pk = queue_pop(&pool->used);
+        if (pk == NULL) {
+            struct timespec ts = { 0, REFILL_IDLE_US * 1000 };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        /* a key pair is only ever used for one exchange */
+        poolkey_free(pk);
+        ret = poolkey_make(pk, pool->type, &rng);
+        if (ret != 0) {
+            atomic_store(&pool->refillErr, ret);
+            break;
+        }
+        queue_push(&pool->ready, pk);
+        atomic_fetch_add(&pool->readyCnt, 1);
+    }
+
+    wc_FreeRng(&rng);
+    return NULL;
+}
+
+static int pool_start(KeyPool* pool, int type, int size)
+{
+    int i;
+    int ret;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->type = type;
+    pool->size = size;
+    atomic_init(&pool->readyCnt, 0);
+    atomic_init(&pool->stop, 0);
+    atomic_init(&pool->refillErr, 0);
+
+    pool->keys = calloc(size, sizeof(PoolKey));
+    if (pool->keys == NULL)
+        return MEMORY_E;
+    ret = queue_init(&pool->ready, size);
+    if (ret == 0)
+        ret = queue_init(&pool->used, size);
+    if (ret != 0)
+        return ret;
+
+    /* every slot starts out used, the refill thread generates them all */
+    for (i = 0; i < size; i++) {
+        pool->keys[i].type = -1;
+        queue_push(&pool->used, &pool->keys[i]);
+    }
+
+    if (pthread_create(&pool->tid, NULL, refill_thread, pool) != 0) {
+        printf("pthread_create failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void pool_stop(KeyPool* pool)
+{
+    int i;
+
+    atomic_store(&pool->stop, 1);
+    pthread_join(pool->tid, NULL);
+
+    for (i = 0; i < pool->size; i++)
+        poolkey_free(&pool->keys[i]);
+    free(pool->ready.cells);
+    free(pool->used.cells);
+    free(pool->keys);
+}
+
+/* take a ready key pair, NULL when the pool is empty */
+static PoolKey* pool_get(KeyPool* pool)
+{
+    PoolKey* pk = queue_pop(&pool->ready);
+
+    if (pk != NULL)
+        atomic_fetch_sub(&pool->readyCnt, 1);
+    return pk;
+}
+
+static void pool_put(KeyPool* pool, PoolKey* pk)
+{
+    queue_push(&pool->used, pk);
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_result(int type, const char* mode, double* lat, int n,
+    long misses)
+{
+    qsort(lat, n, sizeof(double), cmp_double);
+    printf("%-8s %-10s %9.1f %9.1f %9.1f %9.1f %8ld\n", pool_type_name(type),
+        mode, lat[n / 2], lat[(int)(n * 0.90)], lat[(int)(n * 0.99)],
+        lat[n - 1], misses);
+}
+
+/* handle numReq requests, one every intervalUs, each deriving a shared
+ * secret with an ephemeral key pair from the pool (or generated on demand
+ * when pool is NULL) against one of the peer public keys */
+static int run_requests(int type, KeyPool* pool, PoolKey* peers,
+    int numReq, int intervalUs, double* lat, long* misses, WC_RNG* rng)
+{
+    int ret = 0;
+    int i;
+    double next, start;
+    PoolKey local;
+    byte secret[ECC_256_BIT_FIELD];
+    word32 secretSz;
+
+    *misses = 0;
+    next = current_time();
+    for (i = 0; i < numReq; i++) {
+        PoolKey* pk = NULL;
+
+        next += intervalUs / 1000000.0;
+        sleep_until(next);
+
+        start = current_time();
+        if (pool != NULL)
+            pk = pool_get(pool);
+        if (pk == NULL) {
+            if (pool != NULL)
+                (*misses)++;
+            pk = &local;
+            ret = poolkey_make(pk, type, rng);
+        }
+        if (ret == 0) {
+            secretSz = sizeof(secret);
+            ret = poolkey_secret(pk, &peers[i % NUM_PEERS], secret,
+                &secretSz, rng);
+        }
+        lat[i] = (current_time() - start) * 1000000.0;
+
+        if (pk == &local)
+            poolkey_free(pk);
+        else
+            pool_put(pool, pk);
+        if (ret != 0) {
+            printf("%s key exchange failed! %d\n", pool_type_name(type), ret);
+            break;
+        }
+    }
+
+    return ret;
+}
+
+static int bench_curve(int type, int poolSize, int numReq, int intervalUs)
+{
+    int ret = 0;
+    int i;
+    int peersMade = 0;
+    long misses;
+    double* lat = NULL;
+    PoolKey peers[NUM_PEERS];
+    KeyPool pool;
+    WC_RNG rng;
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0)
+        return ret;
+
+    lat = malloc(numReq * sizeof(double));
+    if (lat == NULL) {
+        ret = MEMORY_E;
+        goto exit;
+    }
+
+    for (i = 0; i < NUM_PEERS && ret == 0; i++) {
+        ret = poolkey_make(&peers[i], type, &rng);
+        if (ret == 0)
+            peersMade++;
+    }
+    if (ret != 0) {
+        printf("%s make key failed! %d\n", pool_type_name(type), ret);
+        goto exit;
+    }
+
+    /* key pair generated inside every request */
+    ret = run_requests(type, NULL, peers, numReq, intervalUs, lat, &misses,
+        &rng);
+    if (ret != 0)
+        goto exit;
+    print_result(type, "on-demand", lat, numReq, 0);
+
+    /* key pairs from the pool, wait for it to fill before starting */
+    ret = pool_start(&pool, type, poolSize);
+    if (ret != 0)
+        goto exit;
+    while (atomic_load(&pool.readyCnt) < poolSize &&
+            atomic_load(&pool.refillErr) == 0) {
+        struct timespec ts = { 0, 1000000 };
+        nanosleep(&ts, NULL);
+    }
+    ret = atomic_load(&pool.refillErr);
+    if (ret == 0) {
+        ret = run_requests(type, &pool, peers, numReq, intervalUs, lat,
+            &misses, &rng);
+    }
+    else {
+        printf("%s pool refill failed! %d\n", pool_type_name(type), ret);
+    }
+    pool_stop(&pool);
+    if (ret == 0)
+        print_result(type, "pool", lat, numReq, misses);
+
+exit:
+    for (i = 0; i < peersMade; i++)
+        poolkey_free(&peers[i]);
+    free(lat);
+    wc_FreeRng(&rng);
+
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("ecdh_keypool\n");
+    printf("-?          Help, print this usage\n");
+    printf("-c <curve>  x25519, p256 or all (default all)\n");
+    printf("-k <num>    Key pairs kept in the pool (default %d)\n",
+        DEF_POOL_SIZE);
+    printf("-n <num>    Requests per run (default %d)\n", DEF_REQUESTS);
+    printf("-i <us>     Interval between requests, 0 for back to back "
+           "(default %d)\n", DEF_INTERVAL_US);
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int ch;
+    int doX25519 = 1, doP256 = 1;
+    int poolSize = DEF_POOL_SIZE;
+    int numReq = DEF_REQUESTS;
+    int intervalUs = DEF_INTERVAL_US;
+
+    while ((ch = getopt(argc, argv, "?c:k:n:i:")) != -1) {
+        switch (ch) {
+            case 'c':
+                doX25519 = strcmp(optarg, "p256") != 0;
+                doP256 = strcmp(optarg, "x25519") != 0;
+                break;
+            case 'k':
+                poolSize = atoi(optarg);
+                break;
+            case 'n':
+                numReq = atoi(optarg);
+                break;
+            case 'i':
+                intervalUs = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 1;
+        }
+    }
+    if (poolSize <= 0 || numReq <= 0 || intervalUs < 0) {
+        Usage();
+        return 1;
+    }
+
+    printf("Pool %d key pairs, %d requests, one every %d us\n\n", poolSize,
+        numReq, intervalUs);
+    printf("%-8s %-10s %9s %9s %9s %9s %8s\n", "Curve", "Mode", "p50 us",
+        "p90 us", "p99 us", "max us", "misses");
+    printf("-------------------------------------------------------------"
+           "-------\n");
+
+#ifdef HAVE_CURVE25519
+    if (doX25519)
+        ret = bench_curve(POOL_X25519, poolSize, numReq, intervalUs);
+#else
+    if (doX25519)
+        printf("Configure wolfssl with --enable-curve25519 for X25519\n");
+#endif
+#ifdef HAVE_ECC
+    if (ret == 0 && doP256)
+        ret = bench_curve(POOL_P256, poolSize, numReq, intervalUs);
+#else
+    if (doP256)
+        printf("Configure wolfSSL with --enable-ecc for P-256\n");
+#endif
+
+    return ret == 0 ? 0 : 1;
+}
+
+#else
+
+int main(void)
+{
+    printf("Configure wolfSSL with --enable-curve25519 or --enable-ecc\n");
+    return 1;
+}
+
+#endif /* HAVE_ECC || HAVE_CURVE25519 */
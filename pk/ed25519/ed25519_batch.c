@@ -0,0 +1,651 @@
+/* ed25519_batch.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Example to demonstrate batch Ed25519 / Ed448 sign and verify of a message
+ * stream with the key loaded once, over one or more threads */
+/*
+./configure --enable-ed25519 --enable-ed448 && make && sudo make install
+gcc -o ed25519_batch ed25519_batch.c -lwolfssl -lpthread
+*/
+
+#ifndef WOLFSSL_USER_SETTINGS
+    #include <wolfssl/options.h>
+#endif
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/ed25519.h>
+#include <wolfssl/wolfcrypt/ed448.h>
+#include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if defined(HAVE_ED25519) && defined(HAVE_ED25519_SIGN) && \
+    defined(HAVE_ED25519_VERIFY)
+    #define BATCH_ED25519
+#endif
+#if defined(HAVE_ED448) && defined(HAVE_ED448_SIGN) && \
+    defined(HAVE_ED448_VERIFY)
+    #define BATCH_ED448
+#endif
+
+#if defined(BATCH_ED25519) || defined(BATCH_ED448)
+
+#define DEF_NUM_MSGS    10000
+#define DEF_MSG_SZ      256
+#define DEF_LARGE_SZ    (64 * 1024)
+#define MAX_THREADS     64
+#define MAX_DER_SZ      256
+/* distinct messages held in memory, the stream is reused beyond this */
+#define MAX_POOL_BYTES  (16 * 1024 * 1024)
+
+#ifdef BATCH_ED25519
+/* Test Vector from ed25519_sign.c, used when no key file is given */
+static const uint8_t kEd25519PrivKey[] = {
+    0x88, 0x0d, 0xaa, 0xde, 0x32, 0xaa, 0x93, 0x32,
+    0x79, 0xe2, 0x4e, 0x45, 0xa9, 0x1f, 0x26, 0xd0,
+    0x9b, 0x69, 0xdd, 0x08, 0x33, 0xc7, 0x14, 0xc1,
+    0x57, 0x7f, 0x20, 0xbe, 0x67, 0x4f, 0xb9, 0xeb,
+};
+static const uint8_t kEd25519PubKey[] = {
+    0x37, 0x3e, 0xd5, 0x8d, 0x22, 0x1a, 0x05, 0x81,
+    0xbf, 0x24, 0x6e, 0xdc, 0x5a, 0x42, 0x08, 0x83,
+    0xff, 0xac, 0xfb, 0x28, 0xd0, 0x83, 0xb8, 0x2d,
+    0x1c, 0xb7, 0x04, 0xaf, 0xa8, 0x41, 0x79, 0x23
+};
+#endif
+#ifdef BATCH_ED448
+/* Test Vector from ed448_sign.c */
+static const uint8_t kEd448PrivKey[] = {
+    0x5C, 0xEF, 0xDE, 0xFE, 0x14, 0xBD, 0xB4, 0x82,
+    0x14, 0x15, 0x35, 0x9C, 0xD0, 0xE8, 0x0E, 0x07,
+    0xFD, 0xFE, 0x24, 0xEC, 0xDF, 0x59, 0x28, 0x97,
+    0x0A, 0xE7, 0xE1, 0xD6, 0xD5, 0x38, 0x15, 0xE7,
+    0xA3, 0xFB, 0x56, 0x79, 0xE5, 0x17, 0x6F, 0x47,
+    0xE8, 0x87, 0x6C, 0x8F, 0x32, 0xF0, 0x3F, 0x70,
+    0xF5, 0x3F, 0xEB, 0x92, 0x2C, 0x4B, 0xFD, 0xBE,
+    0x07
+};
+static const uint8_t kEd448PubKey[] = {
+    0x56, 0xBC, 0x28, 0x00, 0x16, 0x93, 0x41, 0xDB,
+    0xBB, 0xAE, 0x4F, 0x95, 0x61, 0x90, 0x6E, 0x10,
+    0xE7, 0xD6, 0x12, 0xC5, 0x4E, 0xA1, 0x7D, 0xDA,
+    0xA0, 0xDD, 0xD3, 0x00, 0x8F, 0x28, 0xA3, 0x05,
+    0x9D, 0xDB, 0xC2, 0x0E, 0x39, 0x0F, 0x6E, 0x31,
+    0x1A, 0x16, 0xE5, 0xC6, 0x5F, 0x69, 0x30, 0x9D,
+    0xC4, 0x03, 0xB7, 0x43, 0x37, 0x03, 0x50, 0xAD,
+    0x00
+};
+#endif
+
+/* The message pool: the stream is read into msgCount records of msgSz
+ * bytes and message i of the run is record i % msgCount */
+typedef struct MsgPool {
+    byte*  data;
+    word32 msgSz;
+    int    msgCount;
+} MsgPool;
+
+/* Each worker imports the key bytes into its own key struct once, then
+ * signs or verifies its share of the stream */
+typedef struct Worker {
+    pthread_t   tid;
+    const struct SigAlg* alg;
+    const byte* priv;
+    const byte* pub;
+    int         ph;         /* pre-hash mode */
+    int         verify;     /* 0 = sign phase, 1 = verify phase */
+    const MsgPool* pool;
+    int         first;      /* first message index of this worker */
+    int         count;
+    byte*       sigs;       /* alg->sigSz bytes per message */
+    double*     lat;        /* per operation latency in microseconds */
+    int         ret;
+    union {
+    #ifdef BATCH_ED25519
+        ed25519_key ed25519;
+    #endif
+    #ifdef BATCH_ED448
+        ed448_key   ed448;
+    #endif
+    } key;
+} Worker;
+
+typedef struct SigAlg {
+    const char* name;
+    const char* phName;
+    word32      sigSz;
+    int  (*keyLoad)(Worker* w);
+    void (*keyFree)(Worker* w);
+    int  (*sign)(Worker* w, const byte* msg, word32 msgSz, byte* sig,
+                 word32* sigSz);
+    int  (*verify)(Worker* w, const byte* sig, word32 sigSz, const byte* msg,
+                   word32 msgSz, int* res);
+} SigAlg;
+
+#ifdef BATCH_ED25519
+static int ed25519_load(Worker* w)
+{
+    int ret = wc_ed25519_init(&w->key.ed25519);
+    if (ret == 0) {
+        ret = wc_ed25519_import_private_key(w->priv, ED25519_KEY_SIZE,
+            w->pub, ED25519_PUB_KEY_SIZE, &w->key.ed25519);
+    }
+    return ret;
+}
+
+static void ed25519_unload(Worker* w)
+{
+    wc_ed25519_free(&w->key.ed25519);
+}
+
+static int ed25519_batch_sign(Worker* w, const byte* msg, word32 msgSz,
+    byte* sig, word32* sigSz)
+{
+    if (w->ph)
+        return wc_ed25519ph_sign_msg(msg, msgSz, sig, sigSz, &w->key.ed25519,
+            NULL, 0);
+    return wc_ed25519_sign_msg(msg, msgSz, sig, sigSz, &w->key.ed25519);
+}
+
+static int ed25519_batch_verify(Worker* w, const byte* sig, word32 sigSz,
+    const byte* msg, word32 msgSz, int* res)
+{
+    if (w->ph)
+        return wc_ed25519ph_verify_msg(sig, sigSz, msg, msgSz, res,
+            &w->key.ed25519, NULL, 0);
+    return wc_ed25519_verify_msg(sig, sigSz, msg, msgSz, res,
+        &w->key.ed25519);
+}
+
+static const SigAlg algEd25519 = {
+    "Ed25519", "Ed25519ph", ED25519_SIG_SIZE, ed25519_load, ed25519_unload,
+    ed25519_batch_sign, ed25519_batch_verify
+};
+#endif /* BATCH_ED25519 */
+
+#ifdef BATCH_ED448
+static int ed448_load(Worker* w)
+{
+    int ret = wc_ed448_init(&w->key.ed448);
+    if (ret == 0) {
+        ret = wc_ed448_import_private_key(w->priv, ED448_KEY_SIZE,
+            w->pub, ED448_PUB_KEY_SIZE, &w->key.ed448);
+    }
+    return ret;
+}
+
+static void ed448_unload(Worker* w)
+{
+    wc_ed448_free(&w->key.ed448);
+}
+
+static int ed448_batch_sign(Worker* w, const byte* msg, word32 msgSz,
+    byte* sig, word32* sigSz)
+{
+    if (w->ph)
+        return wc_ed448ph_sign_msg(msg, msgSz, sig, sigSz, &w->key.ed448,
+            NULL, 0);
+    return wc_ed448_sign_msg(msg, msgSz, sig, sigSz, &w->key.ed448, NULL, 0);
+}
+
+static int ed448_batch_verify(Worker* w, const byte* sig, word32 sigSz,
+    const byte* msg, word32 msgSz, int* res)
+{
+    if (w->ph)
+        return wc_ed448ph_verify_msg(sig, sigSz, msg, msgSz, res,
+            &w->key.ed448, NULL, 0);
+    return wc_ed448_verify_msg(sig, sigSz, msg, msgSz, res, &w->key.ed448,
+        NULL, 0);
+}
+
+static const SigAlg algEd448 = {
+    "Ed448", "Ed448ph", ED448_SIG_SIZE, ed448_load, ed448_unload,
+    ed448_batch_sign, ed448_batch_verify
+};
+#endif /* BATCH_ED448 */
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static void* worker_thread(void* arg)
+{
+    Worker* w = (Worker*)arg;
+    const SigAlg* alg = w->alg;
+    const MsgPool* pool = w->pool;
+    int i;
+    double start;
+
+    w->ret = alg->keyLoad(w);
+    for (i = 0; w->ret == 0 && i < w->count; i++) {
+        int n = w->first + i;
+        const byte* msg = pool->data + (size_t)(n % pool->msgCount) *
+            pool->msgSz;
+        byte* sig = w->sigs + (size_t)n * alg->sigSz;
+        word32 sigSz = alg->sigSz;
+        int res = 0;
+
+        start = current_time();
+        if (w->verify) {
+            w->ret = alg->verify(w, sig, sigSz, msg, pool->msgSz, &res);
+            if (w->ret == 0 && res != 1)
+                w->ret = SIG_VERIFY_E;
+        }
+        else {
+            w->ret = alg->sign(w, msg, pool->msgSz, sig, &sigSz);
+        }
+        w->lat[n] = (current_time() - start) * 1000000.0;
+    }
+    alg->keyFree(w);
+
+    return NULL;
+}
+
+/* run one phase over numMsgs messages split across numThreads workers,
+ * returns the operations per second or a negative error */
+static double run_phase(Worker* workers, int numThreads, int numMsgs,
+    int verify)
+{
+    int i;
+    int started = 0;
+    int ret = 0;
+    int per = numMsgs / numThreads;
+    double start, elapsed;
+
+    start = current_time();
+    for (i = 0; i < numThreads; i++) {
+        workers[i].verify = verify;
+        workers[i].first = i * per;
+        workers[i].count = (i == numThreads - 1) ? numMsgs - i * per : per;
+        if (pthread_create(&workers[i].tid, NULL, worker_thread,
+                &workers[i]) != 0) {
+            printf("pthread_create failed\n");
+            ret = -1;
+            break;
+        }
+        started++;
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i].tid, NULL);
+        if (workers[i].ret != 0) {
+            printf("%s failed! %d: %s\n", verify ? "Verify" : "Sign",
+                workers[i].ret, wc_GetErrorString(workers[i].ret));
+            ret = workers[i].ret;
+        }
+    }
+    elapsed = current_time() - start;
+
+    if (ret != 0)
+        return -1;
+    return numMsgs / elapsed;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* sorts lat in place */
+static double percentile(double* lat, int n, double pct)
+{
+    int idx = (int)(pct / 100.0 * (n - 1) + 0.5);
+    return lat[idx];
+}
+
+static void print_result(const char* name, word32 msgSz, double ops,
+    double* lat, int n)
+{
+    qsort(lat, n, sizeof(double), cmp_double);
+    printf("%-18s %8u %10.0f %9.1f %9.1f %9.1f %9.1f\n", name, msgSz, ops,
+        percentile(lat, n, 50), percentile(lat, n, 99),
+        percentile(lat, n, 99.9), lat[n - 1]);
+}
+
+/* sign then verify numMsgs messages of the pool with one algorithm and
+ * mode */
+static int bench_alg(const SigAlg* alg, const byte* priv, const byte* pub,
+    int ph, const MsgPool* pool, int numMsgs, int numThreads)
+{
+    int ret = 0;
+    int i;
+    double signOps, verifyOps;
+    Worker* workers;
+    byte* sigs;
+    double* signLat;
+    double* verifyLat;
+    char name[48];
+
+    workers = calloc(numThreads, sizeof(Worker));
+    sigs = malloc((size_t)numMsgs * alg->sigSz);
+    signLat = malloc((size_t)numMsgs * sizeof(double));
+    verifyLat = malloc((size_t)numMsgs * sizeof(double));
+    if (workers == NULL || sigs == NULL || signLat == NULL ||
+            verifyLat == NULL) {
+        printf("Batch malloc failed!\n");
+        ret = MEMORY_E;
+        goto exit;
+    }
+
+    for (i = 0; i < numThreads; i++) {
+        workers[i].alg = alg;
+        workers[i].priv = priv;
+        workers[i].pub = pub;
+        workers[i].ph = ph;
+        workers[i].pool = pool;
+        workers[i].sigs = sigs;
+    }
+
+    for (i = 0; i < numThreads; i++)
+        workers[i].lat = signLat;
+    signOps = run_phase(workers, numThreads, numMsgs, 0);
+    if (signOps < 0) {
+        ret = -1;
+        goto exit;
+    }
+    for (i = 0; i < numThreads; i++)
+        workers[i].lat = verifyLat;
+    verifyOps = run_phase(workers, numThreads, numMsgs, 1);
+    if (verifyOps < 0) {
+        ret = -1;
+        goto exit;
+    }
+
+    snprintf(name, sizeof(name), "%s sign", ph ? alg->phName : alg->name);
+    print_result(name, pool->msgSz, signOps, signLat, numMsgs);
+    snprintf(name, sizeof(name), "%s verify", ph ? alg->phName : alg->name);
+    print_result(name, pool->msgSz, verifyOps, verifyLat, numMsgs);
+
+exit:
+    free(verifyLat);
+    free(signLat);
+    free(sigs);
+    free(workers);
+
+    return ret;
+}
+
+/* fill the pool from the stream, or with random data when there is none.
+ * A short stream is repeated, and once stdin is used up the data already
+ * read (seed) is repeated instead */
+static int load_pool(MsgPool* pool, FILE* stream, const MsgPool* seed,
+    word32 msgSz, int numMsgs, WC_RNG* rng)
+{
+    size_t total;
+    size_t got = 0;
+
+    pool->msgSz = msgSz;
+    pool->msgCount = numMsgs;
+    if ((size_t)pool->msgCount * msgSz > MAX_POOL_BYTES)
+        pool->msgCount = MAX_POOL_BYTES / msgSz;
+    if (pool->msgCount < 1)
+        pool->msgCount = 1;
+    total = (size_t)pool->msgCount * msgSz;
+
+    pool->data = malloc(total);
+    if (pool->data == NULL)
+        return MEMORY_E;
+
+    if (stream == NULL)
+        return wc_RNG_GenerateBlock(rng, pool->data, (word32)total);
+
+    got = fread(pool->data, 1, total, stream);
+    if (got == 0 && seed != NULL && seed->data != NULL) {
+        got = (size_t)seed->msgCount * seed->msgSz;
+        if (got > total)
+            got = total;
+        memcpy(pool->data, seed->data, got);
+    }
+    if (got == 0) {
+        printf("Message stream is empty\n");
+        return BUFFER_E;
+    }
+    while (got < total) {
+        size_t n = (total - got < got) ? total - got : got;
+        memcpy(pool->data + got, pool->data, n);
+        got += n;
+    }
+
+    return 0;
+}
+
+#ifdef BATCH_ED25519
+/* load an Ed25519 private key DER, as written by ed25519_keys */
+static int load_ed25519_der(const char* file, byte* priv, byte* pub)
+{
+    int ret;
+    FILE* f;
+    byte der[MAX_DER_SZ];
+    word32 derSz, idx = 0;
+    word32 privSz = ED25519_KEY_SIZE, pubSz = ED25519_PUB_KEY_SIZE;
+    ed25519_key key;
+
+    f = fopen(file, "rb");
+    if (f == NULL) {
+        printf("error opening %s\n", file);
+        return -1;
+    }
+    derSz = (word32)fread(der, 1, sizeof(der), f);
+    fclose(f);
+
+    ret = wc_ed25519_init(&key);
+    if (ret != 0)
+        return ret;
+    ret = wc_Ed25519PrivateKeyDecode(der, &idx, &key, derSz);
+    if (ret == 0)
+        ret = wc_ed25519_export_private_only(&key, priv, &privSz);
+    if (ret == 0)
+        ret = wc_ed25519_make_public(&key, pub, pubSz);
+    wc_ed25519_free(&key);
+
+    if (ret != 0)
+        printf("error %d loading Ed25519 key from %s\n", ret, file);
+    return ret;
+}
+#endif
+
+static void Usage(void)
+{
+    printf("ed25519_batch\n");
+    printf("-?          Help, print this usage\n");
+    printf("-n <num>    Messages signed and verified per run (default %d)\n",
+        DEF_NUM_MSGS);
+    printf("-m <bytes>  Stream message size (default %d)\n", DEF_MSG_SZ);
+    printf("-L <bytes>  Large message size, 0 to skip (default %d)\n",
+        DEF_LARGE_SZ);
+    printf("-t <num>    Threads (default 1, max %d)\n", MAX_THREADS);
+    printf("-f <file>   Read messages from file, - for stdin "
+           "(default random)\n");
+#ifdef BATCH_ED25519
+    printf("-k <file>   Ed25519 private key DER (default test vector)\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int ch;
+    int numMsgs = DEF_NUM_MSGS;
+    int numThreads = 1;
+    int largeMsgs;
+    word32 msgSz = DEF_MSG_SZ;
+    word32 largeSz = DEF_LARGE_SZ;
+    const char* streamFile = NULL;
+    FILE* stream = NULL;
+    MsgPool pool, largePool;
+    WC_RNG rng;
+#ifdef BATCH_ED25519
+    const char* keyFile = NULL;
+    byte ed25519Priv[ED25519_KEY_SIZE];
+    byte ed25519Pub[ED25519_PUB_KEY_SIZE];
+#endif
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?n:m:L:t:f:k:")) != -1) {
+        switch (ch) {
+            case 'n':
+                numMsgs = atoi(optarg);
+                break;
+            case 'm':
+                msgSz = (word32)atoi(optarg);
+                break;
+            case 'L':
+                largeSz = (word32)atoi(optarg);
+                break;
+            case 't':
+                numThreads = atoi(optarg);
+                break;
+            case 'f':
+                streamFile = optarg;
+                break;
+        #ifdef BATCH_ED25519
+            case 'k':
+                keyFile = optarg;
+                break;
+        #endif
+            case '?':
+            default:
+                Usage();
+                return 1;
+        }
+    }
+    if (numMsgs <= 0 || msgSz == 0 || numThreads <= 0 ||
+            numThreads > MAX_THREADS || numThreads > numMsgs) {
+        Usage();
+        return 1;
+    }
+
+    memset(&pool, 0, sizeof(pool));
+    memset(&largePool, 0, sizeof(largePool));
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        printf("RNG init failed! %d\n", ret);
+        return 1;
+    }
+
+#ifdef BATCH_ED25519
+    memcpy(ed25519Priv, kEd25519PrivKey, sizeof(ed25519Priv));
+    memcpy(ed25519Pub, kEd25519PubKey, sizeof(ed25519Pub));
+    if (keyFile != NULL) {
+        ret = load_ed25519_der(keyFile, ed25519Priv, ed25519Pub);
+        if (ret != 0)
+            goto exit;
+    }
+#endif
+
+    if (streamFile != NULL) {
+        stream = (strcmp(streamFile, "-") == 0) ? stdin :
+            fopen(streamFile, "rb");
+        if (stream == NULL) {
+            printf("error opening %s\n", streamFile);
+            ret = -1;
+            goto exit;
+        }
+    }
+
+    ret = load_pool(&pool, stream, NULL, msgSz, numMsgs, &rng);
+    /* large messages are slower to sign, run a tenth as many */
+    largeMsgs = numMsgs / 10 < numThreads ? numThreads : numMsgs / 10;
+    if (ret == 0 && largeSz > 0) {
+        if (stream != NULL && stream != stdin)
+            rewind(stream);
+        ret = load_pool(&largePool, stream, &pool, largeSz, largeMsgs,
+            &rng);
+    }
+    if (ret != 0) {
+        printf("Loading messages failed! %d\n", ret);
+        goto exit;
+    }
+
+    printf("%d messages of %u bytes", numMsgs, msgSz);
+    if (largeSz > 0)
+        printf(", %d messages of %u bytes", largeMsgs, largeSz);
+    printf(", %d thread%s, %s\n", numThreads, numThreads > 1 ? "s" : "",
+        streamFile ? streamFile : "random messages");
+    printf("\n%-18s %8s %10s %9s %9s %9s %9s\n", "Algorithm", "MsgSz",
+        "ops/s", "p50 us", "p99 us", "p99.9 us", "max us");
+    printf("---------------------------------------------------------------"
+           "--------------\n");
+
+#ifdef BATCH_ED25519
+    ret = bench_alg(&algEd25519, ed25519Priv, ed25519Pub, 0, &pool, numMsgs,
+        numThreads);
+    if (ret == 0 && largeSz > 0) {
+        ret = bench_alg(&algEd25519, ed25519Priv, ed25519Pub, 0, &largePool,
+            largeMsgs, numThreads);
+        if (ret == 0)
+            ret = bench_alg(&algEd25519, ed25519Priv, ed25519Pub, 1,
+                &largePool, largeMsgs, numThreads);
+    }
+    if (ret != 0)
+        goto exit;
+#endif
+#ifdef BATCH_ED448
+    ret = bench_alg(&algEd448, kEd448PrivKey, kEd448PubKey, 0, &pool,
+        numMsgs, numThreads);
+    if (ret == 0 && largeSz > 0) {
+        ret = bench_alg(&algEd448, kEd448PrivKey, kEd448PubKey, 0,
+            &largePool, largeMsgs, numThreads);
+        if (ret == 0)
+            ret = bench_alg(&algEd448, kEd448PrivKey, kEd448PubKey, 1,
+                &largePool, largeMsgs, numThreads);
+    }
+#endif
+
+exit:
+    if (stream != NULL && stream != stdin)
+        fclose(stream);
+    free(largePool.data);
+    free(pool.data);
+    wc_FreeRng(&rng);
+
+    if (ret != 0) {
+        printf("Failure %d\n", ret);
+        ret = 1;
+    }
+    return ret;
+}
+
+#else
+
+int main()
+{
+    printf("wolfSSL requires Ed25519 or Ed448 with sign and verify\n");
+    return 1;
+}
+
+#endif /* BATCH_ED25519 || BATCH_ED448 */
@@ -21,9 +21,19 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <wolfssl/options.h>
 #include <wolfssl/wolfcrypt/rsa.h>
 #include <wolfssl/wolfcrypt/hash.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#ifdef WOLF_CRYPTO_CB
+    #include <wolfssl/wolfcrypt/cryptocb.h>
+#endif
 
 #include "rsa-key.h"
 
@@ -76,6 +86,342 @@ void print_rsa(RsaKey *key)
     print_data("rsa_priv_key", buf, len);
 }
 
+/* Check the key size is supported when wolfSSL is built with SP math only */
+static int check_sp_bits(int bits)
+{
+#ifdef WOLFSSL_SP_MATH
+    if (0) {
+    }
+#ifndef WOLFSSL_SP_NO_2048
+    else if (bits == 2048) {
+    }
+#endif
+#ifndef WOLFSSL_SP_NO_3072
+    else if (bits == 3072) {
+    }
+#endif
+#ifdef WOLFSSL_SP_4096
+    else if (bits == 4096) {
+    }
+#endif
+    else {
+        fprintf(stderr, "Bit size not supported with SP_MATH: %d\n", bits);
+        fprintf(stderr, " wolfSSL compiled to support, in bits:");
+#ifndef WOLFSSL_SP_NO_2048
+        fprintf(stderr, " 2048");
+#endif
+#ifndef WOLFSSL_SP_NO_3072
+        fprintf(stderr, " 3072");
+#endif
+#ifdef WOLFSSL_SP_4096
+        fprintf(stderr, " 4096");
+#endif
+        fprintf(stderr, "\n");
+        return 1;
+    }
+#endif
+    (void)bits;
+    return 0;
+}
+
+/* Key generation farm: generate N keys of each size over all cores, timing
+ * each key and counting the prime candidates tried. */
+
+#define FARM_RNG_DEVID      7
+#define FARM_MAX_THREADS    256
+
+/* Per thread state. The RNG is first so it can be matched in the RNG
+ * callback. */
+typedef struct FarmWorker {
+    WC_RNG          rng;
+    pthread_t       tid;
+    struct Farm*    farm;
+    int             counting;   /* set while inside wc_MakeRsaKey */
+    const byte*     candBuf;    /* buffer wc_MakeRsaKey fills with candidates */
+    long            candidates;
+    long            mrRounds;
+} FarmWorker;
+
+typedef struct Farm {
+    int             bits;
+    int             numKeys;
+    int             numThreads;
+    const char*     outDir;     /* NULL to not write DER files */
+    pthread_mutex_t lock;
+    int             next;       /* next key index to generate */
+    int             failed;
+    double*         genTime;    /* per key, milliseconds */
+    long*           candidates; /* per key */
+    long*           mrRounds;   /* per key */
+    FarmWorker*     workers;
+} Farm;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+#ifdef WOLF_CRYPTO_CB
+/* RNG callback used to count prime candidates. wc_MakeRsaKey fills the
+ * same buffer with random bytes for every candidate prime, while the
+ * Miller-Rabin test draws its random bases into a different buffer, so the
+ * first buffer seen in a key generation is taken as the candidate buffer.
+ * The software DRBG is always used for the data. */
+static int farm_rng_cb(int devIdArg, wc_CryptoInfo* info, void* ctx)
+{
+    Farm* farm = (Farm*)ctx;
+    FarmWorker* w = NULL;
+    int i;
+
+    if (info == NULL || info->algo_type != WC_ALGO_TYPE_RNG)
+        return CRYPTOCB_UNAVAILABLE;
+
+    for (i = 0; i < farm->numThreads; i++) {
+        if (&farm->workers[i].rng == info->rng.rng) {
+            w = &farm->workers[i];
+            break;
+        }
+    }
+    if (w != NULL && w->counting) {
+        if (w->candBuf == NULL)
+            w->candBuf = info->rng.out;
+        if (info->rng.out == w->candBuf)
+            w->candidates++;
+        else
+            w->mrRounds++;
+    }
+
+    return CRYPTOCB_UNAVAILABLE;
+}
+#endif
+
+static int farm_write_key(Farm* farm, RsaKey* key, int idx)
+{
+    unsigned char der[2400];
+    char name[512];
+    int len;
+    FILE* f;
+
+    len = wc_RsaKeyToDer(key, der, sizeof(der));
+    if (len < 0) {
+        fprintf(stderr, "Failed to encode RSA key\n");
+        return len;
+    }
+
+    snprintf(name, sizeof(name), "%s/rsa-%d-%04d.der", farm->outDir,
+             farm->bits, idx);
+    f = fopen(name, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open %s\n", name);
+        return -1;
+    }
+    if (fwrite(der, 1, len, f) != (size_t)len) {
+        fprintf(stderr, "Failed to write %s\n", name);
+        len = -1;
+    }
+    fclose(f);
+
+    return len < 0 ? len : 0;
+}
+
+/* Stop handing out keys, other threads read the flag under the lock */
+static void farm_fail(Farm* farm)
+{
+    pthread_mutex_lock(&farm->lock);
+    farm->failed = 1;
+    pthread_mutex_unlock(&farm->lock);
+}
+
+static void* farm_thread(void* arg)
+{
+    FarmWorker* w = (FarmWorker*)arg;
+    Farm* farm = w->farm;
+    RsaKey key;
+    double start;
+    int idx;
+    int ret;
+
+    for (;;) {
+        pthread_mutex_lock(&farm->lock);
+        idx = farm->failed ? farm->numKeys : farm->next++;
+        pthread_mutex_unlock(&farm->lock);
+        if (idx >= farm->numKeys)
+            break;
+
+        ret = wc_InitRsaKey(&key, NULL);
+        if (ret != 0) {
+            fprintf(stderr, "Failed to initialize RSA key\n");
+            farm_fail(farm);
+            break;
+        }
+
+        w->candidates = 0;
+        w->mrRounds = 0;
+        w->candBuf = NULL;
+        w->counting = 1;
+        start = current_time();
+        ret = wc_MakeRsaKey(&key, farm->bits, WC_RSA_EXPONENT, &w->rng);
+        farm->genTime[idx] = (current_time() - start) * 1000.0;
+        w->counting = 0;
+        farm->candidates[idx] = w->candidates;
+        farm->mrRounds[idx] = w->mrRounds;
+
+        if (ret != 0) {
+            fprintf(stderr, "Failed to make RSA key\n");
+        }
+        else {
+            ret = wc_CheckRsaKey(&key);
+            if (ret != 0)
+                fprintf(stderr, "Key failed checks\n");
+        }
+        if (ret == 0 && farm->outDir != NULL)
+            ret = farm_write_key(farm, &key, idx);
+        wc_FreeRsaKey(&key);
+
+        if (ret != 0) {
+            farm_fail(farm);
+            break;
+        }
+        fprintf(stderr, ".");
+    }
+
+    return NULL;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int cmp_long(const void* a, const void* b)
+{
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+/* Print one row of the farm report, sorts the per key arrays */
+static void farm_report(Farm* farm, double elapsed)
+{
+    int i;
+    int n = farm->numKeys;
+    double sumTime = 0;
+    double sumCand = 0, sumMr = 0;
+
+    for (i = 0; i < n; i++) {
+        sumTime += farm->genTime[i];
+        sumCand += farm->candidates[i];
+        sumMr += farm->mrRounds[i];
+    }
+    qsort(farm->genTime, n, sizeof(double), cmp_double);
+    qsort(farm->candidates, n, sizeof(long), cmp_long);
+
+    printf("%5d %6d %8.2f %9.1f %9.1f %9.1f %9.1f", farm->bits, n,
+           n / elapsed, sumTime / n, farm->genTime[n / 2],
+           farm->genTime[(int)((n - 1) * 0.99)], farm->genTime[n - 1]);
+#ifdef WOLF_CRYPTO_CB
+    printf(" %8.1f %8ld %8.1f\n", sumCand / n, farm->candidates[n - 1],
+           sumMr / n);
+#else
+    (void)sumCand;
+    (void)sumMr;
+    printf(" %8s %8s %8s\n", "n/a", "n/a", "n/a");
+#endif
+}
+
+/* Generate numKeys keys of the given size over numThreads threads */
+static int run_farm(int bits, int numKeys, int numThreads, const char* outDir)
+{
+    int ret = 0;
+    int i;
+    int started = 0;
+    int rngs = 0;
+    double start, elapsed;
+    Farm farm;
+
+    memset(&farm, 0, sizeof(farm));
+    farm.bits = bits;
+    farm.numKeys = numKeys;
+    farm.numThreads = numThreads;
+    farm.outDir = outDir;
+    pthread_mutex_init(&farm.lock, NULL);
+
+    farm.genTime = calloc(numKeys, sizeof(double));
+    farm.candidates = calloc(numKeys, sizeof(long));
+    farm.mrRounds = calloc(numKeys, sizeof(long));
+    farm.workers = calloc(numThreads, sizeof(FarmWorker));
+    if (farm.genTime == NULL || farm.candidates == NULL ||
+            farm.mrRounds == NULL || farm.workers == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        ret = 1;
+        goto exit;
+    }
+
+#ifdef WOLF_CRYPTO_CB
+    ret = wc_CryptoCb_RegisterDevice(FARM_RNG_DEVID, farm_rng_cb, &farm);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to register RNG callback\n");
+        ret = 1;
+        goto exit;
+    }
+#endif
+
+    for (i = 0; i < numThreads; i++) {
+        farm.workers[i].farm = &farm;
+    #ifdef WOLF_CRYPTO_CB
+        ret = wc_InitRng_ex(&farm.workers[i].rng, NULL, FARM_RNG_DEVID);
+    #else
+        ret = wc_InitRng(&farm.workers[i].rng);
+    #endif
+        if (ret != 0) {
+            fprintf(stderr, "Failed to initialize random\n");
+            ret = 1;
+            goto exit;
+        }
+        rngs++;
+    }
+
+    start = current_time();
+    for (i = 0; i < numThreads; i++) {
+        if (pthread_create(&farm.workers[i].tid, NULL, farm_thread,
+                           &farm.workers[i]) != 0) {
+            fprintf(stderr, "Failed to create thread\n");
+            farm_fail(&farm);
+            break;
+        }
+        started++;
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(farm.workers[i].tid, NULL);
+    }
+    elapsed = current_time() - start;
+    fprintf(stderr, "\n");
+
+    if (farm.failed) {
+        ret = 1;
+        goto exit;
+    }
+    farm_report(&farm, elapsed);
+
+exit:
+    for (i = 0; i < rngs; i++) {
+        wc_FreeRng(&farm.workers[i].rng);
+    }
+#ifdef WOLF_CRYPTO_CB
+    wc_CryptoCb_UnRegisterDevice(FARM_RNG_DEVID);
+#endif
+    free(farm.workers);
+    free(farm.mrRounds);
+    free(farm.candidates);
+    free(farm.genTime);
+    pthread_mutex_destroy(&farm.lock);
+
+    return ret;
+}
+
 /* Shows usage information */
 void usage()
 {
@@ -87,6 +433,13 @@ void usage()
     fprintf(stderr, "  -checks <num>     Number of signs/verifies to do\n");
     fprintf(stderr, "  -hash-size <num>  Number of bytes in hash\n");
     fprintf(stderr, "                    Range: 1-64. Default: 64\n");
+    fprintf(stderr, "  -farm             Generate keys over all cores and report\n");
+    fprintf(stderr, "                    times, 2048/3072/4096 unless -bits given\n");
+    fprintf(stderr, "  -threads <num>    Number of threads in farm mode\n");
+    fprintf(stderr, "                    Default: number of online CPUs\n");
+    fprintf(stderr, "  -out-dir <dir>    Directory to write DER keys in farm mode\n");
+    fprintf(stderr, "                    Default: current directory\n");
+    fprintf(stderr, "  -no-write         Don't write DER keys in farm mode\n");
     fprintf(stderr, "\n");
 }
 
@@ -107,6 +460,10 @@ int main(int argc, char *argv[])
     int numKeys = DEF_KEYS_GEN;
     int checks = DEF_SV_CHECKS;
     int load_key = 0;
+    int farm = 0;
+    int bits_set = 0;
+    int numThreads = 0;
+    const char* outDir = ".";
 
     /* Skip program name */
     --argc;
@@ -126,6 +483,7 @@ int main(int argc, char *argv[])
                 return 1;
             }
             bits = atoi(*argv);
+            bits_set = 1;
         }
         /* Number of keys to generate */
         else if (XSTRNCMP(*argv, "-num-keys", 10) == 0) {
@@ -157,6 +515,33 @@ int main(int argc, char *argv[])
             }
             hashSz = atoi(*argv);
         }
+        /* Generate keys over all cores */
+        else if (XSTRNCMP(*argv, "-farm", 6) == 0) {
+            farm = 1;
+        }
+        /* Number of threads in farm mode */
+        else if (XSTRNCMP(*argv, "-threads", 9) == 0) {
+            ++argv;
+            if (--argc == 0) {
+                fprintf(stderr, "Missing number of threads value\n");
+                usage();
+                return 1;
+            }
+            numThreads = atoi(*argv);
+        }
+        /* Directory to write keys to in farm mode */
+        else if (XSTRNCMP(*argv, "-out-dir", 9) == 0) {
+            ++argv;
+            if (--argc == 0) {
+                fprintf(stderr, "Missing directory value\n");
+                usage();
+                return 1;
+            }
+            outDir = *argv;
+        }
+        else if (XSTRNCMP(*argv, "-no-write", 10) == 0) {
+            outDir = NULL;
+        }
         else if (XSTRNCMP(*argv, "-help", 6) == 0) {
             usage();
             return 0;
@@ -171,6 +556,57 @@ int main(int argc, char *argv[])
         ++argv;
     }
 
+    if (farm) {
+        static const int farmBits[] = { 2048, 3072, 4096 };
+        int numBits = bits_set ? 1 : (int)(sizeof(farmBits)/sizeof(*farmBits));
+
+        if (numThreads == 0) {
+            numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        if (numThreads < 1 || numThreads > FARM_MAX_THREADS) {
+            fprintf(stderr, "Number of threads out of range (1-%d): %d\n",
+                    FARM_MAX_THREADS, numThreads);
+            usage();
+            return 1;
+        }
+        if (numKeys < 1) {
+            fprintf(stderr, "Number of key out of range (1+): %d\n", numKeys);
+            usage();
+            return 1;
+        }
+
+        printf("#Keys:      %d per size\n", numKeys);
+        printf("Threads:    %d\n", numThreads);
+        printf("Output:     %s\n", outDir ? outDir : "not written");
+    #ifndef WOLF_CRYPTO_CB
+        printf("Prime candidates not counted, needs WOLF_CRYPTO_CB\n");
+    #endif
+        printf("\n%5s %6s %8s %9s %9s %9s %9s %8s %8s %8s\n", "Bits", "Keys",
+               "Keys/s", "Mean ms", "p50 ms", "p99 ms", "Max ms", "Cand avg",
+               "Cand max", "MR avg");
+
+        for (i = 0; i < numBits; i++) {
+            int b = bits_set ? bits : farmBits[i];
+
+            if (b < MIN_RSA_BITS || b > MAX_RSA_BITS) {
+                fprintf(stderr, "Bits out of range (%d-%d): %d\n",
+                        MIN_RSA_BITS, MAX_RSA_BITS, b);
+                return 1;
+            }
+            if (check_sp_bits(b) != 0) {
+                if (bits_set) {
+                    return 1;
+                }
+                continue;
+            }
+            ec = run_farm(b, numKeys, numThreads, outDir);
+            if (ec != 0) {
+                break;
+            }
+        }
+        return ec;
+    }
+
     /* Only use one key when loading */
     if (load_key) {
         numKeys = 1;
@@ -183,37 +619,9 @@ int main(int argc, char *argv[])
         usage();
         return 1;
     }
-#ifdef WOLFSSL_SP_MATH
-    if (0) {
-    }
-#ifndef WOLFSSL_SP_NO_2048
-    else if (bits == 2048) {
-    }
-#endif
-#ifndef WOLFSSL_SP_NO_3072
-    else if (bits == 3072) {
-    }
-#endif
-#ifdef WOLFSSL_SP_4096
-    else if (bits == 4096) {
-    }
-#endif
-    else {
-        fprintf(stderr, "Bit size not supported with SP_MATH: %d\n", bits);
-        fprintf(stderr, " wolfSSL compiled to support, in bits:");
-#ifndef WOLFSSL_SP_NO_2048
-        fprintf(stderr, " 2048");
-#endif
-#ifndef WOLFSSL_SP_NO_3072
-        fprintf(stderr, " 3072");
-#endif
-#ifdef WOLFSSL_SP_4096
-        fprintf(stderr, " 4096");
-#endif
-        fprintf(stderr, "\n");
+    if (check_sp_bits(bits) != 0) {
         return 1;
     }
-#endif
     /* Check number of keys */
     if (numKeys < 1) {
         fprintf(stderr, "Number of key out of range (1+): %d\n", numKeys);
@@ -0,0 +1,455 @@
+/* rsa-pss-bench.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/*
+ * RSA-PSS and PKCS#1 v1.5 sign/verify throughput for 2048, 3072 and
+ * 4096-bit keys. Both sign a SHA-256 digest.
+ *
+ * Verification is done with a public-only key decoded from DER, as a
+ * gateway would, in two ways:
+ * - verify: the result is written to a separate buffer
+ *   (wc_RsaSSL_Verify / wc_RsaPSS_Verify)
+ * - inline: the signature is decoded in place
+ *   (wc_RsaSSL_VerifyInline / wc_RsaPSS_VerifyInline)
+ *
+ * RSA blinding and the SP RSA code (whose public operation is specialized
+ * for e = 65537) are build options, so the example prints which are in the
+ * build. Blinding can not be turned off per key: a build with
+ * WC_RSA_BLINDING refuses private key operations without an RNG. One run
+ * can only compare the private key path (sign, blinded when compiled in)
+ * with the public key path (verify, never blinded); the cost of blinding
+ * itself needs builds with and without it.
+ *
+ * Usage:
+./rsa-pss-bench [-b bits] [-e exponent] [-t seconds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/asn.h>
+#include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+#define DEF_SECS        1.0     /* time spent on each operation */
+#define MAX_SAMPLES     100000  /* latencies kept per operation */
+#define MAX_RSA_BYTES   512
+#define MAX_DER_SIZE    1024
+
+#if !defined(NO_RSA) && defined(WOLFSSL_KEY_GEN) && !defined(NO_SHA256)
+
+static const int benchBits[] = { 2048, 3072, 4096 };
+
+enum {
+    PAD_PKCS15,
+    PAD_PSS
+};
+
+enum {
+    OP_SIGN,
+    OP_VERIFY,
+    OP_VERIFY_INLINE
+};
+
+static const char* padName[] = { "PKCS#1 v1.5", "PSS" };
+static const char* opName[]  = { "sign", "verify", "inline" };
+
+typedef struct OpCtx {
+    int     pad;
+    RsaKey* priv;
+    RsaKey* pub;
+    WC_RNG* rng;
+    byte    digest[WC_SHA256_DIGEST_SIZE];
+    byte    enc[WC_SHA256_DIGEST_SIZE + MAX_ENC_ALG_SZ]; /* DigestInfo */
+    word32  encSz;
+    byte    sig[MAX_RSA_BYTES];
+    word32  sigSz;
+    byte    tmp[MAX_RSA_BYTES];
+    byte    out[MAX_RSA_BYTES];
+} OpCtx;
+
+typedef struct OpResult {
+    int     count;
+    double  secs;
+    double  p50;
+    double  p99;
+} OpResult;
+
+static double* samples;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int rsa_sign(OpCtx* c)
+{
+    int ret;
+
+    if (c->pad == PAD_PSS) {
+        ret = wc_RsaPSS_Sign(c->digest, sizeof(c->digest), c->sig,
+                             sizeof(c->sig), WC_HASH_TYPE_SHA256,
+                             WC_MGF1SHA256, c->priv, c->rng);
+    }
+    else {
+        ret = wc_RsaSSL_Sign(c->enc, c->encSz, c->sig, sizeof(c->sig),
+                             c->priv, c->rng);
+    }
+    if (ret > 0) {
+        c->sigSz = (word32)ret;
+        ret = 0;
+    }
+    return ret;
+}
+
+static int rsa_verify(OpCtx* c, int inl)
+{
+    int ret;
+    byte* res = c->out;
+
+    if (inl) {
+        /* the signature is overwritten, keep the original */
+        XMEMCPY(c->tmp, c->sig, c->sigSz);
+    }
+
+    if (c->pad == PAD_PSS) {
+        if (inl) {
+            ret = wc_RsaPSS_VerifyInline(c->tmp, c->sigSz, &res,
+                                         WC_HASH_TYPE_SHA256, WC_MGF1SHA256,
+                                         c->pub);
+        }
+        else {
+            ret = wc_RsaPSS_Verify(c->sig, c->sigSz, c->out, sizeof(c->out),
+                                   WC_HASH_TYPE_SHA256, WC_MGF1SHA256,
+                                   c->pub);
+        }
+        if (ret > 0) {
+            ret = wc_RsaPSS_CheckPadding(c->digest, sizeof(c->digest), res,
+                                         (word32)ret, WC_HASH_TYPE_SHA256);
+        }
+    }
+    else {
+        if (inl) {
+            ret = wc_RsaSSL_VerifyInline(c->tmp, c->sigSz, &res, c->pub);
+        }
+        else {
+            ret = wc_RsaSSL_Verify(c->sig, c->sigSz, c->out, sizeof(c->out),
+                                   c->pub);
+        }
+        if (ret >= 0) {
+            if ((word32)ret == c->encSz &&
+                    XMEMCMP(res, c->enc, c->encSz) == 0)
+                ret = 0;
+            else
+                ret = SIG_VERIFY_E;
+        }
+    }
+
+    return ret;
+}
+
+static int run_op(OpCtx* c, int op)
+{
+    if (op == OP_SIGN)
+        return rsa_sign(c);
+    return rsa_verify(c, op == OP_VERIFY_INLINE);
+}
+
+/* Run the operation for secs seconds */
+static int bench_op(OpCtx* c, int op, double secs, OpResult* r)
+{
+    int ret = 0, n;
+    double start, t0, t1;
+
+    XMEMSET(r, 0, sizeof(*r));
+    start = current_time();
+    t1 = start;
+    do {
+        t0 = t1;
+        ret = run_op(c, op);
+        t1 = current_time();
+        if (r->count < MAX_SAMPLES)
+            samples[r->count] = (t1 - t0) * 1000;
+        r->count++;
+    } while (ret == 0 && t1 - start < secs);
+    r->secs = t1 - start;
+
+    if (ret == 0) {
+        n = (r->count < MAX_SAMPLES) ? r->count : MAX_SAMPLES;
+        qsort(samples, n, sizeof(double), cmp_double);
+        r->p50 = samples[n / 2];
+        r->p99 = samples[n * 99 / 100];
+    }
+    return ret;
+}
+
+static void print_result(int pad, int op, const OpResult* r)
+{
+    printf("%-12s %-7s %10.1f %10.3f %10.3f %10.3f\n", padName[pad],
+           opName[op], r->count / r->secs, r->secs * 1000 / r->count,
+           r->p50, r->p99);
+}
+
+/* Make a key pair and the public-only key used to verify */
+static int make_keys(RsaKey* priv, RsaKey* pub, int bits, long e,
+                     WC_RNG* rng)
+{
+    int ret, derSz;
+    byte der[MAX_DER_SIZE];
+    word32 idx = 0;
+
+    ret = wc_InitRsaKey(priv, NULL);
+    if (ret != 0)
+        return ret;
+    ret = wc_InitRsaKey(pub, NULL);
+    if (ret != 0) {
+        wc_FreeRsaKey(priv);
+        return ret;
+    }
+
+    ret = wc_MakeRsaKey(priv, bits, e, rng);
+#ifdef WC_RSA_BLINDING
+    if (ret == 0)
+        ret = wc_RsaSetRNG(priv, rng);
+#endif
+    if (ret == 0) {
+        derSz = wc_RsaKeyToPublicDer(priv, der, sizeof(der));
+        if (derSz < 0)
+            ret = derSz;
+        else
+            ret = wc_RsaPublicKeyDecode(der, &idx, pub, (word32)derSz);
+    }
+    if (ret != 0) {
+        wc_FreeRsaKey(pub);
+        wc_FreeRsaKey(priv);
+    }
+
+    return ret;
+}
+
+static int bench_bits(int bits, long e, double secs, WC_RNG* rng)
+{
+    int ret, pad, op;
+    RsaKey priv;
+    RsaKey pub;
+    OpCtx c;
+    OpResult res[2][3];
+    double start;
+
+    start = current_time();
+    ret = make_keys(&priv, &pub, bits, e, rng);
+    if (ret != 0) {
+        printf("RSA-%d key generation failed %d: %s\n", bits, ret,
+               wc_GetErrorString(ret));
+        return ret;
+    }
+
+    printf("\nRSA-%d, e = %ld (key generated in %.2f s)\n", bits, e,
+           current_time() - start);
+    printf("%-12s %-7s %10s %10s %10s %10s\n", "padding", "op", "ops/s",
+           "avg ms", "p50 ms", "p99 ms");
+
+    XMEMSET(&c, 0, sizeof(c));
+    c.priv = &priv;
+    c.pub = &pub;
+    c.rng = rng;
+    ret = wc_RNG_GenerateBlock(rng, c.tmp, sizeof(c.tmp));
+    if (ret == 0)
+        ret = wc_Sha256Hash(c.tmp, sizeof(c.tmp), c.digest);
+    if (ret == 0) {
+        ret = wc_EncodeSignature(c.enc, c.digest, sizeof(c.digest), SHA256h);
+        if (ret > 0) {
+            c.encSz = (word32)ret;
+            ret = 0;
+        }
+    }
+
+    for (pad = PAD_PKCS15; pad <= PAD_PSS && ret == 0; pad++) {
+    #ifndef WC_RSA_PSS
+        if (pad == PAD_PSS) {
+            printf("%-12s not compiled in (--enable-rsapss)\n", padName[pad]);
+            break;
+        }
+    #endif
+        c.pad = pad;
+        for (op = OP_SIGN; op <= OP_VERIFY_INLINE && ret == 0; op++) {
+            ret = bench_op(&c, op, secs, &res[pad][op]);
+            if (ret == 0)
+                print_result(pad, op, &res[pad][op]);
+            else
+                printf("%-12s %-7s failed %d: %s\n", padName[pad],
+                       opName[op], ret, wc_GetErrorString(ret));
+        }
+    }
+
+    if (ret == 0) {
+        printf("sign%s / verify time: v1.5 %.1fx",
+    #ifdef WC_RSA_BLINDING
+               " (blinded)",
+    #else
+               "",
+    #endif
+               (res[PAD_PKCS15][OP_SIGN].secs /
+                res[PAD_PKCS15][OP_SIGN].count) /
+               (res[PAD_PKCS15][OP_VERIFY].secs /
+                res[PAD_PKCS15][OP_VERIFY].count));
+    #ifdef WC_RSA_PSS
+        printf(", PSS %.1fx",
+               (res[PAD_PSS][OP_SIGN].secs / res[PAD_PSS][OP_SIGN].count) /
+               (res[PAD_PSS][OP_VERIFY].secs /
+                res[PAD_PSS][OP_VERIFY].count));
+    #endif
+        printf("\n");
+    }
+
+#ifdef WC_RSA_PSS
+    if (ret == 0) {
+        printf("PSS / v1.5 throughput: sign %.2f, verify %.2f, inline %.2f\n",
+               (res[PAD_PSS][OP_SIGN].count / res[PAD_PSS][OP_SIGN].secs) /
+               (res[PAD_PKCS15][OP_SIGN].count /
+                res[PAD_PKCS15][OP_SIGN].secs),
+               (res[PAD_PSS][OP_VERIFY].count /
+                res[PAD_PSS][OP_VERIFY].secs) /
+               (res[PAD_PKCS15][OP_VERIFY].count /
+                res[PAD_PKCS15][OP_VERIFY].secs),
+               (res[PAD_PSS][OP_VERIFY_INLINE].count /
+                res[PAD_PSS][OP_VERIFY_INLINE].secs) /
+               (res[PAD_PKCS15][OP_VERIFY_INLINE].count /
+                res[PAD_PKCS15][OP_VERIFY_INLINE].secs));
+    }
+#endif
+
+    wc_FreeRsaKey(&pub);
+    wc_FreeRsaKey(&priv);
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("rsa-pss-bench [options]\n");
+    printf("-b <bits>   Key size, default 2048, 3072 and 4096\n");
+    printf("-e <exp>    Public exponent, default %d\n", WC_RSA_EXPONENT);
+    printf("-t <secs>   Time spent on each operation, default %.1f\n",
+           DEF_SECS);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+#if !defined(NO_RSA) && defined(WOLFSSL_KEY_GEN) && !defined(NO_SHA256)
+    int ret = 0, ch, i, bits = 0;
+    long e = WC_RSA_EXPONENT;
+    double secs = DEF_SECS;
+    WC_RNG rng;
+
+    while ((ch = getopt(argc, argv, "?b:e:t:")) != -1) {
+        switch (ch) {
+            case 'b':
+                bits = atoi(optarg);
+                break;
+            case 'e':
+                e = atol(optarg);
+                break;
+            case 't':
+                secs = atof(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (bits < 0 || bits > MAX_RSA_BYTES * 8 || e < 3 || (e & 1) == 0 ||
+            secs <= 0) {
+        Usage();
+        return -1;
+    }
+
+    samples = (double*)malloc(sizeof(double) * MAX_SAMPLES);
+    if (samples == NULL)
+        return MEMORY_E;
+
+    wolfCrypt_Init();
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        printf("Init RNG failed %d\n", ret);
+        free(samples);
+        wolfCrypt_Cleanup();
+        return ret;
+    }
+
+    printf("Build: RSA blinding %s, SP RSA %s, PSS %s\n",
+    #ifdef WC_RSA_BLINDING
+           "yes",
+    #else
+           "no",
+    #endif
+    #ifdef WOLFSSL_HAVE_SP_RSA
+           "yes",
+    #else
+           "no",
+    #endif
+    #ifdef WC_RSA_PSS
+           "yes"
+    #else
+           "no"
+    #endif
+          );
+
+    if (bits != 0) {
+        ret = bench_bits(bits, e, secs, &rng);
+    }
+    else {
+        for (i = 0; i < (int)(sizeof(benchBits) / sizeof(*benchBits)) &&
+                    ret == 0; i++) {
+            ret = bench_bits(benchBits[i], e, secs, &rng);
+        }
+    }
+
+    wc_FreeRng(&rng);
+    free(samples);
+    wolfCrypt_Cleanup();
+
+    return (ret == 0) ? 0 : -1;
+#else
+    printf("wolfSSL missing build features.\n");
+    printf("Please build using `./configure --enable-rsapss --enable-keygen`\n");
+    return -1;
+#endif
+}
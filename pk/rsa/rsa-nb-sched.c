@@ -0,0 +1,472 @@
+/* rsa-nb-sched.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/*
+* A single-threaded cooperative scheduler running many non-blocking RSA
+* operations together with periodic I/O tasks, as in an RTOS control loop.
+*
+* Each RSA task has its own RsaKey and RsaNb context and runs one sign or
+* verify step each time it is scheduled. The I/O tasks must run every
+* period; how late they run shows how responsive the loop stays while
+* signing. The run is repeated with the RSA operations blocking, in the
+* smallest non-blocking steps and with wc_RsaSetNonBlockTime() limits of
+* 1, 5 and 10 ms. The reported figures are the RSA throughput, the worst
+* RSA time slice and the worst I/O task latency.
+*
+* wc_RsaSetNonBlockTime() converts the time to an instruction budget using
+* the CPU speed in MHz. The speed is calibrated at startup so the budget
+* matches the measured time of a step, or can be given with -m.
+*
+* Usage:
+./rsa-nb-sched [-t tasks] [-o ops] [-i io tasks] [-p period ms] [-m MHz]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+static const char* kRsaKey = "../../certs/client-key.der";
+#define RSA_TEST_BYTES 256
+
+#define MAX_RSA_TASKS   64
+#define MAX_IO_TASKS    8
+#define DEF_RSA_TASKS   8       /* half sign, half verify */
+#define DEF_OPS         4       /* operations per RSA task */
+#define DEF_IO_TASKS    2
+#define DEF_IO_PERIOD   2       /* ms */
+
+#if !defined(NO_RSA) && defined(USE_FAST_MATH) && defined(WC_RSA_NONBLOCK)
+
+typedef struct RsaTask {
+    RsaKey  key;
+    RsaNb   nb;
+    int     sign;           /* sign, or verify */
+    int     remaining;      /* operations left */
+    byte    out[RSA_TEST_BYTES];
+} RsaTask;
+
+typedef struct IoTask {
+    double  next;           /* time the task is due */
+    word32  runs;
+    word32  state;
+} IoTask;
+
+/* one scheduler run */
+typedef struct SchedRun {
+    const char* name;
+    int         nonBlock;
+    word32      blockUs;    /* wc_RsaSetNonBlockTime() limit, 0 for none */
+} SchedRun;
+
+typedef struct SchedStats {
+    word32  ops;
+    word32  slices;
+    double  elapsed;
+    double  worstSlice;
+    double  worstIoLate;
+    word32  ioRuns;
+} SchedStats;
+
+static const char* in = "Everyone gets Friday off.";
+
+static RsaTask tasks[MAX_RSA_TASKS];
+static IoTask  ioTasks[MAX_IO_TASKS];
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int load_file_to_buffer(const char* filename, byte** fileBuf, int* fileLen)
+{
+    int ret = 0;
+    FILE* file = NULL;
+
+    /* Open file */
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("File %s does not exist!\n", filename);
+        ret = EXIT_FAILURE;
+        goto exit;
+    }
+
+    /* Determine length of file */
+    fseek(file, 0, SEEK_END);
+    *fileLen = (int) ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    /* Allocate buffer for image */
+    *fileBuf = malloc((size_t) *fileLen);
+    if(!*fileBuf) {
+        printf("File buffer malloc failed!\n");
+        ret = EXIT_FAILURE;
+        goto exit;
+    }
+
+    /* Load file into buffer */
+    ret = (int)fread(*fileBuf, 1, (size_t) *fileLen, file);
+    if(ret != *fileLen) {
+        printf("Error reading file! %d", ret);
+        ret = EXIT_FAILURE;
+        goto exit;
+    }
+    ret = 0;
+
+exit:
+
+    if(file) {
+        fclose(file);
+    }
+
+    return ret;
+}
+
+/* simulated I/O work: poll a peripheral and update a control output */
+static void io_task_run(IoTask* io)
+{
+    int i;
+
+    for (i = 0; i < 200; i++)
+        io->state = io->state * 1103515245 + 12345;
+    io->runs++;
+}
+
+/* (re)arm the non-blocking context for the next operation */
+static int rsa_task_start(RsaTask* t, const SchedRun* run, word32 cpuMHz)
+{
+    int ret;
+
+    if (!run->nonBlock)
+        return wc_RsaSetNonBlock(&t->key, NULL);    /* blocking */
+
+    ret = wc_RsaSetNonBlock(&t->key, &t->nb);
+#ifdef WC_RSA_NONBLOCK_TIME
+    if (ret == 0 && run->blockUs > 0)
+        ret = wc_RsaSetNonBlockTime(&t->key, run->blockUs, cpuMHz);
+#else
+    (void)cpuMHz;
+#endif
+
+    return ret;
+}
+
+/* one step of the task's current operation, FP_WOULDBLOCK if not done */
+static int rsa_task_step(RsaTask* t, WC_RNG* rng, const byte* sig,
+                         word32 sigSz)
+{
+    int ret;
+    byte plain[RSA_TEST_BYTES];
+
+    if (t->sign) {
+        ret = wc_RsaSSL_Sign((const byte*)in, (word32)XSTRLEN(in), t->out,
+                             sizeof(t->out), &t->key, rng);
+        if (ret >= 0 && ((word32)ret != sigSz || XMEMCMP(t->out, sig, sigSz)))
+            ret = SIG_VERIFY_E;
+    }
+    else {
+        ret = wc_RsaSSL_Verify(sig, sigSz, plain, sizeof(plain), &t->key);
+        if (ret >= 0 && ((word32)ret != XSTRLEN(in) ||
+                         XMEMCMP(plain, in, ret) != 0))
+            ret = SIG_VERIFY_E;
+    }
+
+    return ret;
+}
+
+static int sched_run(const SchedRun* run, int numTasks, int numOps,
+                     int numIo, double ioPeriod, word32 cpuMHz, WC_RNG* rng,
+                     const byte* sig, word32 sigSz, SchedStats* st)
+{
+    int ret = 0, i, active = 0, cur = 0;
+    double start, now, t0, dt;
+
+    XMEMSET(st, 0, sizeof(*st));
+
+    for (i = 0; i < numTasks && ret == 0; i++) {
+        tasks[i].remaining = numOps;
+        ret = rsa_task_start(&tasks[i], run, cpuMHz);
+        active++;
+    }
+    if (ret != 0)
+        return ret;
+
+    start = current_time();
+    for (i = 0; i < numIo; i++) {
+        ioTasks[i].next = start + ioPeriod * (i + 1) / numIo;
+        ioTasks[i].runs = 0;
+    }
+
+    while (active > 0) {
+        /* I/O tasks first, they have deadlines */
+        now = current_time();
+        for (i = 0; i < numIo; i++) {
+            if (now < ioTasks[i].next)
+                continue;
+            if (now - ioTasks[i].next > st->worstIoLate)
+                st->worstIoLate = now - ioTasks[i].next;
+            io_task_run(&ioTasks[i]);
+            while (ioTasks[i].next <= now)
+                ioTasks[i].next += ioPeriod;
+        }
+
+        /* next RSA task, round robin */
+        while (tasks[cur].remaining == 0)
+            cur = (cur + 1) % numTasks;
+
+        t0 = current_time();
+        ret = rsa_task_step(&tasks[cur], rng, sig, sigSz);
+        dt = current_time() - t0;
+        st->slices++;
+        if (dt > st->worstSlice)
+            st->worstSlice = dt;
+
+        if (ret != FP_WOULDBLOCK) {
+            if (ret < 0) {
+                printf("RSA %s task %d failed %s (%d)\n",
+                       tasks[cur].sign ? "sign" : "verify", cur,
+                       wc_GetErrorString(ret), ret);
+                return ret;
+            }
+            ret = 0;
+            st->ops++;
+            if (--tasks[cur].remaining > 0)
+                ret = rsa_task_start(&tasks[cur], run, cpuMHz);
+            else
+                active--;
+            if (ret != 0)
+                return ret;
+        }
+        cur = (cur + 1) % numTasks;
+    }
+    st->elapsed = current_time() - start;
+
+    for (i = 0; i < numIo; i++)
+        st->ioRuns += ioTasks[i].runs;
+
+    return 0;
+}
+
+#ifdef WC_RSA_NONBLOCK_TIME
+/* Find the CPU speed value that makes a wc_RsaSetNonBlockTime() budget
+ * take about that long on this machine */
+static word32 calibrate_mhz(RsaTask* t, WC_RNG* rng)
+{
+    const word32 guessMHz = 1000, blockUs = 1000;
+    int ret;
+    word32 slices = 0;
+    double t0, dt = 0, full = 0;
+
+    ret = wc_RsaSetNonBlock(&t->key, &t->nb);
+    if (ret == 0)
+        ret = wc_RsaSetNonBlockTime(&t->key, blockUs, guessMHz);
+    if (ret != 0)
+        return guessMHz;
+
+    do {
+        full += dt;     /* the last step is partial, leave it out */
+        t0 = current_time();
+        ret = wc_RsaSSL_Sign((const byte*)in, (word32)XSTRLEN(in), t->out,
+                             sizeof(t->out), &t->key, rng);
+        dt = current_time() - t0;
+        slices++;
+    } while (ret == FP_WOULDBLOCK);
+    wc_RsaSetNonBlock(&t->key, NULL);
+    if (ret < 0 || slices < 2 || full <= 0)
+        return guessMHz;
+
+    return (word32)(guessMHz * (blockUs / 1000000.0) / (full / (slices - 1)));
+}
+#endif
+
+static void Usage(void)
+{
+    printf("rsa-nb-sched [options]\n");
+    printf("-t <num>    RSA tasks (half sign, half verify), default %d\n",
+           DEF_RSA_TASKS);
+    printf("-o <num>    Operations per RSA task, default %d\n", DEF_OPS);
+    printf("-i <num>    I/O tasks, default %d\n", DEF_IO_TASKS);
+    printf("-p <ms>     I/O task period, default %d\n", DEF_IO_PERIOD);
+    printf("-m <MHz>    CPU speed for wc_RsaSetNonBlockTime(), default "
+           "calibrated\n");
+}
+#endif
+
+int main(int argc, char** argv)
+{
+/* These examples require RSA, FastMath and Non-blocking */
+#if !defined(NO_RSA) && defined(USE_FAST_MATH) && defined(WC_RSA_NONBLOCK)
+    static const SchedRun runs[] = {
+        { "blocking",     0, 0     },
+        { "nb steps",     1, 0     },
+    #ifdef WC_RSA_NONBLOCK_TIME
+        { "nb 1 ms",      1, 1000  },
+        { "nb 5 ms",      1, 5000  },
+        { "nb 10 ms",     1, 10000 },
+    #endif
+    };
+    RsaKey signKey;
+    WC_RNG rng;
+    int ret = 0, ch, i;
+    int numTasks = DEF_RSA_TASKS, numOps = DEF_OPS;
+    int numIo = DEF_IO_TASKS, ioPeriodMs = DEF_IO_PERIOD;
+    word32 cpuMHz = 0, idx;
+    byte* derBuf = NULL;
+    int derSz = 0;
+    byte sig[RSA_TEST_BYTES];
+    int sigSz;
+    SchedStats st;
+
+    while ((ch = getopt(argc, argv, "?t:o:i:p:m:")) != -1) {
+        switch (ch) {
+            case 't':
+                numTasks = atoi(optarg);
+                break;
+            case 'o':
+                numOps = atoi(optarg);
+                break;
+            case 'i':
+                numIo = atoi(optarg);
+                break;
+            case 'p':
+                ioPeriodMs = atoi(optarg);
+                break;
+            case 'm':
+                cpuMHz = (word32)atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (numTasks <= 0 || numTasks > MAX_RSA_TASKS || numOps <= 0 ||
+            numIo < 0 || numIo > MAX_IO_TASKS || ioPeriodMs <= 0) {
+        Usage();
+        return -1;
+    }
+
+    wolfSSL_Init();
+
+    ret = load_file_to_buffer(kRsaKey, &derBuf, &derSz);
+    if (ret != 0) {
+        return -1;
+    }
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        printf("Init RNG failed %d\n", ret);
+        free(derBuf);
+        return ret;
+    }
+
+    /* reference signature, checked by the sign tasks and used by the
+     * verify tasks */
+    ret = wc_InitRsaKey(&signKey, NULL);
+    if (ret == 0) {
+        idx = 0;
+        ret = wc_RsaPrivateKeyDecode(derBuf, &idx, &signKey, (word32)derSz);
+    }
+    if (ret == 0)
+        ret = wc_RsaSetRNG(&signKey, &rng);
+    if (ret == 0) {
+        ret = sigSz = wc_RsaSSL_Sign((const byte*)in, (word32)XSTRLEN(in), sig,
+                                     sizeof(sig), &signKey, &rng);
+        if (ret > 0)
+            ret = 0;
+    }
+    wc_FreeRsaKey(&signKey);
+
+    /* each task has its own key and non-blocking context */
+    for (i = 0; i < numTasks && ret == 0; i++) {
+        tasks[i].sign = (i % 2) == 0;
+        ret = wc_InitRsaKey(&tasks[i].key, NULL);
+        if (ret == 0) {
+            idx = 0;
+            ret = wc_RsaPrivateKeyDecode(derBuf, &idx, &tasks[i].key,
+                                         (word32)derSz);
+        }
+        if (ret == 0)
+            ret = wc_RsaSetRNG(&tasks[i].key, &rng);
+    }
+    if (ret != 0) {
+        printf("RSA key setup failed %s (%d)\n", wc_GetErrorString(ret), ret);
+        goto prog_end;
+    }
+
+#ifdef WC_RSA_NONBLOCK_TIME
+    if (cpuMHz == 0) {
+        cpuMHz = calibrate_mhz(&tasks[0], &rng);
+        printf("Calibrated CPU speed for wc_RsaSetNonBlockTime(): %u MHz\n",
+               cpuMHz);
+    }
+#endif
+
+    printf("%d RSA-%d tasks (%d sign, %d verify), %d ops each, "
+           "%d I/O tasks every %d ms\n\n", numTasks,
+           wc_RsaEncryptSize(&tasks[0].key) * 8, (numTasks + 1) / 2,
+           numTasks / 2, numOps, numIo, ioPeriodMs);
+    printf("%-10s %8s %10s %10s %10s %12s %12s\n", "mode", "ops/s",
+           "slices", "avg us", "worst us", "worst I/O us", "I/O runs");
+
+    for (i = 0; i < (int)(sizeof(runs) / sizeof(runs[0])); i++) {
+        ret = sched_run(&runs[i], numTasks, numOps, numIo,
+                        ioPeriodMs / 1000.0, cpuMHz, &rng, sig, (word32)sigSz,
+                        &st);
+        if (ret != 0)
+            break;
+        printf("%-10s %8.1f %10u %10.1f %10.1f %12.1f %12u\n", runs[i].name,
+               st.ops / st.elapsed, st.slices,
+               st.elapsed / st.slices * 1000000, st.worstSlice * 1000000,
+               st.worstIoLate * 1000000, st.ioRuns);
+    }
+
+prog_end:
+
+    if (ret != 0) {
+        printf("Failure %s (%d)\n", wc_GetErrorString(ret), ret);
+    }
+
+    for (i = 0; i < numTasks; i++)
+        wc_FreeRsaKey(&tasks[i].key);
+    free(derBuf);
+    wc_FreeRng(&rng);
+    wolfSSL_Cleanup();
+
+    return ret == 0 ? 0 : -1;
+#else
+    (void)kRsaKey;
+
+    printf("wolfSSL missing build features.\n");
+    printf("Please build using `./configure --enable-fastmath CFLAGS=\"-DWC_RSA_NONBLOCK -DWC_RSA_NONBLOCK_TIME\"`\n");
+    return -1;
+#endif
+}
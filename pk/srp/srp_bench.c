@@ -0,0 +1,576 @@
+/* srp_bench.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Server side SRP authentication throughput with the RFC 5054 2048 and
+ * 3072-bit groups.
+ *
+ * Users are enrolled into the verifier store (srp_db.c) first. For each user
+ * a client exchange is then run once to record the client's public value A
+ * and proof M1 against a server ephemeral b. The timed part replays these on
+ * N threads doing only the server's work:
+ *   look up salt and verifier, B = kv + g^b, wc_SrpComputeKey(),
+ *   check M1 and make M2.
+ * Drawing b up front keeps the client's modular exponentiations out of the
+ * measurement; the server still does every exponentiation of a real
+ * authentication. Each M2 is compared with the one from the recorded
+ * exchange.
+ */
+
+#ifndef WOLFSSL_USER_SETTINGS
+    #include <wolfssl/options.h>
+#endif
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/srp.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef WOLFCRYPT_HAVE_SRP
+
+#include "srp_db.h"
+
+#define DEF_USERS       64      /* per group */
+#define DEF_AUTHS       2000    /* authentications per run */
+#define DEF_DB_FILE     "srp_verifiers.db"
+#define MAX_THREADS     64
+#define SALT_SZ         20
+#define PRIV_SZ         32      /* server ephemeral, SRP_PRIVATE_KEY_MIN_BITS */
+
+typedef struct Transcript {
+    char    user[SRP_DB_MAX_USER];
+    byte    b[PRIV_SZ];
+    byte    clientPub[SRP_DB_MAX_VERIFIER];
+    word32  clientPubSz;
+    byte    clientProof[SRP_MAX_DIGEST_SIZE];
+    word32  clientProofSz;
+    byte    serverProof[SRP_MAX_DIGEST_SIZE];
+    word32  serverProofSz;
+} Transcript;
+
+typedef struct Bench {
+    SrpDb*      db;
+    Transcript* tr;
+    int         numTr;
+    int         auths;                  /* per thread */
+    double*     lat;                    /* auths per thread, in ms */
+
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             ready;
+    int             go;
+    int             failed;
+} Bench;
+
+typedef struct Worker {
+    Bench*      bench;
+    int         id;
+    pthread_t   tid;
+} Worker;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Make the verifier for a user and add it to the store, as srp_gen does */
+static int enroll_user(SrpDb* db, WC_RNG* rng, const SrpGroup* grp,
+                       const char* user, const char* password)
+{
+    int ret;
+    Srp* srp;
+    SrpRecord rec;
+    word32 vSz = SRP_DB_MAX_VERIFIER;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.hashType = SRP_DB_DEF_TYPE;
+    rec.groupBits = grp->bits;
+    rec.saltSz = SALT_SZ;
+    strncpy(rec.user, user, SRP_DB_MAX_USER - 1);
+
+    srp = XMALLOC(sizeof(Srp), NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (srp == NULL)
+        return MEMORY_E;
+
+    ret = wc_RNG_GenerateBlock(rng, rec.salt, rec.saltSz);
+    if (ret == 0)
+        ret = wc_SrpInit(srp, SRP_DB_DEF_TYPE, SRP_CLIENT_SIDE);
+    if (ret == 0) {
+        ret = wc_SrpSetUsername(srp, (byte*)user, XSTRLEN(user));
+        if (ret == 0) {
+            ret = wc_SrpSetParams(srp, grp->n, grp->nSz, grp->g, grp->gSz,
+                                  rec.salt, rec.saltSz);
+        }
+        if (ret == 0)
+            ret = wc_SrpSetPassword(srp, (byte*)password, XSTRLEN(password));
+        if (ret == 0)
+            ret = wc_SrpGetVerifier(srp, rec.verifier, &vSz);
+        wc_SrpTerm(srp);
+    }
+    XFREE(srp, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    if (ret == 0) {
+        rec.verifierSz = (word16)vSz;
+        ret = srp_db_put(db, &rec);
+    }
+    return ret;
+}
+
+/* Look up the user and calculate the server's public value B */
+static int server_start(Srp* srp, SrpDb* db, const char* user, const byte* b,
+                        byte* pub, word32* pubSz)
+{
+    int ret;
+    SrpRecord rec;
+    const SrpGroup* grp = NULL;
+
+    ret = srp_db_get(db, user, &rec);
+    if (ret == 0) {
+        grp = srp_db_group(rec.groupBits);
+        if (grp == NULL)
+            ret = SRP_DB_FORMAT_E;
+    }
+    if (ret == 0)
+        ret = wc_SrpInit(srp, (SrpType)rec.hashType, SRP_SERVER_SIDE);
+    if (ret == 0) {
+        ret = wc_SrpSetUsername(srp, (byte*)user, XSTRLEN(user));
+        if (ret == 0) {
+            ret = wc_SrpSetParams(srp, grp->n, grp->nSz, grp->g, grp->gSz,
+                                  rec.salt, rec.saltSz);
+        }
+        if (ret == 0)
+            ret = wc_SrpSetVerifier(srp, rec.verifier, rec.verifierSz);
+        if (ret == 0)
+            ret = wc_SrpSetPrivate(srp, b, PRIV_SZ);
+        if (ret == 0)
+            ret = wc_SrpGetPublic(srp, pub, pubSz);
+        if (ret != 0)
+            wc_SrpTerm(srp);
+    }
+
+    return ret;
+}
+
+/* Compute the key, check the client's proof and make the server's proof.
+ * Frees the SRP object. */
+static int server_finish(Srp* srp, const byte* clientPub, word32 clientPubSz,
+                         byte* serverPub, word32 serverPubSz,
+                         const byte* clientProof, word32 clientProofSz,
+                         byte* proof, word32* proofSz)
+{
+    int ret;
+
+    ret = wc_SrpComputeKey(srp, (byte*)clientPub, clientPubSz, serverPub,
+                           serverPubSz);
+    if (ret == 0) {
+        ret = wc_SrpVerifyPeersProof(srp, (byte*)clientProof, clientProofSz);
+    }
+    if (ret == 0) {
+        ret = wc_SrpGetProof(srp, proof, proofSz);
+    }
+    wc_SrpTerm(srp);
+
+    return ret;
+}
+
+/* Run one exchange for the user, recording what the client sent */
+static int make_transcript(SrpDb* db, WC_RNG* rng, const SrpGroup* grp,
+                           const char* user, const char* password,
+                           Transcript* t)
+{
+    int ret;
+    SrpRecord rec;
+    Srp* cli;
+    Srp* srv;
+    byte serverPub[SRP_DB_MAX_VERIFIER];
+    word32 serverPubSz = (word32)sizeof(serverPub);
+
+    memset(t, 0, sizeof(*t));
+    strncpy(t->user, user, SRP_DB_MAX_USER - 1);
+    t->clientPubSz = (word32)sizeof(t->clientPub);
+    t->clientProofSz = (word32)sizeof(t->clientProof);
+    t->serverProofSz = (word32)sizeof(t->serverProof);
+
+    ret = srp_db_get(db, user, &rec);
+    if (ret != 0)
+        return ret;
+
+    cli = XMALLOC(sizeof(Srp), NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    srv = XMALLOC(sizeof(Srp), NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (cli == NULL || srv == NULL) {
+        XFREE(cli, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        XFREE(srv, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        return MEMORY_E;
+    }
+
+    ret = wc_SrpInit(cli, (SrpType)rec.hashType, SRP_CLIENT_SIDE);
+    if (ret == 0) {
+        ret = wc_SrpSetUsername(cli, (byte*)user, XSTRLEN(user));
+        if (ret == 0) {
+            ret = wc_SrpSetParams(cli, grp->n, grp->nSz, grp->g, grp->gSz,
+                                  rec.salt, rec.saltSz);
+        }
+        if (ret == 0)
+            ret = wc_SrpSetPassword(cli, (byte*)password, XSTRLEN(password));
+        if (ret == 0)
+            ret = wc_SrpGetPublic(cli, t->clientPub, &t->clientPubSz);
+
+        if (ret == 0)
+            ret = wc_RNG_GenerateBlock(rng, t->b, sizeof(t->b));
+        if (ret == 0) {
+            ret = server_start(srv, db, user, t->b, serverPub,
+                               &serverPubSz);
+        }
+        if (ret == 0) {
+            ret = wc_SrpComputeKey(cli, t->clientPub, t->clientPubSz,
+                                   serverPub, serverPubSz);
+            if (ret == 0)
+                ret = wc_SrpGetProof(cli, t->clientProof, &t->clientProofSz);
+            if (ret == 0) {
+                ret = server_finish(srv, t->clientPub, t->clientPubSz,
+                                    serverPub, serverPubSz, t->clientProof,
+                                    t->clientProofSz, t->serverProof,
+                                    &t->serverProofSz);
+            }
+            else {
+                wc_SrpTerm(srv);
+            }
+        }
+        if (ret == 0) {
+            ret = wc_SrpVerifyPeersProof(cli, t->serverProof,
+                                         t->serverProofSz);
+        }
+        wc_SrpTerm(cli);
+    }
+
+    XFREE(cli, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(srv, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    return ret;
+}
+
+/* Server's work for one authentication */
+static int server_auth(SrpDb* db, const Transcript* t)
+{
+    int ret;
+    Srp* srp;
+    byte serverPub[SRP_DB_MAX_VERIFIER];
+    word32 serverPubSz = (word32)sizeof(serverPub);
+    byte proof[SRP_MAX_DIGEST_SIZE];
+    word32 proofSz = (word32)sizeof(proof);
+
+    srp = XMALLOC(sizeof(Srp), NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (srp == NULL)
+        return MEMORY_E;
+
+    ret = server_start(srp, db, t->user, t->b, serverPub, &serverPubSz);
+    if (ret == 0) {
+        ret = server_finish(srp, t->clientPub, t->clientPubSz, serverPub,
+                            serverPubSz, t->clientProof, t->clientProofSz,
+                            proof, &proofSz);
+    }
+    if (ret == 0 && (proofSz != t->serverProofSz ||
+                     XMEMCMP(proof, t->serverProof, proofSz) != 0)) {
+        ret = SRP_VERIFY_E;
+    }
+
+    XFREE(srp, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    return ret;
+}
+
+static int bench_failed(Bench* b)
+{
+    int failed;
+
+    pthread_mutex_lock(&b->lock);
+    failed = b->failed;
+    pthread_mutex_unlock(&b->lock);
+    return failed;
+}
+
+static void bench_fail(Bench* b, int ret)
+{
+    pthread_mutex_lock(&b->lock);
+    b->failed = ret;
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void* auth_thread(void* arg)
+{
+    Worker* w = (Worker*)arg;
+    Bench* b = w->bench;
+    double* lat = b->lat + (size_t)w->id * b->auths;
+    double start;
+    int ret = 0, i;
+
+    pthread_mutex_lock(&b->lock);
+    b->ready++;
+    pthread_cond_broadcast(&b->cond);
+    while (!b->go)
+        pthread_cond_wait(&b->cond, &b->lock);
+    pthread_mutex_unlock(&b->lock);
+
+    for (i = 0; i < b->auths && ret == 0 && !bench_failed(b); i++) {
+        start = current_time();
+        ret = server_auth(b->db, &b->tr[(w->id * 7919 + i) % b->numTr]);
+        lat[i] = (current_time() - start) * 1000;
+    }
+    if (ret != 0) {
+        printf("Authentication failed %d: %s\n", ret, wc_GetErrorString(ret));
+        bench_fail(b, ret);
+    }
+
+    return NULL;
+}
+
+/* run the authentications on numThreads threads, returns auths per second */
+static double run_bench(Bench* b, int numThreads, int totalAuths)
+{
+    Worker workers[MAX_THREADS];
+    int i, started = 0;
+    double start, elapsed;
+
+    b->auths = (totalAuths + numThreads - 1) / numThreads;
+    b->ready = 0;
+    b->go = 0;
+    b->failed = 0;
+    b->lat = (double*)malloc(sizeof(double) * b->auths * numThreads);
+    if (b->lat == NULL)
+        return -1;
+
+    for (i = 0; i < numThreads; i++) {
+        workers[i].bench = b;
+        workers[i].id = i;
+        if (pthread_create(&workers[i].tid, NULL, auth_thread,
+                           &workers[i]) != 0)
+            break;
+        started++;
+    }
+
+    pthread_mutex_lock(&b->lock);
+    while (b->ready < started)
+        pthread_cond_wait(&b->cond, &b->lock);
+    if (started < numThreads)
+        b->failed = -1;
+    start = current_time();
+    b->go = 1;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+
+    for (i = 0; i < started; i++)
+        pthread_join(workers[i].tid, NULL);
+    elapsed = current_time() - start;
+
+    if (b->failed)
+        return -1;
+    qsort(b->lat, (size_t)b->auths * numThreads, sizeof(double), cmp_double);
+    return (double)b->auths * numThreads / elapsed;
+}
+
+/* Enroll the users of a group and record one exchange for each */
+static int setup_group(SrpDb* db, WC_RNG* rng, const SrpGroup* grp,
+                       int numUsers, Transcript* tr)
+{
+    int ret = 0, i;
+    char user[SRP_DB_MAX_USER];
+    char password[32];
+    double start;
+
+    start = current_time();
+    for (i = 0; i < numUsers && ret == 0; i++) {
+        snprintf(user, sizeof(user), "device%d-%06d", grp->bits, i);
+        snprintf(password, sizeof(password), "password-%d", i);
+        ret = enroll_user(db, rng, grp, user, password);
+    }
+    if (ret == 0) {
+        printf("%d-bit: enrolled %d users, %.0f verifiers/s\n", grp->bits,
+               numUsers, numUsers / (current_time() - start));
+    }
+
+    for (i = 0; i < numUsers && ret == 0; i++) {
+        snprintf(user, sizeof(user), "device%d-%06d", grp->bits, i);
+        snprintf(password, sizeof(password), "password-%d", i);
+        ret = make_transcript(db, rng, grp, user, password, &tr[i]);
+    }
+
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("srp_bench [options]\n");
+    printf("-g <bits>   Group: 2048 or 3072, default both\n");
+    printf("-u <num>    Users per group, default %d\n", DEF_USERS);
+    printf("-n <num>    Authentications per run, default %d\n", DEF_AUTHS);
+    printf("-t <num>    Maximum threads, default online CPUs\n");
+    printf("-f <file>   Verifier store, default %s\n", DEF_DB_FILE);
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0, ch, t, g, numGroups = 0;
+    int groupBits[2] = { 2048, 3072 };
+    int numUsers = DEF_USERS, totalAuths = DEF_AUTHS;
+    int maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* dbFile = DEF_DB_FILE;
+    const SrpGroup* groups[2];
+    Transcript* tr[2] = { NULL, NULL };
+    double rate;
+    size_t n;
+    SrpDb db;
+    WC_RNG rng;
+    Bench bench;
+
+    while ((ch = getopt(argc, argv, "?g:u:n:t:f:")) != -1) {
+        switch (ch) {
+            case 'g':
+                groupBits[0] = atoi(optarg);
+                groupBits[1] = 0;
+                break;
+            case 'u':
+                numUsers = atoi(optarg);
+                break;
+            case 'n':
+                totalAuths = atoi(optarg);
+                break;
+            case 't':
+                maxThreads = atoi(optarg);
+                break;
+            case 'f':
+                dbFile = optarg;
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (maxThreads > MAX_THREADS)
+        maxThreads = MAX_THREADS;
+    for (g = 0; g < 2 && groupBits[g] != 0; g++) {
+        groups[numGroups] = srp_db_group(groupBits[g]);
+        if (groups[numGroups] == NULL) {
+            Usage();
+            return -1;
+        }
+        numGroups++;
+    }
+    if (numUsers <= 0 || totalAuths <= 0 || maxThreads <= 0) {
+        Usage();
+        return -1;
+    }
+
+    wolfCrypt_Init();
+
+    ret = wc_InitRng(&rng);
+    if (ret == 0) {
+        /* keep the table at most half full */
+        ret = srp_db_create(&db, dbFile, (word32)(numUsers * numGroups * 2));
+        if (ret != 0)
+            wc_FreeRng(&rng);
+    }
+    if (ret != 0) {
+        printf("Failure %d: %s\n", ret, wc_GetErrorString(ret));
+        wolfCrypt_Cleanup();
+        return -1;
+    }
+
+    for (g = 0; g < numGroups && ret == 0; g++) {
+        tr[g] = (Transcript*)malloc(sizeof(Transcript) * numUsers);
+        if (tr[g] == NULL)
+            ret = MEMORY_E;
+        if (ret == 0)
+            ret = setup_group(&db, &rng, groups[g], numUsers, tr[g]);
+    }
+    wc_FreeRng(&rng);
+    if (ret != 0)
+        printf("Failure %d: %s\n", ret, wc_GetErrorString(ret));
+
+    memset(&bench, 0, sizeof(bench));
+    pthread_mutex_init(&bench.lock, NULL);
+    pthread_cond_init(&bench.cond, NULL);
+    bench.db = &db;
+    bench.numTr = numUsers;
+
+    for (g = 0; g < numGroups && ret == 0; g++) {
+        bench.tr = tr[g];
+
+        printf("\n%d-bit group, %d users, %d authentications per run\n",
+               groups[g]->bits, numUsers, totalAuths);
+        printf("%8s %12s %14s %10s %10s %10s\n", "threads", "auths/s",
+               "auths/s/core", "p50 ms", "p99 ms", "max ms");
+
+        for (t = 1; ret == 0; t *= 2) {
+            if (t > maxThreads)
+                t = maxThreads;
+
+            rate = run_bench(&bench, t, totalAuths);
+            if (rate < 0) {
+                ret = -1;
+            }
+            else {
+                n = (size_t)bench.auths * t;
+                printf("%8d %12.1f %14.1f %10.2f %10.2f %10.2f\n", t, rate,
+                       rate / t, bench.lat[n / 2], bench.lat[n * 99 / 100],
+                       bench.lat[n - 1]);
+            }
+            free(bench.lat);
+            bench.lat = NULL;
+
+            if (t == maxThreads)
+                break;
+        }
+    }
+
+    pthread_mutex_destroy(&bench.lock);
+    pthread_cond_destroy(&bench.cond);
+    for (g = 0; g < numGroups; g++)
+        free(tr[g]);
+    srp_db_close(&db);
+    wolfCrypt_Cleanup();
+
+    return (ret == 0) ? 0 : -1;
+}
+
+#else
+
+int main(int argc, char* argv[])
+{
+    (void)argc;
+    (void)argv;
+    fprintf(stderr, "Must build wolfSSL with SRP enabled for this example\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,212 @@
+/* srp_db.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef WOLFSSL_USER_SETTINGS
+    #include <wolfssl/options.h>
+#endif
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+#include "srp_db.h"
+#include "srp_groups.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef struct SrpDbHeader {
+    word32  magic;
+    word32  version;
+    word32  capacity;
+    word32  recordSz;
+} SrpDbHeader;
+
+static const SrpGroup srpGroups[] = {
+    { 2048, srp_n_2048, sizeof(srp_n_2048), srp_g_2048, sizeof(srp_g_2048) },
+    { 3072, srp_n_3072, sizeof(srp_n_3072), srp_g_3072, sizeof(srp_g_3072) },
+};
+
+const SrpGroup* srp_db_group(int bits)
+{
+    int i;
+
+    for (i = 0; i < (int)(sizeof(srpGroups) / sizeof(*srpGroups)); i++) {
+        if (srpGroups[i].bits == bits)
+            return &srpGroups[i];
+    }
+    return NULL;
+}
+
+/* FNV-1a hash of the username */
+static word32 hash_user(const char* user)
+{
+    word32 h = 2166136261U;
+
+    while (*user != '\0') {
+        h ^= (byte)*user++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/* Record slots follow the header, which takes up the first slot */
+static off_t slot_offset(word32 slot)
+{
+    return (off_t)(slot + 1) * SRP_DB_RECORD_SZ;
+}
+
+static int read_slot(SrpDb* db, word32 slot, SrpRecord* rec)
+{
+    if (pread(db->fd, rec, sizeof(*rec), slot_offset(slot)) !=
+            (ssize_t)sizeof(*rec))
+        return SRP_DB_IO_E;
+    return 0;
+}
+
+int srp_db_create(SrpDb* db, const char* path, word32 capacity)
+{
+    SrpDbHeader hdr;
+
+    if (db == NULL || path == NULL || capacity == 0)
+        return BAD_FUNC_ARG;
+
+    db->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (db->fd < 0)
+        return SRP_DB_IO_E;
+    db->capacity = capacity;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SRP_DB_MAGIC;
+    hdr.version = SRP_DB_VERSION;
+    hdr.capacity = capacity;
+    hdr.recordSz = SRP_DB_RECORD_SZ;
+    /* extending the file leaves every slot zero - unused */
+    if (pwrite(db->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+            ftruncate(db->fd, slot_offset(capacity)) != 0) {
+        srp_db_close(db);
+        return SRP_DB_IO_E;
+    }
+
+    return 0;
+}
+
+int srp_db_open(SrpDb* db, const char* path)
+{
+    SrpDbHeader hdr;
+
+    if (db == NULL || path == NULL)
+        return BAD_FUNC_ARG;
+
+    db->fd = open(path, O_RDWR);
+    if (db->fd < 0)
+        return (errno == ENOENT) ? SRP_DB_NOT_FOUND_E : SRP_DB_IO_E;
+
+    if (pread(db->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+        srp_db_close(db);
+        return SRP_DB_IO_E;
+    }
+    if (hdr.magic != SRP_DB_MAGIC || hdr.version != SRP_DB_VERSION ||
+            hdr.recordSz != SRP_DB_RECORD_SZ || hdr.capacity == 0) {
+        srp_db_close(db);
+        return SRP_DB_FORMAT_E;
+    }
+    db->capacity = hdr.capacity;
+
+    return 0;
+}
+
+int srp_db_put(SrpDb* db, const SrpRecord* rec)
+{
+    int ret = SRP_DB_FULL_E;
+    SrpRecord cur;
+    SrpRecord out;
+    word32 slot, i;
+
+    if (db == NULL || rec == NULL || rec->user[0] == '\0' ||
+            strlen(rec->user) >= SRP_DB_MAX_USER ||
+            rec->saltSz > SRP_DB_MAX_SALT ||
+            rec->verifierSz > SRP_DB_MAX_VERIFIER)
+        return BAD_FUNC_ARG;
+
+    /* copy so that unused bytes are written as zero */
+    memset(&out, 0, sizeof(out));
+    out.used = 1;
+    out.hashType = rec->hashType;
+    out.groupBits = rec->groupBits;
+    out.saltSz = rec->saltSz;
+    out.verifierSz = rec->verifierSz;
+    strncpy(out.user, rec->user, SRP_DB_MAX_USER - 1);
+    memcpy(out.salt, rec->salt, rec->saltSz);
+    memcpy(out.verifier, rec->verifier, rec->verifierSz);
+
+    slot = hash_user(rec->user) % db->capacity;
+    for (i = 0; i < db->capacity; i++) {
+        if (read_slot(db, slot, &cur) != 0)
+            return SRP_DB_IO_E;
+        if (!cur.used ||
+                strncmp(cur.user, out.user, SRP_DB_MAX_USER) == 0) {
+            if (pwrite(db->fd, &out, sizeof(out), slot_offset(slot)) !=
+                    (ssize_t)sizeof(out))
+                ret = SRP_DB_IO_E;
+            else
+                ret = 0;
+            break;
+        }
+        slot = (slot + 1) % db->capacity;
+    }
+
+    return ret;
+}
+
+int srp_db_get(SrpDb* db, const char* user, SrpRecord* rec)
+{
+    word32 slot, i;
+
+    if (db == NULL || user == NULL || rec == NULL)
+        return BAD_FUNC_ARG;
+
+    slot = hash_user(user) % db->capacity;
+    for (i = 0; i < db->capacity; i++) {
+        if (read_slot(db, slot, rec) != 0)
+            return SRP_DB_IO_E;
+        /* users are never removed, so an empty slot ends the probe */
+        if (!rec->used)
+            break;
+        if (strncmp(rec->user, user, SRP_DB_MAX_USER) == 0) {
+            if (rec->saltSz > SRP_DB_MAX_SALT ||
+                    rec->verifierSz > SRP_DB_MAX_VERIFIER)
+                return SRP_DB_FORMAT_E;
+            return 0;
+        }
+        slot = (slot + 1) % db->capacity;
+    }
+
+    return SRP_DB_NOT_FOUND_E;
+}
+
+void srp_db_close(SrpDb* db)
+{
+    if (db != NULL && db->fd >= 0) {
+        close(db->fd);
+        db->fd = -1;
+    }
+}
@@ -0,0 +1,101 @@
+/* srp_db.h
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* File-backed store of SRP verifiers keyed by username.
+ *
+ * The file is a fixed size, open addressed hash table: a header followed by
+ * SRP_DB_RECORD_SZ byte records. A username hashes (FNV-1a) to a slot and
+ * collisions probe the following slots. Records are read and written with
+ * pread()/pwrite() so one open store can be shared by many threads, as long
+ * as only one thread adds users. Fields are in host byte order.
+ */
+
+#ifndef SRP_DB_H
+#define SRP_DB_H
+
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/types.h>
+#include <wolfssl/wolfcrypt/srp.h>
+
+#define SRP_DB_MAGIC        0x53525056  /* "SRPV" */
+#define SRP_DB_VERSION      1
+#define SRP_DB_RECORD_SZ    512
+#define SRP_DB_MAX_USER     64
+#define SRP_DB_MAX_SALT     32
+#define SRP_DB_MAX_VERIFIER 384         /* 3072-bit group */
+#define SRP_DB_DEF_CAPACITY 1024
+#define SRP_DB_DEF_GROUP    2048
+
+/* Hash used for verifiers made for the store */
+#ifndef NO_SHA256
+    #define SRP_DB_DEF_TYPE SRP_TYPE_SHA256
+#else
+    #define SRP_DB_DEF_TYPE SRP_TYPE_SHA
+#endif
+
+/* Error codes, in addition to BAD_FUNC_ARG */
+#define SRP_DB_NOT_FOUND_E  -1
+#define SRP_DB_FULL_E       -2
+#define SRP_DB_IO_E         -3
+#define SRP_DB_FORMAT_E     -4
+
+typedef struct SrpGroup {
+    word16      bits;
+    const byte* n;
+    word32      nSz;
+    const byte* g;
+    word32      gSz;
+} SrpGroup;
+
+/* On disk record. Padded to SRP_DB_RECORD_SZ bytes. */
+typedef struct SrpRecord {
+    byte    used;
+    byte    hashType;           /* SrpType the verifier was made with */
+    word16  groupBits;          /* 2048 or 3072 */
+    word16  saltSz;
+    word16  verifierSz;
+    char    user[SRP_DB_MAX_USER];     /* NUL terminated */
+    byte    salt[SRP_DB_MAX_SALT];
+    byte    verifier[SRP_DB_MAX_VERIFIER];
+    byte    pad[SRP_DB_RECORD_SZ - 8 - SRP_DB_MAX_USER - SRP_DB_MAX_SALT -
+                SRP_DB_MAX_VERIFIER];
+} SrpRecord;
+
+typedef struct SrpDb {
+    int     fd;
+    word32  capacity;           /* number of record slots */
+} SrpDb;
+
+/* RFC 5054 group with the given size in bits, NULL when not known */
+const SrpGroup* srp_db_group(int bits);
+
+/* Create (or truncate) a store with room for capacity users */
+int srp_db_create(SrpDb* db, const char* path, word32 capacity);
+/* Open an existing store. Returns SRP_DB_NOT_FOUND_E when the file does not
+ * exist, SRP_DB_IO_E or SRP_DB_FORMAT_E when it can't be read as a store. */
+int srp_db_open(SrpDb* db, const char* path);
+/* Add a user or replace the user's verifier */
+int srp_db_put(SrpDb* db, const SrpRecord* rec);
+/* Look up a user. Returns SRP_DB_NOT_FOUND_E when not stored. */
+int srp_db_get(SrpDb* db, const char* user, SrpRecord* rec);
+void srp_db_close(SrpDb* db);
+
+#endif /* SRP_DB_H */
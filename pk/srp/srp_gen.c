@@ -26,10 +26,12 @@
 #include <wolfssl/wolfcrypt/srp.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #ifdef WOLFCRYPT_HAVE_SRP
 
 #include "srp_params.h"
+#include "srp_db.h"
 
 /* Generate a new random salt */
 static int generate_random_salt(byte *buf, word32 size)
@@ -62,31 +64,85 @@ static void print_buf(char *name, byte* buf, word32 sz)
     printf("\n};\n");
 }
 
+/* Add the user's verifier to the store, creating the store when the file
+ * does not exist. A file that can't be read as a store is left alone. */
+static int store_verifier(const char* file, const char* username, int bits,
+                          byte* salt, word32 saltSz, byte* verifier,
+                          word32 vSz)
+{
+    int ret;
+    SrpDb db;
+    SrpRecord rec;
+
+    if (XSTRLEN(username) >= SRP_DB_MAX_USER)
+        return BAD_FUNC_ARG;
+
+    ret = srp_db_open(&db, file);
+    if (ret == SRP_DB_NOT_FOUND_E) {
+        ret = srp_db_create(&db, file, SRP_DB_DEF_CAPACITY);
+    }
+    if (ret == 0) {
+        XMEMSET(&rec, 0, sizeof(rec));
+        rec.hashType = SRP_DB_DEF_TYPE;
+        rec.groupBits = (word16)bits;
+        rec.saltSz = (word16)saltSz;
+        rec.verifierSz = (word16)vSz;
+        XSTRNCPY(rec.user, username, SRP_DB_MAX_USER - 1);
+        XMEMCPY(rec.salt, salt, saltSz);
+        XMEMCPY(rec.verifier, verifier, vSz);
+        ret = srp_db_put(&db, &rec);
+        srp_db_close(&db);
+    }
+
+    return ret;
+}
+
 int main(int argc, char* argv[])
 {
     int ret;
     Srp srp;
     byte salt[20];
-    byte verifier[80];
+    byte verifier[SRP_DB_MAX_VERIFIER];
     word32 vSz = (word32)sizeof(verifier);
     char* username;
     char* password;
+    char* storeFile = NULL;
+    int bits = SRP_DB_DEF_GROUP;
+    const SrpGroup* grp = NULL;
 
     if (argc < 3) {
-        fprintf(stderr, "usage: %s <username> <password>\n", argv[0]);
+        fprintf(stderr, "usage: %s <username> <password> [store [bits]]\n",
+                argv[0]);
         return 1;
     }
 
     username = argv[1];
     password = argv[2];
+    /* With a store, the verifier uses an RFC 5054 group and is added to the
+     * store instead of being printed. */
+    if (argc > 3) {
+        storeFile = argv[3];
+        if (argc > 4)
+            bits = atoi(argv[4]);
+        grp = srp_db_group(bits);
+        if (grp == NULL) {
+            fprintf(stderr, "Group must be 2048 or 3072 bits\n");
+            return 1;
+        }
+    }
 
     ret = generate_random_salt(salt, sizeof(salt));
     if (ret == 0) {
-        ret = wc_SrpInit(&srp, SRP_TYPE_SHA, SRP_CLIENT_SIDE);
+        ret = wc_SrpInit(&srp, (grp != NULL) ? SRP_DB_DEF_TYPE : SRP_TYPE_SHA,
+                         SRP_CLIENT_SIDE);
     }
     if (ret == 0) {
         ret = wc_SrpSetUsername(&srp, (byte*)username, XSTRLEN(username));
-        if (ret == 0) {
+        if (ret == 0 && grp != NULL) {
+            ret = wc_SrpSetParams(&srp, grp->n, grp->nSz, grp->g, grp->gSz,
+                                  salt, sizeof(salt));
+        }
+        else if (ret == 0) {
             ret = wc_SrpSetParams(&srp, srp_n_640, sizeof(srp_n_640),
                                   srp_g_640, sizeof(srp_g_640),
                                   salt, sizeof(salt));
@@ -101,6 +157,17 @@ int main(int argc, char* argv[])
         wc_SrpTerm(&srp);
     }
 
+    if (ret == 0 && storeFile != NULL) {
+        ret = store_verifier(storeFile, username, bits, salt, sizeof(salt),
+                             verifier, vSz);
+        if (ret == 0)
+            printf("Added %s (%d-bit group) to %s\n", username, bits,
+                   storeFile);
+        else
+            fprintf(stderr, "Failed to store verifier: %d\n", ret);
+        return (ret == 0) ? 0 : 1;
+    }
+
     /* Output the details to store on the server */
     printf("static const char* srp_username = \"%s\";\n", username);
     print_buf("salt", salt, sizeof(salt));
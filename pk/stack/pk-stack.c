@@ -0,0 +1,935 @@
+/* pk-stack.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Stack and heap use of each public key operation.
+ *
+ * Generalizes ecc/ecc-stack.c: every operation runs on its own thread with
+ * a stack filled with a known value beforehand, as StackSizeCheck() in
+ * wolfssl/test.h does, and the untouched part of the stack is counted
+ * afterwards. The use of an empty thread is subtracted so the numbers are
+ * what the operation itself needs on top of a task's own frames. Heap is
+ * counted with allocators registered through wolfSSL_SetAllocators().
+ *
+ * Keys, signatures and buffers are global so that only wolfCrypt's use is
+ * measured. The numbers depend on the build: compare a WOLFSSL_SMALL_STACK
+ * build (less stack, more heap) against the default one.
+ */
+
+#ifndef WOLFSSL_USER_SETTINGS
+    #include <wolfssl/options.h>
+#endif
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/memory.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/ed25519.h>
+#include <wolfssl/wolfcrypt/ed448.h>
+#include <wolfssl/wolfcrypt/curve25519.h>
+#include <wolfssl/wolfcrypt/dh.h>
+#include <wolfssl/wolfcrypt/srp.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define DEF_STACK_SZ    (1024 * 1024)
+#define STACK_FILL      0x01
+#define DEF_RSA_BITS    2048
+#define MAX_OPS         48
+#define MSG_SZ          32          /* message / digest signed */
+#define MAX_SECRET_SZ   512         /* DH and SRP values, up to 4096 bits */
+
+#if defined(USE_WOLFSSL_MEMORY) && !defined(WOLFSSL_STATIC_MEMORY)
+    #define COUNT_HEAP
+#endif
+
+typedef int (*pk_op_fn)(void* arg);
+
+typedef struct PkOp {
+    char        name[32];
+    pk_op_fn    run;
+    void*       arg;
+} PkOp;
+
+typedef struct MemUsage {
+    word32  peakMem;
+    word32  peakAlloc;
+    word32  totalAlloc;
+    word32  curAlloc;       /* allocations left after the operation */
+} MemUsage;
+
+typedef struct StackRun {
+    PkOp*       op;
+    int         ret;
+    MemUsage    heap;
+} StackRun;
+
+static WC_RNG mRng;
+static byte   mMsg[MSG_SZ];
+static byte   mSecret[MAX_SECRET_SZ];
+static word32 mSecretSz;
+
+#ifdef COUNT_HEAP
+/* Counting allocators, only one operation runs at a time. They are
+ * installed before wolfCrypt_Init() so every block wolfCrypt frees came from
+ * count_malloc(). Each block is tagged with the measurement epoch it was
+ * allocated in and the epoch moves on before each operation, so freeing a
+ * block from setup or an earlier operation is not subtracted from the
+ * counts of the current one. */
+typedef struct HeapHdr {
+    size_t  sz;
+    size_t  epoch;
+} HeapHdr;
+
+static MemUsage heapStats;
+static long heapCur;
+static size_t heapEpoch;
+
+static void* count_malloc(size_t sz)
+{
+    HeapHdr* h = (HeapHdr*)malloc(sz + sizeof(HeapHdr));
+
+    if (h == NULL)
+        return NULL;
+    h->sz = sz;
+    h->epoch = heapEpoch;
+    heapCur += (long)sz;
+    if (heapCur > (long)heapStats.peakMem)
+        heapStats.peakMem = (word32)heapCur;
+    heapStats.curAlloc++;
+    if (heapStats.curAlloc > heapStats.peakAlloc)
+        heapStats.peakAlloc = heapStats.curAlloc;
+    heapStats.totalAlloc++;
+
+    return h + 1;
+}
+
+static void count_free(void* ptr)
+{
+    HeapHdr* h;
+
+    if (ptr == NULL)
+        return;
+    h = (HeapHdr*)ptr - 1;
+    if (h->epoch == heapEpoch) {
+        heapCur -= (long)h->sz;
+        heapStats.curAlloc--;
+    }
+    free(h);
+}
+
+static void* count_realloc(void* ptr, size_t sz)
+{
+    void* n = count_malloc(sz);
+    size_t old;
+
+    if (n != NULL && ptr != NULL) {
+        old = ((HeapHdr*)ptr - 1)->sz;
+        memcpy(n, ptr, old < sz ? old : sz);
+        count_free(ptr);
+    }
+    return n;
+}
+#endif /* COUNT_HEAP */
+
+static void* stack_thread(void* arg)
+{
+    StackRun* r = (StackRun*)arg;
+
+#ifdef COUNT_HEAP
+    XMEMSET(&heapStats, 0, sizeof(heapStats));
+    heapCur = 0;
+    heapEpoch++;
+#endif
+    r->ret = r->op->run(r->op->arg);
+#ifdef COUNT_HEAP
+    r->heap = heapStats;
+#endif
+
+    return NULL;
+}
+
+/* Run the operation on a thread with a filled stack of stackSz bytes.
+ * Returns the number of stack bytes touched or a negative value on error. */
+static long stack_check(StackRun* r, size_t stackSz)
+{
+    unsigned char* stack = NULL;
+    pthread_attr_t attr;
+    pthread_t tid;
+    size_t i;
+
+    if (posix_memalign((void**)&stack, sysconf(_SC_PAGESIZE), stackSz) != 0)
+        return -1;
+    XMEMSET(stack, STACK_FILL, stackSz);
+
+    if (pthread_attr_init(&attr) != 0) {
+        free(stack);
+        return -1;
+    }
+    if (pthread_attr_setstack(&attr, stack, stackSz) != 0 ||
+            pthread_create(&tid, &attr, stack_thread, r) != 0) {
+        pthread_attr_destroy(&attr);
+        free(stack);
+        return -1;
+    }
+    pthread_join(tid, NULL);
+    pthread_attr_destroy(&attr);
+
+    /* the stack grows down: count the untouched bytes at the bottom */
+    for (i = 0; i < stackSz; i++) {
+        if (stack[i] != STACK_FILL)
+            break;
+    }
+    free(stack);
+
+    return (long)(stackSz - i);
+}
+
+static int op_none(void* arg)
+{
+    (void)arg;
+    return 0;
+}
+
+#if !defined(NO_RSA) && defined(WOLFSSL_KEY_GEN)
+static RsaKey mRsaKey;
+static RsaKey mRsaGen;
+static int    mRsaBits = DEF_RSA_BITS;
+static byte   mRsaSig[RSA_MAX_SIZE / 8];
+static word32 mRsaSigSz;
+static byte   mRsaOut[RSA_MAX_SIZE / 8];
+
+static int rsa_keygen(void* arg)
+{
+    int ret;
+
+    ret = wc_InitRsaKey(&mRsaGen, NULL);
+    if (ret == 0) {
+        ret = wc_MakeRsaKey(&mRsaGen, mRsaBits, WC_RSA_EXPONENT, &mRng);
+        wc_FreeRsaKey(&mRsaGen);
+    }
+    (void)arg;
+    return ret;
+}
+
+static int rsa_sign(void* arg)
+{
+    int ret;
+
+    ret = wc_RsaSSL_Sign(mMsg, sizeof(mMsg), mRsaSig, sizeof(mRsaSig),
+                         &mRsaKey, &mRng);
+    if (ret > 0) {
+        mRsaSigSz = (word32)ret;
+        ret = 0;
+    }
+    (void)arg;
+    return ret;
+}
+
+static int rsa_verify(void* arg)
+{
+    int ret;
+
+    ret = wc_RsaSSL_Verify(mRsaSig, mRsaSigSz, mRsaOut, sizeof(mRsaOut),
+                           &mRsaKey);
+    if (ret == (int)sizeof(mMsg) && XMEMCMP(mRsaOut, mMsg, ret) == 0)
+        ret = 0;
+    else if (ret >= 0)
+        ret = SIG_VERIFY_E;
+    (void)arg;
+    return ret;
+}
+
+static int rsa_setup(void)
+{
+    int ret;
+
+    ret = wc_InitRsaKey(&mRsaKey, NULL);
+    if (ret == 0)
+        ret = wc_MakeRsaKey(&mRsaKey, mRsaBits, WC_RSA_EXPONENT, &mRng);
+#ifdef WC_RSA_BLINDING
+    if (ret == 0)
+        ret = wc_RsaSetRNG(&mRsaKey, &mRng);
+#endif
+    if (ret == 0)
+        ret = rsa_sign(NULL);
+    return ret;
+}
+#endif /* !NO_RSA && WOLFSSL_KEY_GEN */
+
+#ifdef HAVE_ECC
+typedef struct EccCurve {
+    const char* name;
+    int         id;
+    int         size;
+    int         ready;
+    ecc_key     key;
+    ecc_key     peer;
+    ecc_key     gen;
+    byte        sig[ECC_MAX_SIG_SIZE];
+    word32      sigSz;
+} EccCurve;
+
+static EccCurve mCurves[] = {
+    { "P-256", ECC_SECP256R1, 0, 0 },
+    { "P-384", ECC_SECP384R1, 0, 0 },
+    { "P-521", ECC_SECP521R1, 0, 0 },
+};
+#define NUM_CURVES (int)(sizeof(mCurves) / sizeof(*mCurves))
+
+static int ecc_keygen(void* arg)
+{
+    EccCurve* c = (EccCurve*)arg;
+    int ret;
+
+    ret = wc_ecc_init(&c->gen);
+    if (ret == 0) {
+        ret = wc_ecc_make_key_ex(&mRng, c->size, &c->gen, c->id);
+        wc_ecc_free(&c->gen);
+    }
+    return ret;
+}
+
+static int ecc_sign(void* arg)
+{
+    EccCurve* c = (EccCurve*)arg;
+
+    c->sigSz = (word32)sizeof(c->sig);
+    return wc_ecc_sign_hash(mMsg, sizeof(mMsg), c->sig, &c->sigSz, &mRng,
+                            &c->key);
+}
+
+static int ecc_verify(void* arg)
+{
+    EccCurve* c = (EccCurve*)arg;
+    int ret, res = 0;
+
+    ret = wc_ecc_verify_hash(c->sig, c->sigSz, mMsg, sizeof(mMsg), &res,
+                             &c->key);
+    if (ret == 0 && res != 1)
+        ret = SIG_VERIFY_E;
+    return ret;
+}
+
+#ifdef HAVE_ECC_DHE
+static int ecc_ecdh(void* arg)
+{
+    EccCurve* c = (EccCurve*)arg;
+
+    mSecretSz = (word32)sizeof(mSecret);
+    return wc_ecc_shared_secret(&c->key, &c->peer, mSecret, &mSecretSz);
+}
+#endif
+
+/* Returns 0 when the curve can't be used in this build */
+static int ecc_setup(EccCurve* c)
+{
+    int ret;
+
+    c->size = wc_ecc_get_curve_size_from_id(c->id);
+    if (c->size <= 0)
+        return 0;
+
+    ret = wc_ecc_init(&c->key);
+    if (ret == 0)
+        ret = wc_ecc_init(&c->peer);
+    if (ret == 0)
+        ret = wc_ecc_make_key_ex(&mRng, c->size, &c->key, c->id);
+    if (ret == 0)
+        ret = wc_ecc_make_key_ex(&mRng, c->size, &c->peer, c->id);
+#if defined(ECC_TIMING_RESISTANT) && !defined(HAVE_FIPS)
+    if (ret == 0)
+        ret = wc_ecc_set_rng(&c->key, &mRng);
+#endif
+    if (ret == 0)
+        ret = ecc_sign(c);
+    if (ret == 0)
+        c->ready = 1;
+    return ret;
+}
+#endif /* HAVE_ECC */
+
+#if defined(HAVE_ED25519) && defined(HAVE_ED25519_SIGN) && \
+    defined(HAVE_ED25519_VERIFY)
+static ed25519_key mEd25519;
+static ed25519_key mEd25519Gen;
+static byte        mEd25519Sig[ED25519_SIG_SIZE];
+static word32      mEd25519SigSz;
+
+static int ed25519_keygen(void* arg)
+{
+    int ret;
+
+    ret = wc_ed25519_init(&mEd25519Gen);
+    if (ret == 0) {
+        ret = wc_ed25519_make_key(&mRng, ED25519_KEY_SIZE, &mEd25519Gen);
+        wc_ed25519_free(&mEd25519Gen);
+    }
+    (void)arg;
+    return ret;
+}
+
+static int ed25519_sign(void* arg)
+{
+    mEd25519SigSz = (word32)sizeof(mEd25519Sig);
+    (void)arg;
+    return wc_ed25519_sign_msg(mMsg, sizeof(mMsg), mEd25519Sig,
+                               &mEd25519SigSz, &mEd25519);
+}
+
+static int ed25519_verify(void* arg)
+{
+    int ret, res = 0;
+
+    ret = wc_ed25519_verify_msg(mEd25519Sig, mEd25519SigSz, mMsg,
+                                sizeof(mMsg), &res, &mEd25519);
+    if (ret == 0 && res != 1)
+        ret = SIG_VERIFY_E;
+    (void)arg;
+    return ret;
+}
+
+static int ed25519_setup(void)
+{
+    int ret;
+
+    ret = wc_ed25519_init(&mEd25519);
+    if (ret == 0)
+        ret = wc_ed25519_make_key(&mRng, ED25519_KEY_SIZE, &mEd25519);
+    if (ret == 0)
+        ret = ed25519_sign(NULL);
+    return ret;
+}
+#endif /* HAVE_ED25519 */
+
+#if defined(HAVE_ED448) && defined(HAVE_ED448_SIGN) && \
+    defined(HAVE_ED448_VERIFY)
+static ed448_key mEd448;
+static ed448_key mEd448Gen;
+static byte      mEd448Sig[ED448_SIG_SIZE];
+static word32    mEd448SigSz;
+
+static int ed448_keygen(void* arg)
+{
+    int ret;
+
+    ret = wc_ed448_init(&mEd448Gen);
+    if (ret == 0) {
+        ret = wc_ed448_make_key(&mRng, ED448_KEY_SIZE, &mEd448Gen);
+        wc_ed448_free(&mEd448Gen);
+    }
+    (void)arg;
+    return ret;
+}
+
+static int ed448_sign(void* arg)
+{
+    mEd448SigSz = (word32)sizeof(mEd448Sig);
+    (void)arg;
+    return wc_ed448_sign_msg(mMsg, sizeof(mMsg), mEd448Sig, &mEd448SigSz,
+                             &mEd448, NULL, 0);
+}
+
+static int ed448_verify(void* arg)
+{
+    int ret, res = 0;
+
+    ret = wc_ed448_verify_msg(mEd448Sig, mEd448SigSz, mMsg, sizeof(mMsg),
+                              &res, &mEd448, NULL, 0);
+    if (ret == 0 && res != 1)
+        ret = SIG_VERIFY_E;
+    (void)arg;
+    return ret;
+}
+
+static int ed448_setup(void)
+{
+    int ret;
+
+    ret = wc_ed448_init(&mEd448);
+    if (ret == 0)
+        ret = wc_ed448_make_key(&mRng, ED448_KEY_SIZE, &mEd448);
+    if (ret == 0)
+        ret = ed448_sign(NULL);
+    return ret;
+}
+#endif /* HAVE_ED448 */
+
+#ifdef HAVE_CURVE25519
+static curve25519_key mX25519;
+static curve25519_key mX25519Peer;
+static curve25519_key mX25519Gen;
+
+static int x25519_keygen(void* arg)
+{
+    int ret;
+
+    ret = wc_curve25519_init(&mX25519Gen);
+    if (ret == 0) {
+        ret = wc_curve25519_make_key(&mRng, CURVE25519_KEYSIZE, &mX25519Gen);
+        wc_curve25519_free(&mX25519Gen);
+    }
+    (void)arg;
+    return ret;
+}
+
+static int x25519_shared(void* arg)
+{
+    mSecretSz = (word32)sizeof(mSecret);
+    (void)arg;
+    return wc_curve25519_shared_secret(&mX25519, &mX25519Peer, mSecret,
+                                       &mSecretSz);
+}
+
+static int x25519_setup(void)
+{
+    int ret;
+
+    ret = wc_curve25519_init(&mX25519);
+    if (ret == 0)
+        ret = wc_curve25519_init(&mX25519Peer);
+    if (ret == 0)
+        ret = wc_curve25519_make_key(&mRng, CURVE25519_KEYSIZE, &mX25519);
+    if (ret == 0) {
+        ret = wc_curve25519_make_key(&mRng, CURVE25519_KEYSIZE,
+                                     &mX25519Peer);
+    }
+    return ret;
+}
+#endif /* HAVE_CURVE25519 */
+
+#if !defined(NO_DH) && defined(HAVE_FFDHE_2048)
+static DhKey  mDh;
+static byte   mDhPriv[MAX_SECRET_SZ];
+static word32 mDhPrivSz;
+static byte   mDhPub[MAX_SECRET_SZ];
+static word32 mDhPubSz;
+static byte   mDhPeerPub[MAX_SECRET_SZ];
+static word32 mDhPeerPubSz;
+
+static int dh_keygen(void* arg)
+{
+    mDhPrivSz = (word32)sizeof(mDhPriv);
+    mDhPubSz = (word32)sizeof(mDhPub);
+    (void)arg;
+    return wc_DhGenerateKeyPair(&mDh, &mRng, mDhPriv, &mDhPrivSz, mDhPub,
+                                &mDhPubSz);
+}
+
+static int dh_agree(void* arg)
+{
+    mSecretSz = (word32)sizeof(mSecret);
+    (void)arg;
+    return wc_DhAgree(&mDh, mSecret, &mSecretSz, mDhPriv, mDhPrivSz,
+                      mDhPeerPub, mDhPeerPubSz);
+}
+
+static int dh_setup(void)
+{
+    int ret;
+    const DhParams* params = wc_Dh_ffdhe2048_Get();
+
+    ret = wc_InitDhKey(&mDh);
+    if (ret == 0)
+        ret = wc_DhSetKey(&mDh, params->p, params->p_len, params->g,
+                          params->g_len);
+    if (ret == 0) {
+        /* the peer's key pair, then our own */
+        ret = dh_keygen(NULL);
+        if (ret == 0) {
+            XMEMCPY(mDhPeerPub, mDhPub, mDhPubSz);
+            mDhPeerPubSz = mDhPubSz;
+            ret = dh_keygen(NULL);
+        }
+    }
+    return ret;
+}
+#endif /* !NO_DH && HAVE_FFDHE_2048 */
+
+#if defined(WOLFCRYPT_HAVE_SRP) && !defined(NO_DH) && \
+    defined(HAVE_FFDHE_2048) && !defined(NO_SHA256)
+/* The FFDHE 2048-bit safe prime stands in for the RFC 5054 group of the same
+ * size; the cost of the exchange is the same. */
+static Srp    mSrpCli;
+static Srp    mSrpSrv;
+static byte   mSrpSalt[16];
+static byte   mSrpVerifier[MAX_SECRET_SZ];
+static word32 mSrpVerifierSz;
+static byte   mSrpCliPub[MAX_SECRET_SZ];
+static byte   mSrpSrvPub[MAX_SECRET_SZ];
+static byte   mSrpCliProof[SRP_MAX_DIGEST_SIZE];
+static byte   mSrpSrvProof[SRP_MAX_DIGEST_SIZE];
+static const char* kSrpUser = "device";
+static const char* kSrpPassword = "password";
+
+static int srp_params(Srp* srp)
+{
+    const DhParams* params = wc_Dh_ffdhe2048_Get();
+    int ret;
+
+    ret = wc_SrpSetUsername(srp, (const byte*)kSrpUser, XSTRLEN(kSrpUser));
+    if (ret == 0) {
+        ret = wc_SrpSetParams(srp, params->p, params->p_len, params->g,
+                              params->g_len, mSrpSalt, sizeof(mSrpSalt));
+    }
+    return ret;
+}
+
+/* Both sides of an exchange: the larger of client and server is measured */
+static int srp_exchange(void* arg)
+{
+    int ret;
+    word32 cliPubSz = (word32)sizeof(mSrpCliPub);
+    word32 srvPubSz = (word32)sizeof(mSrpSrvPub);
+    word32 cliProofSz = (word32)sizeof(mSrpCliProof);
+    word32 srvProofSz = (word32)sizeof(mSrpSrvProof);
+
+    ret = wc_SrpInit(&mSrpCli, SRP_TYPE_SHA256, SRP_CLIENT_SIDE);
+    if (ret != 0)
+        return ret;
+    ret = wc_SrpInit(&mSrpSrv, SRP_TYPE_SHA256, SRP_SERVER_SIDE);
+    if (ret != 0) {
+        wc_SrpTerm(&mSrpCli);
+        return ret;
+    }
+
+    ret = srp_params(&mSrpCli);
+    if (ret == 0)
+        ret = wc_SrpSetPassword(&mSrpCli, (const byte*)kSrpPassword,
+                                XSTRLEN(kSrpPassword));
+    if (ret == 0)
+        ret = wc_SrpGetPublic(&mSrpCli, mSrpCliPub, &cliPubSz);
+    if (ret == 0)
+        ret = srp_params(&mSrpSrv);
+    if (ret == 0)
+        ret = wc_SrpSetVerifier(&mSrpSrv, mSrpVerifier, mSrpVerifierSz);
+    if (ret == 0)
+        ret = wc_SrpGetPublic(&mSrpSrv, mSrpSrvPub, &srvPubSz);
+    if (ret == 0)
+        ret = wc_SrpComputeKey(&mSrpCli, mSrpCliPub, cliPubSz, mSrpSrvPub,
+                               srvPubSz);
+    if (ret == 0)
+        ret = wc_SrpGetProof(&mSrpCli, mSrpCliProof, &cliProofSz);
+    if (ret == 0)
+        ret = wc_SrpComputeKey(&mSrpSrv, mSrpCliPub, cliPubSz, mSrpSrvPub,
+                               srvPubSz);
+    if (ret == 0)
+        ret = wc_SrpVerifyPeersProof(&mSrpSrv, mSrpCliProof, cliProofSz);
+    if (ret == 0)
+        ret = wc_SrpGetProof(&mSrpSrv, mSrpSrvProof, &srvProofSz);
+    if (ret == 0)
+        ret = wc_SrpVerifyPeersProof(&mSrpCli, mSrpSrvProof, srvProofSz);
+
+    wc_SrpTerm(&mSrpSrv);
+    wc_SrpTerm(&mSrpCli);
+    (void)arg;
+    return ret;
+}
+
+static int srp_setup(void)
+{
+    int ret;
+
+    mSrpVerifierSz = (word32)sizeof(mSrpVerifier);
+    ret = wc_RNG_GenerateBlock(&mRng, mSrpSalt, sizeof(mSrpSalt));
+    if (ret == 0)
+        ret = wc_SrpInit(&mSrpCli, SRP_TYPE_SHA256, SRP_CLIENT_SIDE);
+    if (ret == 0) {
+        ret = srp_params(&mSrpCli);
+        if (ret == 0)
+            ret = wc_SrpSetPassword(&mSrpCli, (const byte*)kSrpPassword,
+                                    XSTRLEN(kSrpPassword));
+        if (ret == 0)
+            ret = wc_SrpGetVerifier(&mSrpCli, mSrpVerifier, &mSrpVerifierSz);
+        wc_SrpTerm(&mSrpCli);
+    }
+    return ret;
+}
+#define HAVE_SRP_OP
+#endif /* WOLFCRYPT_HAVE_SRP && HAVE_FFDHE_2048 */
+
+static PkOp mOps[MAX_OPS];
+static int  mNumOps;
+
+static void add_op(const char* name, pk_op_fn run, void* arg)
+{
+    if (mNumOps < MAX_OPS) {
+        snprintf(mOps[mNumOps].name, sizeof(mOps[mNumOps].name), "%s", name);
+        mOps[mNumOps].run = run;
+        mOps[mNumOps].arg = arg;
+        mNumOps++;
+    }
+}
+
+/* Make the keys and signatures used by the operations. An algorithm that
+ * fails to set up is left out of the table. */
+static void setup_ops(void)
+{
+    char name[32];
+#ifdef HAVE_ECC
+    int i;
+#endif
+
+#if !defined(NO_RSA) && defined(WOLFSSL_KEY_GEN)
+    if (rsa_setup() == 0) {
+        snprintf(name, sizeof(name), "RSA-%d keygen", mRsaBits);
+        add_op(name, rsa_keygen, NULL);
+        snprintf(name, sizeof(name), "RSA-%d sign", mRsaBits);
+        add_op(name, rsa_sign, NULL);
+        snprintf(name, sizeof(name), "RSA-%d verify", mRsaBits);
+        add_op(name, rsa_verify, NULL);
+    }
+    else {
+        printf("RSA-%d setup failed\n", mRsaBits);
+    }
+#endif
+#ifdef HAVE_ECC
+    for (i = 0; i < NUM_CURVES; i++) {
+        EccCurve* c = &mCurves[i];
+
+        if (ecc_setup(c) != 0 || !c->ready) {
+            printf("%s not available\n", c->name);
+            continue;
+        }
+        snprintf(name, sizeof(name), "ECC %s keygen", c->name);
+        add_op(name, ecc_keygen, c);
+        snprintf(name, sizeof(name), "ECC %s sign", c->name);
+        add_op(name, ecc_sign, c);
+        snprintf(name, sizeof(name), "ECC %s verify", c->name);
+        add_op(name, ecc_verify, c);
+    #ifdef HAVE_ECC_DHE
+        snprintf(name, sizeof(name), "ECC %s ECDH", c->name);
+        add_op(name, ecc_ecdh, c);
+    #endif
+    }
+#endif
+#if defined(HAVE_ED25519) && defined(HAVE_ED25519_SIGN) && \
+    defined(HAVE_ED25519_VERIFY)
+    if (ed25519_setup() == 0) {
+        add_op("Ed25519 keygen", ed25519_keygen, NULL);
+        add_op("Ed25519 sign", ed25519_sign, NULL);
+        add_op("Ed25519 verify", ed25519_verify, NULL);
+    }
+#endif
+#if defined(HAVE_ED448) && defined(HAVE_ED448_SIGN) && \
+    defined(HAVE_ED448_VERIFY)
+    if (ed448_setup() == 0) {
+        add_op("Ed448 keygen", ed448_keygen, NULL);
+        add_op("Ed448 sign", ed448_sign, NULL);
+        add_op("Ed448 verify", ed448_verify, NULL);
+    }
+#endif
+#ifdef HAVE_CURVE25519
+    if (x25519_setup() == 0) {
+        add_op("X25519 keygen", x25519_keygen, NULL);
+        add_op("X25519 shared", x25519_shared, NULL);
+    }
+#endif
+#if !defined(NO_DH) && defined(HAVE_FFDHE_2048)
+    if (dh_setup() == 0) {
+        add_op("DH-2048 keygen", dh_keygen, NULL);
+        add_op("DH-2048 agree", dh_agree, NULL);
+    }
+#endif
+#ifdef HAVE_SRP_OP
+    if (srp_setup() == 0) {
+        add_op("SRP-2048 exchange", srp_exchange, NULL);
+    }
+#endif
+    (void)name;
+}
+
+static void cleanup_ops(void)
+{
+#ifdef HAVE_ECC
+    int i;
+#endif
+
+#if !defined(NO_RSA) && defined(WOLFSSL_KEY_GEN)
+    wc_FreeRsaKey(&mRsaKey);
+#endif
+#ifdef HAVE_ECC
+    for (i = 0; i < NUM_CURVES; i++) {
+        if (mCurves[i].ready) {
+            wc_ecc_free(&mCurves[i].key);
+            wc_ecc_free(&mCurves[i].peer);
+        }
+    }
+#endif
+#if defined(HAVE_ED25519) && defined(HAVE_ED25519_SIGN) && \
+    defined(HAVE_ED25519_VERIFY)
+    wc_ed25519_free(&mEd25519);
+#endif
+#if defined(HAVE_ED448) && defined(HAVE_ED448_SIGN) && \
+    defined(HAVE_ED448_VERIFY)
+    wc_ed448_free(&mEd448);
+#endif
+#ifdef HAVE_CURVE25519
+    wc_curve25519_free(&mX25519);
+    wc_curve25519_free(&mX25519Peer);
+#endif
+#if !defined(NO_DH) && defined(HAVE_FFDHE_2048)
+    wc_FreeDhKey(&mDh);
+#endif
+}
+
+static void Usage(void)
+{
+    printf("pk-stack [options]\n");
+    printf("-s <bytes>  Stack given to each thread, default %d\n",
+           DEF_STACK_SZ);
+#if !defined(NO_RSA) && defined(WOLFSSL_KEY_GEN)
+    printf("-r <bits>   RSA key size, default %d\n", DEF_RSA_BITS);
+#endif
+    printf("-c          Output CSV\n");
+}
+
+int main(int argc, char** argv)
+{
+    int ret, ch, i, csv = 0;
+    size_t stackSz = DEF_STACK_SZ;
+    long base, used;
+    StackRun run;
+    PkOp none;
+
+    while ((ch = getopt(argc, argv, "?s:r:c")) != -1) {
+        switch (ch) {
+            case 's':
+                stackSz = (size_t)atol(optarg);
+                break;
+            case 'r':
+            #if !defined(NO_RSA) && defined(WOLFSSL_KEY_GEN)
+                mRsaBits = atoi(optarg);
+            #endif
+                break;
+            case 'c':
+                csv = 1;
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (stackSz < (size_t)PTHREAD_STACK_MIN) {
+        Usage();
+        return -1;
+    }
+
+#ifdef COUNT_HEAP
+    /* before any allocation, blocks must be freed by the allocator that
+     * made them */
+    ret = wolfSSL_SetAllocators(count_malloc, count_free, count_realloc);
+    if (ret != 0) {
+        printf("Set allocators failed %d\n", ret);
+        return -1;
+    }
+#endif
+
+    wolfCrypt_Init();
+
+    ret = wc_InitRng(&mRng);
+    if (ret == 0)
+        ret = wc_RNG_GenerateBlock(&mRng, mMsg, sizeof(mMsg));
+    if (ret != 0) {
+        printf("Init RNG failed %d\n", ret);
+        wolfCrypt_Cleanup();
+        return -1;
+    }
+
+    setup_ops();
+
+    /* stack used by an empty thread: thread start up and TLS */
+    XMEMSET(&none, 0, sizeof(none));
+    none.run = op_none;
+    XMEMSET(&run, 0, sizeof(run));
+    run.op = &none;
+    base = stack_check(&run, stackSz);
+    if (base < 0) {
+        printf("Unable to create thread with a %lu byte stack\n",
+               (unsigned long)stackSz);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        printf("Build: WOLFSSL_SMALL_STACK %s, SP math %s\n",
+        #ifdef WOLFSSL_SMALL_STACK
+               "yes",
+        #else
+               "no",
+        #endif
+        #if defined(WOLFSSL_SP_MATH_ALL) || defined(WOLFSSL_SP_MATH)
+               "yes"
+        #else
+               "no"
+        #endif
+              );
+        printf("Empty thread stack of %ld bytes subtracted\n\n", base);
+        if (csv)
+            printf("operation,stack,heap_peak,allocs,heap_left\n");
+        else
+            printf("%-22s %10s %10s %8s %10s\n", "Operation", "Stack",
+                   "Heap peak", "Allocs", "Heap left");
+    }
+
+    for (i = 0; i < mNumOps && ret == 0; i++) {
+        XMEMSET(&run, 0, sizeof(run));
+        run.op = &mOps[i];
+        used = stack_check(&run, stackSz);
+        if (used < 0) {
+            ret = -1;
+            break;
+        }
+        used -= base;
+        if (run.ret != 0) {
+            printf("%-22s failed %d: %s\n", mOps[i].name, run.ret,
+                   wc_GetErrorString(run.ret));
+            continue;
+        }
+        /* a stack that was touched up to the end may have overflowed */
+        if (used + base >= (long)stackSz)
+            printf("%-22s used all of the stack, increase -s\n",
+                   mOps[i].name);
+        else if (csv)
+            printf("%s,%ld,%u,%u,%u\n", mOps[i].name, used,
+                   run.heap.peakMem, run.heap.totalAlloc,
+                   run.heap.curAlloc);
+        else
+            printf("%-22s %10ld %10u %8u %10u\n", mOps[i].name, used,
+                   run.heap.peakMem, run.heap.totalAlloc,
+                   run.heap.curAlloc);
+    }
+
+#ifndef COUNT_HEAP
+    printf("\nHeap not counted: wolfSSL built with static memory or without "
+           "wolfSSL memory callbacks\n");
+#endif
+
+    cleanup_ops();
+    wc_FreeRng(&mRng);
+    wolfCrypt_Cleanup();
+
+    return ret;
+}
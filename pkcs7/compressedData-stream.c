@@ -0,0 +1,851 @@
+/* compressedData-stream.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * Streaming PKCS#7/CMS CompressedData (RFC 3274) with a configurable zlib
+ * compression level.
+ *
+ * wc_PKCS7_EncodeCompressedData() compresses the whole content in one call
+ * with the default zlib level. This example instead deflates the input in
+ * fixed size chunks, so memory use is bounded by the chunk size and the zlib
+ * window, writes the compressed stream to a temporary file and then writes
+ * the CompressedData header followed by the compressed stream. The result
+ * can be decoded with wc_PKCS7_DecodeCompressedData().
+ *
+ * wolfSSL's wc_DeCompress() inflates with a 2 KB window (windowBits 11), so
+ * the default window here is 11. Larger windows (-w) usually compress
+ * better but need more memory to decode, and the bundle can then only be
+ * decoded by an inflate with a larger window, such as the streaming
+ * decoder in this example.
+ *
+ * With -b the example compresses the same input at every level from 0 to 9
+ * and reports compressed size, ratio, compression and decompression speed
+ * and zlib heap use, next to wc_PKCS7_EncodeCompressedData().
+ *
+ * Without -i, -s MB of generated firmware-like content is used.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#define compressedFileStream "compressedDataStream.der"
+
+#define DEF_CHUNK_SZ     (16 * 1024)
+#define DEF_CONTENT_MB   4
+#define DEF_WINDOW_BITS  11      /* matches wolfSSL wc_DeCompress() */
+#define DEF_MEM_LEVEL    1       /* matches wolfSSL wc_Compress() */
+/* largest content also decoded in memory with wolfSSL for comparison */
+#define MAX_INMEM_SZ     (16 * 1024 * 1024)
+/* largest CompressedData header written by this example */
+#define MAX_HEADER_SZ    128
+
+#if defined(HAVE_PKCS7) && defined(HAVE_LIBZ) && \
+    !defined(NO_PKCS7_COMPRESSED_DATA) && !defined(NO_SHA256)
+
+/* id-ct-compressedData, 1.2.840.113549.1.9.16.1.9 */
+static const byte oidCompressedData[] =
+    { 0x06, 0x0B, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x09, 0x10, 0x01,
+      0x09 };
+/* id-alg-zlibCompress, 1.2.840.113549.1.9.16.3.8 */
+static const byte oidZlibCompress[] =
+    { 0x06, 0x0B, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x09, 0x10, 0x03,
+      0x08 };
+/* id-data, 1.2.840.113549.1.7.1 */
+static const byte oidData[] =
+    { 0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x01 };
+/* id-ct-firmwarePackage, 1.2.840.113549.1.9.16.1.16 */
+static const byte oidFirmwarePkg[] =
+    { 0x06, 0x0B, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x09, 0x10, 0x01,
+      0x10 };
+
+/* Content source, either a file or generated firmware-like data */
+typedef struct Source {
+    FILE*   file;
+    word64  remaining;  /* generated bytes left */
+    word32  state;      /* generator state */
+} Source;
+
+/* zlib heap accounting */
+typedef struct ZMem {
+    size_t  cur;
+    size_t  peak;
+} ZMem;
+
+typedef struct StreamStats {
+    word64  inSz;
+    word64  outSz;
+    double  seconds;    /* time spent in deflate()/inflate() only */
+    size_t  peakHeap;   /* peak zlib heap */
+    byte    hash[WC_SHA256_DIGEST_SIZE];   /* SHA-256 of the content */
+} StreamStats;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static voidpf zmem_alloc(voidpf opaque, uInt items, uInt size)
+{
+    ZMem* mem = (ZMem*)opaque;
+    size_t sz = (size_t)items * size;
+    size_t* p;
+
+    p = (size_t*)malloc(sz + sizeof(size_t));
+    if (p == NULL)
+        return Z_NULL;
+    p[0] = sz;
+    mem->cur += sz;
+    if (mem->cur > mem->peak)
+        mem->peak = mem->cur;
+
+    return p + 1;
+}
+
+static void zmem_free(voidpf opaque, voidpf ptr)
+{
+    ZMem* mem = (ZMem*)opaque;
+    size_t* p = (size_t*)ptr - 1;
+
+    mem->cur -= p[0];
+    free(p);
+}
+
+static word32 gen_next(Source* src)
+{
+    /* xorshift32, deterministic so each level sees the same input */
+    src->state ^= src->state << 13;
+    src->state ^= src->state >> 17;
+    src->state ^= src->state << 5;
+    return src->state;
+}
+
+/* Fill buf with content that compresses roughly like a firmware image:
+ * mostly repeated code-like words, some strings and some random data. */
+static word32 gen_read(Source* src, byte* buf, word32 sz)
+{
+    static const char* strs[] = { "ERROR: ", "flash", "boot", "update ",
+        "failed", "version ", "%s:%d ", "sensor", "config", "\n" };
+    word32 i = 0, n, r, kind;
+
+    if ((word64)sz > src->remaining)
+        sz = (word32)src->remaining;
+
+    while (i < sz) {
+        r = gen_next(src);
+        kind = r % 100;
+        n = 16 + ((r >> 8) % 240);
+        if (n > sz - i)
+            n = sz - i;
+
+        if (kind < 60) {
+            /* instruction-like words from a small set */
+            word32 j;
+            for (j = 0; j < n; j++)
+                buf[i + j] = (byte)(((r >> 16) + (j & 3) * 0x11) & 0x3F);
+        }
+        else if (kind < 85) {
+            word32 j = 0;
+            while (j < n) {
+                const char* s = strs[gen_next(src) % 10];
+                word32 l = (word32)strlen(s);
+                if (l > n - j)
+                    l = n - j;
+                memcpy(buf + i + j, s, l);
+                j += l;
+            }
+        }
+        else {
+            word32 j;
+            for (j = 0; j < n; j++)
+                buf[i + j] = (byte)gen_next(src);
+        }
+        i += n;
+    }
+
+    src->remaining -= sz;
+    return sz;
+}
+
+static word32 source_read(Source* src, byte* buf, word32 sz)
+{
+    if (src->file != NULL)
+        return (word32)fread(buf, 1, sz, src->file);
+    return gen_read(src, buf, sz);
+}
+
+static void source_reset(Source* src, word64 genSz)
+{
+    if (src->file != NULL)
+        rewind(src->file);
+    src->remaining = genSz;
+    src->state = 0x2545F491;
+}
+
+/* Deflate the source in chunks. Compressed output goes to out (if not NULL).
+ * Only input and output chunk buffers and the zlib state are held. */
+static int deflate_stream(Source* src, int level, int windowBits,
+                          int memLevel, word32 chunkSz, FILE* out,
+                          StreamStats* stats)
+{
+    int ret, flush;
+    z_stream strm;
+    ZMem mem;
+    wc_Sha256 sha;
+    byte* inBuf;
+    byte* outBuf;
+    word32 have;
+    double start;
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&mem, 0, sizeof(mem));
+    memset(&strm, 0, sizeof(strm));
+    strm.zalloc = zmem_alloc;
+    strm.zfree  = zmem_free;
+    strm.opaque = &mem;
+
+    inBuf  = (byte*)malloc(chunkSz);
+    outBuf = (byte*)malloc(chunkSz);
+    if (inBuf == NULL || outBuf == NULL) {
+        free(inBuf);
+        free(outBuf);
+        return MEMORY_E;
+    }
+
+    ret = wc_InitSha256(&sha);
+    if (ret == 0 && deflateInit2(&strm, level, Z_DEFLATED, windowBits,
+                                 memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+        printf("ERROR: deflateInit2() failed\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        do {
+            have = source_read(src, inBuf, chunkSz);
+            wc_Sha256Update(&sha, inBuf, have);
+            stats->inSz += have;
+            flush = (have < chunkSz) ? Z_FINISH : Z_NO_FLUSH;
+
+            strm.next_in  = inBuf;
+            strm.avail_in = have;
+            do {
+                strm.next_out  = outBuf;
+                strm.avail_out = chunkSz;
+
+                start = current_time();
+                if (deflate(&strm, flush) == Z_STREAM_ERROR)
+                    ret = -1;
+                stats->seconds += current_time() - start;
+
+                have = chunkSz - strm.avail_out;
+                stats->outSz += have;
+                if (out != NULL && have > 0 &&
+                        fwrite(outBuf, 1, have, out) != have) {
+                    printf("ERROR: writing compressed data\n");
+                    ret = -1;
+                }
+            } while (ret == 0 && strm.avail_out == 0);
+        } while (ret == 0 && flush != Z_FINISH);
+
+        deflateEnd(&strm);
+    }
+
+    if (ret == 0)
+        ret = wc_Sha256Final(&sha, stats->hash);
+    wc_Sha256Free(&sha);
+    stats->peakHeap = mem.peak;
+
+    free(inBuf);
+    free(outBuf);
+    return ret;
+}
+
+/* Inflate inSz bytes of zlib stream from in, in chunks, hashing output */
+static int inflate_stream(FILE* in, word64 inSz, word32 chunkSz,
+                          StreamStats* stats)
+{
+    int ret = 0, zret = Z_OK;
+    z_stream strm;
+    ZMem mem;
+    wc_Sha256 sha;
+    byte* inBuf;
+    byte* outBuf;
+    word32 have;
+    double start;
+
+    memset(stats, 0, sizeof(*stats));
+    memset(&mem, 0, sizeof(mem));
+    memset(&strm, 0, sizeof(strm));
+    strm.zalloc = zmem_alloc;
+    strm.zfree  = zmem_free;
+    strm.opaque = &mem;
+
+    inBuf  = (byte*)malloc(chunkSz);
+    outBuf = (byte*)malloc(chunkSz);
+    if (inBuf == NULL || outBuf == NULL) {
+        free(inBuf);
+        free(outBuf);
+        return MEMORY_E;
+    }
+
+    ret = wc_InitSha256(&sha);
+    /* windowBits 0 uses the window size from the zlib header, so inflate
+     * memory follows the window chosen by the encoder */
+    if (ret == 0 && inflateInit2(&strm, 0) != Z_OK) {
+        printf("ERROR: inflateInit2() failed\n");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        while (ret == 0 && zret != Z_STREAM_END && inSz > 0) {
+            have = (inSz < chunkSz) ? (word32)inSz : chunkSz;
+            if (fread(inBuf, 1, have, in) != have) {
+                ret = -1;
+                break;
+            }
+            inSz -= have;
+            stats->inSz += have;
+
+            strm.next_in  = inBuf;
+            strm.avail_in = have;
+            do {
+                strm.next_out  = outBuf;
+                strm.avail_out = chunkSz;
+
+                start = current_time();
+                zret = inflate(&strm, Z_NO_FLUSH);
+                stats->seconds += current_time() - start;
+                if (zret != Z_OK && zret != Z_STREAM_END &&
+                        zret != Z_BUF_ERROR) {
+                    printf("ERROR: inflate() failed, ret = %d\n", zret);
+                    ret = -1;
+                    break;
+                }
+
+                have = chunkSz - strm.avail_out;
+                stats->outSz += have;
+                wc_Sha256Update(&sha, outBuf, have);
+            } while (zret != Z_STREAM_END && strm.avail_out == 0);
+        }
+        if (ret == 0 && zret != Z_STREAM_END) {
+            printf("ERROR: truncated compressed stream\n");
+            ret = -1;
+        }
+        inflateEnd(&strm);
+    }
+
+    if (ret == 0)
+        ret = wc_Sha256Final(&sha, stats->hash);
+    wc_Sha256Free(&sha);
+    stats->peakHeap = mem.peak;
+
+    free(inBuf);
+    free(outBuf);
+    return ret;
+}
+
+static word32 set_header(byte tag, word64 len, byte* out)
+{
+    word32 i = 0, n = 0;
+    word64 t;
+
+    out[i++] = tag;
+    if (len < 0x80) {
+        out[i++] = (byte)len;
+        return i;
+    }
+    for (t = len; t > 0; t >>= 8)
+        n++;
+    out[i++] = (byte)(0x80 | n);
+    while (n-- > 0)
+        out[i++] = (byte)(len >> (8 * n));
+
+    return i;
+}
+
+static word32 header_size(word64 len)
+{
+    byte tmp[16];
+    return set_header(0, len, tmp);
+}
+
+/* Write the CompressedData DER header for compSz bytes of zlib stream */
+static word32 build_header(word64 compSz, int fpd, byte* out)
+{
+    const byte* oidContent = fpd ? oidFirmwarePkg : oidData;
+    word32 oidContentSz = fpd ? sizeof(oidFirmwarePkg) : sizeof(oidData);
+    word64 octetSz, explSz, encapSz, algSz, cdSz, outerSz, ciSz;
+    word32 i = 0;
+
+    octetSz = header_size(compSz) + compSz;
+    explSz  = header_size(octetSz) + octetSz;
+    encapSz = oidContentSz + explSz;
+    algSz   = sizeof(oidZlibCompress);
+    cdSz    = 3 + header_size(algSz) + algSz + header_size(encapSz) + encapSz;
+    outerSz = header_size(cdSz) + cdSz;
+    ciSz    = sizeof(oidCompressedData) + header_size(outerSz) + outerSz;
+
+    /* ContentInfo */
+    i += set_header(0x30, ciSz, out + i);
+    memcpy(out + i, oidCompressedData, sizeof(oidCompressedData));
+    i += sizeof(oidCompressedData);
+    i += set_header(0xA0, outerSz, out + i);
+    /* CompressedData */
+    i += set_header(0x30, cdSz, out + i);
+    out[i++] = 0x02; out[i++] = 0x01; out[i++] = 0x00;  /* version 0 */
+    i += set_header(0x30, algSz, out + i);
+    memcpy(out + i, oidZlibCompress, sizeof(oidZlibCompress));
+    i += sizeof(oidZlibCompress);
+    /* EncapsulatedContentInfo */
+    i += set_header(0x30, encapSz, out + i);
+    memcpy(out + i, oidContent, oidContentSz);
+    i += oidContentSz;
+    i += set_header(0xA0, octetSz, out + i);
+    i += set_header(0x04, compSz, out + i);
+
+    return i;
+}
+
+/* Read one TLV header from buf at *idx, checks the tag */
+static int get_header(const byte* buf, word32 bufSz, word32* idx, byte tag,
+                      word64* len)
+{
+    word32 i = *idx, n;
+
+    if (i + 2 > bufSz || buf[i] != tag)
+        return -1;
+    i++;
+    if (buf[i] < 0x80) {
+        *len = buf[i++];
+    }
+    else {
+        n = buf[i++] & 0x7F;
+        if (n == 0 || n > 8 || i + n > bufSz)
+            return -1;
+        *len = 0;
+        while (n-- > 0)
+            *len = (*len << 8) | buf[i++];
+    }
+    *idx = i;
+
+    return 0;
+}
+
+/* Locate the zlib stream inside a CompressedData bundle */
+static int find_compressed(const byte* hdr, word32 hdrSz, word32* offset,
+                           word64* compSz)
+{
+    word32 idx = 0;
+    word64 len;
+
+    if (get_header(hdr, hdrSz, &idx, 0x30, &len) != 0 ||   /* ContentInfo */
+        get_header(hdr, hdrSz, &idx, 0x06, &len) != 0)
+        return -1;
+    idx += (word32)len;
+    if (get_header(hdr, hdrSz, &idx, 0xA0, &len) != 0 ||
+        get_header(hdr, hdrSz, &idx, 0x30, &len) != 0 ||   /* CompressedData */
+        get_header(hdr, hdrSz, &idx, 0x02, &len) != 0)     /* version */
+        return -1;
+    idx += (word32)len;
+    if (get_header(hdr, hdrSz, &idx, 0x30, &len) != 0)     /* algorithm */
+        return -1;
+    idx += (word32)len;
+    if (get_header(hdr, hdrSz, &idx, 0x30, &len) != 0 ||   /* encapContent */
+        get_header(hdr, hdrSz, &idx, 0x06, &len) != 0)
+        return -1;
+    idx += (word32)len;
+    if (get_header(hdr, hdrSz, &idx, 0xA0, &len) != 0 ||
+        get_header(hdr, hdrSz, &idx, 0x04, compSz) != 0)
+        return -1;
+
+    *offset = idx;
+    return 0;
+}
+
+/* Compress the source into a CompressedData bundle at outFile */
+static int compressedData_encode_stream(Source* src, const char* outFile,
+                                        int level, int windowBits,
+                                        int memLevel, word32 chunkSz,
+                                        int fpd, StreamStats* stats)
+{
+    int ret;
+    FILE* tmp;
+    FILE* out;
+    byte hdr[MAX_HEADER_SZ];
+    byte* buf;
+    word32 hdrSz;
+    size_t n;
+
+    tmp = tmpfile();
+    if (tmp == NULL) {
+        printf("ERROR: unable to create temporary file\n");
+        return -1;
+    }
+
+    ret = deflate_stream(src, level, windowBits, memLevel, chunkSz, tmp,
+                         stats);
+    if (ret != 0) {
+        fclose(tmp);
+        return ret;
+    }
+
+    out = fopen(outFile, "wb");
+    if (out == NULL) {
+        printf("ERROR: opening file for writing: %s\n", outFile);
+        fclose(tmp);
+        return -1;
+    }
+
+    /* header, then the compressed stream copied in chunks */
+    hdrSz = build_header(stats->outSz, fpd, hdr);
+    if (fwrite(hdr, 1, hdrSz, out) != hdrSz)
+        ret = -1;
+
+    buf = (byte*)malloc(chunkSz);
+    if (buf == NULL)
+        ret = MEMORY_E;
+    rewind(tmp);
+    while (ret == 0 && (n = fread(buf, 1, chunkSz, tmp)) > 0) {
+        if (fwrite(buf, 1, n, out) != n)
+            ret = -1;
+    }
+    if (ret != 0)
+        printf("ERROR: writing CompressedData bundle\n");
+
+    free(buf);
+    fclose(out);
+    fclose(tmp);
+    return ret;
+}
+
+/* Stream decode a CompressedData bundle, hashing the content */
+static int compressedData_decode_stream(const char* inFile, word32 chunkSz,
+                                        StreamStats* stats)
+{
+    int ret;
+    FILE* in;
+    byte hdr[MAX_HEADER_SZ];
+    word32 hdrSz, offset;
+    word64 compSz;
+
+    in = fopen(inFile, "rb");
+    if (in == NULL) {
+        printf("ERROR: failed to open %s\n", inFile);
+        return -1;
+    }
+
+    hdrSz = (word32)fread(hdr, 1, sizeof(hdr), in);
+    ret = find_compressed(hdr, hdrSz, &offset, &compSz);
+    if (ret != 0) {
+        printf("ERROR: not a CompressedData bundle: %s\n", inFile);
+    }
+    else if (fseek(in, offset, SEEK_SET) != 0) {
+        ret = -1;
+    }
+    else {
+        ret = inflate_stream(in, compSz, chunkSz, stats);
+    }
+
+    fclose(in);
+    return ret;
+}
+
+/* Decode the bundle in memory with wc_PKCS7_DecodeCompressedData() */
+static int compressedData_decode_wolf(const char* inFile, word64 contentSz,
+                                      const byte* hash)
+{
+    int ret = -1;
+    FILE* in;
+    PKCS7* pkcs7 = NULL;
+    long inSz;
+    byte* inBuf = NULL;
+    byte* outBuf = NULL;
+    byte digest[WC_SHA256_DIGEST_SIZE];
+
+    in = fopen(inFile, "rb");
+    if (in == NULL)
+        return -1;
+    fseek(in, 0, SEEK_END);
+    inSz = ftell(in);
+    rewind(in);
+
+    inBuf = (byte*)malloc(inSz);
+    outBuf = (byte*)malloc(contentSz + 1);
+    if (inBuf != NULL && outBuf != NULL &&
+            fread(inBuf, 1, inSz, in) == (size_t)inSz)
+        pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    fclose(in);
+
+    if (pkcs7 != NULL) {
+        ret = wc_PKCS7_DecodeCompressedData(pkcs7, inBuf, (word32)inSz,
+                                            outBuf, (word32)contentSz + 1);
+        if (ret == (int)contentSz &&
+                wc_Sha256Hash(outBuf, ret, digest) == 0 &&
+                memcmp(digest, hash, sizeof(digest)) == 0)
+            ret = 0;
+        else if (ret >= 0)
+            ret = -1;
+        wc_PKCS7_Free(pkcs7);
+    }
+
+    free(inBuf);
+    free(outBuf);
+    return ret;
+}
+
+/* Compress at every level and print ratio against time */
+static int benchmark_levels(Source* src, word64 genSz, int windowBits,
+                            int memLevel, word32 chunkSz)
+{
+    int ret = 0, level;
+    FILE* tmp;
+    StreamStats enc, dec;
+    double mb;
+
+    printf("\n%5s %12s %7s %10s %10s %10s %10s\n", "level", "size",
+           "ratio", "comp MB/s", "dec MB/s", "deflate", "inflate");
+    printf("%5s %12s %7s %10s %10s %10s %10s\n", "", "bytes", "",
+           "", "", "heap", "heap");
+
+    for (level = 0; level <= 9 && ret == 0; level++) {
+        tmp = tmpfile();
+        if (tmp == NULL)
+            return -1;
+
+        source_reset(src, genSz);
+        ret = deflate_stream(src, level, windowBits, memLevel, chunkSz, tmp,
+                             &enc);
+        if (ret == 0) {
+            rewind(tmp);
+            ret = inflate_stream(tmp, enc.outSz, chunkSz, &dec);
+        }
+        if (ret == 0 && (dec.outSz != enc.inSz ||
+                memcmp(dec.hash, enc.hash, sizeof(enc.hash)) != 0)) {
+            printf("ERROR: level %d round trip mismatch\n", level);
+            ret = -1;
+        }
+        fclose(tmp);
+        if (ret != 0)
+            break;
+
+        mb = enc.inSz / (1024.0 * 1024.0);
+        printf("%5d %12llu %6.2fx %10.1f %10.1f %9luK %9luK\n", level,
+               (unsigned long long)enc.outSz,
+               enc.outSz ? (double)enc.inSz / enc.outSz : 0.0,
+               mb / enc.seconds, mb / dec.seconds,
+               (unsigned long)(enc.peakHeap / 1024),
+               (unsigned long)(dec.peakHeap / 1024));
+    }
+
+    /* one-shot wolfSSL CompressedData for comparison */
+    if (ret == 0 && enc.inSz <= MAX_INMEM_SZ) {
+        PKCS7* pkcs7;
+        byte* inBuf = (byte*)malloc(enc.inSz);
+        byte* outBuf = (byte*)malloc(enc.inSz + 1024);
+        double start, t;
+        int outSz = -1;
+
+        pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+        source_reset(src, genSz);
+        if (pkcs7 != NULL && inBuf != NULL && outBuf != NULL &&
+                source_read(src, inBuf, (word32)enc.inSz) == enc.inSz) {
+            pkcs7->content    = inBuf;
+            pkcs7->contentSz  = (word32)enc.inSz;
+            pkcs7->contentOID = DATA;
+
+            start = current_time();
+            outSz = wc_PKCS7_EncodeCompressedData(pkcs7, outBuf,
+                                                  (word32)enc.inSz + 1024);
+            t = current_time() - start;
+            if (outSz > 0) {
+                printf("%5s %12d %6.2fx %10.1f %10s %10s %10s\n", "wolf",
+                       outSz, (double)enc.inSz / outSz,
+                       (enc.inSz / (1024.0 * 1024.0)) / t, "-", "-", "-");
+            }
+        }
+        if (outSz <= 0)
+            printf("wc_PKCS7_EncodeCompressedData() failed, ret = %d\n",
+                   outSz);
+
+        wc_PKCS7_Free(pkcs7);
+        free(inBuf);
+        free(outBuf);
+    }
+
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("compressedData-stream [options]\n");
+    printf("-i <file>   Content to compress, default generated content\n");
+    printf("-s <MB>     Size of generated content, default %d\n",
+           DEF_CONTENT_MB);
+    printf("-o <file>   Output bundle, default %s\n", compressedFileStream);
+    printf("-l <level>  zlib compression level 0-9, default %d\n",
+           Z_DEFAULT_COMPRESSION);
+    printf("-w <bits>   zlib window bits 9-15, default %d\n",
+           DEF_WINDOW_BITS);
+    printf("-m <level>  zlib memory level 1-9, default %d\n", DEF_MEM_LEVEL);
+    printf("-c <bytes>  Chunk size, default %d\n", DEF_CHUNK_SZ);
+    printf("-f          Content type FirmwarePkgData instead of Data\n");
+    printf("-b          Benchmark all compression levels\n");
+}
+
+int main(int argc, char** argv)
+{
+    int ret, ch;
+    int level = Z_DEFAULT_COMPRESSION;
+    int windowBits = DEF_WINDOW_BITS;
+    int memLevel = DEF_MEM_LEVEL;
+    int fpd = 0, bench = 0;
+    word32 chunkSz = DEF_CHUNK_SZ;
+    word64 genSz = (word64)DEF_CONTENT_MB * 1024 * 1024;
+    const char* inFile = NULL;
+    const char* outFile = compressedFileStream;
+    Source src;
+    StreamStats enc, dec;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?i:s:o:l:w:m:c:fb")) != -1) {
+        switch (ch) {
+            case 'i':
+                inFile = optarg;
+                break;
+            case 's':
+                genSz = (word64)atoi(optarg) * 1024 * 1024;
+                break;
+            case 'o':
+                outFile = optarg;
+                break;
+            case 'l':
+                level = atoi(optarg);
+                break;
+            case 'w':
+                windowBits = atoi(optarg);
+                break;
+            case 'm':
+                memLevel = atoi(optarg);
+                break;
+            case 'c':
+                chunkSz = (word32)atoi(optarg);
+                break;
+            case 'f':
+                fpd = 1;
+                break;
+            case 'b':
+                bench = 1;
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (level < Z_DEFAULT_COMPRESSION || level > 9 || windowBits < 9 ||
+            windowBits > 15 || memLevel < 1 || memLevel > 9 ||
+            chunkSz == 0 || genSz == 0) {
+        Usage();
+        return -1;
+    }
+
+    memset(&src, 0, sizeof(src));
+    if (inFile != NULL) {
+        src.file = fopen(inFile, "rb");
+        if (src.file == NULL) {
+            printf("ERROR: failed to open %s\n", inFile);
+            return -1;
+        }
+    }
+
+    if (bench) {
+        printf("Content: %s, window bits %d, memory level %d, chunk %u\n",
+               inFile ? inFile : "generated", windowBits, memLevel, chunkSz);
+        ret = benchmark_levels(&src, genSz, windowBits, memLevel, chunkSz);
+        if (src.file != NULL)
+            fclose(src.file);
+        return ret == 0 ? 0 : -1;
+    }
+
+    source_reset(&src, genSz);
+    ret = compressedData_encode_stream(&src, outFile, level, windowBits,
+                                       memLevel, chunkSz, fpd, &enc);
+    if (src.file != NULL)
+        fclose(src.file);
+    if (ret != 0) {
+        printf("Failed to encode CompressedData bundle\n");
+        return -1;
+    }
+    printf("Successfully encoded CompressedData bundle (%s)\n", outFile);
+    printf("    %llu -> %llu bytes (%.2fx), %.1f MB/s, zlib heap %luK\n",
+           (unsigned long long)enc.inSz, (unsigned long long)enc.outSz,
+           enc.outSz ? (double)enc.inSz / enc.outSz : 0.0,
+           (enc.inSz / (1024.0 * 1024.0)) / enc.seconds,
+           (unsigned long)(enc.peakHeap / 1024));
+
+    ret = compressedData_decode_stream(outFile, chunkSz, &dec);
+    if (ret != 0 || dec.outSz != enc.inSz ||
+            memcmp(dec.hash, enc.hash, sizeof(enc.hash)) != 0) {
+        printf("Failed to decode CompressedData bundle (%s)\n", outFile);
+        return -1;
+    }
+    printf("Successfully decoded CompressedData bundle (%s)\n", outFile);
+    printf("    %.1f MB/s, zlib heap %luK\n",
+           (dec.outSz / (1024.0 * 1024.0)) / dec.seconds,
+           (unsigned long)(dec.peakHeap / 1024));
+
+    /* cross check with the wolfSSL decoder when it can be used */
+    if (windowBits <= DEF_WINDOW_BITS && enc.inSz <= MAX_INMEM_SZ) {
+        if (compressedData_decode_wolf(outFile, enc.inSz, enc.hash) != 0) {
+            printf("Failed to decode CompressedData bundle with "
+                   "wc_PKCS7_DecodeCompressedData()\n");
+            return -1;
+        }
+        printf("Successfully decoded with wc_PKCS7_DecodeCompressedData()\n");
+    }
+
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7 --with-libz\n");
+    return 0;
+}
+
+#endif /* HAVE_PKCS7 & HAVE_LIBZ & !NO_PKCS7_COMPRESSED_DATA */
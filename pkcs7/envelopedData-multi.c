@@ -0,0 +1,504 @@
+/* envelopedData-multi.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * Creates EnvelopedData bundles with a growing number of mixed recipients
+ * (KTRI using RSA, KARI using ECDH, KEKRI using AES key wrap) and measures
+ * how encoding time scales with the recipient count.
+ *
+ * A single content encryption key (CEK) is generated per bundle and wrapped
+ * for every recipient as it is added, so the time spent in each
+ * wc_PKCS7_AddRecipient_*() call is the per-recipient overhead for that
+ * RecipientInfo type. The time spent in wc_PKCS7_EncodeEnvelopedData() is
+ * the content encryption and final encoding.
+ *
+ * By default every recipient certificate is read from disk when it is added,
+ * as a naive distribution system would. With -p the certificate files are
+ * pre-loaded once and kept in memory, which only saves the file reads.
+ * Nothing is precomputed: wc_PKCS7_AddRecipient_KTRI/KARI take the DER
+ * certificate and wolfCrypt parses it and decodes the public key for every
+ * recipient, as there is no API to add a recipient from a decoded key. The
+ * cost of that parse is measured and reported separately.
+ *
+ * This is only provided as an example and may need modification if integrated
+ * into a production application.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#define rsaCertFile "../certs/client-cert.der"
+#define rsaKeyFile  "../certs/client-key.der"
+#define eccCertFile "../certs/client-ecc-cert.der"
+
+#define encodedFileMulti "envelopedDataMulti.der"
+
+/* Default maximum number of recipients */
+#define DEF_MAX_RECIPIENTS 1000
+/* Default content size in bytes */
+#define DEF_CONTENT_SZ     (64 * 1024)
+/* Default number of bundles created for each recipient count */
+#define DEF_ITERATIONS     3
+/* Worst case encoded size of a single RecipientInfo */
+#define MAX_RECIP_SZ       1024
+
+/* recipient type mask bits */
+#define RECIP_KTRI  0x1
+#define RECIP_KARI  0x2
+#define RECIP_KEKRI 0x4
+
+#if defined(HAVE_PKCS7) && !defined(NO_RSA) && defined(HAVE_ECC) && \
+    defined(HAVE_AES_KEYWRAP)
+
+typedef struct RecipTimes {
+    double ktri, kari, kekri;
+    long   ktriCnt, kariCnt, kekriCnt;
+    double encode;
+} RecipTimes;
+
+static byte* rsaCert = NULL;
+static word32 rsaCertSz = 0;
+static byte* eccCert = NULL;
+static word32 eccCertSz = 0;
+static int preload = 0;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int read_file(const char* fileName, byte** buf, word32* bufSz)
+{
+    FILE* file;
+    long sz;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL) {
+        printf("ERROR: failed to open file: %s\n", fileName);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    sz = ftell(file);
+    rewind(file);
+
+    if (sz <= 0) {
+        fclose(file);
+        return -1;
+    }
+
+    *buf = (byte*)XMALLOC(sz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (*buf == NULL) {
+        fclose(file);
+        return MEMORY_E;
+    }
+    *bufSz = (word32)fread(*buf, 1, sz, file);
+    fclose(file);
+
+    if (*bufSz != (word32)sz) {
+        printf("ERROR: failed to read file: %s\n", fileName);
+        XFREE(*buf, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        *buf = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int write_file_buffer(const char* fileName, byte* in, word32 inSz)
+{
+    int ret;
+    FILE* file;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) {
+        printf("ERROR: opening file for writing: %s\n", fileName);
+        return -1;
+    }
+
+    ret = (int)fwrite(in, 1, inSz, file);
+    fclose(file);
+    if (ret != (int)inSz) {
+        printf("ERROR: writing buffer to output file\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Get the recipient certificate, either from the pre-loaded copy or by
+ * reading it from disk as a naive application would. */
+static int get_recip_cert(const char* fileName, byte* cached, word32 cachedSz,
+                          byte** cert, word32* certSz, int* allocated)
+{
+    if (preload) {
+        *cert = cached;
+        *certSz = cachedSz;
+        *allocated = 0;
+        return 0;
+    }
+
+    *allocated = 1;
+    return read_file(fileName, cert, certSz);
+}
+
+static int add_recipient(PKCS7* pkcs7, int idx, int typeMask, WC_RNG* rng,
+                         RecipTimes* t)
+{
+    int ret = 0;
+    int type;
+    int allocated = 0;
+    byte* cert = NULL;
+    word32 certSz = 0;
+    byte kek[32];
+    byte keyId[8];
+    double start;
+
+    /* pick recipient type round-robin over the enabled types */
+    do {
+        type = 1 << (idx % 3);
+        idx++;
+    } while ((type & typeMask) == 0);
+
+    start = current_time();
+
+    if (type == RECIP_KTRI) {
+        ret = get_recip_cert(rsaCertFile, rsaCert, rsaCertSz, &cert,
+                             &certSz, &allocated);
+        if (ret == 0)
+            ret = wc_PKCS7_AddRecipient_KTRI(pkcs7, cert, certSz, 0);
+        t->ktri += current_time() - start;
+        t->ktriCnt++;
+    }
+    else if (type == RECIP_KARI) {
+        ret = get_recip_cert(eccCertFile, eccCert, eccCertSz, &cert,
+                             &certSz, &allocated);
+        if (ret == 0) {
+            ret = wc_PKCS7_AddRecipient_KARI(pkcs7, cert, certSz, AES256_WRAP,
+                                    dhSinglePass_stdDH_sha256kdf_scheme,
+                                    NULL, 0, 0);
+        }
+        t->kari += current_time() - start;
+        t->kariCnt++;
+    }
+    else {
+        /* each KEKRI recipient has its own key encryption key */
+        ret = wc_RNG_GenerateBlock(rng, kek, sizeof(kek));
+        if (ret == 0)
+            ret = wc_RNG_GenerateBlock(rng, keyId, sizeof(keyId));
+        start = current_time();
+        if (ret == 0) {
+            ret = wc_PKCS7_AddRecipient_KEKRI(pkcs7, AES256_WRAP, kek,
+                                    sizeof(kek), keyId, sizeof(keyId),
+                                    NULL, NULL, 0, NULL, 0, 0);
+        }
+        t->kekri += current_time() - start;
+        t->kekriCnt++;
+    }
+
+    if (allocated)
+        XFREE(cert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    if (ret < 0) {
+        printf("ERROR: adding recipient %d (type %d) failed, ret = %d\n",
+               idx, type, ret);
+        return ret;
+    }
+    return 0;
+}
+
+/* Create one EnvelopedData bundle with numRecips recipients. Returns the
+ * encoded size. */
+static int envelopedData_encrypt(int numRecips, int typeMask, byte* content,
+                                 word32 contentSz, byte* out, word32 outSz,
+                                 WC_RNG* rng, RecipTimes* t)
+{
+    int ret = 0;
+    int i;
+    PKCS7* pkcs7;
+    double start;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    pkcs7->content     = content;
+    pkcs7->contentSz   = contentSz;
+    pkcs7->contentOID  = DATA;
+    pkcs7->encryptOID  = AES256CBCb;
+    pkcs7->rng         = rng;
+
+    /* the CEK is generated on the first add and reused for all recipients */
+    for (i = 0; i < numRecips && ret == 0; i++)
+        ret = add_recipient(pkcs7, i, typeMask, rng, t);
+
+    if (ret == 0) {
+        start = current_time();
+        ret = wc_PKCS7_EncodeEnvelopedData(pkcs7, out, outSz);
+        t->encode += current_time() - start;
+        if (ret <= 0)
+            printf("wc_PKCS7_EncodeEnvelopedData() failed, ret = %d\n", ret);
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+/* Decrypt as the RSA (KTRI) recipient to confirm the bundle is usable. */
+static int envelopedData_decrypt(byte* in, word32 inSz, byte* key,
+                                 word32 keySz, byte* expected, word32 expSz,
+                                 WC_RNG* rng)
+{
+    int ret;
+    PKCS7* pkcs7;
+    byte* out;
+
+    out = (byte*)XMALLOC(expSz + 32, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (out == NULL)
+        return MEMORY_E;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL) {
+        XFREE(out, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        return MEMORY_E;
+    }
+
+    ret = wc_PKCS7_InitWithCert(pkcs7, rsaCert, rsaCertSz);
+    if (ret == 0)
+        ret = wc_PKCS7_SetKey(pkcs7, key, keySz);
+    if (ret == 0) {
+        pkcs7->rng = rng;
+        ret = wc_PKCS7_DecodeEnvelopedData(pkcs7, in, inSz, out, expSz + 32);
+        if (ret != (int)expSz || XMEMCMP(out, expected, expSz) != 0) {
+            printf("ERROR: wc_PKCS7_DecodeEnvelopedData(), ret = %d\n", ret);
+            ret = -1;
+        }
+        else {
+            ret = 0;
+        }
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    XFREE(out, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    return ret;
+}
+
+/* Average cost of the certificate parse done inside AddRecipient, measured
+ * via wc_PKCS7_InitWithCert() which performs the same decode. */
+static double cert_parse_time(byte* cert, word32 certSz, int count)
+{
+    int i;
+    PKCS7* pkcs7;
+    double start, total = 0;
+
+    for (i = 0; i < count; i++) {
+        pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+        if (pkcs7 == NULL)
+            return 0;
+        start = current_time();
+        wc_PKCS7_InitWithCert(pkcs7, cert, certSz);
+        total += current_time() - start;
+        wc_PKCS7_Free(pkcs7);
+    }
+
+    return total / count;
+}
+
+static double per_recip_us(double t, long cnt)
+{
+    return cnt > 0 ? (t * 1000000.0) / cnt : 0.0;
+}
+
+static void Usage(void)
+{
+    printf("envelopedData-multi [options]\n");
+    printf("-n <num>    Maximum number of recipients, default %d\n",
+           DEF_MAX_RECIPIENTS);
+    printf("-s <bytes>  Content size, default %d\n", DEF_CONTENT_SZ);
+    printf("-i <num>    Bundles per recipient count, default %d\n",
+           DEF_ITERATIONS);
+    printf("-m <mask>   Recipient types: 1=KTRI 2=KARI 4=KEKRI, default 7\n");
+    printf("-p          Pre-load recipient certificate files, "
+           "still parsed per recipient\n");
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int ch;
+    int i, n;
+    int maxRecips = DEF_MAX_RECIPIENTS;
+    int iterations = DEF_ITERATIONS;
+    int typeMask = RECIP_KTRI | RECIP_KARI | RECIP_KEKRI;
+    word32 contentSz = DEF_CONTENT_SZ;
+    byte* content = NULL;
+    byte* out = NULL;
+    word32 outSz;
+    byte* rsaKey = NULL;
+    word32 rsaKeySz = 0;
+    int encodedSz = 0;
+    double total;
+    RecipTimes t;
+    WC_RNG rng;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?n:s:i:m:p")) != -1) {
+        switch (ch) {
+            case 'n':
+                maxRecips = atoi(optarg);
+                break;
+            case 's':
+                contentSz = (word32)atoi(optarg);
+                break;
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+            case 'm':
+                typeMask = atoi(optarg) & 0x7;
+                break;
+            case 'p':
+                preload = 1;
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (maxRecips <= 0 || iterations <= 0 || contentSz == 0 || typeMask == 0) {
+        Usage();
+        return -1;
+    }
+
+    /* certificates are always loaded once for the decrypt check and for
+     * the -p pre-loaded path */
+    if (read_file(rsaCertFile, &rsaCert, &rsaCertSz) != 0 ||
+        read_file(eccCertFile, &eccCert, &eccCertSz) != 0 ||
+        read_file(rsaKeyFile, &rsaKey, &rsaKeySz) != 0) {
+        ret = -1;
+    }
+    else {
+        ret = wc_InitRng(&rng);
+        if (ret != 0)
+            printf("wc_InitRng() failed, ret = %d\n", ret);
+    }
+    if (ret != 0) {
+        XFREE(rsaKey, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        XFREE(eccCert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        XFREE(rsaCert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        return -1;
+    }
+
+    content = (byte*)XMALLOC(contentSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    outSz = contentSz + 1024 + (word32)maxRecips * MAX_RECIP_SZ;
+    out = (byte*)XMALLOC(outSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (content == NULL || out == NULL) {
+        ret = MEMORY_E;
+        goto exit;
+    }
+    ret = wc_RNG_GenerateBlock(&rng, content, contentSz);
+    if (ret != 0)
+        goto exit;
+
+    printf("Content size %u bytes, recipient certs %s\n", contentSz,
+           preload ? "pre-loaded in memory" : "read per recipient");
+    printf("Cert parse inside AddRecipient: RSA %.1f us, ECC %.1f us\n\n",
+           cert_parse_time(rsaCert, rsaCertSz, 100) * 1000000.0,
+           cert_parse_time(eccCert, eccCertSz, 100) * 1000000.0);
+
+    printf("%10s %12s %12s %12s %12s %12s %12s\n", "recipients",
+           "KTRI us/rcp", "KARI us/rcp", "KEKRI us/rcp", "encode ms",
+           "total ms", "bytes");
+
+    for (n = 1; ret == 0; n *= 10) {
+        if (n > maxRecips)
+            n = maxRecips;
+
+        XMEMSET(&t, 0, sizeof(t));
+        for (i = 0; i < iterations && ret == 0; i++) {
+            encodedSz = envelopedData_encrypt(n, typeMask, content,
+                                              contentSz, out, outSz, &rng,
+                                              &t);
+            if (encodedSz <= 0)
+                ret = -1;
+        }
+        if (ret != 0)
+            break;
+
+        total = (t.ktri + t.kari + t.kekri + t.encode) / iterations;
+        printf("%10d %12.1f %12.1f %12.1f %12.3f %12.3f %12d\n", n,
+               per_recip_us(t.ktri, t.ktriCnt),
+               per_recip_us(t.kari, t.kariCnt),
+               per_recip_us(t.kekri, t.kekriCnt),
+               t.encode * 1000.0 / iterations, total * 1000.0, encodedSz);
+
+        if (n == maxRecips)
+            break;
+    }
+    if (ret != 0)
+        goto exit;
+
+    /* the last bundle has maxRecips recipients */
+    if (write_file_buffer(encodedFileMulti, out, encodedSz) != 0) {
+        ret = -1;
+        goto exit;
+    }
+
+    if (typeMask & RECIP_KTRI) {
+        ret = envelopedData_decrypt(out, encodedSz, rsaKey, rsaKeySz,
+                                    content, contentSz, &rng);
+        if (ret == 0) {
+            printf("\nSuccessfully decoded EnvelopedData bundle (%s)\n",
+                   encodedFileMulti);
+        }
+    }
+
+exit:
+    XFREE(out, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(content, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(rsaKey, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(eccCert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(rsaCert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    wc_FreeRng(&rng);
+
+    return ret;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7\n");
+    return 0;
+}
+
+#endif
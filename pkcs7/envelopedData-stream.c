@@ -0,0 +1,594 @@
+/* envelopedData-stream.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * Streaming decryption of EnvelopedData and AuthEnvelopedData bundles to a
+ * file. The encoded bundle is read from disk in fixed size chunks and fed
+ * into wc_PKCS7_DecodeEnvelopedData() / wc_PKCS7_DecodeAuthEnvelopedData(),
+ * which return WC_PKCS7_WANT_READ_E until they have enough input to make
+ * progress. The whole bundle never has to be held in memory.
+ *
+ * When wolfSSL provides a stream output callback (wc_PKCS7_SetStreamMode(),
+ * wolfSSL 5.7.0 or later built with ASN_BER_TO_DER), EnvelopedData plaintext
+ * is written to the output file as it is decrypted, so peak memory is
+ * bounded by the chunk size. wolfCrypt has no such callback for
+ * AuthEnvelopedData, or for EnvelopedData on older versions: there the
+ * plaintext is only returned once decoding completes, so it is collected in
+ * an output buffer capped at -m MB. Larger bundles are rejected up front
+ * instead of growing memory use with the bundle size.
+ *
+ * AuthEnvelopedData plaintext is not released until the authentication tag
+ * has been verified: it is written to "<output>.part" and only renamed to
+ * the requested output file after wolfCrypt reports success. On failure the
+ * partial file is removed.
+ *
+ * Without -i, the example first creates test bundles with -s MB of random
+ * content, then decrypts them and compares the SHA-256 of the output with
+ * the original content. The bundles are created in a child process so the
+ * content and encode buffers don't show in the peak RSS of the decoder.
+ *
+ * This is only provided as an example and may need modification if integrated
+ * into a production application.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/version.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#define certFile "../certs/client-cert.der"
+#define keyFile  "../certs/client-key.der"
+
+#define encodedFileStream     "envelopedDataStream.der"
+#define encodedFileAuthStream "authEnvelopedDataStream.der"
+#define decodedFileStream     "envelopedDataStream.dec"
+#define decodedFileAuthStream "authEnvelopedDataStream.dec"
+
+/* Default input chunk size */
+#define DEF_CHUNK_SZ    (64 * 1024)
+/* Default generated content size, in MB */
+#define DEF_CONTENT_MB  16
+/* Default cap on plaintext collected in memory without a stream callback */
+#define DEF_MAX_BUFFERED_MB 64
+/* PKCS#7 lengths in wolfCrypt are 32-bit */
+#define MAX_BUNDLE_SZ   0xFFFFFFFFUL
+
+#if defined(HAVE_PKCS7) && !defined(NO_PKCS7_STREAM) && !defined(NO_RSA) && \
+    !defined(NO_SHA256)
+
+#if defined(ASN_BER_TO_DER) && defined(LIBWOLFSSL_VERSION_HEX) && \
+    LIBWOLFSSL_VERSION_HEX >= 0x05007000
+    #define HAVE_STREAM_OUT_CB
+#endif
+
+typedef struct StreamSink {
+    FILE*      file;
+    wc_Sha256  sha;
+    word64     total;
+} StreamSink;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static long peak_rss_kb(void)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+static int load_certs(byte* cert, word32* certSz, byte* key, word32* keySz)
+{
+    FILE* file;
+
+    /* certificate file */
+    file = fopen(certFile, "rb");
+    if (!file) {
+        printf("ERROR: failed to open file: %s\n", certFile);
+        return -1;
+    }
+
+    *certSz = (word32)fread(cert, 1, *certSz, file);
+    fclose(file);
+
+    /* key file */
+    file = fopen(keyFile, "rb");
+    if (!file) {
+        printf("ERROR: failed to open file: %s\n", keyFile);
+        return -1;
+    }
+
+    *keySz = (word32)fread(key, 1, *keySz, file);
+    fclose(file);
+
+    return 0;
+}
+
+static int write_file_buffer(const char* fileName, byte* in, word32 inSz)
+{
+    int ret;
+    FILE* file;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) {
+        printf("ERROR: opening file for writing: %s\n", fileName);
+        return -1;
+    }
+
+    ret = (int)fwrite(in, 1, inSz, file);
+    if (ret == 0) {
+        printf("ERROR: writing buffer to output file\n");
+        return -1;
+    }
+    fclose(file);
+
+    return 0;
+}
+
+static int sink_write(StreamSink* sink, const byte* data, word32 dataSz)
+{
+    if (dataSz == 0)
+        return 0;
+    if (fwrite(data, 1, dataSz, sink->file) != dataSz)
+        return -1;
+    sink->total += dataSz;
+    return wc_Sha256Update(&sink->sha, data, dataSz);
+}
+
+#ifdef HAVE_STREAM_OUT_CB
+/* Called by wolfCrypt with each block of decrypted content */
+static int stream_out_cb(PKCS7* pkcs7, const byte* output, word32 outputSz,
+                         void* ctx)
+{
+    (void)pkcs7;
+    return sink_write((StreamSink*)ctx, output, outputSz);
+}
+#endif
+
+/* Create a test bundle with random content. Returns SHA-256 of content. */
+static int create_bundle(const char* fileName, int auth, word32 contentSz,
+                         byte* cert, word32 certSz, byte* hash)
+{
+    int ret;
+    int encodedSz = 0;
+    PKCS7* pkcs7 = NULL;
+    WC_RNG rng;
+    byte* content;
+    byte* out;
+    word32 outSz = contentSz + 4096;
+
+    content = (byte*)XMALLOC(contentSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    out = (byte*)XMALLOC(outSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (content == NULL || out == NULL) {
+        XFREE(content, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        XFREE(out, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        return MEMORY_E;
+    }
+
+    ret = wc_InitRng(&rng);
+    if (ret == 0)
+        ret = wc_RNG_GenerateBlock(&rng, content, contentSz);
+    if (ret == 0)
+        ret = wc_Sha256Hash(content, contentSz, hash);
+
+    if (ret == 0) {
+        pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+        if (pkcs7 == NULL)
+            ret = MEMORY_E;
+    }
+    if (ret == 0) {
+        pkcs7->content     = content;
+        pkcs7->contentSz   = contentSz;
+        pkcs7->contentOID  = DATA;
+        pkcs7->encryptOID  = auth ? AES256GCMb : AES256CBCb;
+        pkcs7->rng         = &rng;
+
+        ret = wc_PKCS7_AddRecipient_KTRI(pkcs7, cert, certSz, 0);
+        if (ret < 0)
+            printf("wc_PKCS7_AddRecipient_KTRI() failed, ret = %d\n", ret);
+    }
+    if (ret >= 0) {
+        if (auth)
+            encodedSz = wc_PKCS7_EncodeAuthEnvelopedData(pkcs7, out, outSz);
+        else
+            encodedSz = wc_PKCS7_EncodeEnvelopedData(pkcs7, out, outSz);
+        if (encodedSz <= 0) {
+            printf("ERROR: encoding bundle failed, ret = %d\n", encodedSz);
+            ret = -1;
+        }
+    }
+    if (ret >= 0) {
+        ret = write_file_buffer(fileName, out, (word32)encodedSz);
+        if (ret == 0) {
+            printf("Successfully encoded %s bundle (%s), %u byte content\n",
+                   auth ? "AuthEnvelopedData" : "EnvelopedData", fileName,
+                   contentSz);
+        }
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    wc_FreeRng(&rng);
+    XFREE(out, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(content, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return ret < 0 ? ret : 0;
+}
+
+/* Run create_bundle() in a child process, the content hash comes back
+ * through a pipe */
+static int create_bundle_child(const char* fileName, int auth,
+                               word32 contentSz, byte* cert, word32 certSz,
+                               byte* hash)
+{
+    int ret;
+    int fd[2];
+    int status;
+    pid_t pid;
+    ssize_t rd;
+
+    if (pipe(fd) != 0)
+        return -1;
+    pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fd[0]);
+        ret = create_bundle(fileName, auth, contentSz, cert, certSz, hash);
+        if (ret == 0 && write(fd[1], hash, WC_SHA256_DIGEST_SIZE) !=
+                WC_SHA256_DIGEST_SIZE) {
+            ret = -1;
+        }
+        close(fd[1]);
+        fflush(stdout);
+        _exit(ret == 0 ? 0 : 1);
+    }
+
+    close(fd[1]);
+    rd = read(fd[0], hash, WC_SHA256_DIGEST_SIZE);
+    close(fd[0]);
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0 || rd != WC_SHA256_DIGEST_SIZE) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Decrypt inFile to outFile, feeding the decoder chunkSz bytes at a time.
+ * Without the stream callback the plaintext is collected in a buffer of at
+ * most maxBuffered bytes. The SHA-256 of the plaintext is returned in hash. */
+static int stream_decrypt(const char* inFile, const char* outFile, int auth,
+                          word32 chunkSz, word32 maxBuffered, byte* cert,
+                          word32 certSz, byte* key, word32 keySz, byte* hash)
+{
+    int ret;
+    int useCb = 0;
+    PKCS7* pkcs7 = NULL;
+    FILE* in = NULL;
+    StreamSink sink;
+    byte* chunk = NULL;
+    byte* out = NULL;
+    word32 outSz = 0;
+    size_t rd;
+    long inSz;
+    char partFile[512];
+    const char* sinkFile;
+    double start, elapsed;
+    WC_RNG rng;
+
+    XMEMSET(&sink, 0, sizeof(sink));
+
+    /* AuthEnvelopedData plaintext is held back until the tag verifies */
+    snprintf(partFile, sizeof(partFile), "%s.part", outFile);
+    sinkFile = auth ? partFile : outFile;
+
+    in = fopen(inFile, "rb");
+    if (in == NULL) {
+        printf("ERROR: failed to open file: %s\n", inFile);
+        return -1;
+    }
+    fseek(in, 0, SEEK_END);
+    inSz = ftell(in);
+    rewind(in);
+    if (inSz <= 0 || (unsigned long)inSz > MAX_BUNDLE_SZ) {
+        printf("ERROR: %s is empty or over 4 GB, PKCS#7 lengths are "
+               "32-bit\n", inFile);
+        fclose(in);
+        return BAD_FUNC_ARG;
+    }
+
+    sink.file = fopen(sinkFile, "wb");
+    if (sink.file == NULL) {
+        printf("ERROR: opening file for writing: %s\n", sinkFile);
+        fclose(in);
+        return -1;
+    }
+
+    ret = wc_InitSha256(&sink.sha);
+    if (ret != 0) {
+        fclose(sink.file);
+        fclose(in);
+        return ret;
+    }
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        wc_Sha256Free(&sink.sha);
+        fclose(sink.file);
+        fclose(in);
+        return ret;
+    }
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        ret = MEMORY_E;
+    if (ret == 0)
+        ret = wc_PKCS7_InitWithCert(pkcs7, cert, certSz);
+    if (ret == 0)
+        ret = wc_PKCS7_SetKey(pkcs7, key, keySz);
+    if (ret == 0)
+        pkcs7->rng = &rng;
+
+#ifdef HAVE_STREAM_OUT_CB
+    if (ret == 0 && !auth) {
+        ret = wc_PKCS7_SetStreamMode(pkcs7, 1, NULL, stream_out_cb, &sink);
+        useCb = (ret == 0);
+    }
+#endif
+
+    /* Without a stream callback wolfCrypt needs room for all of the
+     * plaintext, which is never larger than the encoded bundle. That is only
+     * done up to maxBuffered so memory use doesn't follow the bundle size. */
+    if (ret == 0) {
+        if (useCb) {
+            outSz = chunkSz;
+        }
+        else if ((unsigned long)inSz <= maxBuffered) {
+            outSz = (word32)inSz;
+        }
+        else {
+            printf("ERROR: %s is %ld bytes, over the %u byte -m limit for "
+                   "plaintext held in memory\n", inFile, inSz, maxBuffered);
+            printf("    only EnvelopedData with the wolfSSL stream output "
+                   "callback is decoded in fixed size chunks\n");
+            ret = BUFFER_E;
+        }
+    }
+    if (ret == 0) {
+        chunk = (byte*)XMALLOC(chunkSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        out = (byte*)XMALLOC(outSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        if (chunk == NULL || out == NULL)
+            ret = MEMORY_E;
+    }
+
+    start = current_time();
+    while (ret == 0) {
+        rd = fread(chunk, 1, chunkSz, in);
+        if (rd == 0) {
+            printf("ERROR: unexpected end of input\n");
+            ret = BUFFER_E;
+            break;
+        }
+
+        if (auth)
+            ret = wc_PKCS7_DecodeAuthEnvelopedData(pkcs7, chunk, (word32)rd,
+                                                   out, outSz);
+        else
+            ret = wc_PKCS7_DecodeEnvelopedData(pkcs7, chunk, (word32)rd,
+                                               out, outSz);
+
+        if (ret == WC_PKCS7_WANT_READ_E) {
+            ret = 0;
+            continue;
+        }
+        if (ret < 0) {
+            printf("ERROR: decoding %s failed, ret = %d\n", inFile, ret);
+            break;
+        }
+
+        /* decode complete: ret is the plaintext size when collected in
+         * the output buffer */
+        if (!useCb)
+            ret = sink_write(&sink, out, (word32)ret);
+        else
+            ret = 0;
+        break;
+    }
+    elapsed = current_time() - start;
+
+    fclose(in);
+    if (fclose(sink.file) != 0 && ret == 0)
+        ret = -1;
+
+    if (ret == 0)
+        ret = wc_Sha256Final(&sink.sha, hash);
+
+    if (auth) {
+        /* release plaintext only after tag verification succeeded */
+        if (ret == 0 && rename(partFile, outFile) != 0)
+            ret = -1;
+        if (ret != 0)
+            remove(partFile);
+    }
+
+    if (ret == 0) {
+        printf("Successfully decoded %s bundle (%s -> %s)\n",
+               auth ? "AuthEnvelopedData" : "EnvelopedData", inFile, outFile);
+        printf("    %llu bytes in %.3f s, %.2f MB/s, chunk %u bytes, "
+               "output %s\n", (unsigned long long)sink.total, elapsed,
+               elapsed > 0 ? (sink.total / (1024.0 * 1024.0)) / elapsed : 0.0,
+               chunkSz, useCb ? "streamed" : "buffered");
+    }
+
+    wc_Sha256Free(&sink.sha);
+    wc_PKCS7_Free(pkcs7);
+    wc_FreeRng(&rng);
+    XFREE(out, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(chunk, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("envelopedData-stream [options]\n");
+    printf("-i <file>   Encoded bundle to decrypt (default: generate)\n");
+    printf("-o <file>   Plaintext output file\n");
+    printf("-a          Input is AuthEnvelopedData\n");
+    printf("-c <bytes>  Input chunk size, default %d\n", DEF_CHUNK_SZ);
+    printf("-s <MB>     Generated content size, default %d\n",
+           DEF_CONTENT_MB);
+    printf("-m <MB>     Largest plaintext held in memory when it can't be "
+           "streamed, default %d\n", DEF_MAX_BUFFERED_MB);
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int ch;
+    int auth = 0;
+    word32 chunkSz = DEF_CHUNK_SZ;
+    word32 contentMb = DEF_CONTENT_MB;
+    word32 maxBufferedMb = DEF_MAX_BUFFERED_MB;
+    word32 maxBuffered;
+    const char* inFile = NULL;
+    const char* outFile = NULL;
+    word32 certSz, keySz;
+    byte cert[2048];
+    byte key[2048];
+    byte expHash[WC_SHA256_DIGEST_SIZE];
+    byte outHash[WC_SHA256_DIGEST_SIZE];
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?i:o:ac:s:m:")) != -1) {
+        switch (ch) {
+            case 'i':
+                inFile = optarg;
+                break;
+            case 'o':
+                outFile = optarg;
+                break;
+            case 'a':
+                auth = 1;
+                break;
+            case 'c':
+                chunkSz = (word32)atoi(optarg);
+                break;
+            case 's':
+                contentMb = (word32)atoi(optarg);
+                break;
+            case 'm':
+                maxBufferedMb = (word32)atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (chunkSz == 0 || contentMb == 0 || contentMb > 4095 ||
+            maxBufferedMb == 0 || maxBufferedMb > 4095) {
+        Usage();
+        return -1;
+    }
+    maxBuffered = maxBufferedMb * 1024 * 1024;
+
+    certSz = sizeof(cert);
+    keySz = sizeof(key);
+    ret = load_certs(cert, &certSz, key, &keySz);
+    if (ret != 0)
+        return -1;
+
+    printf("Peak RSS before decoding: %ld KB\n", peak_rss_kb());
+
+    if (inFile != NULL) {
+        /* decrypt a user supplied bundle */
+        if (outFile == NULL)
+            outFile = auth ? decodedFileAuthStream : decodedFileStream;
+        ret = stream_decrypt(inFile, outFile, auth, chunkSz, maxBuffered,
+                             cert, certSz, key, keySz, outHash);
+    }
+    else {
+        /* EnvelopedData, AES256-CBC */
+        ret = create_bundle_child(encodedFileStream, 0,
+                                  contentMb * 1024 * 1024, cert, certSz,
+                                  expHash);
+        if (ret == 0)
+            ret = stream_decrypt(encodedFileStream, decodedFileStream, 0,
+                                 chunkSz, maxBuffered, cert, certSz, key,
+                                 keySz, outHash);
+        if (ret == 0 && XMEMCMP(expHash, outHash, sizeof(outHash)) != 0) {
+            printf("ERROR: decrypted content does not match\n");
+            ret = -1;
+        }
+
+    #ifdef HAVE_AESGCM
+        /* AuthEnvelopedData, AES256-GCM */
+        if (ret == 0)
+            ret = create_bundle_child(encodedFileAuthStream, 1,
+                                      contentMb * 1024 * 1024, cert, certSz,
+                                      expHash);
+        if (ret == 0)
+            ret = stream_decrypt(encodedFileAuthStream, decodedFileAuthStream,
+                                 1, chunkSz, maxBuffered, cert, certSz, key,
+                                 keySz, outHash);
+        if (ret == 0 && XMEMCMP(expHash, outHash, sizeof(outHash)) != 0) {
+            printf("ERROR: decrypted content does not match\n");
+            ret = -1;
+        }
+    #endif
+    }
+
+    printf("Peak RSS after decoding: %ld KB\n", peak_rss_kb());
+
+    return ret;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7\n");
+    return 0;
+}
+
+#endif
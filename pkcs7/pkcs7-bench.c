@@ -0,0 +1,885 @@
+/* pkcs7-bench.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * Encode and decode throughput benchmark for the PKCS#7/CMS content types
+ * demonstrated in this directory. For each content type and payload size
+ * the encode and decode (or verify) operations are run for a fixed amount
+ * of time, first on a single thread and then on N threads, and the
+ * operations per second are reported.
+ *
+ * Each thread uses its own PKCS7 structures, RNG and buffers. Certificates
+ * and keys are loaded once and shared read-only between threads.
+ *
+ * This is only provided as an example and may need modification if integrated
+ * into a production application.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#define rsaCertFile "../certs/client-cert.der"
+#define rsaKeyFile  "../certs/client-key.der"
+#define eccCertFile "../certs/client-ecc-cert.der"
+#define eccKeyFile  "../certs/ecc-client-key.der"
+
+/* Default number of threads for the multi-threaded run */
+#define DEF_THREADS     4
+/* Default time spent on each measurement, in seconds */
+#define DEF_DURATION    1.0
+/* Maximum number of payload sizes on the command line */
+#define MAX_SIZES       8
+
+#if defined(HAVE_PKCS7) && !defined(NO_RSA)
+
+static const word32 defSizes[] = { 64, 1024, 16384, 262144 };
+
+static byte aes256Key[] = {
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08
+};
+
+static byte keyId[] = {
+    0x02, 0x02, 0x03, 0x04
+};
+
+static const char password[] = "wolfsslPassword";
+
+static byte pwriSalt[] = {
+    0x12, 0x34, 0x56, 0x78, 0x56, 0x34, 0x12
+};
+
+static const byte asnDataOid[] = {
+    0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x01
+};
+
+static byte messageTypeOid[] = {
+    0x06, 0x0a, 0x60, 0x86, 0x48, 0x01, 0x86, 0xF8, 0x45, 0x01, 0x09, 0x02
+};
+static byte messageType[] = { 0x13, 2, '1', '9' };
+
+static PKCS7Attrib attribs[] = {
+    { messageTypeOid, sizeof(messageTypeOid), messageType,
+      sizeof(messageType) }
+};
+#define NUM_ATTRIBS (sizeof(attribs)/sizeof(PKCS7Attrib))
+
+/* shared, read-only after load */
+static byte*  rsaCert;
+static word32 rsaCertSz;
+static byte*  rsaKey;
+static word32 rsaKeySz;
+static byte*  eccCert;
+static word32 eccCertSz;
+static byte*  eccKey;
+static word32 eccKeySz;
+
+/* per-thread state */
+typedef struct BenchCtx {
+    WC_RNG  rng;
+    byte*   payload;
+    word32  payloadSz;
+    byte*   out;
+    word32  outSz;
+    int     encodedSz;
+    byte*   dec;
+    byte*   tmp;
+    word32  decSz;
+} BenchCtx;
+
+typedef int (*BenchFn)(BenchCtx* ctx);
+
+typedef struct BenchCase {
+    const char* name;
+    BenchFn     encode;
+    BenchFn     decode;
+} BenchCase;
+
+typedef struct ThreadArgs {
+    pthread_t          tid;
+    const BenchCase*   bc;
+    BenchCtx*          ctx;
+    int                doDecode;
+    double             duration;
+    pthread_barrier_t* barrier;
+    long               ops;
+    int                ret;
+} ThreadArgs;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int read_file(const char* fileName, byte** buf, word32* bufSz)
+{
+    FILE* file;
+    long sz;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL) {
+        printf("ERROR: failed to open file: %s\n", fileName);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    sz = ftell(file);
+    rewind(file);
+
+    *buf = (byte*)XMALLOC(sz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (*buf == NULL) {
+        fclose(file);
+        return MEMORY_E;
+    }
+    *bufSz = (word32)fread(*buf, 1, sz, file);
+    fclose(file);
+
+    return (*bufSz == (word32)sz) ? 0 : -1;
+}
+
+/* check decoded size/content against the payload */
+static int check_content(BenchCtx* ctx, const byte* content, int sz)
+{
+    if (sz != (int)ctx->payloadSz ||
+            XMEMCMP(content, ctx->payload, ctx->payloadSz) != 0)
+        return -1;
+    return 0;
+}
+
+/* SignedData ---------------------------------------------------------------*/
+
+static int sign_common(BenchCtx* ctx, int withAttribs, int detached)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    ret = wc_PKCS7_InitWithCert(pkcs7, rsaCert, rsaCertSz);
+    if (ret == 0) {
+        pkcs7->rng             = &ctx->rng;
+        pkcs7->content         = ctx->payload;
+        pkcs7->contentSz       = ctx->payloadSz;
+        pkcs7->contentOID      = DATA;
+        pkcs7->hashOID         = SHA256h;
+        pkcs7->encryptOID      = RSAk;
+        pkcs7->privateKey      = rsaKey;
+        pkcs7->privateKeySz    = rsaKeySz;
+        pkcs7->signedAttribs   = withAttribs ? attribs : NULL;
+        pkcs7->signedAttribsSz = withAttribs ? NUM_ATTRIBS : 0;
+        if (detached)
+            ret = wc_PKCS7_SetDetached(pkcs7, 1);
+    }
+    if (ret == 0)
+        ret = wc_PKCS7_EncodeSignedData(pkcs7, ctx->out, ctx->outSz);
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int verify_common(BenchCtx* ctx, int detached)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    if (detached) {
+        pkcs7->content   = ctx->payload;
+        pkcs7->contentSz = ctx->payloadSz;
+    }
+    ret = wc_PKCS7_VerifySignedData(pkcs7, ctx->out, ctx->encodedSz);
+    if (ret == 0 && !detached)
+        ret = check_content(ctx, pkcs7->content, pkcs7->contentSz);
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int signed_noattrs_enc(BenchCtx* c) { return sign_common(c, 0, 0); }
+static int signed_attrs_enc(BenchCtx* c) { return sign_common(c, 1, 0); }
+static int signed_detached_enc(BenchCtx* c) { return sign_common(c, 1, 1); }
+static int signed_dec(BenchCtx* c) { return verify_common(c, 0); }
+static int signed_detached_dec(BenchCtx* c) { return verify_common(c, 1); }
+
+/* EncryptedData ------------------------------------------------------------*/
+
+static int encrypted_enc(BenchCtx* ctx)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    pkcs7->content         = ctx->payload;
+    pkcs7->contentSz       = ctx->payloadSz;
+    pkcs7->contentOID      = DATA;
+    pkcs7->encryptOID      = AES256CBCb;
+    pkcs7->encryptionKey   = aes256Key;
+    pkcs7->encryptionKeySz = sizeof(aes256Key);
+
+    ret = wc_PKCS7_EncodeEncryptedData(pkcs7, ctx->out, ctx->outSz);
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int encrypted_dec(BenchCtx* ctx)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    pkcs7->encryptionKey   = aes256Key;
+    pkcs7->encryptionKeySz = sizeof(aes256Key);
+
+    ret = wc_PKCS7_DecodeEncryptedData(pkcs7, ctx->out, ctx->encodedSz,
+                                       ctx->dec, ctx->decSz);
+    ret = (ret < 0) ? ret : check_content(ctx, ctx->dec, ret);
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+/* EnvelopedData / AuthEnvelopedData ----------------------------------------*/
+
+#define RECIP_KTRI  0
+#define RECIP_KARI  1
+#define RECIP_KEKRI 2
+#define RECIP_PWRI  3
+#define RECIP_ORI   4
+
+static int myOriEncryptCb(PKCS7* pkcs7, byte* cek, word32 cekSz, byte* oriType,
+                          word32* oriTypeSz, byte* oriValue, word32* oriValueSz,
+                          void* ctx)
+{
+    int i;
+
+    if ((*oriValueSz < (2 + cekSz)) || (*oriTypeSz < sizeof(asnDataOid)))
+        return -1;
+
+    /* bitwise complement, for example purposes only */
+    oriValue[0] = 0x04;
+    oriValue[1] = (byte)cekSz;
+    for (i = 0; i < (int)cekSz; i++)
+        oriValue[2 + i] = ~cek[i];
+    *oriValueSz = 2 + cekSz;
+
+    XMEMCPY(oriType, asnDataOid, sizeof(asnDataOid));
+    *oriTypeSz = sizeof(asnDataOid);
+
+    (void)pkcs7;
+    (void)ctx;
+    return 0;
+}
+
+static int myOriDecryptCb(PKCS7* pkcs7, byte* oriType, word32 oriTypeSz,
+                          byte* oriValue, word32 oriValueSz, byte* decryptedKey,
+                          word32* decryptedKeySz, void* ctx)
+{
+    int i;
+
+    if (oriTypeSz != sizeof(asnDataOid) ||
+            XMEMCMP(oriType, asnDataOid, sizeof(asnDataOid)) != 0)
+        return -1;
+    if (*decryptedKeySz < oriValueSz)
+        return -1;
+
+    for (i = 0; i < (int)oriValueSz - 2; i++)
+        decryptedKey[i] = ~oriValue[2 + i];
+    *decryptedKeySz = oriValueSz - 2;
+
+    (void)pkcs7;
+    (void)ctx;
+    return 0;
+}
+
+static int env_encode(BenchCtx* ctx, int recip, int auth)
+{
+    int ret = 0;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    pkcs7->content    = ctx->payload;
+    pkcs7->contentSz  = ctx->payloadSz;
+    pkcs7->contentOID = DATA;
+    pkcs7->encryptOID = auth ? AES256GCMb : AES256CBCb;
+    pkcs7->rng        = &ctx->rng;
+
+    switch (recip) {
+        case RECIP_KTRI:
+            ret = wc_PKCS7_AddRecipient_KTRI(pkcs7, rsaCert, rsaCertSz, 0);
+            break;
+    #ifdef HAVE_ECC
+        case RECIP_KARI:
+            ret = wc_PKCS7_AddRecipient_KARI(pkcs7, eccCert, eccCertSz,
+                                    AES256_WRAP,
+                                    dhSinglePass_stdDH_sha256kdf_scheme,
+                                    NULL, 0, 0);
+            break;
+    #endif
+        case RECIP_KEKRI:
+            ret = wc_PKCS7_AddRecipient_KEKRI(pkcs7, AES256_WRAP, aes256Key,
+                                    sizeof(aes256Key), keyId, sizeof(keyId),
+                                    NULL, NULL, 0, NULL, 0, 0);
+            break;
+    #ifndef NO_PWDBASED
+        case RECIP_PWRI:
+            ret = wc_PKCS7_AddRecipient_PWRI(pkcs7, (byte*)password,
+                                    (word32)XSTRLEN(password), pwriSalt,
+                                    sizeof(pwriSalt), PBKDF2_OID, WC_SHA, 5,
+                                    AES256CBCb, 0);
+            break;
+    #endif
+        case RECIP_ORI:
+            ret = wc_PKCS7_AddRecipient_ORI(pkcs7, myOriEncryptCb, 0);
+            break;
+        default:
+            ret = BAD_FUNC_ARG;
+    }
+
+    if (ret >= 0) {
+        if (auth)
+            ret = wc_PKCS7_EncodeAuthEnvelopedData(pkcs7, ctx->out,
+                                                   ctx->outSz);
+        else
+            ret = wc_PKCS7_EncodeEnvelopedData(pkcs7, ctx->out, ctx->outSz);
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int env_decode(BenchCtx* ctx, int recip, int auth)
+{
+    int ret = 0;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    switch (recip) {
+        case RECIP_KTRI:
+            ret = wc_PKCS7_InitWithCert(pkcs7, rsaCert, rsaCertSz);
+            if (ret == 0)
+                ret = wc_PKCS7_SetKey(pkcs7, rsaKey, rsaKeySz);
+            break;
+        case RECIP_KARI:
+            ret = wc_PKCS7_InitWithCert(pkcs7, eccCert, eccCertSz);
+            if (ret == 0)
+                ret = wc_PKCS7_SetKey(pkcs7, eccKey, eccKeySz);
+            break;
+        case RECIP_KEKRI:
+            ret = wc_PKCS7_SetKey(pkcs7, aes256Key, sizeof(aes256Key));
+            break;
+        case RECIP_PWRI:
+            ret = wc_PKCS7_SetPassword(pkcs7, (byte*)password,
+                                       (word32)XSTRLEN(password));
+            break;
+        case RECIP_ORI:
+            ret = wc_PKCS7_SetOriDecryptCb(pkcs7, myOriDecryptCb);
+            break;
+        default:
+            ret = BAD_FUNC_ARG;
+    }
+    pkcs7->rng = &ctx->rng;
+
+    if (ret == 0) {
+        if (auth)
+            ret = wc_PKCS7_DecodeAuthEnvelopedData(pkcs7, ctx->out,
+                                    ctx->encodedSz, ctx->dec, ctx->decSz);
+        else
+            ret = wc_PKCS7_DecodeEnvelopedData(pkcs7, ctx->out,
+                                    ctx->encodedSz, ctx->dec, ctx->decSz);
+        ret = (ret < 0) ? ret : check_content(ctx, ctx->dec, ret);
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int env_ktri_enc(BenchCtx* c) { return env_encode(c, RECIP_KTRI, 0); }
+static int env_ktri_dec(BenchCtx* c) { return env_decode(c, RECIP_KTRI, 0); }
+static int env_kari_enc(BenchCtx* c) { return env_encode(c, RECIP_KARI, 0); }
+static int env_kari_dec(BenchCtx* c) { return env_decode(c, RECIP_KARI, 0); }
+static int env_kekri_enc(BenchCtx* c) { return env_encode(c, RECIP_KEKRI, 0); }
+static int env_kekri_dec(BenchCtx* c) { return env_decode(c, RECIP_KEKRI, 0); }
+static int env_pwri_enc(BenchCtx* c) { return env_encode(c, RECIP_PWRI, 0); }
+static int env_pwri_dec(BenchCtx* c) { return env_decode(c, RECIP_PWRI, 0); }
+static int env_ori_enc(BenchCtx* c) { return env_encode(c, RECIP_ORI, 0); }
+static int env_ori_dec(BenchCtx* c) { return env_decode(c, RECIP_ORI, 0); }
+static int authenv_enc(BenchCtx* c) { return env_encode(c, RECIP_KTRI, 1); }
+static int authenv_dec(BenchCtx* c) { return env_decode(c, RECIP_KTRI, 1); }
+
+/* CompressedData -----------------------------------------------------------*/
+
+#if defined(HAVE_LIBZ) && !defined(NO_PKCS7_COMPRESSED_DATA)
+static int compressed_enc(BenchCtx* ctx)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    pkcs7->content    = ctx->payload;
+    pkcs7->contentSz  = ctx->payloadSz;
+    pkcs7->contentOID = DATA;
+
+    ret = wc_PKCS7_EncodeCompressedData(pkcs7, ctx->out, ctx->outSz);
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int compressed_dec(BenchCtx* ctx)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    ret = wc_PKCS7_DecodeCompressedData(pkcs7, ctx->out, ctx->encodedSz,
+                                        ctx->dec, ctx->decSz);
+    ret = (ret < 0) ? ret : check_content(ctx, ctx->dec, ret);
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+#endif
+
+/* SignedData encapsulating FirmwarePkgData ---------------------------------*/
+
+#define FPD_PLAIN      0
+#define FPD_ENCRYPTED  1
+#define FPD_COMPRESSED 2
+#define FPD_ENC_COMP   3
+
+static int fpd_encode(BenchCtx* ctx, int type)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    ret = wc_PKCS7_InitWithCert(pkcs7, rsaCert, rsaCertSz);
+    if (ret == 0) {
+        pkcs7->rng = &ctx->rng;
+        switch (type) {
+            case FPD_PLAIN:
+                ret = wc_PKCS7_EncodeSignedFPD(pkcs7, rsaKey, rsaKeySz, RSAk,
+                            SHA256h, ctx->payload, ctx->payloadSz, attribs,
+                            NUM_ATTRIBS, ctx->out, ctx->outSz);
+                break;
+            case FPD_ENCRYPTED:
+                ret = wc_PKCS7_EncodeSignedEncryptedFPD(pkcs7, aes256Key,
+                            sizeof(aes256Key), rsaKey, rsaKeySz, AES256CBCb,
+                            RSAk, SHA256h, ctx->payload, ctx->payloadSz,
+                            NULL, 0, attribs, NUM_ATTRIBS,
+                            ctx->out, ctx->outSz);
+                break;
+        #if defined(HAVE_LIBZ) && !defined(NO_PKCS7_COMPRESSED_DATA)
+            case FPD_COMPRESSED:
+                ret = wc_PKCS7_EncodeSignedCompressedFPD(pkcs7, rsaKey,
+                            rsaKeySz, RSAk, SHA256h, ctx->payload,
+                            ctx->payloadSz, attribs, NUM_ATTRIBS,
+                            ctx->out, ctx->outSz);
+                break;
+            case FPD_ENC_COMP:
+                ret = wc_PKCS7_EncodeSignedEncryptedCompressedFPD(pkcs7,
+                            aes256Key, sizeof(aes256Key), rsaKey, rsaKeySz,
+                            AES256CBCb, RSAk, SHA256h, ctx->payload,
+                            ctx->payloadSz, NULL, 0, attribs, NUM_ATTRIBS,
+                            ctx->out, ctx->outSz);
+                break;
+        #endif
+            default:
+                ret = BAD_FUNC_ARG;
+        }
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int fpd_decode(BenchCtx* ctx, int type)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    ret = wc_PKCS7_VerifySignedData(pkcs7, ctx->out, ctx->encodedSz);
+    if (ret == 0) {
+        pkcs7->encryptionKey   = aes256Key;
+        pkcs7->encryptionKeySz = sizeof(aes256Key);
+
+        switch (type) {
+            case FPD_PLAIN:
+                ret = check_content(ctx, pkcs7->content, pkcs7->contentSz);
+                break;
+            case FPD_ENCRYPTED:
+                ret = wc_PKCS7_DecodeEncryptedData(pkcs7, pkcs7->content,
+                            pkcs7->contentSz, ctx->dec, ctx->decSz);
+                ret = (ret < 0) ? ret : check_content(ctx, ctx->dec, ret);
+                break;
+        #if defined(HAVE_LIBZ) && !defined(NO_PKCS7_COMPRESSED_DATA)
+            case FPD_COMPRESSED:
+                ret = wc_PKCS7_DecodeCompressedData(pkcs7, pkcs7->content,
+                            pkcs7->contentSz, ctx->dec, ctx->decSz);
+                ret = (ret < 0) ? ret : check_content(ctx, ctx->dec, ret);
+                break;
+            case FPD_ENC_COMP:
+                ret = wc_PKCS7_DecodeEncryptedData(pkcs7, pkcs7->content,
+                            pkcs7->contentSz, ctx->tmp, ctx->decSz);
+                if (ret > 0)
+                    ret = wc_PKCS7_DecodeCompressedData(pkcs7, ctx->tmp, ret,
+                            ctx->dec, ctx->decSz);
+                ret = (ret < 0) ? ret : check_content(ctx, ctx->dec, ret);
+                break;
+        #endif
+            default:
+                ret = BAD_FUNC_ARG;
+        }
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int fpd_enc(BenchCtx* c) { return fpd_encode(c, FPD_PLAIN); }
+static int fpd_dec(BenchCtx* c) { return fpd_decode(c, FPD_PLAIN); }
+static int fpd_encr_enc(BenchCtx* c) { return fpd_encode(c, FPD_ENCRYPTED); }
+static int fpd_encr_dec(BenchCtx* c) { return fpd_decode(c, FPD_ENCRYPTED); }
+#if defined(HAVE_LIBZ) && !defined(NO_PKCS7_COMPRESSED_DATA)
+static int fpd_comp_enc(BenchCtx* c) { return fpd_encode(c, FPD_COMPRESSED); }
+static int fpd_comp_dec(BenchCtx* c) { return fpd_decode(c, FPD_COMPRESSED); }
+static int fpd_enc_comp_enc(BenchCtx* c) { return fpd_encode(c, FPD_ENC_COMP); }
+static int fpd_enc_comp_dec(BenchCtx* c) { return fpd_decode(c, FPD_ENC_COMP); }
+#endif
+
+static const BenchCase benchCases[] = {
+    { "SignedData",               signed_noattrs_enc,  signed_dec },
+    { "SignedData+attrs",         signed_attrs_enc,    signed_dec },
+    { "SignedData detached",      signed_detached_enc, signed_detached_dec },
+    { "EncryptedData",            encrypted_enc,       encrypted_dec },
+    { "EnvelopedData KTRI",       env_ktri_enc,        env_ktri_dec },
+#ifdef HAVE_ECC
+    { "EnvelopedData KARI",       env_kari_enc,        env_kari_dec },
+#endif
+    { "EnvelopedData KEKRI",      env_kekri_enc,       env_kekri_dec },
+#ifndef NO_PWDBASED
+    { "EnvelopedData PWRI",       env_pwri_enc,        env_pwri_dec },
+#endif
+    { "EnvelopedData ORI",        env_ori_enc,         env_ori_dec },
+#ifdef HAVE_AESGCM
+    { "AuthEnvelopedData KTRI",   authenv_enc,         authenv_dec },
+#endif
+#if defined(HAVE_LIBZ) && !defined(NO_PKCS7_COMPRESSED_DATA)
+    { "CompressedData",           compressed_enc,      compressed_dec },
+#endif
+    { "Signed FPD",               fpd_enc,             fpd_dec },
+    { "Signed Encrypted FPD",     fpd_encr_enc,        fpd_encr_dec },
+#if defined(HAVE_LIBZ) && !defined(NO_PKCS7_COMPRESSED_DATA)
+    { "Signed Compressed FPD",    fpd_comp_enc,        fpd_comp_dec },
+    { "Signed Enc Compressed FPD", fpd_enc_comp_enc,   fpd_enc_comp_dec },
+#endif
+};
+#define NUM_CASES (int)(sizeof(benchCases)/sizeof(benchCases[0]))
+
+static int ctx_init(BenchCtx* ctx, const byte* payload, word32 payloadSz)
+{
+    XMEMSET(ctx, 0, sizeof(*ctx));
+
+    if (wc_InitRng(&ctx->rng) != 0)
+        return -1;
+
+    /* room for the largest bundle: payload, padding/compression growth,
+     * certificate, signature and recipient infos */
+    ctx->payloadSz = payloadSz;
+    ctx->outSz     = payloadSz + (payloadSz / 8) + 8192;
+    ctx->decSz     = ctx->outSz;
+    ctx->payload   = (byte*)XMALLOC(payloadSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    ctx->out       = (byte*)XMALLOC(ctx->outSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    ctx->dec       = (byte*)XMALLOC(ctx->decSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    ctx->tmp       = (byte*)XMALLOC(ctx->decSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (ctx->payload == NULL || ctx->out == NULL || ctx->dec == NULL ||
+            ctx->tmp == NULL)
+        return MEMORY_E;
+
+    XMEMCPY(ctx->payload, payload, payloadSz);
+    return 0;
+}
+
+static void ctx_free(BenchCtx* ctx)
+{
+    XFREE(ctx->payload, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(ctx->out, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(ctx->dec, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(ctx->tmp, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    wc_FreeRng(&ctx->rng);
+}
+
+static void* bench_thread(void* arg)
+{
+    ThreadArgs* t = (ThreadArgs*)arg;
+    BenchFn fn = t->doDecode ? t->bc->decode : t->bc->encode;
+    double start;
+    int ret;
+
+    pthread_barrier_wait(t->barrier);
+
+    start = current_time();
+    do {
+        ret = fn(t->ctx);
+        if (ret < 0) {
+            t->ret = ret;
+            break;
+        }
+        t->ops++;
+    } while (current_time() - start < t->duration);
+
+    return NULL;
+}
+
+/* Run one operation on numThreads threads. Returns total ops/s. */
+static double run_case(const BenchCase* bc, BenchCtx* ctxs, int numThreads,
+                       int doDecode, double duration, int* err)
+{
+    ThreadArgs* args;
+    pthread_barrier_t barrier;
+    double start, elapsed;
+    long ops = 0;
+    int i;
+
+    args = (ThreadArgs*)XMALLOC(sizeof(ThreadArgs) * numThreads, NULL,
+                                DYNAMIC_TYPE_TMP_BUFFER);
+    if (args == NULL) {
+        *err = MEMORY_E;
+        return 0;
+    }
+    XMEMSET(args, 0, sizeof(ThreadArgs) * numThreads);
+    pthread_barrier_init(&barrier, NULL, numThreads);
+
+    start = current_time();
+    for (i = 0; i < numThreads; i++) {
+        args[i].bc       = bc;
+        args[i].ctx      = &ctxs[i];
+        args[i].doDecode = doDecode;
+        args[i].duration = duration;
+        args[i].barrier  = &barrier;
+        pthread_create(&args[i].tid, NULL, bench_thread, &args[i]);
+    }
+    for (i = 0; i < numThreads; i++) {
+        pthread_join(args[i].tid, NULL);
+        ops += args[i].ops;
+        if (args[i].ret != 0)
+            *err = args[i].ret;
+    }
+    elapsed = current_time() - start;
+
+    pthread_barrier_destroy(&barrier);
+    XFREE(args, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return elapsed > 0 ? ops / elapsed : 0;
+}
+
+static void Usage(void)
+{
+    printf("pkcs7-bench [options]\n");
+    printf("-t <num>    Threads for the multi-threaded run, default %d\n",
+           DEF_THREADS);
+    printf("-d <sec>    Seconds per measurement, default %.1f\n",
+           DEF_DURATION);
+    printf("-s <bytes>  Payload size, repeatable, default 64/1K/16K/256K\n");
+    printf("-c <name>   Only run cases whose name contains <name>\n");
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int ch;
+    int i, s, c;
+    int err;
+    int numThreads = DEF_THREADS;
+    int numCtxs;
+    double duration = DEF_DURATION;
+    word32 sizes[MAX_SIZES];
+    int numSizes = 0;
+    const char* filter = NULL;
+    BenchCtx* ctxs = NULL;
+    byte* payload;
+    double enc1, dec1, encN, decN;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?t:d:s:c:")) != -1) {
+        switch (ch) {
+            case 't':
+                numThreads = atoi(optarg);
+                break;
+            case 'd':
+                duration = atof(optarg);
+                break;
+            case 's':
+                if (numSizes < MAX_SIZES)
+                    sizes[numSizes++] = (word32)atoi(optarg);
+                break;
+            case 'c':
+                filter = optarg;
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (numThreads <= 0 || duration <= 0) {
+        Usage();
+        return -1;
+    }
+    if (numSizes == 0) {
+        for (i = 0; i < (int)(sizeof(defSizes)/sizeof(defSizes[0])); i++)
+            sizes[numSizes++] = defSizes[i];
+    }
+
+    if (read_file(rsaCertFile, &rsaCert, &rsaCertSz) != 0 ||
+        read_file(rsaKeyFile, &rsaKey, &rsaKeySz) != 0 ||
+        read_file(eccCertFile, &eccCert, &eccCertSz) != 0 ||
+        read_file(eccKeyFile, &eccKey, &eccKeySz) != 0)
+        return -1;
+
+    ctxs = (BenchCtx*)XMALLOC(sizeof(BenchCtx) * numThreads, NULL,
+                              DYNAMIC_TYPE_TMP_BUFFER);
+    if (ctxs == NULL)
+        return MEMORY_E;
+
+    printf("ops/s with 1 thread (x1) and %d threads (x%d)\n\n", numThreads,
+           numThreads);
+    printf("%-26s %8s %11s %11s %11s %11s\n", "content type", "bytes",
+           "enc x1", "dec x1", "enc xN", "dec xN");
+
+    for (s = 0; s < numSizes && ret == 0; s++) {
+        /* semi-compressible payload, similar to a firmware image */
+        payload = (byte*)XMALLOC(sizes[s], NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        if (payload == NULL) {
+            ret = MEMORY_E;
+            break;
+        }
+        for (i = 0; i < (int)sizes[s]; i++)
+            payload[i] = (byte)((i % 251) ^ (i >> 10));
+
+        for (numCtxs = 0; numCtxs < numThreads && ret == 0; numCtxs++)
+            ret = ctx_init(&ctxs[numCtxs], payload, sizes[s]);
+        XFREE(payload, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+        for (c = 0; c < NUM_CASES && ret == 0; c++) {
+            const BenchCase* bc = &benchCases[c];
+
+            if (filter != NULL && strstr(bc->name, filter) == NULL)
+                continue;
+
+            /* each thread decodes its own bundle, which also checks that
+             * the encode/decode pair round trips */
+            for (i = 0; i < numThreads; i++) {
+                ctxs[i].encodedSz = bc->encode(&ctxs[i]);
+                if (ctxs[i].encodedSz <= 0 || bc->decode(&ctxs[i]) != 0) {
+                    printf("ERROR: %s round trip failed, ret = %d\n",
+                           bc->name, ctxs[i].encodedSz);
+                    ret = -1;
+                    break;
+                }
+            }
+            if (ret != 0)
+                break;
+
+            err = 0;
+            enc1 = run_case(bc, ctxs, 1, 0, duration, &err);
+            dec1 = run_case(bc, ctxs, 1, 1, duration, &err);
+            encN = run_case(bc, ctxs, numThreads, 0, duration, &err);
+            decN = run_case(bc, ctxs, numThreads, 1, duration, &err);
+            if (err != 0) {
+                printf("ERROR: %s failed during benchmark, ret = %d\n",
+                       bc->name, err);
+                ret = err;
+                break;
+            }
+
+            printf("%-26s %8u %11.1f %11.1f %11.1f %11.1f\n", bc->name,
+                   sizes[s], enc1, dec1, encN, decN);
+        }
+
+        for (i = 0; i < numCtxs; i++)
+            ctx_free(&ctxs[i]);
+    }
+
+    XFREE(ctxs, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(rsaCert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(rsaKey, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(eccCert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(eccKey, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return ret;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,790 @@
+/* pkcs7-verify-batch.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * Batch SignedData verifier. All input bundles are loaded into memory up
+ * front, then a pool of worker threads verifies them.
+ *
+ * Signer certificates are kept in a store keyed by the SignerIdentifier found
+ * in the SignerInfo (IssuerAndSerialNumber or SubjectKeyIdentifier). Only
+ * the certificate in the bundle that matches the SignerIdentifier is stored,
+ * not other certificates in the chain. The store lets bundles that were
+ * generated without embedded certificates be verified.
+ *
+ * The store only holds the DER certificate. It does not make a verification
+ * cheaper: each bundle is verified with a freshly initialized PKCS7 and
+ * wc_PKCS7_InitWithCert() parses the signer certificate and decodes its
+ * public key every time. wolfCrypt has no public API to hand a decoded signer
+ * key to another PKCS7, and reusing one PKCS7 across messages carries decode
+ * state from one message to the next.
+ *
+ * Inputs are read either from a directory (one DER bundle per file) or from
+ * stdin as a stream of concatenated DER bundles.
+ *
+ * This is only provided as an example and may need modification if integrated
+ * into a production application.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+/* Default input when no directory or stdin is requested */
+#define DEFAULT_INPUT    "signed.p7s"
+/* Default number of worker threads */
+#define DEF_THREADS      4
+/* Default number of passes over the inputs */
+#define DEF_PASSES       1000
+/* Maximum number of distinct signers held in the store */
+#define MAX_SIGNERS      64
+/* Maximum number of input bundles */
+#define MAX_INPUTS       65536
+/* Maximum size of a single bundle read from stdin */
+#define MAX_STREAM_BUNDLE (1024 * 1024)
+
+#if defined(HAVE_PKCS7) && !defined(NO_SHA256)
+
+/* SignerIdentifier types, used as part of the cache key */
+#define SID_ISSUER_AND_SERIAL 1
+#define SID_SKID              2
+
+typedef struct Input {
+    byte*  der;
+    word32 derSz;
+} Input;
+
+typedef struct SignerEntry {
+    byte   sidType;
+    byte   sidHash[WC_SHA256_DIGEST_SIZE];
+    byte*  cert;
+    word32 certSz;
+} SignerEntry;
+
+typedef struct SignerCache {
+    pthread_rwlock_t lock;
+    SignerEntry      entry[MAX_SIGNERS];
+    int              count;
+} SignerCache;
+
+typedef struct WorkerCtx {
+    pthread_t tid;
+    int       id;
+    /* statistics */
+    long      verified;
+    long      failed;
+    long      hits;
+    long      misses;
+    long      uncached;
+} WorkerCtx;
+
+static Input       inputs[MAX_INPUTS];
+static int         inputCnt = 0;
+static SignerCache cache;
+
+static pthread_mutex_t workLock = PTHREAD_MUTEX_INITIALIZER;
+static long            workNext = 0;
+static long            workTotal = 0;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+/* Read a DER tag and definite length at *idx. On success *idx is moved to the
+ * start of the value. */
+static int der_get_header(const byte* in, word32 inSz, word32* idx, byte* tag,
+                          word32* len)
+{
+    word32 i = *idx;
+    word32 l = 0;
+    int    n;
+
+    if (i + 2 > inSz)
+        return -1;
+
+    *tag = in[i++];
+    if (in[i] < 0x80) {
+        l = in[i++];
+    }
+    else {
+        n = in[i++] & 0x7F;
+        /* indefinite length (n == 0) is not supported by the cache lookup */
+        if (n == 0 || n > 4 || i + n > inSz)
+            return -1;
+        while (n-- > 0)
+            l = (l << 8) | in[i++];
+    }
+    if (l > inSz - i)
+        return -1;
+
+    *idx = i;
+    *len = l;
+    return 0;
+}
+
+/* Read a header and skip over the value. */
+static int der_skip(const byte* in, word32 inSz, word32* idx, byte expTag)
+{
+    byte   tag;
+    word32 len;
+
+    if (der_get_header(in, inSz, idx, &tag, &len) != 0 || tag != expTag)
+        return -1;
+    *idx += len;
+    return 0;
+}
+
+/* Locate the SignerIdentifier of the first SignerInfo in a SignedData
+ * bundle, without decoding the certificates or content. */
+static int get_bundle_sid(const byte* in, word32 inSz, byte* sidType,
+                          const byte** sid, word32* sidSz)
+{
+    word32 idx = 0;
+    word32 len;
+    byte   tag;
+
+    /* ContentInfo */
+    if (der_get_header(in, inSz, &idx, &tag, &len) != 0 || tag != 0x30)
+        return -1;
+    if (der_skip(in, inSz, &idx, 0x06) != 0)
+        return -1;
+    if (der_get_header(in, inSz, &idx, &tag, &len) != 0 || tag != 0xA0)
+        return -1;
+
+    /* SignedData */
+    if (der_get_header(in, inSz, &idx, &tag, &len) != 0 || tag != 0x30)
+        return -1;
+    if (der_skip(in, inSz, &idx, 0x02) != 0 ||      /* version */
+        der_skip(in, inSz, &idx, 0x31) != 0 ||      /* digestAlgorithms */
+        der_skip(in, inSz, &idx, 0x30) != 0)        /* encapContentInfo */
+        return -1;
+
+    /* optional certificates [0] and crls [1] */
+    if (idx < inSz && in[idx] == 0xA0 && der_skip(in, inSz, &idx, 0xA0) != 0)
+        return -1;
+    if (idx < inSz && in[idx] == 0xA1 && der_skip(in, inSz, &idx, 0xA1) != 0)
+        return -1;
+
+    /* signerInfos SET, first SignerInfo */
+    if (der_get_header(in, inSz, &idx, &tag, &len) != 0 || tag != 0x31)
+        return -1;
+    if (der_get_header(in, inSz, &idx, &tag, &len) != 0 || tag != 0x30)
+        return -1;
+    if (der_skip(in, inSz, &idx, 0x02) != 0)
+        return -1;
+
+    /* sid */
+    if (der_get_header(in, inSz, &idx, &tag, &len) != 0)
+        return -1;
+    if (tag == 0x30)
+        *sidType = SID_ISSUER_AND_SERIAL;
+    else if (tag == 0x80)
+        *sidType = SID_SKID;
+    else
+        return -1;
+
+    *sid = in + idx;
+    *sidSz = len;
+    return 0;
+}
+
+/* Find the value of the SubjectKeyIdentifier extension in a DER certificate.
+ * idx is the start of the TBSCertificate content, after the issuer. */
+static int get_cert_skid(const byte* cert, word32 idx, word32 tbsEnd,
+                         const byte** skid, word32* skidSz)
+{
+    /* id-ce-subjectKeyIdentifier, 2.5.29.14 */
+    static const byte skidOid[] = { 0x06, 0x03, 0x55, 0x1D, 0x0E };
+    word32 len;
+    word32 extEnd;
+    word32 next;
+    byte   tag;
+
+    if (der_skip(cert, tbsEnd, &idx, 0x30) != 0 ||   /* validity */
+        der_skip(cert, tbsEnd, &idx, 0x30) != 0 ||   /* subject */
+        der_skip(cert, tbsEnd, &idx, 0x30) != 0)     /* subjectPublicKeyInfo */
+        return -1;
+
+    /* optional issuerUniqueID [1] and subjectUniqueID [2] */
+    if (idx < tbsEnd && cert[idx] == 0x81 &&
+        der_skip(cert, tbsEnd, &idx, 0x81) != 0)
+        return -1;
+    if (idx < tbsEnd && cert[idx] == 0x82 &&
+        der_skip(cert, tbsEnd, &idx, 0x82) != 0)
+        return -1;
+
+    /* extensions [3] EXPLICIT SEQUENCE OF Extension */
+    if (der_get_header(cert, tbsEnd, &idx, &tag, &len) != 0 || tag != 0xA3)
+        return -1;
+    if (der_get_header(cert, tbsEnd, &idx, &tag, &len) != 0 || tag != 0x30)
+        return -1;
+    extEnd = idx + len;
+
+    while (idx < extEnd) {
+        if (der_get_header(cert, extEnd, &idx, &tag, &len) != 0 || tag != 0x30)
+            return -1;
+        next = idx + len;
+
+        if (len > sizeof(skidOid) &&
+                XMEMCMP(cert + idx, skidOid, sizeof(skidOid)) == 0) {
+            idx += sizeof(skidOid);
+            /* optional critical BOOLEAN */
+            if (idx < next && cert[idx] == 0x01 &&
+                    der_skip(cert, next, &idx, 0x01) != 0)
+                return -1;
+            /* extnValue OCTET STRING wrapping the KeyIdentifier OCTET STRING */
+            if (der_get_header(cert, next, &idx, &tag, &len) != 0 ||
+                    tag != 0x04)
+                return -1;
+            if (der_get_header(cert, next, &idx, &tag, &len) != 0 ||
+                    tag != 0x04)
+                return -1;
+            *skid = cert + idx;
+            *skidSz = len;
+            return 0;
+        }
+        idx = next;
+    }
+
+    return -1;
+}
+
+/* Build the cache key of a DER certificate for the given SignerIdentifier
+ * type, so it can be compared with the hash of the SID of a SignerInfo.
+ *
+ * The content of IssuerAndSerialNumber is the issuer Name followed by the
+ * serial INTEGER, so hashing those two TLVs from the certificate produces the
+ * same key as hashing the SID content. For SubjectKeyIdentifier the key is
+ * the hash of the key identifier from the certificate extension. */
+static int get_cert_sid_hash(const byte* cert, word32 certSz, byte sidType,
+                             byte* hash)
+{
+    word32 idx = 0;
+    word32 len;
+    word32 snIdx, snSz, issuerIdx, tbsEnd;
+    byte   tag;
+    byte   buf[1024];
+    const byte* skid;
+    word32 skidSz;
+    int    ret;
+
+    if (der_get_header(cert, certSz, &idx, &tag, &len) != 0 || tag != 0x30)
+        return -1;
+    if (der_get_header(cert, certSz, &idx, &tag, &len) != 0 || tag != 0x30)
+        return -1;
+    tbsEnd = idx + len;
+    if (idx < tbsEnd && cert[idx] == 0xA0 &&
+        der_skip(cert, tbsEnd, &idx, 0xA0) != 0)
+        return -1;
+
+    snIdx = idx;
+    if (der_skip(cert, tbsEnd, &idx, 0x02) != 0)
+        return -1;
+    snSz = idx - snIdx;
+
+    if (der_skip(cert, tbsEnd, &idx, 0x30) != 0)    /* signature algo */
+        return -1;
+
+    issuerIdx = idx;
+    if (der_skip(cert, tbsEnd, &idx, 0x30) != 0)
+        return -1;
+    len = idx - issuerIdx;
+
+    if (sidType == SID_SKID) {
+        if (get_cert_skid(cert, idx, tbsEnd, &skid, &skidSz) != 0)
+            return -1;
+        return wc_Sha256Hash(skid, skidSz, hash);
+    }
+
+    if (len + snSz > sizeof(buf))
+        return -1;
+    XMEMCPY(buf, cert + issuerIdx, len);
+    XMEMCPY(buf + len, cert + snIdx, snSz);
+
+    ret = wc_Sha256Hash(buf, len + snSz, hash);
+    return ret;
+}
+
+/* Returns index of cached signer, or -1 if not found. Caller holds lock. */
+static int cache_find(byte sidType, const byte* sidHash)
+{
+    int i;
+
+    for (i = 0; i < cache.count; i++) {
+        if (cache.entry[i].sidType == sidType &&
+            XMEMCMP(cache.entry[i].sidHash, sidHash,
+                    WC_SHA256_DIGEST_SIZE) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int cache_add(byte sidType, const byte* sidHash, const byte* cert,
+                     word32 certSz)
+{
+    int idx;
+    SignerEntry* e;
+
+    pthread_rwlock_wrlock(&cache.lock);
+
+    /* another worker may have added it already */
+    idx = cache_find(sidType, sidHash);
+    if (idx < 0 && cache.count < MAX_SIGNERS) {
+        e = &cache.entry[cache.count];
+        e->cert = (byte*)XMALLOC(certSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        if (e->cert != NULL) {
+            XMEMCPY(e->cert, cert, certSz);
+            e->certSz = certSz;
+            e->sidType = sidType;
+            XMEMCPY(e->sidHash, sidHash, WC_SHA256_DIGEST_SIZE);
+            idx = cache.count++;
+        }
+    }
+
+    pthread_rwlock_unlock(&cache.lock);
+    return idx;
+}
+
+/* Verify with a fresh PKCS7 and, on success, cache the certificate that
+ * matches the SignerIdentifier. The first certificate in the bundle may be a
+ * CA, so it is not assumed to be the signer. */
+static int verify_uncached(Input* in, int haveSid, byte sidType,
+                           const byte* sidHash)
+{
+    int ret;
+    int i;
+    PKCS7* pkcs7;
+    byte certHash[WC_SHA256_DIGEST_SIZE];
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    ret = wc_PKCS7_InitWithCert(pkcs7, NULL, 0);
+    if (ret == 0)
+        ret = wc_PKCS7_VerifySignedData(pkcs7, in->der, in->derSz);
+
+    for (i = 0; ret == 0 && haveSid && i < MAX_PKCS7_CERTS; i++) {
+        if (pkcs7->cert[i] == NULL || pkcs7->certSz[i] == 0)
+            continue;
+        if (get_cert_sid_hash(pkcs7->cert[i], pkcs7->certSz[i], sidType,
+                              certHash) == 0 &&
+                XMEMCMP(certHash, sidHash, WC_SHA256_DIGEST_SIZE) == 0) {
+            /* cache full is not an error, later bundles miss again */
+            cache_add(sidType, sidHash, pkcs7->cert[i], pkcs7->certSz[i]);
+            break;
+        }
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int verify_one(WorkerCtx* w, Input* in)
+{
+    int ret;
+    int idx = -1;
+    int haveSid;
+    byte sidType = 0;
+    const byte* sid = NULL;
+    word32 sidSz = 0;
+    byte sidHash[WC_SHA256_DIGEST_SIZE];
+    PKCS7* pkcs7;
+
+    haveSid = (get_bundle_sid(in->der, in->derSz, &sidType, &sid,
+                              &sidSz) == 0 &&
+               wc_Sha256Hash(sid, sidSz, sidHash) == 0);
+    if (!haveSid) {
+        w->uncached++;
+        return verify_uncached(in, 0, 0, NULL);
+    }
+
+    pthread_rwlock_rdlock(&cache.lock);
+    idx = cache_find(sidType, sidHash);
+    pthread_rwlock_unlock(&cache.lock);
+
+    if (idx < 0) {
+        w->misses++;
+        return verify_uncached(in, 1, sidType, sidHash);
+    }
+
+    w->hits++;
+
+    /* A PKCS7 keeps decoded state from the last message, so each bundle gets
+     * a freshly initialized one. Cache entries are never removed, so the cert
+     * is safe to read here without the lock. */
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+    ret = wc_PKCS7_InitWithCert(pkcs7, cache.entry[idx].cert,
+                                cache.entry[idx].certSz);
+    if (ret == 0)
+        ret = wc_PKCS7_VerifySignedData(pkcs7, in->der, in->derSz);
+    wc_PKCS7_Free(pkcs7);
+
+    return ret;
+}
+
+static void* worker_thread(void* arg)
+{
+    WorkerCtx* w = (WorkerCtx*)arg;
+    long job;
+    int ret;
+
+    for (;;) {
+        pthread_mutex_lock(&workLock);
+        job = workNext++;
+        pthread_mutex_unlock(&workLock);
+        if (job >= workTotal)
+            break;
+
+        ret = verify_one(w, &inputs[job % inputCnt]);
+        if (ret == 0) {
+            w->verified++;
+        }
+        else {
+            w->failed++;
+            if (w->failed == 1) {
+                printf("Thread %d: verify failed for input %ld, ret = %d\n",
+                       w->id, job % inputCnt, ret);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int add_input(byte* der, word32 derSz)
+{
+    if (inputCnt >= MAX_INPUTS) {
+        printf("ERROR: too many inputs, max %d\n", MAX_INPUTS);
+        XFREE(der, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        return -1;
+    }
+    inputs[inputCnt].der = der;
+    inputs[inputCnt].derSz = derSz;
+    inputCnt++;
+    return 0;
+}
+
+static int read_file(const char* fileName, byte** der, word32* derSz)
+{
+    FILE* file;
+    long  sz;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL) {
+        printf("ERROR: opening file: %s\n", fileName);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    sz = ftell(file);
+    rewind(file);
+    if (sz <= 0) {
+        fclose(file);
+        return -1;
+    }
+
+    *der = (byte*)XMALLOC(sz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (*der == NULL) {
+        fclose(file);
+        return MEMORY_E;
+    }
+    *derSz = (word32)fread(*der, 1, sz, file);
+    fclose(file);
+
+    if (*derSz != (word32)sz) {
+        XFREE(*der, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        return -1;
+    }
+    return 0;
+}
+
+static int load_dir(const char* dirName)
+{
+    DIR* dir;
+    struct dirent* ent;
+    char path[1024];
+    byte* der;
+    word32 derSz;
+
+    dir = opendir(dirName);
+    if (dir == NULL) {
+        printf("ERROR: opening directory: %s\n", dirName);
+        return -1;
+    }
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dirName, ent->d_name);
+        if (read_file(path, &der, &derSz) != 0) {
+            printf("Skipping %s\n", path);
+            continue;
+        }
+        if (add_input(der, derSz) != 0)
+            break;
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+/* Read a stream of concatenated DER bundles from stdin. Each bundle is framed
+ * by the length of its outer SEQUENCE. */
+static int load_stream(FILE* stream)
+{
+    byte   hdr[6];
+    byte*  der;
+    word32 idx, len, hdrSz, extra, total;
+    size_t n;
+
+    for (;;) {
+        /* read the tag and the first length byte */
+        n = fread(hdr, 1, 2, stream);
+        if (n == 0)
+            break;
+        if (n != 2 || hdr[0] != 0x30)
+            return -1;
+
+        hdrSz = 2;
+        len = hdr[1];
+        if (hdr[1] & 0x80) {
+            extra = hdr[1] & 0x7F;
+            if (extra == 0 || extra > 4)
+                return -1;
+            if (fread(hdr + 2, 1, extra, stream) != extra)
+                return -1;
+            hdrSz += extra;
+            len = 0;
+            for (idx = 2; idx < hdrSz; idx++)
+                len = (len << 8) | hdr[idx];
+        }
+
+        if (len > MAX_STREAM_BUNDLE - hdrSz)
+            return -1;
+        total = hdrSz + len;
+
+        der = (byte*)XMALLOC(total, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        if (der == NULL)
+            return MEMORY_E;
+        XMEMCPY(der, hdr, hdrSz);
+        if (fread(der + hdrSz, 1, len, stream) != len) {
+            XFREE(der, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+            return -1;
+        }
+        if (add_input(der, total) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int preload_signer(const char* fileName)
+{
+    byte*  cert;
+    word32 certSz;
+    byte   hash[WC_SHA256_DIGEST_SIZE];
+    int    ret;
+
+    ret = read_file(fileName, &cert, &certSz);
+    if (ret != 0)
+        return ret;
+
+    ret = get_cert_sid_hash(cert, certSz, SID_ISSUER_AND_SERIAL, hash);
+    if (ret == 0 && cache_add(SID_ISSUER_AND_SERIAL, hash, cert, certSz) < 0)
+        ret = -1;
+    /* also match bundles that identify the signer by SubjectKeyIdentifier */
+    if (ret == 0 && get_cert_sid_hash(cert, certSz, SID_SKID, hash) == 0 &&
+            cache_add(SID_SKID, hash, cert, certSz) < 0)
+        ret = -1;
+
+    XFREE(cert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("pkcs7-verify-batch [options]\n");
+    printf("-d <dir>    Verify every DER bundle in directory\n");
+    printf("-s          Read concatenated DER bundles from stdin\n");
+    printf("-c <file>   Pre-load a DER signer certificate (repeatable)\n");
+    printf("-t <num>    Number of worker threads, default %d\n", DEF_THREADS);
+    printf("-n <num>    Number of passes over the inputs, default %d\n",
+           DEF_PASSES);
+    printf("With no -d or -s, %s is verified.\n", DEFAULT_INPUT);
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int ch;
+    int i;
+    int numThreads = DEF_THREADS;
+    long passes = DEF_PASSES;
+    const char* dirName = NULL;
+    int useStdin = 0;
+    WorkerCtx* workers;
+    double start, elapsed;
+    long verified = 0, failed = 0, hits = 0, misses = 0, uncached = 0;
+    byte* der;
+    word32 derSz;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    if (pthread_rwlock_init(&cache.lock, NULL) != 0)
+        return -1;
+
+    while ((ch = getopt(argc, argv, "?d:sc:t:n:")) != -1) {
+        switch (ch) {
+            case 'd':
+                dirName = optarg;
+                break;
+            case 's':
+                useStdin = 1;
+                break;
+            case 'c':
+                if (preload_signer(optarg) != 0) {
+                    printf("ERROR: failed to load signer cert %s\n", optarg);
+                    return -1;
+                }
+                break;
+            case 't':
+                numThreads = atoi(optarg);
+                if (numThreads <= 0) {
+                    Usage();
+                    return -1;
+                }
+                break;
+            case 'n':
+                passes = atol(optarg);
+                if (passes <= 0) {
+                    Usage();
+                    return -1;
+                }
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+
+    if (dirName != NULL) {
+        ret = load_dir(dirName);
+    }
+    else if (useStdin) {
+        ret = load_stream(stdin);
+    }
+    else {
+        ret = read_file(DEFAULT_INPUT, &der, &derSz);
+        if (ret == 0)
+            ret = add_input(der, derSz);
+    }
+    if (ret != 0 || inputCnt == 0) {
+        printf("ERROR: no input bundles loaded\n");
+        return -1;
+    }
+
+    printf("Loaded %d bundles, %d pre-loaded signers, %d threads, "
+           "%ld passes\n", inputCnt, cache.count, numThreads, passes);
+
+    workers = (WorkerCtx*)XMALLOC(sizeof(WorkerCtx) * numThreads, NULL,
+                                  DYNAMIC_TYPE_TMP_BUFFER);
+    if (workers == NULL)
+        return MEMORY_E;
+    XMEMSET(workers, 0, sizeof(WorkerCtx) * numThreads);
+
+    workTotal = passes * inputCnt;
+    workNext = 0;
+
+    start = current_time();
+    for (i = 0; i < numThreads; i++) {
+        workers[i].id = i;
+        if (pthread_create(&workers[i].tid, NULL, worker_thread,
+                           &workers[i]) != 0) {
+            printf("ERROR: failed to create thread %d\n", i);
+            numThreads = i;
+            ret = -1;
+            break;
+        }
+    }
+    for (i = 0; i < numThreads; i++)
+        pthread_join(workers[i].tid, NULL);
+    elapsed = current_time() - start;
+
+    for (i = 0; i < numThreads; i++) {
+        verified += workers[i].verified;
+        failed   += workers[i].failed;
+        hits     += workers[i].hits;
+        misses   += workers[i].misses;
+        uncached += workers[i].uncached;
+    }
+
+    printf("Verified       : %ld\n", verified);
+    printf("Failed         : %ld\n", failed);
+    printf("Elapsed        : %.3f s\n", elapsed);
+    printf("Verifications/s: %.1f\n", elapsed > 0 ? verified / elapsed : 0.0);
+    printf("Signer found   : %ld\n", hits);
+    printf("Signer missing : %ld\n", misses);
+    printf("No signer ID   : %ld\n", uncached);
+    printf("Found rate     : %.2f%%\n", (hits + misses) > 0 ?
+           100.0 * hits / (hits + misses) : 0.0);
+    printf("Stored signers : %d\n", cache.count);
+
+    for (i = 0; i < cache.count; i++)
+        XFREE(cache.entry[i].cert, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    for (i = 0; i < inputCnt; i++)
+        XFREE(inputs[i].der, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(workers, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    pthread_rwlock_destroy(&cache.lock);
+
+    if (ret == 0 && failed > 0)
+        ret = -1;
+
+    return ret;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7\n");
+    return 0;
+}
+
+#endif
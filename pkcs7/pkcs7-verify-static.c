@@ -0,0 +1,505 @@
+/* pkcs7-verify-static.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * Bootloader style PKCS#7/CMS SignedData verification with a fixed memory
+ * budget, for RSA-2048, RSA-3072, ECDSA P-256 and ECDSA P-384 signed images.
+ *
+ * The image is hashed in place by the caller and the signature is checked
+ * with wc_PKCS7_VerifySignedData_ex() against the SignedData header and
+ * footer (created with wc_PKCS7_EncodeSignedData_ex()), so the image is
+ * never copied. The PKCS7 structure itself is on the stack
+ * (wc_PKCS7_Init()), as in pkcs7-verify.c.
+ *
+ * When wolfSSL is built with WOLFSSL_STATIC_MEMORY, all verify allocations
+ * come from a fixed pool loaded with wc_LoadStaticMemory() and the example
+ * reports the peak pool use and allocation counts tracked by wolfSSL. Build
+ * wolfSSL with WOLFSSL_NO_MALLOC as well to prove that nothing falls back
+ * to the system heap. Without static memory the same numbers are collected
+ * with counting allocators registered through wolfSSL_SetAllocators().
+ *
+ * Signer keys and certificates are generated at startup, using a separate
+ * memory pool, so only the verify path is measured.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/sha512.h>
+#include <wolfssl/wolfcrypt/memory.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+/* Size of the image that is signed and verified */
+#define IMAGE_SZ          (256 * 1024)
+/* Verifications per key type */
+#define DEF_ITERATIONS    50
+/* SignedData header and footer buffers */
+#define HEAD_MAX_SZ       4096
+#define FOOT_MAX_SZ       2048
+
+/* Fixed pool for verification, and a larger one for key generation and
+ * signing, which a bootloader does not do. */
+#ifndef STATIC_VERIFY_POOL_SZ
+    #define STATIC_VERIFY_POOL_SZ  (64 * 1024)
+#endif
+#define STATIC_HOST_POOL_SZ        (512 * 1024)
+
+#if defined(HAVE_PKCS7) && defined(WOLFSSL_CERT_GEN) && \
+    defined(WOLFSSL_KEY_GEN) && !defined(NO_RSA) && defined(HAVE_ECC) && \
+    defined(WOLFSSL_SHA384)
+
+#ifdef WOLFSSL_STATIC_MEMORY
+    static WOLFSSL_HEAP_HINT* verifyHeap;
+    static WOLFSSL_HEAP_HINT* hostHeap;
+    static byte gVerifyPool[STATIC_VERIFY_POOL_SZ];
+    static byte gHostPool[STATIC_HOST_POOL_SZ];
+    static WOLFSSL_MEM_CONN_STATS verifyStats;
+#else
+    #define verifyHeap NULL
+    #define hostHeap   NULL
+#endif
+
+typedef struct VerifyCase {
+    const char* name;
+    int         keyType;        /* RSA_TYPE or ECC_TYPE */
+    int         bits;
+    int         curveId;
+    int         hashOID;
+    int         sigType;        /* certificate signature type */
+} VerifyCase;
+
+static const VerifyCase cases[] = {
+    { "RSA-2048",    RSA_TYPE, 2048, 0,             SHA256h, CTC_SHA256wRSA },
+    { "RSA-3072",    RSA_TYPE, 3072, 0,             SHA256h, CTC_SHA256wRSA },
+    { "ECDSA P-256", ECC_TYPE, 256,  ECC_SECP256R1, SHA256h,
+                                                    CTC_SHA256wECDSA },
+    { "ECDSA P-384", ECC_TYPE, 384,  ECC_SECP384R1, SHA384h,
+                                                    CTC_SHA384wECDSA },
+};
+
+/* The image lives outside the pools, as it would in flash. At 256KB it is
+ * also larger than the biggest static memory bucket. */
+static byte gImage[IMAGE_SZ];
+
+/* signed image as stored by the bootloader */
+typedef struct SignedImage {
+    byte    head[HEAD_MAX_SZ];
+    word32  headSz;
+    byte    foot[FOOT_MAX_SZ];
+    word32  footSz;
+} SignedImage;
+
+typedef struct MemUsage {
+    word32  peakMem;
+    word32  peakAlloc;
+    word32  totalAlloc;
+    word32  curAlloc;       /* allocations left after the verify */
+} MemUsage;
+
+#ifndef WOLFSSL_STATIC_MEMORY
+/* counting allocators, used when static memory is not available */
+static MemUsage heapStats;
+static word32 heapCur;
+
+static void* count_malloc(size_t sz)
+{
+    size_t* p = (size_t*)malloc(sz + sizeof(size_t));
+
+    if (p == NULL)
+        return NULL;
+    p[0] = sz;
+    heapCur += (word32)sz;
+    if (heapCur > heapStats.peakMem)
+        heapStats.peakMem = heapCur;
+    heapStats.curAlloc++;
+    if (heapStats.curAlloc > heapStats.peakAlloc)
+        heapStats.peakAlloc = heapStats.curAlloc;
+    heapStats.totalAlloc++;
+
+    return p + 1;
+}
+
+static void count_free(void* ptr)
+{
+    size_t* p;
+
+    if (ptr == NULL)
+        return;
+    p = (size_t*)ptr - 1;
+    heapCur -= (word32)p[0];
+    heapStats.curAlloc--;
+    free(p);
+}
+
+static void* count_realloc(void* ptr, size_t sz)
+{
+    void* n = count_malloc(sz);
+    size_t old;
+
+    if (n != NULL && ptr != NULL) {
+        old = ((size_t*)ptr)[-1];
+        memcpy(n, ptr, old < sz ? old : sz);
+        count_free(ptr);
+    }
+    return n;
+}
+#endif /* !WOLFSSL_STATIC_MEMORY */
+
+static void mem_reset(void)
+{
+#ifdef WOLFSSL_STATIC_MEMORY
+    XMEMSET(&verifyStats, 0, sizeof(verifyStats));
+#else
+    XMEMSET(&heapStats, 0, sizeof(heapStats));
+    heapCur = 0;
+#endif
+}
+
+static void mem_get(MemUsage* usage)
+{
+#ifdef WOLFSSL_STATIC_MEMORY
+    usage->peakMem    = verifyStats.peakMem;
+    usage->peakAlloc  = verifyStats.peakAlloc;
+    usage->totalAlloc = verifyStats.totalAlloc;
+    usage->curAlloc   = verifyStats.curAlloc;
+#else
+    *usage = heapStats;
+#endif
+}
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+/* Hash the image in place, with the hash state on the stack */
+static int hash_image(int hashOID, const byte* img, word32 imgSz,
+                      byte* hash, word32* hashSz, void* heap)
+{
+    int ret;
+
+    if (hashOID == SHA384h) {
+        wc_Sha384 sha;
+        ret = wc_InitSha384_ex(&sha, heap, INVALID_DEVID);
+        if (ret == 0)
+            ret = wc_Sha384Update(&sha, img, imgSz);
+        if (ret == 0)
+            ret = wc_Sha384Final(&sha, hash);
+        wc_Sha384Free(&sha);
+        *hashSz = WC_SHA384_DIGEST_SIZE;
+    }
+    else {
+        wc_Sha256 sha;
+        ret = wc_InitSha256_ex(&sha, heap, INVALID_DEVID);
+        if (ret == 0)
+            ret = wc_Sha256Update(&sha, img, imgSz);
+        if (ret == 0)
+            ret = wc_Sha256Final(&sha, hash);
+        wc_Sha256Free(&sha);
+        *hashSz = WC_SHA256_DIGEST_SIZE;
+    }
+
+    return ret;
+}
+
+/* Generate a signer key and self-signed certificate, then sign the image */
+static int sign_image(const VerifyCase* vc, const byte* img, word32 imgSz,
+                      WC_RNG* rng, SignedImage* out)
+{
+    int ret, keyDerSz = 0, certSz = 0;
+    RsaKey rsaKey;
+    ecc_key eccKey;
+    void* key;
+    Cert cert;
+    PKCS7* pkcs7;
+    byte hash[WC_MAX_DIGEST_SIZE];
+    word32 hashSz;
+    byte* keyDer;
+    byte* certDer;
+
+    keyDer = (byte*)XMALLOC(4096, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+    certDer = (byte*)XMALLOC(4096, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+    if (keyDer == NULL || certDer == NULL) {
+        XFREE(keyDer, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+        XFREE(certDer, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+        return MEMORY_E;
+    }
+
+    if (vc->keyType == RSA_TYPE) {
+        key = &rsaKey;
+        ret = wc_InitRsaKey(&rsaKey, hostHeap);
+        if (ret == 0)
+            ret = wc_MakeRsaKey(&rsaKey, vc->bits, WC_RSA_EXPONENT, rng);
+        if (ret == 0)
+            ret = keyDerSz = wc_RsaKeyToDer(&rsaKey, keyDer, 4096);
+    }
+    else {
+        key = &eccKey;
+        ret = wc_ecc_init_ex(&eccKey, hostHeap, INVALID_DEVID);
+        if (ret == 0)
+            ret = wc_ecc_make_key_ex(rng, vc->bits / 8, &eccKey, vc->curveId);
+        if (ret == 0)
+            ret = keyDerSz = wc_EccKeyToDer(&eccKey, keyDer, 4096);
+    }
+
+    if (ret > 0)
+        ret = wc_InitCert(&cert);
+    if (ret == 0) {
+        strncpy(cert.subject.commonName, "Bootloader Image Signer",
+                CTC_NAME_SIZE);
+        strncpy(cert.subject.org, "wolfSSL", CTC_NAME_SIZE);
+        cert.sigType = vc->sigType;
+        cert.selfSigned = 1;
+        ret = wc_MakeCert_ex(&cert, certDer, 4096, vc->keyType, key, rng);
+    }
+    if (ret >= 0)
+        ret = certSz = wc_SignCert_ex(cert.bodySz, cert.sigType, certDer, 4096,
+                                      vc->keyType, key, rng);
+    if (vc->keyType == RSA_TYPE)
+        wc_FreeRsaKey(&rsaKey);
+    else
+        wc_ecc_free(&eccKey);
+    if (ret < 0) {
+        printf("ERROR: failed to create %s signer, ret = %d\n", vc->name, ret);
+        XFREE(keyDer, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+        XFREE(certDer, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+        return ret;
+    }
+
+    /* sign over the image hash, the image is not part of the bundle */
+    ret = hash_image(vc->hashOID, img, imgSz, hash, &hashSz, hostHeap);
+    pkcs7 = wc_PKCS7_New(hostHeap, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        ret = MEMORY_E;
+    if (ret == 0)
+        ret = wc_PKCS7_InitWithCert(pkcs7, certDer, certSz);
+    if (ret == 0) {
+        pkcs7->rng          = rng;
+        pkcs7->content      = (byte*)img;
+        pkcs7->contentSz    = imgSz;
+        pkcs7->contentOID   = DATA;
+        pkcs7->hashOID      = vc->hashOID;
+        pkcs7->encryptOID   = (vc->keyType == RSA_TYPE) ? RSAk : ECDSAk;
+        pkcs7->privateKey   = keyDer;
+        pkcs7->privateKeySz = keyDerSz;
+
+        out->headSz = sizeof(out->head);
+        out->footSz = sizeof(out->foot);
+        ret = wc_PKCS7_EncodeSignedData_ex(pkcs7, hash, hashSz,
+                                           out->head, &out->headSz,
+                                           out->foot, &out->footSz);
+        if (ret != 0)
+            printf("ERROR: wc_PKCS7_EncodeSignedData_ex() failed, "
+                   "ret = %d\n", ret);
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    XFREE(keyDer, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(certDer, hostHeap, DYNAMIC_TYPE_TMP_BUFFER);
+    return ret;
+}
+
+/* Bootloader verify: hash the image, then check the signature. Every
+ * allocation made here comes from the verify heap. */
+static int verify_image(const VerifyCase* vc, const byte* img, word32 imgSz,
+                        SignedImage* si, double* hashTime, double* verifyTime)
+{
+    int ret;
+    PKCS7 pkcs7;
+    byte hash[WC_MAX_DIGEST_SIZE];
+    word32 hashSz;
+    double start;
+
+    start = current_time();
+    ret = hash_image(vc->hashOID, img, imgSz, hash, &hashSz, verifyHeap);
+    *hashTime = current_time() - start;
+    if (ret != 0)
+        return ret;
+
+    start = current_time();
+    ret = wc_PKCS7_Init(&pkcs7, verifyHeap, INVALID_DEVID);
+    if (ret == 0)
+        ret = wc_PKCS7_InitWithCert(&pkcs7, NULL, 0);
+    if (ret == 0)
+        ret = wc_PKCS7_VerifySignedData_ex(&pkcs7, hash, hashSz,
+                                           si->head, si->headSz,
+                                           si->foot, si->footSz);
+    wc_PKCS7_Free(&pkcs7);
+    *verifyTime = current_time() - start;
+
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("pkcs7-verify-static [options]\n");
+    printf("-i <num>    Verifications per key type, default %d\n",
+           DEF_ITERATIONS);
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0, ch, i, c;
+    int iterations = DEF_ITERATIONS;
+    byte* img = gImage;
+    WC_RNG rng;
+    SignedImage si;
+    MemUsage usage, worst;
+    word32 bound = 0;
+    double hashTime, verifyTime, hashTotal, verifyTotal;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?i:")) != -1) {
+        switch (ch) {
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (iterations <= 0) {
+        Usage();
+        return -1;
+    }
+
+#ifdef WOLFSSL_STATIC_MEMORY
+    if (wc_LoadStaticMemory(&verifyHeap, gVerifyPool, sizeof(gVerifyPool),
+                            WOLFMEM_GENERAL | WOLFMEM_TRACK_STATS, 1) != 0 ||
+        wc_LoadStaticMemory(&hostHeap, gHostPool, sizeof(gHostPool),
+                            WOLFMEM_GENERAL, 1) != 0) {
+        printf("unable to load static memory\n");
+        return -1;
+    }
+    /* collect statistics for everything allocated from the verify pool */
+    verifyHeap->stats = &verifyStats;
+    printf("Static memory: verify pool %d bytes\n", STATIC_VERIFY_POOL_SZ);
+#else
+    if (wolfSSL_SetAllocators(count_malloc, count_free, count_realloc) != 0) {
+        printf("unable to set allocators\n");
+        return -1;
+    }
+    printf("Static memory not enabled, measuring the system heap\n");
+#endif
+
+    /* after the allocators, so nothing from init is freed by count_free() */
+    ret = wolfCrypt_Init();
+    if (ret != 0) {
+        printf("wolfCrypt initialization failed\n");
+        return -1;
+    }
+
+    ret = wc_InitRng_ex(&rng, hostHeap, INVALID_DEVID);
+    if (ret == 0)
+        ret = wc_RNG_GenerateBlock(&rng, img, IMAGE_SZ);
+    if (ret != 0) {
+        wolfCrypt_Cleanup();
+        return -1;
+    }
+
+    printf("Image %d bytes, %d verifications each\n\n", IMAGE_SZ, iterations);
+    printf("%-12s %10s %8s %8s %10s %10s\n", "signer", "peak heap",
+           "allocs", "peak", "hash ms", "verify ms");
+
+    for (c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++) {
+        const VerifyCase* vc = &cases[c];
+
+        ret = sign_image(vc, img, IMAGE_SZ, &rng, &si);
+        if (ret != 0)
+            break;
+
+        XMEMSET(&worst, 0, sizeof(worst));
+        hashTotal = verifyTotal = 0;
+        for (i = 0; i < iterations && ret == 0; i++) {
+            mem_reset();
+            ret = verify_image(vc, img, IMAGE_SZ, &si, &hashTime,
+                               &verifyTime);
+            mem_get(&usage);
+            if (ret != 0) {
+                printf("ERROR: %s verify failed, ret = %d\n", vc->name, ret);
+                break;
+            }
+            if (usage.curAlloc != 0) {
+                printf("ERROR: %s verify leaked %u allocations\n", vc->name,
+                       usage.curAlloc);
+                ret = -1;
+                break;
+            }
+            if (usage.peakMem > worst.peakMem)
+                worst.peakMem = usage.peakMem;
+            if (usage.peakAlloc > worst.peakAlloc)
+                worst.peakAlloc = usage.peakAlloc;
+            if (usage.totalAlloc > worst.totalAlloc)
+                worst.totalAlloc = usage.totalAlloc;
+            hashTotal += hashTime;
+            verifyTotal += verifyTime;
+        }
+        if (ret != 0)
+            break;
+
+        printf("%-12s %10u %8u %8u %10.3f %10.3f\n", vc->name,
+               worst.peakMem, worst.totalAlloc, worst.peakAlloc,
+               hashTotal * 1000 / iterations,
+               verifyTotal * 1000 / iterations);
+        if (worst.peakMem > bound)
+            bound = worst.peakMem;
+    }
+
+    if (ret == 0) {
+        printf("\nPeak verify heap across all signers: %u bytes\n", bound);
+        printf("(peak heap is the largest use seen over all runs, allocs is "
+               "the allocation\n count per verify, peak the most "
+               "allocations live at once)\n");
+    }
+
+    wc_FreeRng(&rng);
+    wolfCrypt_Cleanup();
+
+    return ret == 0 ? 0 : -1;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7 --enable-certgen --enable-keygen --enable-sha384\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,632 @@
+/* signedData-EncryptedFirmwareCB-stream.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * Streaming variant of the decrypt callback in
+ * signedData-EncryptedFirmwareCB.c, for devices with an AES engine.
+ *
+ * The decrypt callback set with wc_PKCS7_SetDecodeEncryptedCb() installs
+ * the firmware image while it decrypts it. The AES-CBC decryption goes
+ * through a crypto callback device that stands in for a DMA driven AES
+ * engine (software AES, throttled to the configured engine rate). The
+ * content is decrypted in fixed size chunks and each decrypted chunk is
+ * handed to a flash programming thread, so programming chunk N overlaps
+ * with decrypting chunk N+1.
+ *
+ * The same bundle is also installed the single-shot way used by
+ * myDecryptionFunc(): decrypt everything with one wc_AesCbcDecrypt() call,
+ * then program the flash. The example reports the install time of both.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+#ifdef WOLF_CRYPTO_CB
+    #include <wolfssl/wolfcrypt/cryptocb.h>
+#endif
+
+#define certFile "../certs/client-cert.der"
+#define keyFile  "../certs/client-key.der"
+
+#define OUTPUT_FILE "signedData_EncryptedFPD_stream.der"
+
+#define AES_ENGINE_DEVID    9
+#define FLASH_PAGE_SZ       4096
+#define DEF_IMAGE_SZ        (1024 * 1024)
+#define DEF_CHUNK_SZ        (16 * 1024)
+#define DEF_PAGE_US         1000    /* flash program time per page */
+#define DEF_ENGINE_MBPS     25      /* AES engine throughput, MB/s */
+
+#if defined(HAVE_PKCS7) && defined(WOLF_CRYPTO_CB) && \
+    defined(HAVE_AES_CBC) && defined(WOLFSSL_AES_256)
+
+static byte defKey[] = {
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08
+};
+
+/* simulated AES engine, registered as a crypto callback device */
+typedef struct AesEngine {
+    double  bytesPerSec;    /* 0 for no throttling */
+    word32  jobs;
+    word32  bytes;
+} AesEngine;
+
+/* install of one image: decrypt, then program to a simulated flash */
+typedef struct Install {
+    int             chunkSz;     /* 0 for single-shot */
+    int             pageUs;
+    byte*           flash;
+    word32          flashSz;
+    word32          imageSz;     /* set once the padding is known */
+    double          decryptTime;
+
+    /* hand-off to the flash thread */
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    byte*           src;
+    word32          ready;       /* bytes decrypted and ready to program */
+    word32          flashed;     /* bytes programmed */
+    int             last;        /* all content decrypted */
+} Install;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static void sleep_until(double t)
+{
+    struct timespec ts;
+    double now = current_time();
+
+    if (t <= now)
+        return;
+    t -= now;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1000000000.0);
+    nanosleep(&ts, NULL);
+}
+
+static int load_certs(byte* cert, word32* certSz, byte* key, word32* keySz)
+{
+    FILE* file;
+
+    /* certificate file */
+    file = fopen(certFile, "rb");
+    if (!file)
+        return -1;
+
+    *certSz = (word32)fread(cert, 1, *certSz, file);
+    fclose(file);
+
+    /* key file */
+    file = fopen(keyFile, "rb");
+    if (!file)
+        return -1;
+
+    *keySz = (word32)fread(key, 1, *keySz, file);
+    fclose(file);
+
+    return 0;
+}
+
+static int write_file_buffer(const char* fileName, byte* in, word32 inSz)
+{
+    int ret;
+    FILE* file;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) {
+        printf("ERROR: opening file for writing: %s\n", fileName);
+        return -1;
+    }
+
+    ret = (int)fwrite(in, 1, inSz, file);
+    if (ret == 0) {
+        printf("ERROR: writing buffer to output file\n");
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    return 0;
+}
+
+/* AES engine: runs the AES-CBC operation in software and holds the caller
+ * for the time the engine would take at its rated throughput */
+static int aesEngineCb(int devId, wc_CryptoInfo* info, void* ctx)
+{
+    int ret;
+    AesEngine* eng = (AesEngine*)ctx;
+    Aes* aes;
+    word32 sz;
+    double start;
+
+    if (info->algo_type != WC_ALGO_TYPE_CIPHER ||
+            info->cipher.type != WC_CIPHER_AES_CBC)
+        return CRYPTOCB_UNAVAILABLE;
+
+    start = current_time();
+    aes = info->cipher.aescbc.aes;
+    sz = info->cipher.aescbc.sz;
+
+    /* software fall back, IV chaining is kept in the Aes structure */
+    aes->devId = INVALID_DEVID;
+    if (info->cipher.enc)
+        ret = wc_AesCbcEncrypt(aes, info->cipher.aescbc.out,
+                               info->cipher.aescbc.in, sz);
+    else
+        ret = wc_AesCbcDecrypt(aes, info->cipher.aescbc.out,
+                               info->cipher.aescbc.in, sz);
+    aes->devId = devId;
+
+    if (eng->bytesPerSec > 0)
+        sleep_until(start + (double)sz / eng->bytesPerSec);
+    eng->jobs++;
+    eng->bytes += sz;
+
+    return ret;
+}
+
+/* program len bytes at offset, one page at a time */
+static void flash_program(Install* inst, const byte* src, word32 offset,
+                          word32 len)
+{
+    word32 n;
+    double start;
+
+    while (len > 0) {
+        start = current_time();
+        n = FLASH_PAGE_SZ - (offset % FLASH_PAGE_SZ);
+        if (n > len)
+            n = len;
+        XMEMCPY(inst->flash + offset, src + offset, n);
+        sleep_until(start + inst->pageUs / 1000000.0);
+        offset += n;
+        len -= n;
+    }
+}
+
+/* flash thread, programs whatever the decrypt callback has made ready */
+static void* flash_thread(void* arg)
+{
+    Install* inst = (Install*)arg;
+    word32 from, to;
+
+    pthread_mutex_lock(&inst->lock);
+    for (;;) {
+        while (inst->flashed == inst->ready && !inst->last)
+            pthread_cond_wait(&inst->cond, &inst->lock);
+        if (inst->flashed == inst->ready)
+            break;
+        from = inst->flashed;
+        to = inst->ready;
+        pthread_mutex_unlock(&inst->lock);
+
+        flash_program(inst, inst->src, from, to - from);
+
+        pthread_mutex_lock(&inst->lock);
+        inst->flashed = to;
+    }
+    pthread_mutex_unlock(&inst->lock);
+
+    return NULL;
+}
+
+static void flash_publish(Install* inst, word32 ready, int last)
+{
+    pthread_mutex_lock(&inst->lock);
+    inst->ready = ready;
+    inst->last = last;
+    pthread_cond_signal(&inst->cond);
+    pthread_mutex_unlock(&inst->lock);
+}
+
+/* find the key from the fwDecryptKeyID attribute, as myDecryptionFunc()
+ * does. Only the default 256 bit key is used in this example. */
+static int get_key(PKCS7* pkcs7, byte** key, int* keySz)
+{
+    int ret, keyId = -1;
+    word32 keyIdSz = 0;
+    byte keyIdRaw[16];
+
+    /* fwDecryptKeyID OID "1.2.840.113549.1.9.16.2.37 */
+    const unsigned char fwDecryptKeyID[] = {
+        0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D,
+        0x01, 0x09, 0x10, 0x02, 0x25
+    };
+
+    ret = wc_PKCS7_GetAttributeValue(pkcs7, fwDecryptKeyID,
+            sizeof(fwDecryptKeyID), NULL, &keyIdSz);
+    if (ret == LENGTH_ONLY_E && keyIdSz >= 3 && keyIdSz <= sizeof(keyIdRaw)) {
+        ret = wc_PKCS7_GetAttributeValue(pkcs7, fwDecryptKeyID,
+                sizeof(fwDecryptKeyID), keyIdRaw, &keyIdSz);
+        if (ret > 0)
+            keyId = keyIdRaw[2];   /* skip OCTET STRING tag and length */
+    }
+    if (keyId != 0) {
+        printf("\t\tUnexpected key ID %d\n", keyId);
+        return -1;
+    }
+
+    *key = defKey;
+    *keySz = sizeof(defKey);
+    return 0;
+}
+
+/* callback function for wc_PKCS7_DecodeEncryptedData, installs the image
+ * while decrypting it */
+static int streamDecryptionFunc(PKCS7* pkcs7, int encryptOID, byte* iv,
+        int ivSz, byte* aad, word32 aadSz, byte* authTag, word32 authTagSz,
+        byte* in, int inSz, byte* out, void* usrCtx)
+{
+    int ret, keySz, n, off;
+    byte* key;
+    byte pad;
+    Aes aes;
+    pthread_t flasher;
+    Install* inst = (Install*)usrCtx;
+    double start;
+
+    if (encryptOID != AES256CBCb || ivSz != AES_BLOCK_SIZE ||
+            inSz <= 0 || (inSz % AES_BLOCK_SIZE) != 0)
+        return BAD_FUNC_ARG;
+    if (get_key(pkcs7, &key, &keySz) != 0)
+        return -1;
+
+    ret = wc_AesInit(&aes, NULL, AES_ENGINE_DEVID);
+    if (ret == 0)
+        ret = wc_AesSetKey(&aes, key, keySz, iv, AES_DECRYPTION);
+    if (ret != 0) {
+        wc_AesFree(&aes);
+        return ret;
+    }
+
+    if (inst->chunkSz == 0) {
+        /* single-shot: decrypt all of it, then program the flash */
+        start = current_time();
+        ret = wc_AesCbcDecrypt(&aes, out, in, inSz);
+        inst->decryptTime = current_time() - start;
+        wc_AesFree(&aes);
+        if (ret != 0)
+            return ret;
+
+        pad = out[inSz - 1];
+        if (pad == 0 || pad > AES_BLOCK_SIZE || (word32)(inSz - pad) >
+                inst->flashSz)
+            return -1;
+        inst->imageSz = inSz - pad;
+        flash_program(inst, out, 0, inst->imageSz);
+        return 0;
+    }
+
+    /* streamed: flash thread programs chunk N while chunk N+1 decrypts */
+    inst->src = out;
+    inst->ready = inst->flashed = 0;
+    inst->last = 0;
+    inst->decryptTime = 0;
+    if (pthread_create(&flasher, NULL, flash_thread, inst) != 0) {
+        wc_AesFree(&aes);
+        return -1;
+    }
+
+    for (off = 0; off < inSz && ret == 0; off += n) {
+        n = inSz - off;
+        if (n > inst->chunkSz)
+            n = inst->chunkSz;
+
+        start = current_time();
+        ret = wc_AesCbcDecrypt(&aes, out + off, in + off, n);
+        inst->decryptTime += current_time() - start;
+        if (ret != 0)
+            break;
+
+        if (off + n < inSz) {
+            flash_publish(inst, off + n, 0);
+            continue;
+        }
+
+        /* padding is only in the last block */
+        pad = out[inSz - 1];
+        if (pad == 0 || pad > AES_BLOCK_SIZE || (word32)(inSz - pad) >
+                inst->flashSz) {
+            ret = -1;
+            break;
+        }
+        inst->imageSz = inSz - pad;
+        flash_publish(inst, inst->imageSz, 1);
+    }
+    if (ret != 0)
+        flash_publish(inst, inst->ready, 1);
+
+    pthread_join(flasher, NULL);
+    wc_AesFree(&aes);
+
+    return ret;
+}
+
+/* returns size of bundle on success */
+static int generateBundle(const byte* image, word32 imageSz, byte* out,
+                          word32 outSz)
+{
+    int ret;
+    PKCS7* pkcs7;
+    word32 certSz, keySz;
+    byte cert[2048];
+    byte key[2048];
+
+    /* fwDecryptKeyID OID 1.2.840.113549.1.9.16.2.37 */
+    const unsigned char fwDecryptKeyID[] = {
+        0x06, 0x0B,
+        0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D,
+        0x01, 0x09, 0x10, 0x02, 0x25
+    };
+    byte keyID[] = { 0x04, 0x01, 0x00 };
+
+    PKCS7Attrib attribs[] =
+    {
+        { fwDecryptKeyID, sizeof(fwDecryptKeyID), keyID, sizeof(keyID) }
+    };
+
+    certSz = sizeof(cert);
+    keySz = sizeof(key);
+    ret = load_certs(cert, &certSz, key, &keySz);
+    if (ret != 0)
+        return -1;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return -1;
+
+    ret = wc_PKCS7_InitWithCert(pkcs7, cert, certSz);
+    if (ret == 0)
+        ret = wc_PKCS7_SetSignerIdentifierType(pkcs7, CMS_SKID);
+    if (ret == 0) {
+        ret = wc_PKCS7_EncodeSignedEncryptedFPD(pkcs7, defKey, sizeof(defKey),
+                key, keySz, AES256CBCb, RSAk, SHA256h, (byte*)image, imageSz,
+                NULL, 0, attribs, 1, out, outSz);
+        if (ret <= 0)
+            printf("ERROR: wc_PKCS7_EncodeSignedEncryptedFPD() failed, "
+                   "ret = %d\n", ret);
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+/* verify the bundle and install the image through the decrypt callback */
+static int installBundle(byte* der, word32 derSz, Install* inst,
+                         double* verifyTime, double* installTime)
+{
+    int ret;
+    PKCS7* pkcs7;
+    byte* decoded;
+    double start;
+
+    decoded = (byte*)XMALLOC(derSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (decoded == NULL || pkcs7 == NULL) {
+        XFREE(decoded, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        wc_PKCS7_Free(pkcs7);
+        return MEMORY_E;
+    }
+
+    start = current_time();
+    ret = wc_PKCS7_InitWithCert(pkcs7, NULL, 0);
+    if (ret == 0)
+        ret = wc_PKCS7_VerifySignedData(pkcs7, der, derSz);
+    *verifyTime = current_time() - start;
+    if (ret != 0)
+        printf("\tERROR: verify failed, ret = %d\n", ret);
+
+    if (ret == 0)
+        ret = wc_PKCS7_SetDecodeEncryptedCb(pkcs7, streamDecryptionFunc);
+    if (ret == 0)
+        ret = wc_PKCS7_SetDecodeEncryptedCtx(pkcs7, inst);
+    if (ret == 0) {
+        XMEMSET(inst->flash, 0xFF, inst->flashSz);   /* erased flash */
+        start = current_time();
+        ret = wc_PKCS7_DecodeEncryptedData(pkcs7, pkcs7->content,
+                pkcs7->contentSz, decoded, derSz);
+        *installTime = current_time() - start;
+        if (ret < 0)
+            printf("\tERROR: install failed, ret = %d\n", ret);
+        else
+            ret = 0;
+    }
+
+    XFREE(decoded, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("signedData-EncryptedFirmwareCB-stream [options]\n");
+    printf("-s <bytes>  Firmware image size, default %d\n", DEF_IMAGE_SZ);
+    printf("-c <bytes>  Decrypt chunk size, multiple of %d, default %d\n",
+           AES_BLOCK_SIZE, DEF_CHUNK_SZ);
+    printf("-p <us>     Flash program time per %d byte page, default %d\n",
+           FLASH_PAGE_SZ, DEF_PAGE_US);
+    printf("-r <MB/s>   AES engine throughput, 0 for unthrottled, "
+           "default %d\n", DEF_ENGINE_MBPS);
+}
+
+int main(int argc, char** argv)
+{
+    int ret, ch, i;
+    int imageSz = DEF_IMAGE_SZ;
+    int chunkSz = DEF_CHUNK_SZ;
+    int pageUs = DEF_PAGE_US;
+    int engineMBps = DEF_ENGINE_MBPS;
+    byte* image = NULL;
+    byte* der = NULL;
+    word32 derSz;
+    WC_RNG rng;
+    AesEngine engine;
+    Install inst;
+    double verifyTime, installTime;
+    const char* mode[2] = { "single-shot", "streamed" };
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?s:c:p:r:")) != -1) {
+        switch (ch) {
+            case 's':
+                imageSz = atoi(optarg);
+                break;
+            case 'c':
+                chunkSz = atoi(optarg);
+                break;
+            case 'p':
+                pageUs = atoi(optarg);
+                break;
+            case 'r':
+                engineMBps = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (imageSz <= 0 || chunkSz <= 0 || (chunkSz % AES_BLOCK_SIZE) != 0 ||
+            pageUs < 0 || engineMBps < 0) {
+        Usage();
+        return -1;
+    }
+
+    ret = wolfCrypt_Init();
+    if (ret != 0) {
+        printf("wolfCrypt initialization failed\n");
+        return -1;
+    }
+
+    XMEMSET(&engine, 0, sizeof(engine));
+    engine.bytesPerSec = engineMBps * 1024.0 * 1024.0;
+    ret = wc_CryptoCb_RegisterDevice(AES_ENGINE_DEVID, aesEngineCb, &engine);
+    if (ret != 0) {
+        printf("unable to register AES engine, ret = %d\n", ret);
+        return -1;
+    }
+
+    XMEMSET(&inst, 0, sizeof(inst));
+    pthread_mutex_init(&inst.lock, NULL);
+    pthread_cond_init(&inst.cond, NULL);
+    inst.pageUs = pageUs;
+    inst.flashSz = imageSz;
+
+    derSz = imageSz + 8192;
+    image = (byte*)XMALLOC(imageSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    inst.flash = (byte*)XMALLOC(imageSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    der = (byte*)XMALLOC(derSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (image == NULL || inst.flash == NULL || der == NULL) {
+        ret = MEMORY_E;
+        goto exit;
+    }
+
+    ret = wc_InitRng(&rng);
+    if (ret == 0) {
+        ret = wc_RNG_GenerateBlock(&rng, image, imageSz);
+        wc_FreeRng(&rng);
+    }
+    if (ret != 0)
+        goto exit;
+
+    ret = generateBundle(image, imageSz, der, derSz);
+    if (ret <= 0)
+        goto exit;
+    derSz = ret;
+    printf("Signed Encrypted FirmwarePkgData: image %d bytes, bundle %u bytes "
+           "(%s)\n", imageSz, derSz, OUTPUT_FILE);
+    ret = write_file_buffer(OUTPUT_FILE, der, derSz);
+    if (ret != 0)
+        goto exit;
+
+    printf("Flash page %d bytes, %d us/page, AES engine %d MB/s, chunk %d "
+           "bytes\n\n", FLASH_PAGE_SZ, pageUs, engineMBps, chunkSz);
+    printf("%-12s %10s %11s %11s %10s %8s\n", "install", "verify ms",
+           "decrypt ms", "install ms", "total ms", "engine");
+
+    for (i = 0; i < 2; i++) {
+        inst.chunkSz = (i == 0) ? 0 : chunkSz;
+        inst.imageSz = 0;
+        engine.jobs = 0;
+
+        ret = installBundle(der, derSz, &inst, &verifyTime, &installTime);
+        if (ret != 0)
+            break;
+        if (inst.imageSz != (word32)imageSz ||
+                XMEMCMP(inst.flash, image, imageSz) != 0) {
+            printf("ERROR: %s install does not match the firmware image\n",
+                   mode[i]);
+            ret = -1;
+            break;
+        }
+
+        printf("%-12s %10.2f %11.2f %11.2f %10.2f %8u\n", mode[i],
+               verifyTime * 1000, inst.decryptTime * 1000,
+               installTime * 1000, (verifyTime + installTime) * 1000,
+               engine.jobs);
+    }
+    if (ret == 0)
+        printf("\nFlash contents match the firmware image\n");
+
+exit:
+    if (ret < 0)
+        printf("ERROR = %d\n", ret);
+    wc_CryptoCb_UnRegisterDevice(AES_ENGINE_DEVID);
+    pthread_mutex_destroy(&inst.lock);
+    pthread_cond_destroy(&inst.cond);
+    XFREE(image, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(inst.flash, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    XFREE(der, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    wolfCrypt_Cleanup();
+
+    return ret == 0 ? 0 : -1;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7 --enable-cryptocb\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,1375 @@
+/* signedData-FirmwareDelta.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * This file includes an example of delta (patch) firmware updates carried in
+ * a PKCS7/CMS SignedData bundle that encapsulates an EncryptedData content
+ * of type FirmwarePkgData, the same layout as
+ * signedData-EncryptedFirmwarePkgData.c.
+ *
+ * Host side:
+ *   - creates a bsdiff-style delta of the new image against the base image:
+ *     records of (diff length, extra length, seek), where diff bytes are the
+ *     byte-wise difference to the base image (mostly zero, so zero runs are
+ *     run-length coded) and extra bytes are new data
+ *   - encrypts the delta as FirmwarePkgData in an EncryptedData
+ *   - signs it with wc_PKCS7_EncodeSignedData_ex(), adding a
+ *     firmwarePackageInfo attribute (RFC 4108) whose dependency is the base
+ *     firmware version the delta applies to
+ *
+ * Device side, with RAM bounded by the chunk size:
+ *   - hashes the encapsulated content while reading it and verifies the
+ *     signature with wc_PKCS7_VerifySignedData_ex(), so only the bundle
+ *     header and footer are held in memory
+ *   - checks the base version attribute against the running version
+ *   - decrypts the EncryptedData content with AES-CBC chunk by chunk and
+ *     feeds the plaintext into a streaming patcher that reads the base image
+ *     and writes the new image
+ *
+ * The example compares package size and device apply time for the delta
+ * and for a full image package.
+ *
+ * Without -b and -n, a base image and a new image are generated.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/aes.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+
+#define certFile "../certs/client-cert.der"
+#define keyFile  "../certs/client-key.der"
+
+#define baseImageFile     "firmwareBase.bin"
+#define newImageFile      "firmwareNew.bin"
+#define patchedImageFile  "firmwarePatched.bin"
+#define deltaPackageFile  "signedFirmwareDelta.der"
+#define fullPackageFile   "signedFirmwareFull.der"
+
+#define DEF_BASE_VERSION  "1.0.0"
+#define DEF_CHUNK_SZ      4096     /* device chunk size, multiple of 16 */
+#define DEF_IMAGE_SZ      (1024 * 1024)
+
+#define HEAD_MAX_SZ       4096     /* SignedData before the content */
+#define FOOT_MAX_SZ       4096     /* SignedData after the content */
+#define INNER_HDR_MAX_SZ  256      /* EncryptedData before the ciphertext */
+
+#define DELTA_MAGIC       "FWD1"
+#define DELTA_HDR_SZ      (4 + 4 + 4 + 2 * WC_SHA256_DIGEST_SIZE)
+#define MATCH_KEY_SZ      8        /* bytes hashed to find matches */
+#define MIN_MATCH_SZ      24       /* shortest exact match used */
+#define MATCH_TABLE_BITS  20
+
+#if defined(HAVE_PKCS7) && !defined(NO_AES) && defined(HAVE_AES_CBC) && \
+    defined(WOLFSSL_AES_256) && !defined(NO_SHA256) && !defined(NO_RSA)
+
+static byte aes256Key[] = {
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+    0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08
+};
+
+/* id-aa-firmwarePackageInfo, 1.2.840.113549.1.9.16.2.42 */
+static byte fwPkgInfoOid[] = {
+    0x06, 0x0B,
+    0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D,
+    0x01, 0x09, 0x10, 0x02, 0x2A
+};
+/* id-aes256-CBC, 2.16.840.1.101.3.4.1.42 */
+static const byte aes256CbcOid[] = {
+    0x06, 0x09, 0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x01, 0x2A
+};
+
+/* growable host side buffer */
+typedef struct Buffer {
+    byte*   buf;
+    word32  len;
+    word32  cap;
+} Buffer;
+
+/* Device side patch state, all memory is fixed at init */
+enum {
+    PATCH_HEADER,
+    PATCH_CTRL,
+    PATCH_DIFF_ZERO,
+    PATCH_DIFF_LITLEN,
+    PATCH_DIFF_LIT,
+    PATCH_EXTRA,
+    PATCH_DONE
+};
+
+typedef struct Patcher {
+    int     state;
+    byte    hdr[DELTA_HDR_SZ];
+    word32  hdrLen;
+    word32  oldSz;
+    word32  newSz;
+    /* varint being parsed */
+    word64  varint;
+    int     varintShift;
+    int     ctrlIdx;
+    word64  ctrl[3];        /* diff length, extra length, zigzag seek */
+    word64  diffLeft;
+    word64  litLeft;
+    word64  extraLeft;
+    word64  oldPos;
+    word64  newPos;
+    /* base image read cache */
+    FILE*   oldFile;
+    byte*   oldBuf;
+    word64  oldBufStart;
+    word32  oldBufLen;
+    /* output image write buffer */
+    FILE*   outFile;
+    byte*   outBuf;
+    word32  outLen;
+    word32  chunkSz;
+    wc_Sha256 sha;          /* hash of the new image */
+} Patcher;
+
+typedef struct ApplyStats {
+    double  seconds;
+    word32  ramSz;          /* device working buffers */
+} ApplyStats;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int load_certs(byte* cert, word32* certSz, byte* key, word32* keySz)
+{
+    FILE* file;
+
+    /* certificate file */
+    file = fopen(certFile, "rb");
+    if (!file)
+        return -1;
+
+    *certSz = (word32)fread(cert, 1, *certSz, file);
+    fclose(file);
+
+    /* key file */
+    file = fopen(keyFile, "rb");
+    if (!file)
+        return -1;
+
+    *keySz = (word32)fread(key, 1, *keySz, file);
+    fclose(file);
+
+    return 0;
+}
+
+static int write_file_buffer(const char* fileName, byte* in, word32 inSz)
+{
+    int ret;
+    FILE* file;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) {
+        printf("ERROR: opening file for writing: %s\n", fileName);
+        return -1;
+    }
+
+    ret = (int)fwrite(in, 1, inSz, file);
+    if (ret == 0) {
+        printf("ERROR: writing buffer to output file\n");
+        return -1;
+    }
+    fclose(file);
+
+    return 0;
+}
+
+static byte* read_file(const char* fileName, word32* sz)
+{
+    FILE* file;
+    long len;
+    byte* buf = NULL;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL) {
+        printf("ERROR: failed to open %s\n", fileName);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    len = ftell(file);
+    rewind(file);
+
+    if (len > 0)
+        buf = (byte*)malloc(len);
+    if (buf != NULL && fread(buf, 1, len, file) != (size_t)len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(file);
+
+    *sz = (word32)len;
+    return buf;
+}
+
+/* Host: test images */
+
+static word32 rand_next(word32* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void store_le32(byte* p, word32 v)
+{
+    p[0] = (byte)v;
+    p[1] = (byte)(v >> 8);
+    p[2] = (byte)(v >> 16);
+    p[3] = (byte)(v >> 24);
+}
+
+/* base image: code-like words with embedded absolute addresses */
+static void gen_base_image(byte* img, word32 sz)
+{
+    word32 i, r, state = 0x1234567;
+
+    for (i = 0; i + 4 <= sz; i += 4) {
+        r = rand_next(&state);
+        if ((r & 7) == 0) {
+            /* absolute address into the image, changes when code moves */
+            word32 addr = 0x08000000 + (r >> 8) % sz;
+            store_le32(img + i, addr);
+        }
+        else {
+            img[i] = (byte)(r & 0x3F); img[i+1] = (byte)(0x40 | (r >> 28));
+            img[i+2] = (byte)((r >> 8) & 0x0F); img[i+3] = 0xE5;
+        }
+    }
+    for (; i < sz; i++)
+        img[i] = 0xFF;
+}
+
+/* new image: a few inserted functions, one removed block, relocated
+ * addresses after each insertion and an appended section */
+static byte* gen_new_image(const byte* base, word32 baseSz, word32* newSz)
+{
+    static const word32 insertAt[] = { 1, 3, 6 };  /* eighths of base */
+    word32 i, j, k, r, state = 0x7654321;
+    word32 shift = 0, pos = 0, outLen = 0, insSz = 2048, appSz = 16384;
+    byte* img;
+
+    img = (byte*)malloc(baseSz + 4 * insSz + appSz);
+    if (img == NULL)
+        return NULL;
+
+    for (k = 0; k <= 3; k++) {
+        word32 end = (k < 3) ? (baseSz / 8) * insertAt[k] : baseSz;
+
+        /* copy base up to the insertion point, relocating addresses */
+        for (i = pos; i + 4 <= end; i += 4) {
+            word32 w = base[i] | (base[i+1] << 8) | (base[i+2] << 16) |
+                       ((word32)base[i+3] << 24);
+            if ((w & 0xFF000000) == 0x08000000 && shift > 0) {
+                w += shift;
+                store_le32(img + outLen, w);
+            }
+            else {
+                memcpy(img + outLen, base + i, 4);
+            }
+            outLen += 4;
+        }
+        pos = end;
+        if (k == 3)
+            break;
+
+        /* new function */
+        for (j = 0; j < insSz; j++)
+            img[outLen++] = (byte)rand_next(&state);
+        shift += insSz;
+
+        /* drop a block after the second insertion */
+        if (k == 1)
+            pos += 1024;
+    }
+
+    /* appended section */
+    for (j = 0; j < appSz; j++) {
+        r = rand_next(&state);
+        img[outLen++] = (byte)((j & 3) == 3 ? 0xE5 : r & 0x3F);
+    }
+
+    *newSz = outLen;
+    return img;
+}
+
+/* Host: delta encoder */
+
+static int buf_grow(Buffer* b, word32 add)
+{
+    byte* p;
+    word32 cap;
+
+    if (b->len + add <= b->cap)
+        return 0;
+    cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + add)
+        cap *= 2;
+    p = (byte*)realloc(b->buf, cap);
+    if (p == NULL)
+        return MEMORY_E;
+    b->buf = p;
+    b->cap = cap;
+
+    return 0;
+}
+
+static int buf_put(Buffer* b, const byte* data, word32 sz)
+{
+    if (buf_grow(b, sz) != 0)
+        return MEMORY_E;
+    memcpy(b->buf + b->len, data, sz);
+    b->len += sz;
+
+    return 0;
+}
+
+static int buf_put_u32(Buffer* b, word32 v)
+{
+    byte tmp[4];
+
+    tmp[0] = (byte)(v >> 24); tmp[1] = (byte)(v >> 16);
+    tmp[2] = (byte)(v >> 8);  tmp[3] = (byte)v;
+    return buf_put(b, tmp, 4);
+}
+
+static int buf_put_varint(Buffer* b, word64 v)
+{
+    byte tmp[10];
+    word32 i = 0;
+
+    do {
+        tmp[i] = (byte)(v & 0x7F);
+        v >>= 7;
+        if (v)
+            tmp[i] |= 0x80;
+        i++;
+    } while (v);
+
+    return buf_put(b, tmp, i);
+}
+
+static word32 match_hash(const byte* p)
+{
+    word64 v = 0;
+    int i;
+
+    for (i = 0; i < MATCH_KEY_SZ; i++)
+        v = (v << 8) | p[i];
+    return (word32)((v * 0x9E3779B97F4A7C15ULL) >> (64 - MATCH_TABLE_BITS));
+}
+
+/* Write diff bytes (new - old) as (zero run, literal length, literals)
+ * tokens. Zero runs shorter than 4 bytes stay inside literals. */
+static int put_diff(Buffer* b, const byte* oldp, const byte* newp,
+                    word32 len)
+{
+    int ret = 0;
+    word32 i = 0, zero, lit, z;
+
+    while (ret == 0 && i < len) {
+        zero = 0;
+        while (i + zero < len && newp[i + zero] == oldp[i + zero])
+            zero++;
+        i += zero;
+
+        lit = 0;
+        while (i + lit < len) {
+            for (z = 0; z < 4 && i + lit + z < len &&
+                        newp[i + lit + z] == oldp[i + lit + z]; z++);
+            if (z == 4 || (z > 0 && i + lit + z == len))
+                break;
+            lit += (z > 0) ? z : 1;
+        }
+
+        ret = buf_put_varint(b, zero);
+        if (ret == 0)
+            ret = buf_put_varint(b, lit);
+        while (ret == 0 && lit > 0) {
+            byte d = (byte)(newp[i] - oldp[i]);
+            ret = buf_put(b, &d, 1);
+            i++;
+            lit--;
+        }
+    }
+
+    return ret;
+}
+
+/* Create a bsdiff-style delta from oldImg to newImg. Exact matches are found
+ * through a hash index of the base image, and each match is extended forward
+ * as long as more than half of the bytes match, which covers code whose
+ * embedded addresses changed. An empty base gives a full image payload. */
+static int delta_create(const byte* oldImg, word32 oldSz, const byte* newImg,
+                        word32 newSz, Buffer* out)
+{
+    int ret;
+    int* table = NULL;
+    word32 i, s, scan = 0, lastScan = 0, lastOld = 0;
+    word32 matchNew, matchOld, matchLen, lenf, a, c, m;
+    long score, best;
+    byte hash[WC_SHA256_DIGEST_SIZE];
+
+    /* header */
+    ret = buf_put(out, (const byte*)DELTA_MAGIC, 4);
+    if (ret == 0)
+        ret = buf_put_u32(out, oldSz);
+    if (ret == 0)
+        ret = buf_put_u32(out, newSz);
+    memset(hash, 0, sizeof(hash));
+    if (ret == 0 && oldSz > 0)
+        ret = wc_Sha256Hash(oldImg, oldSz, hash);
+    if (ret == 0)
+        ret = buf_put(out, hash, sizeof(hash));
+    if (ret == 0)
+        ret = wc_Sha256Hash(newImg, newSz, hash);
+    if (ret == 0)
+        ret = buf_put(out, hash, sizeof(hash));
+    if (ret != 0)
+        return ret;
+
+    if (oldSz >= MATCH_KEY_SZ) {
+        table = (int*)malloc(sizeof(int) << MATCH_TABLE_BITS);
+        if (table == NULL)
+            return MEMORY_E;
+        memset(table, 0xFF, sizeof(int) << MATCH_TABLE_BITS);
+        for (i = 0; i + MATCH_KEY_SZ <= oldSz; i++)
+            table[match_hash(oldImg + i)] = (int)i;
+    }
+
+    while (ret == 0) {
+        /* find the next exact match that is not on the current alignment */
+        matchNew = newSz;
+        matchOld = 0;
+        matchLen = 0;
+        for (s = scan; table != NULL && s + MATCH_KEY_SZ <= newSz; s++) {
+            a = lastOld + (s - lastScan);
+            if (a + MATCH_KEY_SZ <= oldSz &&
+                    memcmp(oldImg + a, newImg + s, MATCH_KEY_SZ) == 0)
+                continue;
+            if (table[match_hash(newImg + s)] < 0)
+                continue;
+            c = (word32)table[match_hash(newImg + s)];
+            if (c == a)
+                continue;
+            for (m = 0; c + m < oldSz && s + m < newSz &&
+                        oldImg[c + m] == newImg[s + m]; m++);
+            if (m >= MIN_MATCH_SZ) {
+                matchNew = s;
+                matchOld = c;
+                matchLen = m;
+                break;
+            }
+        }
+
+        /* extend the previous alignment forward while it pays off */
+        lenf = 0;
+        score = 0;
+        best = 0;
+        for (i = 0; lastScan + i < matchNew && lastOld + i < oldSz; i++) {
+            if (oldImg[lastOld + i] == newImg[lastScan + i])
+                score++;
+            else
+                score--;
+            if (score > best) {
+                best = score;
+                lenf = i + 1;
+            }
+        }
+
+        /* control: diff length, extra length, zigzag encoded seek. The seek
+         * is kept in 64 bits since long is 32 bits on many embedded targets */
+        {
+            int64_t seek = (matchNew < newSz) ?
+                           (int64_t)matchOld - (int64_t)(lastOld + lenf) : 0;
+            ret = buf_put_varint(out, lenf);
+            if (ret == 0)
+                ret = buf_put_varint(out, matchNew - lastScan - lenf);
+            if (ret == 0)
+                ret = buf_put_varint(out, ((word64)seek << 1) ^
+                                          (word64)(seek >> 63));
+        }
+        if (ret == 0 && lenf > 0)
+            ret = put_diff(out, oldImg + lastOld, newImg + lastScan, lenf);
+        if (ret == 0)
+            ret = buf_put(out, newImg + lastScan + lenf,
+                          matchNew - lastScan - lenf);
+
+        if (matchNew == newSz)
+            break;
+        lastScan = matchNew;
+        lastOld = matchOld;
+        scan = matchNew + matchLen;
+    }
+
+    free(table);
+    return ret;
+}
+
+/* Host: package */
+
+/* Encrypt the payload as FirmwarePkgData and sign it. The signature is made
+ * over the content hash, and the package is written as
+ * header | EncryptedData | footer. baseVersion adds the base dependency. */
+static int create_package(const char* fileName, byte* payload,
+                          word32 payloadSz, const char* baseVersion,
+                          byte* cert, word32 certSz, byte* key, word32 keySz,
+                          word32* packageSz)
+{
+    int ret, encSz = 0;
+    PKCS7* pkcs7;
+    WC_RNG rng;
+    byte* enc;
+    byte head[HEAD_MAX_SZ];
+    byte foot[FOOT_MAX_SZ];
+    word32 headSz = sizeof(head), footSz = sizeof(foot);
+    byte hash[WC_SHA256_DIGEST_SIZE];
+    byte pkgInfo[64];
+    word32 verSz = 0;
+    FILE* file;
+    PKCS7Attrib attribs[1];
+
+    enc = (byte*)malloc(payloadSz + 512);
+    if (enc == NULL)
+        return MEMORY_E;
+
+    /* encrypt FirmwarePkgData */
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL) {
+        free(enc);
+        return MEMORY_E;
+    }
+    pkcs7->content         = payload;
+    pkcs7->contentSz       = payloadSz;
+    pkcs7->contentOID      = FIRMWARE_PKG_DATA;
+    pkcs7->encryptOID      = AES256CBCb;
+    pkcs7->encryptionKey   = aes256Key;
+    pkcs7->encryptionKeySz = sizeof(aes256Key);
+
+    encSz = wc_PKCS7_EncodeEncryptedData(pkcs7, enc, payloadSz + 512);
+    wc_PKCS7_Free(pkcs7);
+    if (encSz <= 0) {
+        printf("ERROR: wc_PKCS7_EncodeEncryptedData() failed, ret = %d\n",
+               encSz);
+        free(enc);
+        return -1;
+    }
+
+    ret = wc_Sha256Hash(enc, encSz, hash);
+    if (ret == 0)
+        ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        free(enc);
+        return ret;
+    }
+
+    /* sign the EncryptedData */
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        ret = MEMORY_E;
+    if (ret == 0)
+        ret = wc_PKCS7_InitWithCert(pkcs7, cert, certSz);
+    if (ret == 0) {
+        pkcs7->rng          = &rng;
+        pkcs7->content      = enc;
+        pkcs7->contentSz    = encSz;
+        pkcs7->contentOID   = ENCRYPTED_DATA;
+        pkcs7->hashOID      = SHA256h;
+        pkcs7->encryptOID   = RSAk;
+        pkcs7->privateKey   = key;
+        pkcs7->privateKeySz = keySz;
+
+        if (baseVersion != NULL) {
+            /* FirmwarePackageInfo { dependencies { legacy OCTET STRING } } */
+            verSz = (word32)strlen(baseVersion);
+            if (verSz > sizeof(pkgInfo) - 6)
+                verSz = sizeof(pkgInfo) - 6;
+            pkgInfo[0] = 0x30; pkgInfo[1] = (byte)(verSz + 4);
+            pkgInfo[2] = 0x30; pkgInfo[3] = (byte)(verSz + 2);
+            pkgInfo[4] = 0x04; pkgInfo[5] = (byte)verSz;
+            memcpy(pkgInfo + 6, baseVersion, verSz);
+
+            attribs[0].oid     = fwPkgInfoOid;
+            attribs[0].oidSz   = sizeof(fwPkgInfoOid);
+            attribs[0].value   = pkgInfo;
+            attribs[0].valueSz = verSz + 6;
+            pkcs7->signedAttribs   = attribs;
+            pkcs7->signedAttribsSz = 1;
+        }
+
+        ret = wc_PKCS7_EncodeSignedData_ex(pkcs7, hash, sizeof(hash),
+                                           head, &headSz, foot, &footSz);
+        if (ret != 0)
+            printf("ERROR: wc_PKCS7_EncodeSignedData_ex() failed, "
+                   "ret = %d\n", ret);
+    }
+    wc_PKCS7_Free(pkcs7);
+    wc_FreeRng(&rng);
+
+    if (ret == 0) {
+        file = fopen(fileName, "wb");
+        if (file == NULL ||
+                fwrite(head, 1, headSz, file) != headSz ||
+                fwrite(enc, 1, encSz, file) != (size_t)encSz ||
+                fwrite(foot, 1, footSz, file) != footSz) {
+            printf("ERROR: writing package %s\n", fileName);
+            ret = -1;
+        }
+        if (file != NULL)
+            fclose(file);
+        *packageSz = headSz + encSz + footSz;
+    }
+
+    free(enc);
+    return ret;
+}
+
+/* Device: streaming patcher */
+
+static int patch_flush(Patcher* p)
+{
+    if (p->outLen > 0) {
+        if (fwrite(p->outBuf, 1, p->outLen, p->outFile) != p->outLen)
+            return -1;
+        wc_Sha256Update(&p->sha, p->outBuf, p->outLen);
+        p->outLen = 0;
+    }
+    return 0;
+}
+
+static int patch_out(Patcher* p, byte b)
+{
+    if (p->newPos >= p->newSz)
+        return -1;
+    p->outBuf[p->outLen++] = b;
+    p->newPos++;
+    if (p->outLen == p->chunkSz)
+        return patch_flush(p);
+    return 0;
+}
+
+static int patch_old(Patcher* p, byte* b)
+{
+    if (p->oldPos >= p->oldSz)
+        return -1;
+    if (p->oldPos < p->oldBufStart ||
+            p->oldPos >= p->oldBufStart + p->oldBufLen) {
+        if (fseek(p->oldFile, (long)p->oldPos, SEEK_SET) != 0)
+            return -1;
+        p->oldBufStart = p->oldPos;
+        p->oldBufLen = (word32)fread(p->oldBuf, 1, p->chunkSz, p->oldFile);
+        if (p->oldBufLen == 0)
+            return -1;
+    }
+    *b = p->oldBuf[p->oldPos - p->oldBufStart];
+    p->oldPos++;
+
+    return 0;
+}
+
+/* Check the header and that the running image is the expected base */
+static int patch_header(Patcher* p)
+{
+    wc_Sha256 sha;
+    byte hash[WC_SHA256_DIGEST_SIZE];
+    word32 n;
+    word64 total = 0;
+    int ret;
+
+    if (memcmp(p->hdr, DELTA_MAGIC, 4) != 0)
+        return -1;
+    p->oldSz = ((word32)p->hdr[4] << 24) | (p->hdr[5] << 16) |
+               (p->hdr[6] << 8) | p->hdr[7];
+    p->newSz = ((word32)p->hdr[8] << 24) | (p->hdr[9] << 16) |
+               (p->hdr[10] << 8) | p->hdr[11];
+    if (p->oldSz == 0)
+        return 0;
+
+    if (p->oldFile == NULL) {
+        printf("ERROR: delta package needs the base image\n");
+        return -1;
+    }
+    ret = wc_InitSha256(&sha);
+    rewind(p->oldFile);
+    while (ret == 0 &&
+           (n = (word32)fread(p->oldBuf, 1, p->chunkSz, p->oldFile)) > 0) {
+        ret = wc_Sha256Update(&sha, p->oldBuf, n);
+        total += n;
+    }
+    if (ret == 0)
+        ret = wc_Sha256Final(&sha, hash);
+    wc_Sha256Free(&sha);
+    p->oldBufLen = 0;
+
+    if (ret == 0 && (total != p->oldSz ||
+            memcmp(hash, p->hdr + 12, sizeof(hash)) != 0)) {
+        printf("ERROR: running image is not the base of this delta\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/* Parse one varint byte, returns 1 when the value is complete */
+static int patch_varint(Patcher* p, byte b, word64* v)
+{
+    if (p->varintShift > 63)
+        return -1;
+    p->varint |= (word64)(b & 0x7F) << p->varintShift;
+    p->varintShift += 7;
+    if (b & 0x80)
+        return 0;
+
+    *v = p->varint;
+    p->varint = 0;
+    p->varintShift = 0;
+    return 1;
+}
+
+/* Record finished, apply the seek and wait for the next control */
+static int patch_next_record(Patcher* p)
+{
+    word64 z = p->ctrl[2];
+    int64_t seek = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+
+    if ((int64_t)p->oldPos + seek < 0)
+        return -1;
+    p->oldPos = (word64)((int64_t)p->oldPos + seek);
+    p->state = (p->newPos == p->newSz) ? PATCH_DONE : PATCH_CTRL;
+
+    return 0;
+}
+
+static int patch_after_diff(Patcher* p)
+{
+    if (p->diffLeft > 0) {
+        p->state = PATCH_DIFF_ZERO;
+        return 0;
+    }
+    if (p->extraLeft > 0) {
+        p->state = PATCH_EXTRA;
+        return 0;
+    }
+    return patch_next_record(p);
+}
+
+/* Feed decrypted delta bytes into the patcher */
+static int patch_feed(Patcher* p, const byte* in, word32 inSz)
+{
+    int ret = 0, done;
+    word32 i;
+    word64 v = 0, k;
+    byte b;
+
+    for (i = 0; ret == 0 && i < inSz; i++) {
+        switch (p->state) {
+            case PATCH_HEADER:
+                p->hdr[p->hdrLen++] = in[i];
+                if (p->hdrLen == DELTA_HDR_SZ) {
+                    ret = patch_header(p);
+                    p->state = (p->newSz == 0) ? PATCH_DONE : PATCH_CTRL;
+                }
+                break;
+
+            case PATCH_CTRL:
+                done = patch_varint(p, in[i], &v);
+                if (done < 0)
+                    ret = -1;
+                else if (done) {
+                    p->ctrl[p->ctrlIdx++] = v;
+                    if (p->ctrlIdx == 3) {
+                        p->ctrlIdx = 0;
+                        p->diffLeft = p->ctrl[0];
+                        p->extraLeft = p->ctrl[1];
+                        if (p->newPos + p->diffLeft + p->extraLeft > p->newSz)
+                            ret = -1;
+                        else
+                            ret = patch_after_diff(p);
+                    }
+                }
+                break;
+
+            case PATCH_DIFF_ZERO:
+                done = patch_varint(p, in[i], &v);
+                if (done < 0 || (done && v > p->diffLeft))
+                    ret = -1;
+                else if (done) {
+                    /* unchanged bytes, copied from the base image */
+                    for (k = 0; ret == 0 && k < v; k++) {
+                        ret = patch_old(p, &b);
+                        if (ret == 0)
+                            ret = patch_out(p, b);
+                    }
+                    p->diffLeft -= v;
+                    p->state = PATCH_DIFF_LITLEN;
+                }
+                break;
+
+            case PATCH_DIFF_LITLEN:
+                done = patch_varint(p, in[i], &v);
+                if (done < 0 || (done && v > p->diffLeft))
+                    ret = -1;
+                else if (done) {
+                    p->litLeft = v;
+                    p->diffLeft -= v;
+                    if (v > 0)
+                        p->state = PATCH_DIFF_LIT;
+                    else
+                        ret = patch_after_diff(p);
+                }
+                break;
+
+            case PATCH_DIFF_LIT:
+                ret = patch_old(p, &b);
+                if (ret == 0)
+                    ret = patch_out(p, (byte)(b + in[i]));
+                if (ret == 0 && --p->litLeft == 0)
+                    ret = patch_after_diff(p);
+                break;
+
+            case PATCH_EXTRA:
+                ret = patch_out(p, in[i]);
+                if (ret == 0 && --p->extraLeft == 0)
+                    ret = patch_next_record(p);
+                break;
+
+            case PATCH_DONE:
+            default:
+                /* data after the end of the delta */
+                ret = -1;
+                break;
+        }
+    }
+
+    return ret;
+}
+
+static int patch_final(Patcher* p)
+{
+    byte hash[WC_SHA256_DIGEST_SIZE];
+    int ret;
+
+    if (p->state != PATCH_DONE)
+        return -1;
+    ret = patch_flush(p);
+    if (ret == 0)
+        ret = wc_Sha256Final(&p->sha, hash);
+    if (ret == 0 &&
+            memcmp(hash, p->hdr + 12 + WC_SHA256_DIGEST_SIZE, sizeof(hash)))
+        ret = -1;
+
+    return ret;
+}
+
+/* Device: streaming verify and decrypt */
+
+/* Read one TLV header from buf at *idx, checks the tag */
+static int get_header(const byte* buf, word32 bufSz, word32* idx, byte tag,
+                      word32* len)
+{
+    word32 i = *idx, n;
+
+    if (i + 2 > bufSz || buf[i] != tag)
+        return -1;
+    i++;
+    if (buf[i] < 0x80) {
+        *len = buf[i++];
+    }
+    else {
+        n = buf[i++] & 0x7F;
+        if (n == 0 || n > 4 || i + n > bufSz)
+            return -1;
+        *len = 0;
+        while (n-- > 0)
+            *len = (*len << 8) | buf[i++];
+    }
+    *idx = i;
+
+    return 0;
+}
+
+static int skip_tlv(const byte* buf, word32 bufSz, word32* idx, byte tag)
+{
+    word32 len;
+
+    if (get_header(buf, bufSz, idx, tag, &len) != 0 || *idx + len > bufSz)
+        return -1;
+    *idx += len;
+    return 0;
+}
+
+/* Find the encapsulated content of a SignedData bundle */
+static int find_signed_content(const byte* buf, word32 bufSz,
+                               word32* contentOff, word32* contentSz)
+{
+    word32 idx = 0, len;
+
+    if (get_header(buf, bufSz, &idx, 0x30, &len) != 0 ||  /* ContentInfo */
+        skip_tlv(buf, bufSz, &idx, 0x06) != 0 ||
+        get_header(buf, bufSz, &idx, 0xA0, &len) != 0 ||
+        get_header(buf, bufSz, &idx, 0x30, &len) != 0 ||  /* SignedData */
+        skip_tlv(buf, bufSz, &idx, 0x02) != 0 ||           /* version */
+        skip_tlv(buf, bufSz, &idx, 0x31) != 0 ||           /* digestAlgs */
+        get_header(buf, bufSz, &idx, 0x30, &len) != 0 ||  /* encapContent */
+        skip_tlv(buf, bufSz, &idx, 0x06) != 0 ||
+        get_header(buf, bufSz, &idx, 0xA0, &len) != 0)
+        return -1;
+
+    /* content is either an OCTET STRING or the inner ContentInfo itself */
+    if (idx < bufSz && buf[idx] == 0x04) {
+        if (get_header(buf, bufSz, &idx, 0x04, &len) != 0)
+            return -1;
+    }
+    *contentOff = idx;
+    *contentSz = len;
+
+    return 0;
+}
+
+/* Find the IV and ciphertext of an EncryptedData, offsets into buf */
+static int find_encrypted_content(const byte* buf, word32 bufSz,
+                                  word32* ivOff, word32* encOff,
+                                  word32* encSz)
+{
+    word32 idx = 0, len;
+
+    if (get_header(buf, bufSz, &idx, 0x30, &len) != 0 ||  /* ContentInfo */
+        skip_tlv(buf, bufSz, &idx, 0x06) != 0 ||
+        get_header(buf, bufSz, &idx, 0xA0, &len) != 0 ||
+        get_header(buf, bufSz, &idx, 0x30, &len) != 0 ||  /* EncryptedData */
+        skip_tlv(buf, bufSz, &idx, 0x02) != 0 ||           /* version */
+        get_header(buf, bufSz, &idx, 0x30, &len) != 0 ||  /* EncContentInfo */
+        skip_tlv(buf, bufSz, &idx, 0x06) != 0 ||           /* contentType */
+        get_header(buf, bufSz, &idx, 0x30, &len) != 0)    /* algorithm */
+        return -1;
+
+    if (idx + sizeof(aes256CbcOid) > bufSz ||
+            memcmp(buf + idx, aes256CbcOid, sizeof(aes256CbcOid)) != 0) {
+        printf("ERROR: package is not encrypted with AES-256-CBC\n");
+        return -1;
+    }
+    idx += sizeof(aes256CbcOid);
+    if (get_header(buf, bufSz, &idx, 0x04, &len) != 0 ||
+            len != AES_BLOCK_SIZE)
+        return -1;
+    *ivOff = idx;
+    idx += len;
+
+    /* [0] IMPLICIT encryptedContent */
+    if (get_header(buf, bufSz, &idx, 0x80, &len) != 0)
+        return -1;
+    *encOff = idx;
+    *encSz = len;
+
+    return 0;
+}
+
+/* Check the base version dependency, if the package has one */
+static int check_base_version(PKCS7* pkcs7, const char* runningVersion)
+{
+    int ret;
+    byte value[64];
+    word32 valueSz = sizeof(value);
+    word32 idx = 0, len;
+
+    ret = wc_PKCS7_GetAttributeValue(pkcs7, fwPkgInfoOid + 2,
+                                     sizeof(fwPkgInfoOid) - 2, value,
+                                     &valueSz);
+    if (ret <= 0) {
+        printf("\tFull image package, no base version\n");
+        return 0;
+    }
+
+    if (get_header(value, ret, &idx, 0x30, &len) != 0 ||
+            get_header(value, ret, &idx, 0x30, &len) != 0 ||
+            get_header(value, ret, &idx, 0x04, &len) != 0 ||
+            idx + len > (word32)ret)
+        return -1;
+
+    printf("\tDelta package for base version %.*s\n", (int)len, value + idx);
+    if (len != strlen(runningVersion) ||
+            memcmp(value + idx, runningVersion, len) != 0) {
+        printf("ERROR: running version %s does not match\n", runningVersion);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Verify, decrypt and apply a package. Only fixed size buffers are used:
+ * the bundle header and footer, and chunk buffers for ciphertext,
+ * plaintext, base image reads and output writes. */
+static int device_apply(const char* packageFile, const char* baseFile,
+                        const char* outFile, const char* runningVersion,
+                        word32 chunkSz, ApplyStats* stats)
+{
+    int ret = 0;
+    FILE* pkg;
+    PKCS7* pkcs7 = NULL;
+    Aes aes;
+    Patcher patch;
+    wc_Sha256 sha;
+    byte head[HEAD_MAX_SZ];
+    byte foot[FOOT_MAX_SZ];
+    byte inner[INNER_HDR_MAX_SZ];
+    byte hash[WC_SHA256_DIGEST_SIZE];
+    byte iv[AES_BLOCK_SIZE];
+    byte* encBuf;
+    byte* decBuf;
+    word32 headSz, footSz, innerSz, contentOff, contentSz;
+    word32 ivOff, encOff, encSz, n, left, pad;
+    long pkgSz;
+    double start = current_time();
+
+    memset(&patch, 0, sizeof(patch));
+    encBuf = (byte*)malloc(chunkSz);
+    decBuf = (byte*)malloc(chunkSz);
+    patch.oldBuf = (byte*)malloc(chunkSz);
+    patch.outBuf = (byte*)malloc(chunkSz);
+    patch.chunkSz = chunkSz;
+    stats->ramSz = 4 * chunkSz + sizeof(head) + sizeof(foot) +
+                   sizeof(inner) + sizeof(patch) + sizeof(aes);
+
+    pkg = fopen(packageFile, "rb");
+    if (pkg == NULL || encBuf == NULL || decBuf == NULL ||
+            patch.oldBuf == NULL || patch.outBuf == NULL) {
+        printf("ERROR: unable to open %s\n", packageFile);
+        ret = -1;
+        goto exit;
+    }
+    fseek(pkg, 0, SEEK_END);
+    pkgSz = ftell(pkg);
+    rewind(pkg);
+
+    /* 1. locate the content and hash it while reading */
+    n = (word32)fread(head, 1, sizeof(head), pkg);
+    if (find_signed_content(head, n, &contentOff, &contentSz) != 0 ||
+            (long)contentOff + contentSz > pkgSz ||
+            pkgSz - contentOff - contentSz > (long)sizeof(foot)) {
+        printf("ERROR: not a SignedData package\n");
+        ret = -1;
+        goto exit;
+    }
+    headSz = contentOff;
+    footSz = (word32)(pkgSz - contentOff - contentSz);
+
+    ret = wc_InitSha256(&sha);
+    fseek(pkg, contentOff, SEEK_SET);
+    for (left = contentSz; ret == 0 && left > 0; left -= n) {
+        n = (left < chunkSz) ? left : chunkSz;
+        if (fread(encBuf, 1, n, pkg) != n)
+            ret = -1;
+        else
+            ret = wc_Sha256Update(&sha, encBuf, n);
+    }
+    if (ret == 0)
+        ret = wc_Sha256Final(&sha, hash);
+    wc_Sha256Free(&sha);
+    if (ret == 0 && fread(foot, 1, footSz, pkg) != footSz)
+        ret = -1;
+    if (ret != 0)
+        goto exit;
+
+    /* 2. verify the signature over the content hash */
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL) {
+        ret = MEMORY_E;
+        goto exit;
+    }
+    ret = wc_PKCS7_VerifySignedData_ex(pkcs7, hash, sizeof(hash),
+                                       head, headSz, foot, footSz);
+    if (ret != 0) {
+        printf("ERROR: wc_PKCS7_VerifySignedData_ex() failed, ret = %d\n",
+               ret);
+        goto exit;
+    }
+    printf("\tSignature verified\n");
+
+    ret = check_base_version(pkcs7, runningVersion);
+    if (ret != 0)
+        goto exit;
+
+    /* 3. locate the ciphertext in the EncryptedData */
+    fseek(pkg, contentOff, SEEK_SET);
+    innerSz = (word32)fread(inner, 1,
+                    contentSz < sizeof(inner) ? contentSz : sizeof(inner), pkg);
+    ret = find_encrypted_content(inner, innerSz, &ivOff, &encOff, &encSz);
+    if (ret != 0 || encSz == 0 || encSz % AES_BLOCK_SIZE != 0 ||
+            encOff + encSz > contentSz) {
+        printf("ERROR: unable to parse EncryptedData\n");
+        ret = -1;
+        goto exit;
+    }
+    memcpy(iv, inner + ivOff, AES_BLOCK_SIZE);
+
+    /* 4. decrypt and patch chunk by chunk */
+    if (baseFile != NULL)
+        patch.oldFile = fopen(baseFile, "rb");
+    patch.outFile = fopen(outFile, "wb");
+    if (patch.outFile == NULL) {
+        ret = -1;
+        goto exit;
+    }
+    patch.state = PATCH_HEADER;
+    ret = wc_InitSha256(&patch.sha);
+
+    if (ret == 0)
+        ret = wc_AesInit(&aes, NULL, INVALID_DEVID);
+    if (ret == 0)
+        ret = wc_AesSetKey(&aes, aes256Key, sizeof(aes256Key), iv,
+                           AES_DECRYPTION);
+    fseek(pkg, contentOff + encOff, SEEK_SET);
+    for (left = encSz; ret == 0 && left > 0; left -= n) {
+        n = (left < chunkSz) ? left : chunkSz;
+        if (fread(encBuf, 1, n, pkg) != n) {
+            ret = -1;
+            break;
+        }
+        /* the CBC chaining value is kept in aes between calls */
+        ret = wc_AesCbcDecrypt(&aes, decBuf, encBuf, n);
+        pad = 0;
+        if (ret == 0 && left == n) {
+            /* last chunk, remove the padding */
+            pad = decBuf[n - 1];
+            if (pad == 0 || pad > AES_BLOCK_SIZE)
+                ret = -1;
+        }
+        if (ret == 0)
+            ret = patch_feed(&patch, decBuf, n - pad);
+    }
+    wc_AesFree(&aes);
+
+    if (ret == 0)
+        ret = patch_final(&patch);
+    if (ret != 0)
+        printf("ERROR: failed to apply firmware package\n");
+    wc_Sha256Free(&patch.sha);
+
+exit:
+    stats->seconds = current_time() - start;
+
+    wc_PKCS7_Free(pkcs7);
+    if (patch.outFile != NULL)
+        fclose(patch.outFile);
+    if (patch.oldFile != NULL)
+        fclose(patch.oldFile);
+    if (pkg != NULL)
+        fclose(pkg);
+    free(patch.outBuf);
+    free(patch.oldBuf);
+    free(decBuf);
+    free(encBuf);
+
+    return ret;
+}
+
+static int files_equal(const char* a, const char* b)
+{
+    word32 aSz, bSz;
+    byte* aBuf = read_file(a, &aSz);
+    byte* bBuf = read_file(b, &bSz);
+    int ret = (aBuf != NULL && bBuf != NULL && aSz == bSz &&
+               memcmp(aBuf, bBuf, aSz) == 0);
+
+    free(aBuf);
+    free(bBuf);
+    return ret;
+}
+
+static void Usage(void)
+{
+    printf("signedData-FirmwareDelta [options]\n");
+    printf("-b <file>   Base (running) firmware image\n");
+    printf("-n <file>   New firmware image\n");
+    printf("-v <ver>    Base firmware version, default %s\n",
+           DEF_BASE_VERSION);
+    printf("-c <bytes>  Device chunk size, multiple of 16, default %d\n",
+           DEF_CHUNK_SZ);
+}
+
+int main(int argc, char** argv)
+{
+    int ret, ch;
+    const char* baseFile = NULL;
+    const char* newFile = NULL;
+    const char* baseVersion = DEF_BASE_VERSION;
+    word32 chunkSz = DEF_CHUNK_SZ;
+    byte cert[2048];
+    byte key[2048];
+    word32 certSz = sizeof(cert), keySz = sizeof(key);
+    byte* baseImg = NULL;
+    byte* newImg = NULL;
+    word32 baseSz = 0, newSz = 0, deltaPkgSz = 0, fullPkgSz = 0;
+    Buffer delta, full;
+    ApplyStats deltaStats, fullStats;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?b:n:v:c:")) != -1) {
+        switch (ch) {
+            case 'b':
+                baseFile = optarg;
+                break;
+            case 'n':
+                newFile = optarg;
+                break;
+            case 'v':
+                baseVersion = optarg;
+                break;
+            case 'c':
+                chunkSz = (word32)atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (chunkSz == 0 || chunkSz % AES_BLOCK_SIZE != 0 ||
+            (baseFile == NULL) != (newFile == NULL)) {
+        Usage();
+        return -1;
+    }
+
+    if (load_certs(cert, &certSz, key, &keySz) != 0)
+        return -1;
+
+    /* images, generated unless given */
+    if (baseFile != NULL) {
+        baseImg = read_file(baseFile, &baseSz);
+        newImg = read_file(newFile, &newSz);
+    }
+    else {
+        baseSz = DEF_IMAGE_SZ;
+        baseImg = (byte*)malloc(baseSz);
+        if (baseImg != NULL) {
+            gen_base_image(baseImg, baseSz);
+            newImg = gen_new_image(baseImg, baseSz, &newSz);
+        }
+        baseFile = baseImageFile;
+        if (newImg != NULL &&
+                (write_file_buffer(baseImageFile, baseImg, baseSz) != 0 ||
+                 write_file_buffer(newImageFile, newImg, newSz) != 0)) {
+            free(newImg);
+            newImg = NULL;
+        }
+        newFile = newImageFile;
+    }
+    if (baseImg == NULL || newImg == NULL) {
+        free(baseImg);
+        free(newImg);
+        return -1;
+    }
+
+    /* host: payloads and packages */
+    memset(&delta, 0, sizeof(delta));
+    memset(&full, 0, sizeof(full));
+    ret = delta_create(baseImg, baseSz, newImg, newSz, &delta);
+    if (ret == 0)
+        ret = delta_create(NULL, 0, newImg, newSz, &full);
+    if (ret == 0)
+        ret = create_package(deltaPackageFile, delta.buf, delta.len,
+                             baseVersion, cert, certSz, key, keySz,
+                             &deltaPkgSz);
+    if (ret == 0)
+        ret = create_package(fullPackageFile, full.buf, full.len, NULL,
+                             cert, certSz, key, keySz, &fullPkgSz);
+    free(baseImg);
+    free(newImg);
+    if (ret != 0) {
+        printf("Failed to create firmware packages\n");
+        free(delta.buf);
+        free(full.buf);
+        return -1;
+    }
+    printf("Successfully created firmware packages (%s, %s)\n",
+           deltaPackageFile, fullPackageFile);
+
+    /* device: apply both */
+    printf("\nApplying %s\n", fullPackageFile);
+    ret = device_apply(fullPackageFile, NULL, patchedImageFile, baseVersion,
+                       chunkSz, &fullStats);
+    if (ret == 0 && !files_equal(patchedImageFile, newFile))
+        ret = -1;
+    if (ret == 0) {
+        printf("\nApplying %s\n", deltaPackageFile);
+        ret = device_apply(deltaPackageFile, baseFile, patchedImageFile,
+                           baseVersion, chunkSz, &deltaStats);
+    }
+    if (ret == 0 && !files_equal(patchedImageFile, newFile))
+        ret = -1;
+    if (ret != 0) {
+        printf("Failed to apply firmware packages\n");
+        free(delta.buf);
+        free(full.buf);
+        return -1;
+    }
+    printf("Successfully applied packages, image matches %s\n", newFile);
+
+    printf("\nbase image %u bytes, new image %u bytes\n", baseSz, newSz);
+    printf("%-12s %12s %12s %12s\n", "package", "payload", "package",
+           "apply ms");
+    printf("%-12s %12u %12u %12.1f\n", "full image", full.len, fullPkgSz,
+           fullStats.seconds * 1000);
+    printf("%-12s %12u %12u %12.1f\n", "delta", delta.len, deltaPkgSz,
+           deltaStats.seconds * 1000);
+    printf("delta package is %.1f%% of the full package\n",
+           100.0 * deltaPkgSz / fullPkgSz);
+    printf("device working buffers: %u bytes (chunk %u)\n",
+           deltaStats.ramSz, chunkSz);
+
+    free(delta.buf);
+    free(full.buf);
+
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,564 @@
+/* signedData-cryptodev-pipeline.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * This file includes an example of pipelined PKCS#7/CMS SignedData signing
+ * through the wolfCrypt crypto callback (CryptoDev) interface, for signing
+ * devices such as HSMs that have a high per-operation latency but can run
+ * many operations in parallel.
+ *
+ * The crypto callback does not perform the RSA or ECDSA signature itself.
+ * It submits a job to a simulated HSM (a pool of worker threads that adds a
+ * configurable latency to each operation) and waits for the completion.
+ * Because wc_PKCS7_EncodeSignedData() can not resume an encoding after
+ * the callback returns WC_PENDING_E, each in-flight encoding runs on its
+ * own submitter thread and the callback blocks that thread only. The
+ * in-flight depth is the number of encodings waiting on the HSM at once.
+ *
+ * This is not a non-blocking offload: every in-flight operation holds a
+ * thread that sleeps until the HSM completes it. A non-blocking design
+ * would return WC_PENDING_E from the callback and poll for the result, which
+ * needs a wolfCrypt encoder that can resume, such as the WOLFSSL_ASYNC_CRYPT
+ * support in TLS.
+ *
+ * The example reports signatures/s as the in-flight depth goes from 1 to
+ * the maximum depth (default 64).
+ *
+ * This is only provided as an example and may need modification if integrated
+ * into a production application.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+#ifdef WOLF_CRYPTO_CB
+    #include <wolfssl/wolfcrypt/cryptocb.h>
+#endif
+
+#define rsaCertFile "../certs/client-cert.der"
+#define rsaKeyFile  "../certs/client-key.der"
+#define eccCertFile "../certs/client-ecc-cert.der"
+#define eccKeyFile  "../certs/ecc-client-key.der"
+
+#define DEF_MAX_DEPTH    64     /* largest in-flight depth tested */
+#define DEF_HSM_UNITS    64     /* parallel operations the HSM can run */
+#define DEF_HSM_LATENCY  20     /* HSM latency per operation, ms */
+#define DEF_SIGS         256    /* signatures per depth */
+#define MAX_THREADS      256
+
+#if defined(HAVE_PKCS7) && defined(WOLF_CRYPTO_CB)
+
+/* one signing operation handed to the simulated HSM */
+typedef struct HsmJob {
+    wc_CryptoInfo*  info;
+    int             devId;
+    int             ret;
+    int             done;
+    struct HsmJob*  next;
+} HsmJob;
+
+/* simulated HSM: a job queue served by a pool of worker threads */
+typedef struct Hsm {
+    pthread_mutex_t lock;
+    pthread_cond_t  jobReady;    /* signaled when a job is queued */
+    pthread_cond_t  jobDone;     /* broadcast when a job completes */
+    HsmJob*         head;
+    HsmJob*         tail;
+    int             stop;
+    int             latencyMs;
+    int             numUnits;
+    pthread_t       unit[MAX_THREADS];
+} Hsm;
+
+/* per-depth signing run, shared by the submitter threads */
+typedef struct SignRun {
+    pthread_mutex_t lock;
+    int             remaining;   /* signatures left to start */
+    int             failed;
+    int             devId;
+    int             keyOID;
+    byte*           cert;
+    word32          certSz;
+    byte*           key;
+    word32          keySz;
+    byte*           lastOut;     /* last bundle, verified at the end */
+    int             lastOutSz;
+} SignRun;
+
+static byte content[] = "Hello World, signed by the HSM";
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static void sleep_until(double t)
+{
+    struct timespec ts;
+    double now = current_time();
+
+    if (t <= now)
+        return;
+    t -= now;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1000000000.0);
+    nanosleep(&ts, NULL);
+}
+
+static int load_file(const char* fileName, byte* buf, word32* bufSz)
+{
+    FILE* file;
+
+    file = fopen(fileName, "rb");
+    if (!file) {
+        printf("ERROR: failed to open %s\n", fileName);
+        return -1;
+    }
+
+    *bufSz = (word32)fread(buf, 1, *bufSz, file);
+    fclose(file);
+
+    return 0;
+}
+
+/* Run one signature in software, as the HSM would in hardware */
+static int hsm_do_sign(wc_CryptoInfo* info, int devIdArg)
+{
+    int ret = CRYPTOCB_UNAVAILABLE;
+
+#ifndef NO_RSA
+    if (info->pk.type == WC_PK_TYPE_RSA) {
+        /* set devId to invalid, so software is used */
+        info->pk.rsa.key->devId = INVALID_DEVID;
+
+        ret = wc_RsaFunction(
+            info->pk.rsa.in, info->pk.rsa.inLen,
+            info->pk.rsa.out, info->pk.rsa.outLen,
+            info->pk.rsa.type, info->pk.rsa.key, info->pk.rsa.rng);
+
+        /* reset devId */
+        info->pk.rsa.key->devId = devIdArg;
+    }
+#endif
+#ifdef HAVE_ECC
+    if (info->pk.type == WC_PK_TYPE_ECDSA_SIGN) {
+        /* set devId to invalid, so software is used */
+        info->pk.eccsign.key->devId = INVALID_DEVID;
+
+        ret = wc_ecc_sign_hash(
+            info->pk.eccsign.in, info->pk.eccsign.inlen,
+            info->pk.eccsign.out, info->pk.eccsign.outlen,
+            info->pk.eccsign.rng, info->pk.eccsign.key);
+
+        /* reset devId */
+        info->pk.eccsign.key->devId = devIdArg;
+    }
+#endif
+
+    return ret;
+}
+
+static void* hsm_unit(void* arg)
+{
+    Hsm* hsm = (Hsm*)arg;
+    HsmJob* job;
+    double start;
+
+    for (;;) {
+        pthread_mutex_lock(&hsm->lock);
+        while (hsm->head == NULL && !hsm->stop)
+            pthread_cond_wait(&hsm->jobReady, &hsm->lock);
+        if (hsm->head == NULL) {
+            pthread_mutex_unlock(&hsm->lock);
+            break;
+        }
+        job = hsm->head;
+        hsm->head = job->next;
+        if (hsm->head == NULL)
+            hsm->tail = NULL;
+        pthread_mutex_unlock(&hsm->lock);
+
+        start = current_time();
+        job->ret = hsm_do_sign(job->info, job->devId);
+        /* the operation takes at least the HSM latency */
+        sleep_until(start + hsm->latencyMs / 1000.0);
+
+        pthread_mutex_lock(&hsm->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&hsm->jobDone);
+        pthread_mutex_unlock(&hsm->lock);
+    }
+
+    return NULL;
+}
+
+static int hsm_start(Hsm* hsm, int numUnits, int latencyMs)
+{
+    int i;
+
+    memset(hsm, 0, sizeof(*hsm));
+    pthread_mutex_init(&hsm->lock, NULL);
+    pthread_cond_init(&hsm->jobReady, NULL);
+    pthread_cond_init(&hsm->jobDone, NULL);
+    hsm->latencyMs = latencyMs;
+
+    for (i = 0; i < numUnits; i++) {
+        if (pthread_create(&hsm->unit[i], NULL, hsm_unit, hsm) != 0)
+            return -1;
+        hsm->numUnits++;
+    }
+
+    return 0;
+}
+
+static void hsm_stop(Hsm* hsm)
+{
+    int i;
+
+    pthread_mutex_lock(&hsm->lock);
+    hsm->stop = 1;
+    pthread_cond_broadcast(&hsm->jobReady);
+    pthread_mutex_unlock(&hsm->lock);
+
+    for (i = 0; i < hsm->numUnits; i++)
+        pthread_join(hsm->unit[i], NULL);
+
+    pthread_cond_destroy(&hsm->jobDone);
+    pthread_cond_destroy(&hsm->jobReady);
+    pthread_mutex_destroy(&hsm->lock);
+}
+
+/* Private key operations offloaded to the HSM */
+static int hsm_supported(wc_CryptoInfo* info)
+{
+    if (info->algo_type != WC_ALGO_TYPE_PK)
+        return 0;
+#ifndef NO_RSA
+    if (info->pk.type == WC_PK_TYPE_RSA) {
+        return info->pk.rsa.type == RSA_PRIVATE_ENCRYPT ||
+               info->pk.rsa.type == RSA_PRIVATE_DECRYPT;
+    }
+#endif
+#ifdef HAVE_ECC
+    if (info->pk.type == WC_PK_TYPE_ECDSA_SIGN)
+        return 1;
+#endif
+
+    return 0;
+}
+
+/* Crypto callback: queue private key operations on the HSM and wait for
+ * the completion. Everything else is done in software. */
+static int hsmCryptoDevCb(int devIdArg, wc_CryptoInfo* info, void* ctx)
+{
+    Hsm* hsm = (Hsm*)ctx;
+    HsmJob job;
+
+    if (info == NULL || hsm == NULL)
+        return BAD_FUNC_ARG;
+
+    if (!hsm_supported(info))
+        return CRYPTOCB_UNAVAILABLE;
+
+    memset(&job, 0, sizeof(job));
+    job.info = info;
+    job.devId = devIdArg;
+
+    /* submit, the operation is now pending on the HSM */
+    pthread_mutex_lock(&hsm->lock);
+    if (hsm->tail != NULL)
+        hsm->tail->next = &job;
+    else
+        hsm->head = &job;
+    hsm->tail = &job;
+    pthread_cond_signal(&hsm->jobReady);
+
+    /* wait for completion, only this encoding is blocked */
+    while (!job.done)
+        pthread_cond_wait(&hsm->jobDone, &hsm->lock);
+    pthread_mutex_unlock(&hsm->lock);
+
+    return job.ret;
+}
+
+/* Submitter thread: one in-flight SignedData encoding at a time */
+static void* sign_thread(void* arg)
+{
+    SignRun* run = (SignRun*)arg;
+    PKCS7* pkcs7;
+    WC_RNG rng;
+    byte out[4096];
+    int ret;
+
+    if (wc_InitRng(&rng) != 0) {
+        pthread_mutex_lock(&run->lock);
+        run->failed++;
+        pthread_mutex_unlock(&run->lock);
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&run->lock);
+        if (run->remaining == 0 || run->failed) {
+            pthread_mutex_unlock(&run->lock);
+            break;
+        }
+        run->remaining--;
+        pthread_mutex_unlock(&run->lock);
+
+        ret = -1;
+        pkcs7 = wc_PKCS7_New(NULL, run->devId);
+        if (pkcs7 != NULL &&
+                wc_PKCS7_InitWithCert(pkcs7, run->cert, run->certSz) == 0) {
+            pkcs7->rng          = &rng;
+            pkcs7->content      = content;
+            pkcs7->contentSz    = sizeof(content);
+            pkcs7->contentOID   = DATA;
+            pkcs7->hashOID      = SHA256h;
+            pkcs7->encryptOID   = run->keyOID;
+            pkcs7->privateKey   = run->key;
+            pkcs7->privateKeySz = run->keySz;
+
+            ret = wc_PKCS7_EncodeSignedData(pkcs7, out, sizeof(out));
+        }
+        wc_PKCS7_Free(pkcs7);
+
+        pthread_mutex_lock(&run->lock);
+        if (ret <= 0) {
+            printf("ERROR: wc_PKCS7_EncodeSignedData() failed, ret = %d\n",
+                   ret);
+            run->failed++;
+        }
+        else {
+            memcpy(run->lastOut, out, ret);
+            run->lastOutSz = ret;
+        }
+        pthread_mutex_unlock(&run->lock);
+    }
+
+    wc_FreeRng(&rng);
+    return NULL;
+}
+
+static int signedData_verify(byte* in, word32 inSz)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return -1;
+
+    ret = wc_PKCS7_VerifySignedData(pkcs7, in, inSz);
+    if (ret < 0 || pkcs7->contentSz != sizeof(content) ||
+            memcmp(pkcs7->content, content, sizeof(content)) != 0) {
+        printf("ERROR: Failed to verify SignedData bundle, ret = %d\n", ret);
+        ret = -1;
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+/* Sign numSigs bundles with depth encodings in flight, returns sigs/s */
+static double run_depth(SignRun* run, int depth, int numSigs)
+{
+    pthread_t tid[MAX_THREADS];
+    double start, elapsed;
+    int i, created = 0;
+
+    run->remaining = numSigs;
+    run->failed = 0;
+
+    start = current_time();
+    for (i = 0; i < depth; i++) {
+        if (pthread_create(&tid[i], NULL, sign_thread, run) != 0)
+            break;
+        created++;
+    }
+    for (i = 0; i < created; i++)
+        pthread_join(tid[i], NULL);
+    elapsed = current_time() - start;
+
+    if (created != depth || run->failed ||
+            signedData_verify(run->lastOut, run->lastOutSz) < 0)
+        return -1;
+
+    return numSigs / elapsed;
+}
+
+static void Usage(void)
+{
+    printf("signedData-cryptodev-pipeline [options]\n");
+    printf("-e          Sign with ECDSA P-256 instead of RSA-2048\n");
+    printf("-d <num>    Maximum in-flight depth, default %d\n",
+           DEF_MAX_DEPTH);
+    printf("-u <num>    HSM parallel units, default %d\n", DEF_HSM_UNITS);
+    printf("-l <ms>     HSM latency per operation, default %d\n",
+           DEF_HSM_LATENCY);
+    printf("-n <num>    Signatures per depth, default %d\n", DEF_SIGS);
+}
+
+int main(int argc, char** argv)
+{
+    int ret, ch, depth;
+    int devId = 1;
+    int useEcc = 0;
+    int maxDepth = DEF_MAX_DEPTH;
+    int numUnits = DEF_HSM_UNITS;
+    int latencyMs = DEF_HSM_LATENCY;
+    int numSigs = DEF_SIGS;
+    double rate, base = 0;
+    byte cert[2048];
+    byte key[2048];
+    byte lastOut[4096];
+    word32 certSz = sizeof(cert);
+    word32 keySz = sizeof(key);
+    SignRun run;
+    Hsm hsm;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?ed:u:l:n:")) != -1) {
+        switch (ch) {
+            case 'e':
+                useEcc = 1;
+                break;
+            case 'd':
+                maxDepth = atoi(optarg);
+                break;
+            case 'u':
+                numUnits = atoi(optarg);
+                break;
+            case 'l':
+                latencyMs = atoi(optarg);
+                break;
+            case 'n':
+                numSigs = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (maxDepth <= 0 || maxDepth > MAX_THREADS || numUnits <= 0 ||
+            numUnits > MAX_THREADS || latencyMs < 0 || numSigs <= 0) {
+        Usage();
+        return -1;
+    }
+#ifndef HAVE_ECC
+    if (useEcc) {
+        printf("ECDSA requires wolfSSL built with ECC support\n");
+        return -1;
+    }
+#endif
+
+    ret = wolfCrypt_Init();
+    if (ret != 0) {
+        printf("wolfCrypt initialization failed\n");
+        return -1;
+    }
+
+    if (load_file(useEcc ? eccCertFile : rsaCertFile, cert, &certSz) != 0 ||
+            load_file(useEcc ? eccKeyFile : rsaKeyFile, key, &keySz) != 0)
+        return -1;
+
+    if (hsm_start(&hsm, numUnits, latencyMs) != 0) {
+        printf("Failed to start HSM worker pool\n");
+        hsm_stop(&hsm);
+        return -1;
+    }
+
+    /* setting devId to something other than INVALID_DEVID, enables
+       cryptodev callback to be used internally by wolfCrypt */
+    ret = wc_CryptoDev_RegisterDevice(devId, hsmCryptoDevCb, &hsm);
+    if (ret != 0) {
+        printf("Failed to register crypto dev device, ret = %d\n", ret);
+        hsm_stop(&hsm);
+        return -1;
+    }
+
+    memset(&run, 0, sizeof(run));
+    pthread_mutex_init(&run.lock, NULL);
+    run.devId   = devId;
+    run.keyOID  = useEcc ? ECDSAk : RSAk;
+    run.cert    = cert;
+    run.certSz  = certSz;
+    run.key     = key;
+    run.keySz   = keySz;
+    run.lastOut = lastOut;
+
+    printf("%s SignedData, HSM: %d units, %d ms latency, %d sigs per "
+           "depth\n\n", useEcc ? "ECDSA P-256" : "RSA-2048", numUnits,
+           latencyMs, numSigs);
+    printf("%8s %12s %10s\n", "depth", "sigs/s", "speedup");
+
+    for (depth = 1; ret == 0; depth *= 2) {
+        if (depth > maxDepth)
+            depth = maxDepth;
+
+        rate = run_depth(&run, depth, numSigs);
+        if (rate < 0) {
+            printf("ERROR: signing failed at depth %d\n", depth);
+            ret = -1;
+            break;
+        }
+        if (base == 0)
+            base = rate;
+        printf("%8d %12.1f %9.2fx\n", depth, rate, rate / base);
+
+        if (depth == maxDepth)
+            break;
+    }
+
+    if (ret == 0)
+        printf("\nSuccessfully verified SignedData bundle.\n");
+
+    pthread_mutex_destroy(&run.lock);
+    hsm_stop(&hsm);
+    wolfCrypt_Cleanup();
+
+    return ret;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7 --enable-cryptocb\n");
+    return 0;
+}
+
+#endif /* HAVE_PKCS7 & WOLF_CRYPTO_CB */
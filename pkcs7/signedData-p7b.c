@@ -25,12 +25,33 @@
  * converting each certificate to PEM format (from DER), and printing
  * it to the terminal for info/reference.
  *
+ * It also includes tools for large trust stores:
+ *
+ * - A bundle builder that reads certificates (DER, PEM files holding any
+ *   number of certificates, or other .p7b bundles), sorts them in DER
+ *   SET OF order, drops duplicates and writes a degenerate SignedData.
+ * - A loader that walks the certificates of a .p7b once and hands each
+ *   certificate to wolfSSL_CertManagerLoadCABuffer() directly from the
+ *   bundle buffer, without copying or re-encoding it. wc_PKCS7 decoding
+ *   keeps at most MAX_PKCS7_CERTS certificates, so it is not used here.
+ * - A benchmark of trust store load time against bundle size, compared
+ *   with loading the same certificates from a PEM bundle.
+ *
  * This is only provided as an example and may need modification if integrated
  * into a production application.
  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
 #include <wolfssl/wolfcrypt/pkcs7.h>
 #include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
 
 /* Sample certificate .p7b file, to be converted to DER/PEM */
 #define p7bFile  "../certs/test-degenerate.p7b"
@@ -39,38 +60,426 @@
  * for your expected PEM certificate sizes */
 #define MAX_PEM_CERT_SIZE 4096
 
-#if defined(HAVE_PKCS7) && defined(WOLFSSL_DER_TO_PEM)
+/* Largest bundle used by the benchmark */
+#define DEF_BENCH_CERTS   5000
 
-int main(int argc, char** argv)
+#if defined(HAVE_PKCS7) && !defined(WOLFCRYPT_ONLY) && !defined(NO_CERTS)
+
+/* OIDs with tag and length */
+static const byte oidSignedData[] = {
+    0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02
+};
+static const byte oidData[] = {
+    0x06, 0x09, 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x01
+};
+
+typedef struct CertEntry {
+    byte*  der;
+    word32 derSz;
+} CertEntry;
+
+typedef struct CertList {
+    CertEntry* certs;
+    int        count;
+    int        cap;
+} CertList;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int read_file(const char* fileName, byte** buf, word32* bufSz)
+{
+    FILE* file;
+    long sz;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL) {
+        printf("Error opening %s\n", fileName);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    sz = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (sz <= 0) {
+        fclose(file);
+        return -1;
+    }
+
+    *buf = (byte*)XMALLOC(sz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (*buf == NULL) {
+        fclose(file);
+        return MEMORY_E;
+    }
+    *bufSz = (word32)fread(*buf, 1, sz, file);
+    fclose(file);
+
+    return 0;
+}
+
+static int write_file(const char* fileName, const byte* buf, word32 bufSz)
+{
+    FILE* file;
+    int ret = 0;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) {
+        printf("Error opening %s for writing\n", fileName);
+        return -1;
+    }
+    if (fwrite(buf, 1, bufSz, file) != bufSz)
+        ret = -1;
+    fclose(file);
+
+    return ret;
+}
+
+static word32 set_header(byte tag, word32 len, byte* out)
+{
+    word32 i = 0, n = 0;
+    word32 t;
+
+    out[i++] = tag;
+    if (len < 0x80) {
+        out[i++] = (byte)len;
+        return i;
+    }
+    for (t = len; t > 0; t >>= 8)
+        n++;
+    out[i++] = (byte)(0x80 | n);
+    while (n-- > 0)
+        out[i++] = (byte)(len >> (8 * n));
+
+    return i;
+}
+
+static word32 header_size(word32 len)
+{
+    byte tmp[8];
+    return set_header(0, len, tmp);
+}
+
+/* read a DER tag and definite length at *idx, leaves *idx at the value */
+static int get_header(const byte* in, word32* idx, word32 inSz, byte tag,
+                      word32* len)
+{
+    word32 i = *idx, n, l = 0;
+
+    if (i + 2 > inSz || in[i] != tag)
+        return ASN_PARSE_E;
+    i++;
+    if (in[i] < 0x80) {
+        l = in[i++];
+    }
+    else {
+        n = in[i++] & 0x7F;
+        if (n == 0 || n > 4 || i + n > inSz)
+            return ASN_PARSE_E;    /* indefinite length or too long */
+        while (n-- > 0)
+            l = (l << 8) | in[i++];
+    }
+    if (l > inSz - i)
+        return ASN_PARSE_E;
+
+    *idx = i;
+    *len = l;
+    return 0;
+}
+
+static int cert_list_add(CertList* list, const byte* der, word32 derSz)
+{
+    CertEntry* n;
+
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 64;
+        n = (CertEntry*)realloc(list->certs, list->cap * sizeof(CertEntry));
+        if (n == NULL)
+            return MEMORY_E;
+        list->certs = n;
+    }
+    n = &list->certs[list->count];
+    n->der = (byte*)XMALLOC(derSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (n->der == NULL)
+        return MEMORY_E;
+    XMEMCPY(n->der, der, derSz);
+    n->derSz = derSz;
+    list->count++;
+
+    return 0;
+}
+
+static void cert_list_free(CertList* list)
+{
+    int i;
+
+    for (i = 0; i < list->count; i++)
+        XFREE(list->certs[i].der, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    free(list->certs);
+    XMEMSET(list, 0, sizeof(*list));
+}
+
+/* DER SET OF order: compare the encodings as octet strings */
+static int cert_cmp(const void* a, const void* b)
+{
+    const CertEntry* x = (const CertEntry*)a;
+    const CertEntry* y = (const CertEntry*)b;
+    word32 n = x->derSz < y->derSz ? x->derSz : y->derSz;
+    int c = XMEMCMP(x->der, y->der, n);
+
+    if (c != 0)
+        return c;
+    return (x->derSz > y->derSz) - (x->derSz < y->derSz);
+}
+
+/* sort the list and drop duplicate certificates, returns number dropped */
+static int cert_list_sort(CertList* list)
+{
+    int i, out = 0;
+
+    if (list->count == 0)
+        return 0;
+    qsort(list->certs, list->count, sizeof(CertEntry), cert_cmp);
+    for (i = 1; i < list->count; i++) {
+        if (cert_cmp(&list->certs[out], &list->certs[i]) == 0)
+            XFREE(list->certs[i].der, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        else
+            list->certs[++out] = list->certs[i];
+    }
+    i = list->count - (out + 1);
+    list->count = out + 1;
+
+    return i;
+}
+
+/* encode the certificates as a degenerate SignedData, caller frees out */
+static int build_p7b(const CertList* list, byte** out, word32* outSz)
+{
+    int i;
+    word32 certsSz = 0, sdSz, explSz, ciSz, idx = 0;
+    byte* p;
+
+    for (i = 0; i < list->count; i++)
+        certsSz += list->certs[i].derSz;
+
+    /* version, empty digestAlgorithms, encapContentInfo (no content),
+     * certificates, empty signerInfos */
+    sdSz    = 3 + 2 + (2 + sizeof(oidData)) + header_size(certsSz) + certsSz
+              + 2;
+    explSz  = header_size(sdSz) + sdSz;
+    ciSz    = sizeof(oidSignedData) + header_size(explSz) + explSz;
+    *outSz  = header_size(ciSz) + ciSz;
+
+    p = (byte*)XMALLOC(*outSz, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (p == NULL)
+        return MEMORY_E;
+
+    idx += set_header(0x30, ciSz, p + idx);
+    XMEMCPY(p + idx, oidSignedData, sizeof(oidSignedData));
+    idx += sizeof(oidSignedData);
+    idx += set_header(0xA0, explSz, p + idx);
+    idx += set_header(0x30, sdSz, p + idx);
+    p[idx++] = 0x02; p[idx++] = 0x01; p[idx++] = 0x01;  /* version 1 */
+    p[idx++] = 0x31; p[idx++] = 0x00;                   /* digestAlgorithms */
+    idx += set_header(0x30, sizeof(oidData), p + idx);
+    XMEMCPY(p + idx, oidData, sizeof(oidData));
+    idx += sizeof(oidData);
+    idx += set_header(0xA0, certsSz, p + idx);          /* certificates */
+    for (i = 0; i < list->count; i++) {
+        XMEMCPY(p + idx, list->certs[i].der, list->certs[i].derSz);
+        idx += list->certs[i].derSz;
+    }
+    p[idx++] = 0x31; p[idx++] = 0x00;                   /* signerInfos */
+
+    *out = p;
+    return 0;
+}
+
+/* find the certificates [0] of a DER SignedData, sets the range of the
+ * certificate encodings. Returns 0 with an empty range if there are none. */
+static int find_p7b_certs(const byte* p7b, word32 p7bSz, word32* start,
+                          word32* end)
+{
+    int ret;
+    word32 idx = 0, len;
+
+    *start = *end = 0;
+
+    /* ContentInfo, contentType signedData, [0] */
+    ret = get_header(p7b, &idx, p7bSz, 0x30, &len);
+    if (ret == 0 && (idx + sizeof(oidSignedData) > p7bSz ||
+            XMEMCMP(p7b + idx, oidSignedData, sizeof(oidSignedData)) != 0))
+        ret = ASN_PARSE_E;
+    if (ret == 0) {
+        idx += sizeof(oidSignedData);
+        ret = get_header(p7b, &idx, p7bSz, 0xA0, &len);
+    }
+    /* SignedData: skip version, digestAlgorithms, encapContentInfo */
+    if (ret == 0)
+        ret = get_header(p7b, &idx, p7bSz, 0x30, &len);
+    if (ret == 0 && (ret = get_header(p7b, &idx, p7bSz, 0x02, &len)) == 0)
+        idx += len;
+    if (ret == 0 && (ret = get_header(p7b, &idx, p7bSz, 0x31, &len)) == 0)
+        idx += len;
+    if (ret == 0 && (ret = get_header(p7b, &idx, p7bSz, 0x30, &len)) == 0)
+        idx += len;
+    if (ret == 0 && idx < p7bSz && p7b[idx] == 0xA0) {
+        ret = get_header(p7b, &idx, p7bSz, 0xA0, &len);
+        if (ret == 0) {
+            *start = idx;
+            *end = idx + len;
+        }
+    }
+    if (ret != 0)
+        printf("Error: not a DER encoded SignedData, ret = %d\n", ret);
+
+    return ret;
+}
+
+/* next certificate encoding in [*idx, end), advances *idx past it */
+static int next_cert(const byte* p7b, word32* idx, word32 end,
+                     const byte** cert, word32* certSz)
+{
+    int ret;
+    word32 i = *idx, len;
+
+    ret = get_header(p7b, &i, end, 0x30, &len);
+    if (ret != 0)
+        return ret;
+    *cert = p7b + *idx;
+    *certSz = i + len - *idx;
+    *idx = i + len;
+
+    return 0;
+}
+
+/* Walk the certificates of a .p7b and load each one as a trusted CA,
+ * straight from the bundle buffer. Returns the number of CAs loaded. */
+static int load_p7b(WOLFSSL_CERT_MANAGER* cm, const byte* p7b, word32 p7bSz,
+                    int* failed)
+{
+    int ret, loaded = 0;
+    word32 idx, end, certSz;
+    const byte* cert;
+
+    *failed = 0;
+    ret = find_p7b_certs(p7b, p7bSz, &idx, &end);
+    while (ret == 0 && idx < end) {
+        ret = next_cert(p7b, &idx, end, &cert, &certSz);
+        if (ret != 0)
+            break;
+        if (wolfSSL_CertManagerLoadCABuffer(cm, cert, certSz,
+                WOLFSSL_FILETYPE_ASN1) == WOLFSSL_SUCCESS)
+            loaded++;
+        else
+            (*failed)++;
+    }
+
+    return ret == 0 ? loaded : ret;
+}
+
+#ifdef WOLFSSL_PEM_TO_DER
+/* find str in [p, end), the buffer is not NUL terminated */
+static char* find_str(char* p, const char* end, const char* str)
+{
+    size_t n = strlen(str);
+
+    for (; p + n <= end; p++) {
+        if (*p == *str && XMEMCMP(p, str, n) == 0)
+            return p;
+    }
+    return NULL;
+}
+#endif
+
+/* add the certificates in a file: DER, a PEM file with any number of
+ * certificates, or another .p7b */
+static int cert_list_add_file(CertList* list, const char* fileName)
+{
+    int ret;
+    byte* buf = NULL;
+    word32 bufSz = 0, idx = 0, len;
+
+    ret = read_file(fileName, &buf, &bufSz);
+    if (ret != 0)
+        return ret;
+
+    if (buf[0] == 0x30 && get_header(buf, &idx, bufSz, 0x30, &len) == 0 &&
+            idx + sizeof(oidSignedData) <= bufSz &&
+            XMEMCMP(buf + idx, oidSignedData, sizeof(oidSignedData)) == 0) {
+        /* merge the certificates of another bundle */
+        const byte* cert;
+        word32 certSz, end;
+
+        ret = find_p7b_certs(buf, bufSz, &idx, &end);
+        while (ret == 0 && idx < end) {
+            ret = next_cert(buf, &idx, end, &cert, &certSz);
+            if (ret == 0)
+                ret = cert_list_add(list, cert, certSz);
+        }
+    }
+    else if (buf[0] == 0x30) {
+        ret = cert_list_add(list, buf, bufSz);
+    }
+    else {
+#ifdef WOLFSSL_PEM_TO_DER
+        const char* begin = "-----BEGIN CERTIFICATE-----";
+        const char* end = "-----END CERTIFICATE-----";
+        char* p = (char*)buf;
+        char* e;
+        byte der[MAX_PEM_CERT_SIZE];
+        int derSz;
+
+        while (ret == 0 && (p = find_str(p, (char*)buf + bufSz,
+                                         begin)) != NULL) {
+            e = find_str(p, (char*)buf + bufSz, end);
+            if (e == NULL)
+                break;
+            e += strlen(end);
+            derSz = wc_CertPemToDer((byte*)p, (int)(e - p), der, sizeof(der),
+                                    CERT_TYPE);
+            if (derSz < 0)
+                ret = derSz;
+            else
+                ret = cert_list_add(list, der, derSz);
+            p = e;
+        }
+#else
+        printf("Error: PEM input needs WOLFSSL_PEM_TO_DER\n");
+        ret = -1;
+#endif
+    }
+
+    XFREE(buf, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    return ret;
+}
+
+#ifdef WOLFSSL_DER_TO_PEM
+/* original example: print each certificate of a .p7b as PEM */
+static int print_p7b(const char* fileName)
 {
     int ret, i;
     PKCS7* pkcs7;
     word32 p7bBufSz;            /* size of p7b we read, bytes */
-    byte   p7bBuf[4096];        /* array to hold input p7b file */
+    byte*  p7bBuf = NULL;       /* array to hold input p7b file */
     byte*  singleCertDer;       /* tmp ptr to one DER cert in decoded PKCS7 */
     word32 singleCertDerSz;     /* tmp size of one DER cert in decoded PKCS7 */
     byte*  singleCertPem;
-    word32 singleCertPemSz;
-    FILE* file;
-
-#ifdef DEBUG_WOLFSSL
-    wolfSSL_Debugging_ON();
-#endif
+    int    singleCertPemSz;
 
     /* read p7b file into buffer */
-    p7bBufSz = sizeof(p7bBuf);
-    file = fopen(p7bFile, "rb");
-    if (file == NULL) {
-        printf("Error opening %s\n", p7bFile);
+    ret = read_file(fileName, &p7bBuf, &p7bBufSz);
+    if (ret != 0)
         return -1;
-    }
-    p7bBufSz = (word32)fread(p7bBuf, 1, p7bBufSz, file);
-    fclose(file);
 
     /* extract cert from PKCS#7 (p7b) format */
     pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
     if (pkcs7 == NULL) {
         printf("Error creating new PKCS7 structure\n");
+        XFREE(p7bBuf, NULL, DYNAMIC_TYPE_TMP_BUFFER);
         return -1;
     }
 
@@ -78,6 +487,7 @@ int main(int argc, char** argv)
     if (ret < 0) {
         printf("Error in wc_PKCS7_VerifySignedData(), ret = %d\n", ret);
         wc_PKCS7_Free(pkcs7);
+        XFREE(p7bBuf, NULL, DYNAMIC_TYPE_TMP_BUFFER);
         return -1;
     }
     printf("Successfully verified SignedData bundle.\n");
@@ -112,8 +522,8 @@ int main(int argc, char** argv)
         singleCertPemSz = wc_DerToPem(singleCertDer, singleCertDerSz,
                                       singleCertPem, singleCertPemSz,
                                       CERT_TYPE);
-        if (singleCertPem < 0) {
-            printf("Error converting DER to PEM, ret = %d\n", ret);
+        if (singleCertPemSz < 0) {
+            printf("Error converting DER to PEM, ret = %d\n", singleCertPemSz);
             XFREE(singleCertPem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
             break;
         }
@@ -131,13 +541,343 @@ int main(int argc, char** argv)
     }
 
     wc_PKCS7_Free(pkcs7);
+    XFREE(p7bBuf, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+
+    return 0;
+}
+#endif /* WOLFSSL_DER_TO_PEM */
+
+/* build a sorted, deduplicated .p7b from certificate files */
+static int build_bundle(const char* outFile, char** files, int numFiles)
+{
+    int ret = 0, i, dropped;
+    CertList list;
+    byte* p7b = NULL;
+    word32 p7bSz;
+
+    XMEMSET(&list, 0, sizeof(list));
+    for (i = 0; i < numFiles && ret == 0; i++) {
+        ret = cert_list_add_file(&list, files[i]);
+        if (ret != 0)
+            printf("Error reading certificates from %s, ret = %d\n", files[i],
+                   ret);
+    }
+    if (ret == 0 && list.count == 0) {
+        printf("Error: no certificates found in the input files\n");
+        ret = -1;
+    }
+    if (ret == 0) {
+        i = list.count;
+        dropped = cert_list_sort(&list);
+        ret = build_p7b(&list, &p7b, &p7bSz);
+        if (ret == 0)
+            ret = write_file(outFile, p7b, p7bSz);
+        if (ret == 0)
+            printf("Wrote %s: %d certificates (%d read, %d duplicates "
+                   "dropped), %u bytes\n", outFile, list.count, i, dropped,
+                   p7bSz);
+    }
+
+    /* small bundles can be cross checked with the wolfCrypt decoder */
+    if (ret == 0 && list.count <= MAX_PKCS7_CERTS) {
+        PKCS7* pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+        if (pkcs7 == NULL)
+            ret = MEMORY_E;
+        else {
+            ret = wc_PKCS7_VerifySignedData(pkcs7, p7b, p7bSz);
+            if (ret == 0 && pkcs7->certSz[list.count - 1] == 0)
+                ret = -1;
+            if (ret != 0)
+                printf("Error: wc_PKCS7_VerifySignedData() check failed, "
+                       "ret = %d\n", ret);
+            wc_PKCS7_Free(pkcs7);
+        }
+    }
+
+    XFREE(p7b, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    cert_list_free(&list);
+    return ret;
+}
+
+/* load a .p7b into a certificate manager and report the time */
+static int load_bundle(const char* fileName)
+{
+    int ret, failed;
+    byte* p7b = NULL;
+    word32 p7bSz;
+    WOLFSSL_CERT_MANAGER* cm;
+    double start;
+
+    ret = read_file(fileName, &p7b, &p7bSz);
+    if (ret != 0)
+        return -1;
 
-    (void)argc;
-    (void)argv;
+    cm = wolfSSL_CertManagerNew();
+    if (cm == NULL) {
+        XFREE(p7b, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        return MEMORY_E;
+    }
+
+    start = current_time();
+    ret = load_p7b(cm, p7b, p7bSz, &failed);
+    start = current_time() - start;
+    if (ret >= 0) {
+        printf("Loaded %d CA certificates from %s (%u bytes) in %.2f ms\n",
+               ret, fileName, p7bSz, start * 1000);
+        if (failed > 0)
+            printf("%d certificates could not be loaded\n", failed);
+        ret = 0;
+    }
+
+    wolfSSL_CertManagerFree(cm);
+    XFREE(p7b, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    return ret;
+}
+
+#if defined(WOLFSSL_CERT_GEN) && defined(HAVE_ECC) && \
+    defined(WOLFSSL_DER_TO_PEM)
+/* generate self-signed CA certificates, all with the same P-256 key */
+static int make_certs(CertList* list, int count)
+{
+    int ret, i, derSz;
+    WC_RNG rng;
+    ecc_key key;
+    Cert cert;
+    byte der[1024];
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0)
+        return ret;
+    ret = wc_ecc_init(&key);
+    if (ret == 0)
+        ret = wc_ecc_make_key(&rng, 32, &key);
+
+    for (i = 0; i < count && ret == 0; i++) {
+        ret = wc_InitCert(&cert);
+        if (ret != 0)
+            break;
+        snprintf(cert.subject.commonName, CTC_NAME_SIZE,
+                 "wolfSSL Bench Root CA %d", i);
+        strncpy(cert.subject.org, "wolfSSL", CTC_NAME_SIZE);
+        cert.isCA = 1;
+        cert.selfSigned = 1;
+        cert.sigType = CTC_SHA256wECDSA;
+
+        derSz = wc_MakeCert_ex(&cert, der, sizeof(der), ECC_TYPE, &key, &rng);
+        if (derSz >= 0)
+            derSz = wc_SignCert_ex(cert.bodySz, cert.sigType, der, sizeof(der),
+                                   ECC_TYPE, &key, &rng);
+        if (derSz < 0)
+            ret = derSz;
+        else
+            ret = cert_list_add(list, der, derSz);
+    }
+
+    wc_ecc_free(&key);
+    wc_FreeRng(&rng);
+    return ret;
+}
 
+/* concatenated PEM bundle of the first count certificates */
+static int make_pem_bundle(const CertList* list, int count, byte** out,
+                           word32* outSz)
+{
+    int i, n;
+    word32 cap = 0, idx = 0;
+    byte* p;
+
+    for (i = 0; i < count; i++)
+        cap += list->certs[i].derSz * 3 / 2 + 128;
+    p = (byte*)XMALLOC(cap, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+    if (p == NULL)
+        return MEMORY_E;
+
+    for (i = 0; i < count; i++) {
+        n = wc_DerToPem(list->certs[i].der, list->certs[i].derSz, p + idx,
+                        cap - idx, CERT_TYPE);
+        if (n < 0) {
+            XFREE(p, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+            return n;
+        }
+        idx += n;
+    }
+
+    *out = p;
+    *outSz = idx;
     return 0;
 }
 
+/* load time against bundle size, p7b and PEM */
+static int bench_bundles(int maxCerts)
+{
+    static const int sizes[] = { 100, 500, 1000, 2000, 5000, 10000 };
+    int ret, s, failed, count;
+    int numSizes = (int)(sizeof(sizes) / sizeof(sizes[0]));
+    CertList all, list;
+    WOLFSSL_CERT_MANAGER* cm;
+    byte* p7b;
+    byte* pem;
+    word32 p7bSz, pemSz;
+    double start, p7bTime, pemTime;
+
+    XMEMSET(&all, 0, sizeof(all));
+    printf("Generating %d CA certificates\n", maxCerts);
+    ret = make_certs(&all, maxCerts);
+    if (ret != 0) {
+        printf("Error generating certificates, ret = %d\n", ret);
+        cert_list_free(&all);
+        return ret;
+    }
+
+    printf("%8s %12s %12s %12s %12s\n", "certs", "p7b bytes", "p7b ms",
+           "PEM ms", "p7b certs/s");
+    for (s = 0; s <= numSizes && ret == 0; s++) {
+        /* the fixed sizes, then maxCerts itself when it is larger */
+        count = (s < numSizes && sizes[s] < maxCerts) ? sizes[s] : maxCerts;
+
+        /* bundle of the first count certificates, sorted */
+        list.count = list.cap = count;
+        list.certs = (CertEntry*)malloc(count * sizeof(CertEntry));
+        if (list.certs == NULL) {
+            ret = MEMORY_E;
+            break;
+        }
+        XMEMCPY(list.certs, all.certs, count * sizeof(CertEntry));
+        qsort(list.certs, count, sizeof(CertEntry), cert_cmp);
+        ret = build_p7b(&list, &p7b, &p7bSz);
+        free(list.certs);
+        if (ret != 0)
+            break;
+        ret = make_pem_bundle(&all, count, &pem, &pemSz);
+        if (ret != 0) {
+            XFREE(p7b, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+            break;
+        }
+
+        cm = wolfSSL_CertManagerNew();
+        if (cm == NULL) {
+            ret = MEMORY_E;
+            XFREE(p7b, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+            XFREE(pem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+            break;
+        }
+        start = current_time();
+        ret = load_p7b(cm, p7b, p7bSz, &failed);
+        p7bTime = current_time() - start;
+        wolfSSL_CertManagerFree(cm);
+        if (ret != count) {
+            printf("Error: loaded %d of %d certificates from p7b\n", ret,
+                   count);
+            ret = -1;
+        }
+        else if ((cm = wolfSSL_CertManagerNew()) == NULL) {
+            ret = MEMORY_E;
+        }
+        else {
+            start = current_time();
+            ret = wolfSSL_CertManagerLoadCABuffer(cm, pem, pemSz,
+                                                  WOLFSSL_FILETYPE_PEM);
+            pemTime = current_time() - start;
+            wolfSSL_CertManagerFree(cm);
+            ret = (ret == WOLFSSL_SUCCESS) ? 0 : ret;
+        }
+        if (ret == 0)
+            printf("%8d %12u %12.2f %12.2f %12.0f\n", count, p7bSz,
+                   p7bTime * 1000, pemTime * 1000, count / p7bTime);
+
+        XFREE(p7b, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        XFREE(pem, NULL, DYNAMIC_TYPE_TMP_BUFFER);
+        if (count == maxCerts)
+            break;
+    }
+
+    cert_list_free(&all);
+    return ret;
+}
+#endif /* WOLFSSL_CERT_GEN && HAVE_ECC && WOLFSSL_DER_TO_PEM */
+
+static void Usage(void)
+{
+    printf("signedData-p7b [options] [cert files]\n");
+    printf("(no options) Print the certificates of %s as PEM\n", p7bFile);
+    printf("-p <p7b>     Print the certificates of a .p7b as PEM\n");
+    printf("-o <p7b>     Build a sorted, deduplicated .p7b from the cert files "
+           "(DER, PEM or .p7b)\n");
+    printf("-l <p7b>     Load a .p7b into a certificate manager\n");
+    printf("-b           Benchmark load time against bundle size\n");
+    printf("-n <num>     Largest benchmark bundle, default %d\n",
+           DEF_BENCH_CERTS);
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0, ch, bench = 0;
+    int maxCerts = DEF_BENCH_CERTS;
+    const char* printFile = p7bFile;
+    const char* outFile = NULL;
+    const char* loadFile = NULL;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?p:o:l:bn:")) != -1) {
+        switch (ch) {
+            case 'p':
+                printFile = optarg;
+                break;
+            case 'o':
+                outFile = optarg;
+                break;
+            case 'l':
+                loadFile = optarg;
+                break;
+            case 'b':
+                bench = 1;
+                break;
+            case 'n':
+                maxCerts = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (maxCerts <= 0 || (outFile != NULL && optind >= argc)) {
+        Usage();
+        return -1;
+    }
+
+    wolfSSL_Init();
+
+    if (outFile != NULL)
+        ret = build_bundle(outFile, argv + optind, argc - optind);
+    if (ret == 0 && loadFile != NULL)
+        ret = load_bundle(loadFile);
+    if (ret == 0 && bench) {
+#if defined(WOLFSSL_CERT_GEN) && defined(HAVE_ECC) && \
+    defined(WOLFSSL_DER_TO_PEM)
+        ret = bench_bundles(maxCerts);
+#else
+        printf("Benchmark needs ./configure --enable-certgen "
+               "CFLAGS=\"-DWOLFSSL_DER_TO_PEM\"\n");
+#endif
+    }
+    if (ret == 0 && outFile == NULL && loadFile == NULL && !bench) {
+#ifdef WOLFSSL_DER_TO_PEM
+        ret = print_p7b(printFile);
+#else
+        printf("Printing PEM needs CFLAGS=\"-DWOLFSSL_DER_TO_PEM\"\n");
+        (void)printFile;
+#endif
+    }
+
+    wolfSSL_Cleanup();
+
+    return ret == 0 ? 0 : -1;
+}
+
 #else
 
 int main(int argc, char** argv)
@@ -148,4 +888,3 @@ int main(int argc, char** argv)
 }
 
 #endif
-
@@ -0,0 +1,519 @@
+/* signedData-template.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * DESCRIPTION:
+ *
+ * This file includes an example of a reusable SignedData signer template for
+ * services that sign many messages with the same signer certificate and
+ * mostly static attributes.
+ *
+ * signer_template_init() does the per-signer work once:
+ *   - parses the signer certificate (wc_PKCS7_InitWithCert), which also
+ *     provides the issuer and serial number used for the SignerIdentifier
+ *   - sets the digest/signature algorithms and static signed attributes
+ *   - decodes the RSA private key once and keeps it in an RsaKey. The
+ *     PKCS7 structure is bound to a crypto callback device that signs with
+ *     the cached key, so the key is not decoded again for every signature.
+ *
+ * signer_template_sign() then only sets the content and calls
+ * wc_PKCS7_EncodeSignedData(). That still encodes the whole SignedData for
+ * every message, including the SignerIdentifier, the algorithm identifiers
+ * and the static signed attributes. wolfCrypt has no API to pre-encode the
+ * invariant SignerInfo parts, so the saving comes from not parsing the
+ * certificate and, with the cached key, not decoding the private key per
+ * message.
+ *
+ * Each template registers its own crypto callback device, so several
+ * templates (for example one per worker thread) can be live at once. Device
+ * registration in wolfCrypt is not thread safe, so create the templates from
+ * one thread before handing them out.
+ *
+ * The example compares ops/s of the per-message approach used in
+ * signedData.c against the template with and without the cached key.
+ *
+ * This is only provided as an example and may need modification if integrated
+ * into a production application.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/pkcs7.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/logging.h>
+#ifdef WOLF_CRYPTO_CB
+    #include <wolfssl/wolfcrypt/cryptocb.h>
+#endif
+
+#define certFile "../certs/client-cert.der"
+#define keyFile  "../certs/client-key.der"
+#define encodedFileTemplate "signedData_template.der"
+
+/* Default number of messages signed in each mode */
+#define DEF_MESSAGES     2000
+/* First crypto callback device ID handed out to templates */
+#define TEMPLATE_DEVID_BASE 7
+
+#if defined(HAVE_PKCS7) && !defined(NO_RSA)
+
+static byte messageTypeOid[] =
+           { 0x06, 0x0a, 0x60, 0x86, 0x48, 0x01, 0x86, 0xF8, 0x45, 0x01,
+             0x09, 0x02 };
+static byte messageType[] = { 0x13, 2, '1', '9' };
+
+static PKCS7Attrib staticAttribs[] =
+{
+    { messageTypeOid, sizeof(messageTypeOid), messageType,
+                                   sizeof(messageType) }
+};
+
+/* Reusable signer state, prepared once per signer (and per thread). */
+typedef struct SignerTemplate {
+    PKCS7*  pkcs7;
+    WC_RNG  rng;
+    RsaKey  key;
+    int     devId;      /* crypto callback device of this template */
+    int     keyCached;  /* signatures use the cached RsaKey */
+    int     rngInit;
+    byte*   keyDer;     /* DER key, used when the key is not cached */
+    word32  keyDerSz;
+} SignerTemplate;
+
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int load_certs(byte* cert, word32* certSz, byte* key, word32* keySz)
+{
+    FILE* file;
+
+    /* certificate file */
+    file = fopen(certFile, "rb");
+    if (!file)
+        return -1;
+
+    *certSz = (word32)fread(cert, 1, *certSz, file);
+    fclose(file);
+
+    /* key file */
+    file = fopen(keyFile, "rb");
+    if (!file)
+        return -1;
+
+    *keySz = (word32)fread(key, 1, *keySz, file);
+    fclose(file);
+
+    return 0;
+}
+
+static int write_file_buffer(const char* fileName, byte* in, word32 inSz)
+{
+    int ret;
+    FILE* file;
+
+    file = fopen(fileName, "wb");
+    if (file == NULL) {
+        printf("ERROR: opening file for writing: %s\n", fileName);
+        return -1;
+    }
+
+    ret = (int)fwrite(in, 1, inSz, file);
+    if (ret == 0) {
+        printf("ERROR: writing buffer to output file\n");
+        return -1;
+    }
+    fclose(file);
+
+    return 0;
+}
+
+#ifdef WOLF_CRYPTO_CB
+/* Next free device ID, one per template */
+static int nextDevId = TEMPLATE_DEVID_BASE;
+
+/* Crypto callback that performs the RSA private operation with the key
+ * cached in the SignerTemplate. wolfCrypt has already applied the PKCS#1
+ * v1.5 padding, so only the raw private key operation is done here. Any
+ * other operation falls back to software. */
+static int templateCryptoCb(int devIdArg, wc_CryptoInfo* info, void* ctx)
+{
+    SignerTemplate* tmpl = (SignerTemplate*)ctx;
+
+    if (info == NULL || tmpl == NULL)
+        return BAD_FUNC_ARG;
+
+    if (info->algo_type == WC_ALGO_TYPE_PK &&
+            info->pk.type == WC_PK_TYPE_RSA &&
+            (info->pk.rsa.type == RSA_PRIVATE_ENCRYPT ||
+             info->pk.rsa.type == RSA_PRIVATE_DECRYPT)) {
+        return wc_RsaFunction(info->pk.rsa.in, info->pk.rsa.inLen,
+                              info->pk.rsa.out, info->pk.rsa.outLen,
+                              info->pk.rsa.type, &tmpl->key,
+                              info->pk.rsa.rng);
+    }
+
+    (void)devIdArg;
+    return CRYPTOCB_UNAVAILABLE;
+}
+#endif
+
+static int signer_template_encode(SignerTemplate* tmpl, const byte* content,
+                                  word32 contentSz, byte* out, word32 outSz)
+{
+    tmpl->pkcs7->content   = (byte*)content;
+    tmpl->pkcs7->contentSz = contentSz;
+
+    return wc_PKCS7_EncodeSignedData(tmpl->pkcs7, out, outSz);
+}
+
+static void signer_template_free(SignerTemplate* tmpl)
+{
+    wc_PKCS7_Free(tmpl->pkcs7);
+    tmpl->pkcs7 = NULL;
+#ifdef WOLF_CRYPTO_CB
+    if (tmpl->keyCached) {
+        wc_CryptoCb_UnRegisterDevice(tmpl->devId);
+        wc_FreeRsaKey(&tmpl->key);
+        tmpl->keyCached = 0;
+        tmpl->devId = INVALID_DEVID;
+    }
+#endif
+    if (tmpl->rngInit) {
+        wc_FreeRng(&tmpl->rng);
+        tmpl->rngInit = 0;
+    }
+}
+
+/* Prepare a signer template. When cacheKey is set and crypto callbacks are
+ * available the private key is decoded once here. */
+static int signer_template_init(SignerTemplate* tmpl, byte* cert,
+                                word32 certSz, byte* key, word32 keySz,
+                                PKCS7Attrib* attribs, word32 attribsSz,
+                                int cacheKey)
+{
+    int ret;
+    int devId = INVALID_DEVID;
+    word32 idx = 0;
+    byte probe[1] = { 0 };
+    byte out[2048];
+
+    XMEMSET(tmpl, 0, sizeof(*tmpl));
+    tmpl->devId = INVALID_DEVID;
+    tmpl->keyDer = key;
+    tmpl->keyDerSz = keySz;
+
+    ret = wc_InitRng(&tmpl->rng);
+    if (ret != 0)
+        return ret;
+    tmpl->rngInit = 1;
+
+#ifdef WOLF_CRYPTO_CB
+    if (cacheKey) {
+        ret = wc_InitRsaKey(&tmpl->key, NULL);
+        if (ret == 0)
+            ret = wc_RsaPrivateKeyDecode(key, &idx, &tmpl->key, keySz);
+    #ifdef WC_RSA_BLINDING
+        if (ret == 0)
+            ret = wc_RsaSetRNG(&tmpl->key, &tmpl->rng);
+    #endif
+        if (ret == 0)
+            ret = wc_CryptoCb_RegisterDevice(nextDevId, templateCryptoCb,
+                                             tmpl);
+        if (ret == 0) {
+            devId = tmpl->devId = nextDevId++;
+            tmpl->keyCached = 1;
+        }
+        else {
+            wc_FreeRsaKey(&tmpl->key);
+        }
+    }
+#else
+    (void)idx;
+    (void)cacheKey;
+#endif
+
+    tmpl->pkcs7 = wc_PKCS7_New(NULL, devId);
+    if (tmpl->pkcs7 == NULL) {
+        signer_template_free(tmpl);
+        return MEMORY_E;
+    }
+
+    /* parse signer certificate once */
+    ret = wc_PKCS7_InitWithCert(tmpl->pkcs7, cert, certSz);
+    if (ret != 0) {
+        printf("ERROR: wc_PKCS7_InitWithCert() failed, ret = %d\n", ret);
+        signer_template_free(tmpl);
+        return ret;
+    }
+
+    tmpl->pkcs7->rng             = &tmpl->rng;
+    tmpl->pkcs7->contentOID      = DATA;
+    tmpl->pkcs7->hashOID         = SHA256h;
+    tmpl->pkcs7->encryptOID      = RSAk;
+    tmpl->pkcs7->signedAttribs   = attribs;
+    tmpl->pkcs7->signedAttribsSz = attribsSz;
+    if (!tmpl->keyCached) {
+        tmpl->pkcs7->privateKey   = tmpl->keyDer;
+        tmpl->pkcs7->privateKeySz = tmpl->keyDerSz;
+    }
+
+    /* make sure the template can sign, otherwise fall back to the DER key */
+    if (tmpl->keyCached &&
+            signer_template_encode(tmpl, probe, sizeof(probe), out,
+                                   sizeof(out)) <= 0) {
+        printf("Cached key signing not available, using DER key\n");
+    #ifdef WOLF_CRYPTO_CB
+        wc_CryptoCb_UnRegisterDevice(tmpl->devId);
+        wc_FreeRsaKey(&tmpl->key);
+    #endif
+        tmpl->devId = INVALID_DEVID;
+        tmpl->keyCached = 0;
+        tmpl->pkcs7->devId        = INVALID_DEVID;
+        tmpl->pkcs7->privateKey   = tmpl->keyDer;
+        tmpl->pkcs7->privateKeySz = tmpl->keyDerSz;
+    }
+
+    return 0;
+}
+
+/* Sign one message with a prepared template, returns encoded size. */
+static int signer_template_sign(SignerTemplate* tmpl, const byte* content,
+                                word32 contentSz, byte* out, word32 outSz)
+{
+    return signer_template_encode(tmpl, content, contentSz, out, outSz);
+}
+
+/* Per-message signing as done in signedData.c, for comparison */
+static int sign_per_message(byte* cert, word32 certSz, byte* key,
+                            word32 keySz, WC_RNG* rng, const byte* content,
+                            word32 contentSz, byte* out, word32 outSz)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return MEMORY_E;
+
+    ret = wc_PKCS7_InitWithCert(pkcs7, cert, certSz);
+    if (ret == 0) {
+        pkcs7->rng             = rng;
+        pkcs7->content         = (byte*)content;
+        pkcs7->contentSz       = contentSz;
+        pkcs7->contentOID      = DATA;
+        pkcs7->hashOID         = SHA256h;
+        pkcs7->encryptOID      = RSAk;
+        pkcs7->privateKey      = key;
+        pkcs7->privateKeySz    = keySz;
+        pkcs7->signedAttribs   = staticAttribs;
+        pkcs7->signedAttribsSz = sizeof(staticAttribs)/sizeof(PKCS7Attrib);
+
+        ret = wc_PKCS7_EncodeSignedData(pkcs7, out, outSz);
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+static int signedData_verify(byte* in, word32 inSz, const byte* content,
+                             word32 contentSz)
+{
+    int ret;
+    PKCS7* pkcs7;
+
+    pkcs7 = wc_PKCS7_New(NULL, INVALID_DEVID);
+    if (pkcs7 == NULL)
+        return -1;
+
+    ret = wc_PKCS7_VerifySignedData(pkcs7, in, inSz);
+    if (ret < 0 || pkcs7->contentSz != contentSz ||
+            XMEMCMP(pkcs7->content, content, contentSz) != 0) {
+        printf("ERROR: Failed to verify SignedData bundle, ret = %d\n", ret);
+        ret = -1;
+    }
+
+    wc_PKCS7_Free(pkcs7);
+    return ret;
+}
+
+/* Build a unique message for each index */
+static word32 make_message(byte* msg, word32 msgSz, int i)
+{
+    return (word32)snprintf((char*)msg, msgSz,
+                            "{\"event\":%d,\"status\":\"ok\"}", i);
+}
+
+static void Usage(void)
+{
+    printf("signedData-template [options]\n");
+    printf("-n <num>    Messages signed in each mode, default %d\n",
+           DEF_MESSAGES);
+}
+
+int main(int argc, char** argv)
+{
+    int ret = 0;
+    int ch;
+    int i;
+    int numMsgs = DEF_MESSAGES;
+    int encodedSz = 0;
+    word32 certSz, keySz, msgSz;
+    byte cert[2048];
+    byte key[2048];
+    byte out[4096];
+    byte msg[64];
+    double start, base, tmplDer, tmplCached = 0;
+    SignerTemplate tmpl;
+    WC_RNG rng;
+
+#ifdef DEBUG_WOLFSSL
+    wolfSSL_Debugging_ON();
+#endif
+
+    while ((ch = getopt(argc, argv, "?n:")) != -1) {
+        switch (ch) {
+            case 'n':
+                numMsgs = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 0;
+        }
+    }
+    if (numMsgs <= 0) {
+        Usage();
+        return -1;
+    }
+
+    ret = wolfCrypt_Init();
+    if (ret != 0) {
+        printf("wolfCrypt initialization failed\n");
+        return -1;
+    }
+
+    certSz = sizeof(cert);
+    keySz = sizeof(key);
+    ret = load_certs(cert, &certSz, key, &keySz);
+    if (ret != 0)
+        return -1;
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        printf("ERROR: wc_InitRng() failed, ret = %d\n", ret);
+        return -1;
+    }
+
+    /* 1: per-message PKCS7, cert parse and key decode */
+    start = current_time();
+    for (i = 0; i < numMsgs && ret >= 0; i++) {
+        msgSz = make_message(msg, sizeof(msg), i);
+        ret = sign_per_message(cert, certSz, key, keySz, &rng, msg, msgSz,
+                               out, sizeof(out));
+    }
+    base = numMsgs / (current_time() - start);
+    if (ret <= 0 || signedData_verify(out, ret, msg, msgSz) != 0) {
+        printf("ERROR: per-message signing failed, ret = %d\n", ret);
+        wc_FreeRng(&rng);
+        return -1;
+    }
+
+    /* 2: template, private key decoded for each signature */
+    ret = signer_template_init(&tmpl, cert, certSz, key, keySz,
+                               staticAttribs,
+                               sizeof(staticAttribs)/sizeof(PKCS7Attrib), 0);
+    start = current_time();
+    for (i = 0; i < numMsgs && ret >= 0; i++) {
+        msgSz = make_message(msg, sizeof(msg), i);
+        ret = signer_template_sign(&tmpl, msg, msgSz, out, sizeof(out));
+    }
+    tmplDer = numMsgs / (current_time() - start);
+    signer_template_free(&tmpl);
+    if (ret <= 0 || signedData_verify(out, ret, msg, msgSz) != 0) {
+        printf("ERROR: template signing failed, ret = %d\n", ret);
+        wc_FreeRng(&rng);
+        return -1;
+    }
+
+    /* 3: template with cached private key */
+    ret = signer_template_init(&tmpl, cert, certSz, key, keySz,
+                               staticAttribs,
+                               sizeof(staticAttribs)/sizeof(PKCS7Attrib), 1);
+    if (ret == 0 && tmpl.keyCached) {
+        start = current_time();
+        for (i = 0; i < numMsgs && ret >= 0; i++) {
+            msgSz = make_message(msg, sizeof(msg), i);
+            ret = signer_template_sign(&tmpl, msg, msgSz, out, sizeof(out));
+        }
+        tmplCached = numMsgs / (current_time() - start);
+        if (ret <= 0 || signedData_verify(out, ret, msg, msgSz) != 0) {
+            printf("ERROR: cached key signing failed, ret = %d\n", ret);
+            ret = -1;
+        }
+    }
+    encodedSz = ret;
+    signer_template_free(&tmpl);
+    wc_FreeRng(&rng);
+    if (ret < 0)
+        return -1;
+
+    if (encodedSz > 0) {
+        if (write_file_buffer(encodedFileTemplate, out, encodedSz) != 0)
+            return -1;
+        printf("Successfully encoded SignedData bundle (%s)\n",
+               encodedFileTemplate);
+    }
+
+    printf("\n%d messages, RSA-2048 with SHA-256, default + messageType "
+           "attributes\n", numMsgs);
+    printf("%-34s %10.1f ops/s\n", "per-message PKCS7", base);
+    printf("%-34s %10.1f ops/s (%.2fx)\n", "template", tmplDer,
+           tmplDer / base);
+    if (tmplCached > 0) {
+        printf("%-34s %10.1f ops/s (%.2fx)\n", "template + cached key",
+               tmplCached, tmplCached / base);
+    }
+    else {
+        printf("%-34s %10s\n", "template + cached key",
+               "not available (needs --enable-cryptocb)");
+    }
+
+    wolfCrypt_Cleanup();
+
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    printf("Must build wolfSSL using ./configure --enable-pkcs7\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,169 @@
+/* gen_limbs.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Build time generator of the public key in big integer form.
+ *
+ * Prints a header with the modulus of rsa_vfy_data.h as little-endian
+ * sp_int digits, for both 32 and 64-bit digits, so verify_limbs.c can fill
+ * in the key without parsing bytes at run time. The Montgomery constants
+ * used by the e = 65537 path in rsa_vfy_limbs.h are computed here too:
+ * R^2 mod n, with R = 2^2048, and -1/n mod 2^digit bits.
+ *
+ * Runs on the build host and doesn't need wolfSSL:
+ *
+ * cc -o gen_limbs gen_limbs.c
+ * ./gen_limbs > rsa_pub_2048_limbs.h
+ */
+
+#include <stdio.h>
+
+#include "rsa_vfy_data.h"
+
+#define N_SZ    ((int)sizeof(public_key_2048_n))
+
+/* Print the big-endian number in buf as digits of digitBits bits.
+ * Returns the number of digits used. */
+static int print_limbs(const char* name, const unsigned char* buf, int sz,
+                       int digitBits)
+{
+    int digitSz = digitBits / 8;
+    int digits = (sz + digitSz - 1) / digitSz;
+    int used = 0;
+    int i, j, idx;
+    unsigned long long d;
+
+    printf("static const sp_int_digit %s[%d] = {", name, digits);
+    for (i = 0; i < digits; i++) {
+        d = 0;
+        /* digit i holds bytes sz-1-i*digitSz (least significant) upwards */
+        for (j = digitSz - 1; j >= 0; j--) {
+            idx = sz - 1 - (i * digitSz + j);
+            d <<= 8;
+            if (idx >= 0)
+                d |= buf[idx];
+        }
+        if (d != 0)
+            used = i + 1;
+        if ((i % (digitBits == 64 ? 3 : 6)) == 0)
+            printf("\n   ");
+        if (digitBits == 64)
+            printf(" 0x%016llxULL,", d);
+        else
+            printf(" 0x%08llxU,", d);
+    }
+    printf("\n};\n");
+    return used;
+}
+
+/* R^2 mod n as big-endian bytes, by doubling 1 modulo n 2 * 2048 times */
+static void calc_rr(unsigned char* rr)
+{
+    int i, j, carry, ge;
+    unsigned int t;
+
+    for (i = 0; i < N_SZ; i++)
+        rr[i] = 0;
+    rr[N_SZ - 1] = 1;
+
+    for (i = 0; i < 2 * 8 * N_SZ; i++) {
+        /* rr = 2 * rr, the top bit shifted out is kept in carry */
+        carry = 0;
+        for (j = N_SZ - 1; j >= 0; j--) {
+            t = ((unsigned int)rr[j] << 1) | carry;
+            rr[j] = (unsigned char)t;
+            carry = t >> 8;
+        }
+        /* reduce once, 2 * rr < 2n */
+        ge = carry;
+        for (j = 0; !ge && j < N_SZ; j++) {
+            if (rr[j] != public_key_2048_n[j]) {
+                ge = rr[j] > public_key_2048_n[j];
+                break;
+            }
+            if (j == N_SZ - 1)
+                ge = 1;
+        }
+        if (ge) {
+            carry = 0;
+            for (j = N_SZ - 1; j >= 0; j--) {
+                t = (unsigned int)rr[j] - public_key_2048_n[j] - carry;
+                rr[j] = (unsigned char)t;
+                carry = (t >> 8) & 1;
+            }
+        }
+    }
+}
+
+/* -1/n mod 2^64, the low 32 bits are the value for 32-bit digits */
+static unsigned long long calc_mp(void)
+{
+    unsigned long long n0 = 0, inv;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        n0 |= (unsigned long long)public_key_2048_n[N_SZ - 1 - i] << (8 * i);
+
+    /* Newton iteration, correct bits double from 3 each time */
+    inv = n0;
+    for (i = 0; i < 5; i++)
+        inv *= 2 - n0 * inv;
+
+    return (unsigned long long)0 - inv;
+}
+
+static void print_key(int digitBits)
+{
+    unsigned char rr[N_SZ];
+    unsigned long long mp = calc_mp();
+    int used;
+
+    used = print_limbs("public_key_2048_n_limbs", public_key_2048_n, N_SZ,
+                       digitBits);
+    printf("#define PUBLIC_KEY_2048_N_USED %d\n", used);
+    calc_rr(rr);
+    print_limbs("public_key_2048_rr_limbs", rr, N_SZ, digitBits);
+    if (digitBits == 64)
+        printf("#define PUBLIC_KEY_2048_MP 0x%016llxULL\n", mp);
+    else
+        printf("#define PUBLIC_KEY_2048_MP 0x%08llxU\n", mp & 0xffffffffULL);
+}
+
+int main(void)
+{
+    printf("/* rsa_pub_2048_limbs.h\n");
+    printf(" *\n");
+    printf(" * Generated by gen_limbs from rsa_vfy_data.h - do not edit.\n");
+    printf(" */\n\n");
+    printf("#ifndef RSA_PUB_2048_LIMBS_H\n");
+    printf("#define RSA_PUB_2048_LIMBS_H\n\n");
+    printf("#define PUBLIC_KEY_2048_E 0x%lxUL\n\n", public_key_2048_e);
+
+    printf("#if SP_WORD_SIZE == 64\n");
+    print_key(64);
+    printf("#elif SP_WORD_SIZE == 32\n");
+    print_key(32);
+    printf("#else\n");
+    printf("    #error Limbs only generated for 32 and 64-bit digits\n");
+    printf("#endif\n\n");
+    printf("#endif /* RSA_PUB_2048_LIMBS_H */\n");
+
+    return 0;
+}
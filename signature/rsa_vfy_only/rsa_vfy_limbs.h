@@ -0,0 +1,213 @@
+/* rsa_vfy_limbs.h
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Helpers for the public key generated at build time by gen_limbs.
+ *
+ * set_key_limbs() fills in an RsaKey from the digits, for verifying with
+ * wolfCrypt. rsa_public_f4() is a public key operation fixed to e = 65537:
+ * 16 Montgomery squarings and one Montgomery multiplication with the
+ * constants computed by gen_limbs, with no exponent scanning and no
+ * conversion of the key at run time. The values are all public, so the
+ * code is not constant time.
+ *
+ * Include after rsa_vfy_data.h and rsa_pub_2048_limbs.h.
+ */
+
+#ifndef RSA_VFY_LIMBS_H
+#define RSA_VFY_LIMBS_H
+
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+/* Number of digits in the 2048-bit modulus */
+#define F4_DIGITS      (2048 / SP_WORD_SIZE)
+/* Size of the modulus in bytes */
+#define F4_SZ          (2048 / 8)
+
+#if PUBLIC_KEY_2048_E != 0x10001UL
+    #error rsa_public_f4() only supports the public exponent 65537
+#endif
+
+/* Fill in the public key from the generated digits.
+ *
+ * key  [in]  RSA key initialized with wc_InitRsaKey().
+ */
+static void set_key_limbs(RsaKey* key)
+{
+    XMEMCPY(key->n.dp, public_key_2048_n_limbs,
+            sizeof(public_key_2048_n_limbs));
+    key->n.used = PUBLIC_KEY_2048_N_USED;
+    key->e.dp[0] = (sp_int_digit)PUBLIC_KEY_2048_E;
+    key->e.used = 1;
+}
+
+/* Montgomery multiplication: r = a * b / R mod n, with R = 2^2048.
+ *
+ * r  [out]  Result, less than n. May be the same as a or b.
+ * a  [in]   Number less than n.
+ * b  [in]   Number less than n.
+ */
+static void f4_mont_mul(sp_int_digit* r, const sp_int_digit* a,
+                        const sp_int_digit* b)
+{
+    const sp_int_digit* n = public_key_2048_n_limbs;
+    sp_int_digit t[F4_DIGITS + 2];
+    sp_int_digit m;
+    sp_int_word w;
+    int i, j;
+
+    XMEMSET(t, 0, sizeof(t));
+    for (i = 0; i < F4_DIGITS; i++) {
+        /* t += a * b[i] */
+        w = 0;
+        for (j = 0; j < F4_DIGITS; j++) {
+            w += (sp_int_word)a[j] * b[i] + t[j];
+            t[j] = (sp_int_digit)w;
+            w >>= SP_WORD_SIZE;
+        }
+        w += t[F4_DIGITS];
+        t[F4_DIGITS] = (sp_int_digit)w;
+        t[F4_DIGITS + 1] = (sp_int_digit)(w >> SP_WORD_SIZE);
+
+        /* t = (t + m * n) / 2^SP_WORD_SIZE, the low digit becomes zero */
+        m = t[0] * (sp_int_digit)PUBLIC_KEY_2048_MP;
+        w = (sp_int_word)m * n[0] + t[0];
+        w >>= SP_WORD_SIZE;
+        for (j = 1; j < F4_DIGITS; j++) {
+            w += (sp_int_word)m * n[j] + t[j];
+            t[j - 1] = (sp_int_digit)w;
+            w >>= SP_WORD_SIZE;
+        }
+        w += t[F4_DIGITS];
+        t[F4_DIGITS - 1] = (sp_int_digit)w;
+        t[F4_DIGITS] = t[F4_DIGITS + 1] + (sp_int_digit)(w >> SP_WORD_SIZE);
+    }
+
+    /* t < 2n, subtract n once when t >= n */
+    j = (t[F4_DIGITS] != 0);
+    for (i = F4_DIGITS - 1; !j && i >= 0; i--) {
+        if (t[i] != n[i]) {
+            j = t[i] > n[i];
+            break;
+        }
+        if (i == 0)
+            j = 1;
+    }
+    if (j) {
+        m = 0;
+        for (i = 0; i < F4_DIGITS; i++) {
+            w = (sp_int_word)t[i] - n[i] - m;
+            r[i] = (sp_int_digit)w;
+            m = (sp_int_digit)(w >> SP_WORD_SIZE) & 1;
+        }
+    }
+    else {
+        XMEMCPY(r, t, F4_DIGITS * sizeof(sp_int_digit));
+    }
+}
+
+/* RSA public key operation with e = 65537: out = in^65537 mod n.
+ *
+ * in    [in]   Big-endian signature of F4_SZ bytes.
+ * inSz  [in]   Size of the signature in bytes.
+ * out   [out]  Buffer of F4_SZ bytes for the big-endian result.
+ * Returns 0 on success, BAD_FUNC_ARG when the size is wrong and
+ * RSA_OUT_OF_RANGE_E when the signature is not less than n.
+ */
+static int rsa_public_f4(const unsigned char* in, word32 inSz,
+                         unsigned char* out)
+{
+    sp_int_digit s[F4_DIGITS];
+    sp_int_digit r[F4_DIGITS];
+    int i, j, lt = 0;
+
+    if (inSz != F4_SZ)
+        return BAD_FUNC_ARG;
+
+    /* big-endian bytes to little-endian digits */
+    for (i = 0; i < F4_DIGITS; i++) {
+        s[i] = 0;
+        for (j = 0; j < SP_WORD_SIZE / 8; j++) {
+            s[i] |= (sp_int_digit)in[F4_SZ - 1 - i * (SP_WORD_SIZE / 8) - j]
+                    << (8 * j);
+        }
+    }
+    for (i = F4_DIGITS - 1; i >= 0; i--) {
+        if (s[i] != public_key_2048_n_limbs[i]) {
+            lt = s[i] < public_key_2048_n_limbs[i];
+            break;
+        }
+    }
+    if (!lt)
+        return RSA_OUT_OF_RANGE_E;
+
+    /* r = s * R mod n, then 16 squarings: r = s^65536 * R mod n */
+    f4_mont_mul(r, s, public_key_2048_rr_limbs);
+    for (i = 0; i < 16; i++)
+        f4_mont_mul(r, r, r);
+    /* multiplying by s out of Montgomery form leaves s^65537 mod n */
+    f4_mont_mul(r, r, s);
+
+    for (i = 0; i < F4_DIGITS; i++) {
+        for (j = 0; j < SP_WORD_SIZE / 8; j++) {
+            out[F4_SZ - 1 - i * (SP_WORD_SIZE / 8) - j] =
+                (unsigned char)(r[i] >> (8 * j));
+        }
+    }
+
+    return 0;
+}
+
+/* Verify a PKCS #1 v1.5 signature with rsa_public_f4().
+ *
+ * sig     [in]  Signature of F4_SZ bytes.
+ * sigSz   [in]  Size of the signature in bytes.
+ * enc     [in]  Expected DigestInfo encoding of the hash.
+ * encSz   [in]  Size of the encoding in bytes.
+ * Returns 0 when the signature verifies and a negative value otherwise.
+ */
+static int rsa_verify_f4(const unsigned char* sig, word32 sigSz,
+                         const unsigned char* enc, word32 encSz)
+{
+    unsigned char em[F4_SZ];
+    word32 i;
+    int ret;
+
+    if (encSz > F4_SZ - 11)
+        return BAD_FUNC_ARG;
+
+    ret = rsa_public_f4(sig, sigSz, em);
+    if (ret != 0)
+        return ret;
+
+    /* 0x00 0x01 0xFF..0xFF 0x00 DigestInfo */
+    if (em[0] != 0x00 || em[1] != 0x01 || em[F4_SZ - encSz - 1] != 0x00)
+        return SIG_VERIFY_E;
+    for (i = 2; i < F4_SZ - encSz - 1; i++) {
+        if (em[i] != 0xFF)
+            return SIG_VERIFY_E;
+    }
+    if (XMEMCMP(em + F4_SZ - encSz, enc, encSz) != 0)
+        return SIG_VERIFY_E;
+
+    return 0;
+}
+
+#endif /* RSA_VFY_LIMBS_H */
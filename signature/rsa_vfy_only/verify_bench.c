@@ -0,0 +1,251 @@
+/* verify_bench.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Cost of loading the public key at run time (verify.c) against copying in
+ * digits generated at build time (verify_limbs.c), and of the wolfCrypt
+ * public key operation against rsa_public_f4(), fixed to e = 65537.
+ *
+ * Both ways of loading are timed for the key set up alone, and all three
+ * for a whole verify (hash, key set up, public key operation and compare).
+ * The e = 65537 path has no key set up, its constants are generated at
+ * build time. Times are in CPU
+ * cycles where a cycle counter is readable from user space, otherwise in
+ * nanoseconds. RAM used by the key and the constant data are printed; run
+ * "make size" for the code size of verify and verify_limbs.
+ *
+ * ./verify_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+#if !defined(WOLFSSL_SP_MATH) && !defined(WOLFSSL_SP_MATH_ALL)
+    #error Pre-decoded limbs need sp_int: configure with --enable-sp-math
+#endif
+
+#include "rsa_vfy_data.h"
+#include "rsa_pub_2048_limbs.h"
+#include "rsa_vfy_limbs.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+/* ASN.1 encoding of digest algorithm before hash */
+#define ENC_ALG_SZ     19
+
+#define DEF_ITERATIONS 10000
+
+enum {
+    LOAD_DECODE,
+    LOAD_LIMBS,
+    LOAD_F4
+};
+
+static const char* loadName[] = { "decode at run time", "build time limbs",
+                                  "limbs, e=65537 path" };
+
+#if defined(__x86_64__) || defined(__i386__)
+static const char* unitName = "cycles";
+
+static word64 cycles(void)
+{
+    return (word64)__rdtsc();
+}
+#elif defined(__aarch64__)
+static const char* unitName = "timer ticks";
+
+static word64 cycles(void)
+{
+    word64 t;
+
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (t));
+    return t;
+}
+#else
+static const char* unitName = "ns";
+
+static word64 cycles(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (word64)ts.tv_sec * 1000000000 + (word64)ts.tv_nsec;
+}
+#endif
+
+static int cmp_word64(const void* a, const void* b)
+{
+    word64 x = *(const word64*)a, y = *(const word64*)b;
+    return (x > y) - (x < y);
+}
+
+/* Load the public key into an initialized RSA key */
+static int load_key(RsaKey* key, int how)
+{
+    int ret = 0;
+
+    if (how == LOAD_DECODE) {
+        ret = mp_read_unsigned_bin(&key->n, public_key_2048_n,
+                                   sizeof(public_key_2048_n));
+        if (ret == 0)
+            ret = mp_set_int(&key->e, public_key_2048_e);
+    }
+    else {
+        set_key_limbs(key);
+    }
+
+    return ret;
+}
+
+static int key_setup(int how)
+{
+    int ret;
+    RsaKey rsaKey;
+
+    ret = wc_InitRsaKey(&rsaKey, NULL);
+    if (ret == 0) {
+        ret = load_key(&rsaKey, how);
+        wc_FreeRsaKey(&rsaKey);
+    }
+
+    return ret;
+}
+
+/* The same steps as verify.c and verify_limbs.c */
+static int verify(int how)
+{
+    int            ret;
+    Sha256         sha256;
+    RsaKey         rsaKey;
+    unsigned char  sig[sizeof(rsa_sig_2048)];
+    unsigned char* decSig = NULL;
+    int            decSigLen;
+    unsigned char  encSig[ENC_ALG_SZ + WC_SHA256_DIGEST_SIZE] = {
+        0x30, 0x31, 0x30, 0x0D, 0x06, 0x09, 0x60, 0x86,
+        0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05,
+        0x00, 0x04, 0x20, 0x00,
+    };
+
+    /* verifying in place overwrites the signature */
+    XMEMCPY(sig, rsa_sig_2048, sizeof(sig));
+
+    ret = wc_InitSha256(&sha256);
+    if (ret == 0) {
+        ret = wc_Sha256Update(&sha256, msg, sizeof(msg));
+        if (ret == 0)
+            ret = wc_Sha256Final(&sha256, encSig + ENC_ALG_SZ);
+        wc_Sha256Free(&sha256);
+    }
+
+    /* fixed exponent path, no RsaKey */
+    if (ret == 0 && how == LOAD_F4)
+        return rsa_verify_f4(rsa_sig_2048, sizeof(rsa_sig_2048), encSig,
+                             sizeof(encSig));
+
+    if (ret == 0)
+        ret = wc_InitRsaKey(&rsaKey, NULL);
+    if (ret == 0) {
+        ret = load_key(&rsaKey, how);
+        if (ret == 0) {
+            decSigLen = wc_RsaSSL_VerifyInline(sig, sizeof(sig), &decSig,
+                                               &rsaKey);
+            if (decSigLen < 0)
+                ret = decSigLen;
+            else if (decSigLen != (int)sizeof(encSig) ||
+                     XMEMCMP(encSig, decSig, decSigLen) != 0)
+                ret = -1;
+        }
+        wc_FreeRsaKey(&rsaKey);
+    }
+
+    return ret;
+}
+
+/* Time iterations of the function, report the median and minimum */
+static int time_it(const char* what, int (*fn)(int), int how, word64* t,
+                   int iterations)
+{
+    int ret = 0, i;
+    word64 start;
+
+    for (i = 0; i < iterations && ret == 0; i++) {
+        start = cycles();
+        ret = fn(how);
+        t[i] = cycles() - start;
+    }
+    if (ret != 0) {
+        printf("%s (%s) failed: %d\n", what, loadName[how], ret);
+        return ret;
+    }
+
+    qsort(t, iterations, sizeof(word64), cmp_word64);
+    printf("%-10s %-20s %12llu %12llu\n", what, loadName[how],
+           (unsigned long long)t[iterations / 2],
+           (unsigned long long)t[0]);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    int iterations = DEF_ITERATIONS;
+    word64* t;
+
+    if (argc > 1)
+        iterations = atoi(argv[1]);
+    if (iterations <= 0) {
+        printf("Usage: verify_bench [iterations]\n");
+        return 1;
+    }
+
+    t = (word64*)malloc(sizeof(word64) * iterations);
+    if (t == NULL)
+        return 1;
+
+    printf("RAM: RsaKey %u bytes, Sha256 %u bytes (stack)\n",
+           (unsigned)sizeof(RsaKey), (unsigned)sizeof(Sha256));
+    printf("Constant data: modulus bytes %u, modulus limbs %u\n\n",
+           (unsigned)sizeof(public_key_2048_n),
+           (unsigned)sizeof(public_key_2048_n_limbs));
+
+    printf("%d iterations, in %s\n", iterations, unitName);
+    printf("%-10s %-20s %12s %12s\n", "step", "key", "median", "min");
+    if (ret == 0)
+        ret = time_it("key setup", key_setup, LOAD_DECODE, t, iterations);
+    if (ret == 0)
+        ret = time_it("key setup", key_setup, LOAD_LIMBS, t, iterations);
+    if (ret == 0)
+        ret = time_it("verify", verify, LOAD_DECODE, t, iterations);
+    if (ret == 0)
+        ret = time_it("verify", verify, LOAD_LIMBS, t, iterations);
+    if (ret == 0)
+        ret = time_it("verify", verify, LOAD_F4, t, iterations);
+
+    free(t);
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/* verify_limbs.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL.
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Verify-only RSA with the public key compiled in as big integer digits.
+ *
+ * verify.c converts the modulus from bytes with mp_read_unsigned_bin() at
+ * run time. Here gen_limbs, run at build time, emits the modulus as sp_int
+ * digits (rsa_pub_2048_limbs.h) and the key is filled in with a copy.
+ * The signature is verified twice: with wolfCrypt, using the key filled in
+ * from the digits, and with rsa_public_f4() from rsa_vfy_limbs.h, which is
+ * fixed to e = 65537 and does 16 squarings and one multiplication with
+ * Montgomery constants also generated at build time.
+ *
+ * Needs the sp_int math library, as configured in the README. See
+ * verify_bench.c for the cost of each way.
+ */
+
+#include <stdio.h>
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/settings.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+#if !defined(WOLFSSL_SP_MATH) && !defined(WOLFSSL_SP_MATH_ALL)
+    #error Pre-decoded limbs need sp_int: configure with --enable-sp-math
+#endif
+
+#include "rsa_vfy_data.h"
+#include "rsa_pub_2048_limbs.h"
+#include "rsa_vfy_limbs.h"
+
+/* ASN.1 encoding of digest algorithm before hash */
+#define ENC_ALG_SZ     19
+
+/* Main entry point.
+ * Verifies the signature with the message and RSA public key.
+ *
+ * argc  [in]  Count of command line arguments.
+ * argv  [in]  Command line argument vector.
+ * Returns 0 on success and 1 otherwise.
+ */
+int main(int argc, char* argv[])
+{
+    int            ret = 0;
+    Sha256         sha256;
+    Sha256*        pSha256 = NULL;
+    RsaKey         rsaKey;
+    RsaKey*        pRsaKey = NULL;
+    unsigned char  sig[sizeof(rsa_sig_2048)];
+    unsigned char* decSig = NULL;
+    word32         decSigLen = 0;
+    unsigned char  encSig[ENC_ALG_SZ + WC_SHA256_DIGEST_SIZE] = {
+        0x30, 0x31, 0x30, 0x0D, 0x06, 0x09, 0x60, 0x86,
+        0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05,
+        0x00, 0x04, 0x20, 0x00,
+    };
+
+    /* Calculate SHA-256 digest of message */
+    if (ret == 0)
+        ret = wc_InitSha256(&sha256);
+    if (ret == 0) {
+        pSha256 = &sha256;
+        ret = wc_Sha256Update(&sha256, msg, sizeof(msg));
+    }
+    if (ret == 0)
+        ret = wc_Sha256Final(&sha256, encSig + ENC_ALG_SZ);
+
+    /* Initialize the RSA key and copy in the public key. */
+    if (ret == 0)
+        ret = wc_InitRsaKey(&rsaKey, NULL);
+    if (ret == 0) {
+        pRsaKey = &rsaKey;
+        set_key_limbs(&rsaKey);
+    }
+
+    /* Verify the signature by decrypting the value, in place in a copy. */
+    if (ret == 0) {
+        XMEMCPY(sig, rsa_sig_2048, sizeof(sig));
+        decSigLen = wc_RsaSSL_VerifyInline(sig, sizeof(sig), &decSig,
+                                           &rsaKey);
+        if ((int)decSigLen < 0)
+            ret = (int)decSigLen;
+    }
+
+    /* Check the decrypted result matches the encoded digest. */
+    if (ret == 0 && decSigLen != sizeof(encSig))
+        ret = -1;
+    if (ret == 0 && XMEMCMP(encSig, decSig, decSigLen) != 0)
+        ret = -1;
+
+    /* Verify again with the operation fixed to e = 65537. */
+    if (ret == 0)
+        ret = rsa_verify_f4(rsa_sig_2048, sizeof(rsa_sig_2048), encSig,
+                            sizeof(encSig));
+
+    /* Free the data structures */
+    if (pRsaKey != NULL)
+        wc_FreeRsaKey(pRsaKey);
+    if (pSha256 != NULL)
+        wc_Sha256Free(pSha256);
+
+    return ret == 0 ? 0 : 1;
+}
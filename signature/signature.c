@@ -26,14 +26,22 @@
 #include <wolfssl/wolfcrypt/rsa.h>
 #include <wolfssl/wolfcrypt/signature.h>
 #include <wolfssl/wolfcrypt/hash.h>
+#include <wolfssl/wolfcrypt/asn.h>
 #include <wolfssl/wolfcrypt/logging.h>
 #include <wolfssl/wolfcrypt/error-crypt.h>
 
 #include <stdio.h>
+#include <time.h>
 
 #define RSA_KEY_SIZE    2048
 #define DER_FILE_BUFFER 2048 /* max DER size */
 
+/* Streaming mode */
+#define STREAM_CHUNK_SZ (1024 * 1024) /* read and hashed at a time */
+#define BENCH_SECS      1.0           /* time spent signing / verifying */
+#define SIG_TYPE_RSA_PSS 4            /* not a wc_SignatureType */
+#define MAX_SIG_SZ      512
+
 void hexdump(const void *buffer, word32 len, byte cols)
 {
    word32 i;
@@ -390,14 +398,320 @@ exit:
     return ret;
 }
 
+static double current_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+/* Hash the file a chunk at a time, so memory use doesn't depend on its size */
+static int stream_hash_file(const char* filename, enum wc_HashType hash_type,
+    byte* digest, word32* digestSz)
+{
+    int ret;
+    FILE* file;
+    byte* chunk;
+    size_t len;
+    unsigned long long total = 0;
+    double start, secs;
+    wc_HashAlg hash;
+
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("File %s does not exist!\n", filename);
+        return EXIT_FAILURE;
+    }
+    chunk = malloc(STREAM_CHUNK_SZ);
+    if (chunk == NULL) {
+        printf("Chunk buffer malloc failed!\n");
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    start = current_time();
+    ret = wc_HashInit(&hash, hash_type);
+    if (ret == 0) {
+        while ((len = fread(chunk, 1, STREAM_CHUNK_SZ, file)) > 0) {
+            ret = wc_HashUpdate(&hash, hash_type, chunk, (word32)len);
+            if (ret != 0)
+                break;
+            total += len;
+        }
+        if (ret == 0 && ferror(file)) {
+            printf("Error reading file!\n");
+            ret = EXIT_FAILURE;
+        }
+        if (ret == 0)
+            ret = wc_HashFinal(&hash, hash_type, digest);
+        wc_HashFree(&hash, hash_type);
+    }
+    secs = current_time() - start;
+
+    if (ret == 0) {
+        *digestSz = (word32)wc_HashGetDigestSize(hash_type);
+        printf("Hashed %llu bytes in %.3f s: %.1f MB/s\n", total, secs,
+            (secs > 0) ? total / secs / (1024 * 1024) : 0);
+        printf("Digest:\n");
+        hexdump(digest, *digestSz, 16);
+    }
+    else {
+        printf("Hashing file failed! %d\n", ret);
+    }
+
+    free(chunk);
+    fclose(file);
+    return ret;
+}
+
+#if !defined(NO_RSA) && defined(WC_RSA_PSS)
+static int hash_to_mgf(enum wc_HashType hash_type)
+{
+    switch (hash_type) {
+        case WC_HASH_TYPE_SHA:
+            return WC_MGF1SHA1;
+        case WC_HASH_TYPE_SHA224:
+            return WC_MGF1SHA224;
+        case WC_HASH_TYPE_SHA256:
+            return WC_MGF1SHA256;
+        case WC_HASH_TYPE_SHA384:
+            return WC_MGF1SHA384;
+        case WC_HASH_TYPE_SHA512:
+            return WC_MGF1SHA512;
+        default:
+            return WC_MGF1NONE;
+    }
+}
+#endif
+
+/* Sign the digest. The signature types of wc_SignatureGenerateHash() and
+ * RSA-PSS are supported. */
+static int sign_digest(enum wc_HashType hash_type, int sig_type,
+    const byte* digest, word32 digestSz, byte* sig, word32* sigLen,
+    void* key, word32 keyLen, WC_RNG* rng)
+{
+    int ret;
+
+#if !defined(NO_RSA) && defined(WC_RSA_PSS)
+    if (sig_type == SIG_TYPE_RSA_PSS) {
+        ret = wc_RsaPSS_Sign(digest, digestSz, sig, *sigLen, hash_type,
+            hash_to_mgf(hash_type), (RsaKey*)key, rng);
+        if (ret > 0) {
+            *sigLen = (word32)ret;
+            ret = 0;
+        }
+        return ret;
+    }
+#endif
+    ret = wc_SignatureGenerateHash(hash_type,
+        (enum wc_SignatureType)sig_type, digest, digestSz, sig, sigLen, key,
+        keyLen, rng);
+
+    return ret;
+}
+
+static int verify_digest(enum wc_HashType hash_type, int sig_type,
+    const byte* digest, word32 digestSz, const byte* sig, word32 sigLen,
+    void* key, word32 keyLen)
+{
+    int ret;
+
+#if !defined(NO_RSA) && defined(WC_RSA_PSS)
+    if (sig_type == SIG_TYPE_RSA_PSS) {
+        byte tmp[MAX_SIG_SZ];
+        byte* out = NULL;
+
+        if (sigLen > sizeof(tmp))
+            return BUFFER_E;
+        /* verified in place */
+        XMEMCPY(tmp, sig, sigLen);
+        ret = wc_RsaPSS_VerifyInline(tmp, sigLen, &out, hash_type,
+            hash_to_mgf(hash_type), (RsaKey*)key);
+        if (ret > 0) {
+            ret = wc_RsaPSS_CheckPadding(digest, digestSz, out, (word32)ret,
+                hash_type);
+        }
+        return ret;
+    }
+#endif
+    ret = wc_SignatureVerifyHash(hash_type,
+        (enum wc_SignatureType)sig_type, digest, digestSz, sig, sigLen, key,
+        keyLen);
+
+    return ret;
+}
+
+/* Hash the file in chunks, then sign and verify the digest. Signing and
+ * verifying are repeated for BENCH_SECS to report operations per second. */
+static int stream_sign_verify_test(const char* filename,
+    enum wc_HashType hash_type, int sig_type, byte* verifyFileBuf,
+    int verifyFileLen)
+{
+    int ret;
+    int count;
+    byte digest[WC_MAX_DIGEST_SIZE];
+    word32 digestSz = 0;
+#if !defined(NO_RSA) && !defined(NO_ASN)
+    byte encDigest[WC_MAX_DIGEST_SIZE + MAX_ENC_ALG_SZ];
+#endif
+    const byte* msg = digest;
+    word32 msgSz;
+    byte sigBuf[MAX_SIG_SZ];
+    word32 sigLen = 0;
+    void* key = NULL;
+    word32 keyLen = 0;
+    double start, secs;
+    WC_RNG rng;
+#ifdef HAVE_ECC
+    ecc_key eccKey;
+#endif
+#ifndef NO_RSA
+    RsaKey rsaKey;
+#endif
+
+    ret = stream_hash_file(filename, hash_type, digest, &digestSz);
+    if (ret != 0)
+        return EXIT_FAILURE;
+
+    ret = wc_InitRng(&rng);
+    if (ret != 0) {
+        printf("Init RNG failed! %d\n", ret);
+        return EXIT_FAILURE;
+    }
+
+    /* Generate or load the key */
+    switch (sig_type) {
+#ifdef HAVE_ECC
+    case WC_SIGNATURE_TYPE_ECC:
+        ret = wc_ecc_init(&eccKey);
+        if (ret == 0) {
+            key = &eccKey;
+            keyLen = sizeof(eccKey);
+            ret = wc_ecc_make_key_ex(&rng, 32, &eccKey, ECC_CURVE_DEF);
+        }
+        break;
+#endif
+#ifndef NO_RSA
+    #ifndef NO_ASN
+    case WC_SIGNATURE_TYPE_RSA_W_ENC:
+    #endif
+    case WC_SIGNATURE_TYPE_RSA:
+    #ifdef WC_RSA_PSS
+    case SIG_TYPE_RSA_PSS:
+    #endif
+        ret = wc_InitRsaKey(&rsaKey, NULL);
+        if (ret == 0) {
+            key = &rsaKey;
+            keyLen = sizeof(rsaKey);
+        #ifdef WOLFSSL_KEY_GEN
+            ret = wc_MakeRsaKey(&rsaKey, RSA_KEY_SIZE, 65537, &rng);
+        #else
+            ret = rsa_load_der_file("../certs/client-key.der", &rsaKey);
+        #endif
+        }
+        break;
+#endif
+    default:
+        printf("Signature type %d, not supported!\n", sig_type);
+        ret = EXIT_FAILURE;
+    }
+    if (ret != 0) {
+        printf("Key setup failed! %d\n", ret);
+        ret = EXIT_FAILURE;
+        goto exit;
+    }
+
+    /* The *Hash() APIs take the DigestInfo already encoded for RSA_W_ENC */
+    msgSz = digestSz;
+#if !defined(NO_RSA) && !defined(NO_ASN)
+    if (sig_type == WC_SIGNATURE_TYPE_RSA_W_ENC) {
+        ret = wc_HashGetOID(hash_type);
+        if (ret > 0) {
+            msgSz = wc_EncodeSignature(encDigest, digest, digestSz, ret);
+            msg = encDigest;
+            ret = 0;
+        }
+        if (ret != 0 || msgSz == 0) {
+            printf("Encoding digest failed! %d\n", ret);
+            ret = EXIT_FAILURE;
+            goto exit;
+        }
+    }
+#endif
+
+    if (verifyFileBuf) {
+        if (verifyFileLen > (int)sizeof(sigBuf)) {
+            printf("Signature file too big!\n");
+            ret = EXIT_FAILURE;
+            goto exit;
+        }
+        XMEMCPY(sigBuf, verifyFileBuf, verifyFileLen);
+        sigLen = (word32)verifyFileLen;
+    }
+    else {
+        count = 0;
+        start = current_time();
+        do {
+            sigLen = sizeof(sigBuf);
+            ret = sign_digest(hash_type, sig_type, msg, msgSz, sigBuf,
+                &sigLen, key, keyLen, &rng);
+            count++;
+            secs = current_time() - start;
+        } while (ret == 0 && secs < BENCH_SECS);
+        printf("Signature Generation: %s (%d)\n",
+            (ret == 0) ? "Pass" : "Fail", ret);
+        if (ret != 0) {
+            ret = EXIT_FAILURE;
+            goto exit;
+        }
+        printf("Sign: %d ops in %.3f s: %.1f ops/s\n", count, secs,
+            count / secs);
+    }
+
+    printf("Signature Data: Len %d\n", sigLen);
+    hexdump(sigBuf, sigLen, 16);
+
+    count = 0;
+    start = current_time();
+    do {
+        ret = verify_digest(hash_type, sig_type, msg, msgSz, sigBuf,
+            sigLen, key, keyLen);
+        count++;
+        secs = current_time() - start;
+    } while (ret == 0 && secs < BENCH_SECS);
+    printf("Signature Verification: %s (%d)\n",
+        (ret == 0) ? "Pass" : "Fail", ret);
+    if (ret != 0) {
+        ret = EXIT_FAILURE;
+        goto exit;
+    }
+    printf("Verify: %d ops in %.3f s: %.1f ops/s\n", count, secs,
+        count / secs);
+
+exit:
+#ifdef HAVE_ECC
+    if (key == &eccKey)
+        wc_ecc_free(&eccKey);
+#endif
+#ifndef NO_RSA
+    if (key == &rsaKey)
+        wc_FreeRsaKey(&rsaKey);
+#endif
+    wc_FreeRng(&rng);
+
+    return ret;
+}
+
 int main(int argc, char** argv)
 {
     int ret = 0;
     int fileLen;
     byte* fileBuf = NULL;
-    int verifyFileLen;
+    int verifyFileLen = 0;
     byte* verifyFileBuf = NULL;
     const char* verify_file = NULL;
+    int stream = 0;
     enum wc_SignatureType sig_type = WC_SIGNATURE_TYPE_NONE;
     enum wc_HashType hash_type = WC_HASH_TYPE_NONE;
 
@@ -422,9 +736,15 @@ int main(int argc, char** argv)
 #endif
 
     /* Check arguments */
+    if (argc >= 2 && XSTRCMP(argv[1], "-stream") == 0) {
+        stream = 1;
+        argc--;
+        argv++;
+    }
     if (argc < 2) {
-        printf("Usage: signature <filename> <sig> <hash> <verifyfile> \n");
-        printf("  <sig>: 1=ECC, 2=RSA, 3=RSA (w/DER Encoding): default %d\n", sig_type);
+        printf("Usage: signature [-stream] <filename> <sig> <hash> <verifyfile> \n");
+        printf("  -stream: hash the file in chunks then sign the digest\n");
+        printf("  <sig>: 1=ECC, 2=RSA, 3=RSA (w/DER Encoding), 4=RSA-PSS (-stream only): default %d\n", sig_type);
         printf("  <hash>: 1=MD2, 2=MD4, 3=MD5, 4=SHA, 5=SHA224, 6=SHA256, 7=SHA384, 8=SHA512, 9=MD5+SHA: default %d\n", hash_type);
         printf("  <verifyfile>: optional sig verify binary file\n");
         return 1;
@@ -447,6 +767,20 @@ int main(int argc, char** argv)
 
     printf("Signature Example: Sig=%d, Hash=%d\n", sig_type, hash_type);
 
+    if (stream) {
+        /* Load verify signature file (optional) */
+        if (verify_file) {
+            ret = load_file_to_buffer(verify_file, &verifyFileBuf,
+                &verifyFileLen);
+            if (ret < 0) {
+                goto exit;
+            }
+        }
+        ret = stream_sign_verify_test(argv[1], hash_type, sig_type,
+            verifyFileBuf, verifyFileLen);
+        goto exit;
+    }
+
     /* Load input file */
     ret = load_file_to_buffer(argv[1], &fileBuf, &fileLen);
     if (ret < 0) {
@@ -489,6 +823,9 @@ exit:
     if(fileBuf) {
         free(fileBuf);
     }
+    if(verifyFileBuf) {
+        free(verifyFileBuf);
+    }
 
     return ret;
 }
@@ -29,8 +29,12 @@
 #include <wolfssl/wolfcrypt/error-crypt.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
-/* utility to perform loop on each curve to determine max signature size */
+/* number of operations timed for each curve and step */
 #ifndef ECC_LOOP_COUNT
 #define ECC_LOOP_COUNT 1000
 #endif
@@ -59,32 +63,138 @@ static void hexdump(const void *buffer, word32 len, byte cols)
 #endif
 
 #ifdef HAVE_ECC
-int ecc_sign_verify_test(enum wc_HashType hash_type,
-    enum wc_SignatureType sig_type, const byte* fileBuf, int fileLen,
-    byte* verifyFileBuf, int* verifyFileLen, int* pmaxSigSz, int* pmaxCurveSigSz,
-    int curveId, int keySz)
+/* curves reported by default, any not compiled in are skipped */
+static const int benchCurves[] = {
+    ECC_SECP256R1,
+    ECC_SECP384R1,
+    ECC_SECP521R1,
+#ifdef HAVE_ECC_BRAINPOOL
+    ECC_BRAINPOOLP256R1,
+    ECC_BRAINPOOLP384R1,
+    ECC_BRAINPOOLP512R1,
+#endif
+#ifdef WOLFSSL_SM2
+    ECC_SM2P256V1,
+#endif
+};
+
+typedef struct CurveResult {
+    int    curveId;
+    int    keySz;
+    double keyGenOps;   /* operations per second, 0 when not run */
+    double signOps;
+    double verifyOps;
+    double ecdhOps;
+    int    curveMaxSig; /* wc_ecc_sig_size() */
+    int    calcMaxSig;  /* wc_ecc_sig_size_calc() */
+    int    sigHist[ECC_MAX_SIG_SIZE + 1]; /* count of each DER length seen */
+} CurveResult;
+
+static double current_time(void)
 {
-    int ret;
-    ecc_key eccKey;
-    WC_RNG rng;
-    byte* sigBuf = NULL;
-    word32 sigLen;
-    byte eccPubKeyBuf[ECC_BUFSIZE], eccPrivKeyBuf[ECC_BUFSIZE];
-    word32 eccPubKeyLen, eccPrivKeyLen;
-    word32 maxCurveSigSz;
+    struct timespec ts;
 
-#ifdef DEBUG_SIG_TEST
-    printf("ECC Signature: Curve %s, Size %d\n", wc_ecc_get_name(curveId), keySz);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+static int is_sm2(int curveId)
+{
+#ifdef WOLFSSL_SM2
+    return curveId == ECC_SM2P256V1;
+#else
+    (void)curveId;
+    return 0;
+#endif
+}
+
+/* SM2 keys have their own make/sign/verify/shared secret calls, the hash
+ * signed here is the plain digest rather than H(ZA || M) since only the
+ * cost of the curve operation is of interest */
+static int bench_make_key(WC_RNG* rng, ecc_key* key, int keySz, int curveId)
+{
+#ifdef WOLFSSL_SM2
+    if (is_sm2(curveId))
+        return wc_ecc_sm2_make_key(rng, key, WC_ECC_FLAG_NONE);
+#endif
+    return wc_ecc_make_key_ex(rng, keySz, key, curveId);
+}
+
+static int bench_sign(const byte* hash, word32 hashSz, byte* sig,
+    word32* sigSz, WC_RNG* rng, ecc_key* key)
+{
+#ifdef WOLFSSL_SM2
+    if (is_sm2(key->dp->id))
+        return wc_ecc_sm2_sign_hash(hash, hashSz, sig, sigSz, rng, key);
+#endif
+    return wc_ecc_sign_hash(hash, hashSz, sig, sigSz, rng, key);
+}
+
+static int bench_verify(const byte* sig, word32 sigSz, const byte* hash,
+    word32 hashSz, int* res, ecc_key* key)
+{
+#ifdef WOLFSSL_SM2
+    if (is_sm2(key->dp->id))
+        return wc_ecc_sm2_verify_hash(sig, sigSz, hash, hashSz, res, key);
+#endif
+    return wc_ecc_verify_hash(sig, sigSz, hash, hashSz, res, key);
+}
+
+#ifdef HAVE_ECC_DHE
+static int bench_shared_secret(ecc_key* priv, ecc_key* pub, byte* out,
+    word32* outSz)
+{
+#ifdef WOLFSSL_SM2
+    if (is_sm2(priv->dp->id))
+        return wc_ecc_sm2_shared_secret(priv, pub, out, outSz);
+#endif
+    return wc_ecc_shared_secret(priv, pub, out, outSz);
+}
 #endif
 
-    /* Init */
-    wc_InitRng(&rng);
+static int bench_keygen(WC_RNG* rng, CurveResult* r, int loops)
+{
+    int ret = 0;
+    int i;
+    double start;
+    ecc_key key;
+
+    start = current_time();
+    for (i = 0; i < loops; i++) {
+        wc_ecc_init(&key);
+        ret = bench_make_key(rng, &key, r->keySz, r->curveId);
+        wc_ecc_free(&key);
+        if (ret != 0) {
+            printf("ECC Make Key Failed! %d\n", ret);
+            return ret;
+        }
+    }
+    r->keyGenOps = loops / (current_time() - start);
+
+    return ret;
+}
+
+/* sign the digest loops times recording each DER length, then verify every
+ * signature with a key holding only the imported public point */
+static int bench_sign_verify(WC_RNG* rng, CurveResult* r, const byte* hash,
+    word32 hashSz, int loops)
+{
+    int ret;
+    int i;
+    int verified = 0;
+    double start;
+    ecc_key eccKey;
+    ecc_key pubKey;
+    byte* sigBuf = NULL;
+    word32* sigLens = NULL;
+    byte eccPubKeyBuf[ECC_BUFSIZE];
+    word32 eccPubKeyLen = ECC_BUFSIZE;
 
-    /* Generate key */
     wc_ecc_init(&eccKey);
+    wc_ecc_init(&pubKey);
 
-    ret = wc_ecc_make_key_ex(&rng, keySz, &eccKey, curveId);
-    if(ret != 0) {
+    ret = bench_make_key(rng, &eccKey, r->keySz, r->curveId);
+    if (ret != 0) {
         printf("ECC Make Key Failed! %d\n", ret);
         goto exit;
     }
@@ -94,129 +204,200 @@ int ecc_sign_verify_test(enum wc_HashType hash_type,
         printf("ECC Sig SizeFailed! %d\n", ret);
         goto exit;
     }
-    maxCurveSigSz = ret;
+    r->curveMaxSig = ret;
+    r->calcMaxSig = wc_ecc_sig_size_calc(r->keySz);
 
-    /* Display public key data */
-    eccPubKeyLen = ECC_BUFSIZE;
     ret = wc_ecc_export_x963(&eccKey, eccPubKeyBuf, &eccPubKeyLen);
     if (ret != 0) {
         printf("ECC public key x963 export failed! %d\n", ret);
-        ret = EXIT_FAILURE;
         goto exit;
     }
-
 #ifdef DEBUG_SIG_TEST
     printf("ECC Public Key: Len %d\n", eccPubKeyLen);
     hexdump(eccPubKeyBuf, eccPubKeyLen, 16);
 #endif
 
-    /* Display private key data */
-    eccPrivKeyLen = ECC_BUFSIZE;
-    ret = wc_ecc_export_private_only(&eccKey, eccPrivKeyBuf, &eccPrivKeyLen);
+    ret = wc_ecc_import_x963_ex(eccPubKeyBuf, eccPubKeyLen, &pubKey,
+        r->curveId);
     if (ret != 0) {
-        printf("ECC private key export failed! %d\n", ret);
-        ret = EXIT_FAILURE;
+        printf("ECC public key import failed! %d\n", ret);
         goto exit;
     }
-#ifdef DEBUG_SIG_TEST
-    printf("ECC Private Key: Len %d\n", eccPrivKeyLen);
-    hexdump(eccPrivKeyBuf, eccPrivKeyLen, 16);
-#endif
 
-    if (verifyFileBuf) {
-        sigLen = *verifyFileLen;
-        sigBuf = verifyFileBuf;
+    sigBuf = malloc((size_t)loops * r->curveMaxSig);
+    sigLens = malloc((size_t)loops * sizeof(word32));
+    if (sigBuf == NULL || sigLens == NULL) {
+        printf("ECC Signature malloc failed!\n");
+        ret = MEMORY_E;
+        goto exit;
     }
-    else {
-        /* Get signature length and allocate buffer */
-        sigLen = wc_SignatureGetSize(sig_type, &eccKey, sizeof(eccKey));
-        if(sigLen <= 0) {
-            printf("ECC Signature type %d not supported!\n", sig_type);
-            ret = EXIT_FAILURE;
+
+    start = current_time();
+    for (i = 0; i < loops; i++) {
+        sigLens[i] = r->curveMaxSig;
+        ret = bench_sign(hash, hashSz, sigBuf + (size_t)i * r->curveMaxSig,
+            &sigLens[i], rng, &eccKey);
+        if (ret != 0) {
+            printf("ECC Sign Failed! %d\n", ret);
             goto exit;
         }
+    }
+    r->signOps = loops / (current_time() - start);
 
-        sigBuf = malloc(sigLen);
-        if(!sigBuf) {
-            printf("ECC Signature malloc failed!\n");
-            ret = EXIT_FAILURE;
-            goto exit;
+    for (i = 0; i < loops; i++) {
+        if (sigLens[i] <= ECC_MAX_SIG_SIZE)
+            r->sigHist[sigLens[i]]++;
+    #ifdef DEBUG_SIG_TEST_MAX
+        if ((int)sigLens[i] == r->curveMaxSig) {
+            printf("Curve %s: Max %d\n", wc_ecc_get_name(r->curveId),
+                sigLens[i]);
+            hexdump(sigBuf + (size_t)i * r->curveMaxSig, sigLens[i], 16);
         }
-    #ifdef DEBUG_SIG_TEST
-        printf("ECC Signature Len: %d\n", sigLen);
     #endif
+    }
 
-        /* Perform hash and sign to create signature */
-        ret = wc_SignatureGenerate(
-            hash_type, sig_type,
-            fileBuf, fileLen,
-            sigBuf, &sigLen,
-            &eccKey, sizeof(eccKey),
-            &rng);
-        *verifyFileLen = sigLen;
-    #ifdef DEBUG_SIG_TEST
-        printf("ECC Signature Generation: %s (%d)\n",
-            (ret == 0) ? "Pass" : "Fail", ret);
-    #endif
-        if(ret < 0) {
-            ret = EXIT_FAILURE;
+    start = current_time();
+    for (i = 0; i < loops; i++) {
+        int res = 0;
+        ret = bench_verify(sigBuf + (size_t)i * r->curveMaxSig, sigLens[i],
+            hash, hashSz, &res, &pubKey);
+        if (ret != 0) {
+            printf("ECC Verify Failed! %d\n", ret);
             goto exit;
         }
+        verified += res;
     }
+    r->verifyOps = loops / (current_time() - start);
 
-#ifdef DEBUG_SIG_TEST
-    printf("Signature Data:\n");
-    hexdump(sigBuf, sigLen, 16);
-#endif
+    if (verified != loops) {
+        printf("ECC Signature Verification: %d of %d failed\n",
+            loops - verified, loops);
+        ret = SIG_VERIFY_E;
+    }
 
-    /* Perform signature verification */
-    /* Release and init new key */
+exit:
+    free(sigLens);
+    free(sigBuf);
+    wc_ecc_free(&pubKey);
     wc_ecc_free(&eccKey);
-    wc_ecc_init(&eccKey);
 
-    /* Import the public key */
-    ret = wc_ecc_import_x963_ex(eccPubKeyBuf, eccPubKeyLen, &eccKey, curveId);
+    return ret;
+}
+
+#ifdef HAVE_ECC_DHE
+static int bench_ecdh(WC_RNG* rng, CurveResult* r, int loops)
+{
+    int ret;
+    int i;
+    double start;
+    ecc_key privKey;
+    ecc_key peerKey;
+    byte secret[MAX_ECC_BYTES];
+    word32 secretSz;
+
+    wc_ecc_init(&privKey);
+    wc_ecc_init(&peerKey);
+
+    ret = bench_make_key(rng, &privKey, r->keySz, r->curveId);
+    if (ret == 0)
+        ret = bench_make_key(rng, &peerKey, r->keySz, r->curveId);
     if (ret != 0) {
-        printf("ECC public key import failed! %d\n", ret);
-        ret = EXIT_FAILURE;
+        printf("ECC Make Key Failed! %d\n", ret);
         goto exit;
     }
+#if defined(ECC_TIMING_RESISTANT) && !defined(HAVE_FIPS)
+    /* blinding of the private key needs an RNG */
+    ret = wc_ecc_set_rng(&privKey, rng);
+    if (ret != 0)
+        goto exit;
+#endif
+
+    start = current_time();
+    for (i = 0; i < loops; i++) {
+        secretSz = sizeof(secret);
+        ret = bench_shared_secret(&privKey, &peerKey, secret, &secretSz);
+        if (ret != 0) {
+            printf("ECC Shared Secret Failed! %d\n", ret);
+            goto exit;
+        }
+    }
+    r->ecdhOps = loops / (current_time() - start);
+
+exit:
+    wc_ecc_free(&peerKey);
+    wc_ecc_free(&privKey);
+
+    return ret;
+}
+#endif /* HAVE_ECC_DHE */
+
+static int ecc_curve_bench(WC_RNG* rng, CurveResult* r, const byte* hash,
+    word32 hashSz, int loops)
+{
+    int ret;
 
-    /* Perform signature verification using public key */
-    ret = wc_SignatureVerify(
-        hash_type, sig_type,
-        fileBuf, fileLen,
-        sigBuf, sigLen,
-        &eccKey, sizeof(eccKey));
 #ifdef DEBUG_SIG_TEST
-    printf("ECC Signature Verification: %s (%d)\n",
-        (ret == 0) ? "Pass" : "Fail", ret);
+    printf("ECC Curve %s, Size %d\n", wc_ecc_get_name(r->curveId), r->keySz);
 #endif
-    if (ret < 0) {
-        ret = EXIT_FAILURE;
-    }
 
-    if (pmaxSigSz && *pmaxSigSz < sigLen) {
-    #ifdef DEBUG_SIG_TEST_MAX
-        printf("Curve: Max %d->%d\n", *pmaxSigSz, sigLen);
-        hexdump(sigBuf, sigLen, 16);
-    #endif
-        *pmaxSigSz = sigLen;
-    }
+    ret = bench_keygen(rng, r, loops);
+    if (ret == 0)
+        ret = bench_sign_verify(rng, r, hash, hashSz, loops);
+#ifdef HAVE_ECC_DHE
+    if (ret == 0)
+        ret = bench_ecdh(rng, r, loops);
+#endif
 
-    if (pmaxCurveSigSz && *pmaxCurveSigSz < maxCurveSigSz) {
-        *pmaxCurveSigSz = maxCurveSigSz;
-    }
+    return ret;
+}
 
-exit:
-    /* Free */
-    if(sigBuf) {
-        free(sigBuf);
+static void print_ops(double ops)
+{
+    if (ops > 0)
+        printf(" %9.1f", ops);
+    else
+        printf(" %9s", "-");
+}
+
+static void print_table_header(void)
+{
+    printf("\n%-16s %5s %9s %9s %9s %9s | %4s %6s %4s %8s %7s | %s\n",
+        "Curve", "KeySz", "keygen/s", "sign/s", "verify/s", "ecdh/s",
+        "Min", "Avg", "Max", "CurveMax", "CalcMax", "DER length: share");
+    printf("------------------------------------------------------------------"
+           "---------------------------------------------------------\n");
+}
+
+/* one row per curve: ops/s for each step, then the observed DER signature
+ * lengths against the curve max and calculated max, then the share of
+ * signatures at each observed length */
+static void print_table_row(const CurveResult* r, int loops)
+{
+    int len;
+    int minSz = 0, maxSz = 0;
+    long total = 0;
+
+    for (len = 0; len <= ECC_MAX_SIG_SIZE; len++) {
+        if (r->sigHist[len] == 0)
+            continue;
+        if (minSz == 0)
+            minSz = len;
+        maxSz = len;
+        total += (long)len * r->sigHist[len];
     }
-    wc_ecc_free(&eccKey);
-    wc_FreeRng(&rng);
 
-    return ret;
+    printf("%-16s %5d", wc_ecc_get_name(r->curveId), r->keySz);
+    print_ops(r->keyGenOps);
+    print_ops(r->signOps);
+    print_ops(r->verifyOps);
+    print_ops(r->ecdhOps);
+    printf(" | %4d %6.1f %4d %8d %7d |", minSz, (double)total / loops,
+        maxSz, r->curveMaxSig, r->calcMaxSig);
+    for (len = minSz; len <= maxSz && len > 0; len++) {
+        if (r->sigHist[len] > 0)
+            printf(" %d:%.1f%%", len, 100.0 * r->sigHist[len] / loops);
+    }
+    printf("\n");
 }
 #endif /* HAVE_ECC */
 
@@ -255,6 +436,7 @@ static int load_file_to_buffer(const char* filename, byte** fileBuf, int* fileLe
         ret = EXIT_FAILURE;
         goto exit;
     }
+    ret = 0;
 
 exit:
 
@@ -265,92 +447,127 @@ exit:
     return ret;
 }
 
+static void Usage(void)
+{
+    printf("Usage: eccsiglentest [-a] [-n loops] [filename]\n");
+    printf("    -a        sweep every curve from SECP192R1 to BRAINPOOLP512R1\n");
+    printf("    -n loops  operations timed per curve and step (default %d)\n",
+        ECC_LOOP_COUNT);
+    printf("    filename  file hashed for signing (default built-in message)\n");
+}
+
 int main(int argc, char** argv)
 {
     int ret = 0;
     int fileLen = 0;
-    int verifyFileLen = 0;
+    int ch;
+    int allCurves = 0;
+    int loops = ECC_LOOP_COUNT;
 
     byte* fileBuf = NULL;
-    byte* verifyFileBuf = NULL;
+    static const char defaultMsg[] = "eccsiglentest message to sign";
 
-    const char* verify_file = NULL;
-
-    enum wc_SignatureType sig_type = WC_SIGNATURE_TYPE_NONE;
-    enum wc_HashType hash_type = WC_HASH_TYPE_NONE;
-
-    sig_type = WC_SIGNATURE_TYPE_ECC;
-    hash_type = WC_HASH_TYPE_SHA256;
+    enum wc_HashType hash_type = WC_HASH_TYPE_SHA256;
+    byte hash[WC_MAX_DIGEST_SIZE];
+    int hashSz;
 
 #if 0
     wolfSSL_Debugging_ON();
 #endif
 
     /* Check arguments */
-    if (argc < 2) {
-        printf("Usage: eccsiglentest <filename>\n");
+    while ((ch = getopt(argc, argv, "?an:")) != -1) {
+        switch (ch) {
+            case 'a':
+                allCurves = 1;
+                break;
+            case 'n':
+                loops = atoi(optarg);
+                break;
+            case '?':
+            default:
+                Usage();
+                return 1;
+        }
+    }
+    if (loops <= 0) {
+        Usage();
         return 1;
     }
 
     /* Verify hash type is supported */
-    if (wc_HashGetDigestSize(hash_type) <= 0) {
+    hashSz = wc_HashGetDigestSize(hash_type);
+    if (hashSz <= 0) {
         printf("Hash type %d not supported!\n", hash_type);
         return 1;
     }
 
-    printf("Signature Length Test: Loops %d\n", ECC_LOOP_COUNT);
+    printf("ECC Curve Performance and Signature Length Test: Loops %d\n",
+        loops);
 
-    /* Load input file */
-    ret = load_file_to_buffer(argv[1], &fileBuf, &fileLen);
-    if (ret < 0) {
-        goto exit;
-    }
-
-    /* Load verify signature file (optional) */
-    if (verify_file) {
-        ret = load_file_to_buffer(verify_file, &verifyFileBuf, &verifyFileLen);
-        if (ret < 0) {
+    /* Load input file and hash it once, the curve operations are timed
+     * against the digest */
+    if (optind < argc) {
+        ret = load_file_to_buffer(argv[optind], &fileBuf, &fileLen);
+        if (ret != 0) {
             goto exit;
         }
+        ret = wc_Hash(hash_type, fileBuf, fileLen, hash, sizeof(hash));
+    }
+    else {
+        ret = wc_Hash(hash_type, (const byte*)defaultMsg,
+            (word32)strlen(defaultMsg), hash, sizeof(hash));
+    }
+    if (ret != 0) {
+        printf("Hash failed! %d\n", ret);
+        goto exit;
     }
 
-    /* Perform sign and verify */
-    switch(sig_type)
-    {
 #ifdef HAVE_ECC
-    case WC_SIGNATURE_TYPE_ECC:
     {
+        WC_RNG rng;
+        CurveResult r;
         int curveId;
-        int sigSz = verifyFileLen;
-    #if 1
-        for (curveId=ECC_SECP192R1; curveId<=ECC_BRAINPOOLP512R1; curveId++)
-    #else
-        curveId = ECC_SECP521R1;
+        int i;
+        int numCurves = allCurves ?
+            ECC_BRAINPOOLP512R1 - ECC_SECP192R1 + 1 :
+            (int)(sizeof(benchCurves) / sizeof(benchCurves[0]));
+
+        ret = wc_InitRng(&rng);
+        if (ret != 0) {
+            printf("RNG init failed! %d\n", ret);
+            goto exit;
+        }
+
+    #ifndef HAVE_ECC_DHE
+        printf("ECDH not compiled in, ecdh/s column skipped\n");
     #endif
-        {
-            int keySz = wc_ecc_get_curve_size_from_id(curveId);
-            if (keySz > 0) {
-                int maxSigSz = 0;
-                int maxCurveSigSz = 0;
-                int tries = ECC_LOOP_COUNT;
-                while (--tries > 0) {
-                    ret = ecc_sign_verify_test(hash_type, sig_type, fileBuf, fileLen,
-                        verifyFileBuf, &sigSz, &maxSigSz, &maxCurveSigSz, curveId, keySz);
-                }
-
-                /* print max */
-                printf("ECC Curve %s, KeySz %d, Sig: CurveMax %d, ActMax %d, CalcMax %d\n",
-                    wc_ecc_get_name(curveId), keySz, maxCurveSigSz, maxSigSz,
-                    wc_ecc_sig_size_calc(keySz));
+        print_table_header();
+        for (i = 0; i < numCurves; i++) {
+            curveId = allCurves ? ECC_SECP192R1 + i : benchCurves[i];
+
+            memset(&r, 0, sizeof(r));
+            r.curveId = curveId;
+            r.keySz = wc_ecc_get_curve_size_from_id(curveId);
+            if (r.keySz <= 0)
+                continue; /* not compiled in */
+
+            ret = ecc_curve_bench(&rng, &r, hash, hashSz, loops);
+            if (ret != 0) {
+                printf("ECC Curve %s failed! %d\n", wc_ecc_get_name(curveId),
+                    ret);
+                break;
             }
+            print_table_row(&r, loops);
+            fflush(stdout);
         }
+
+        wc_FreeRng(&rng);
     }
-        break;
+#else
+    ret = EXIT_FAILURE;
+    printf("ECC not compiled in!\n");
 #endif
-        default:
-            ret = EXIT_FAILURE;
-            printf("Signature type %d, not supported!\n", sig_type);
-    }
 
 exit:
     /* Free */
@@ -0,0 +1,98 @@
+/* interop.h
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Shared by interopsigtest.c and the two library backends. Kept free of
+ * wolfSSL and OpenSSL headers since both define names such as SHA256 and RSA,
+ * so each library is compiled in its own translation unit. */
+
+#ifndef SIGTEST_INTEROP_H
+#define SIGTEST_INTEROP_H
+
+#define IOP_MAX_SIG_SZ    512  /* RSA-4096 */
+#define IOP_MAX_DIGEST_SZ 64   /* SHA-512 */
+#define IOP_MAX_DER_SZ    2560
+
+/* signature schemes */
+enum {
+    IOP_RSA_PKCS1,
+    IOP_RSA_PSS,
+    IOP_ECDSA
+};
+
+/* hashes, PSS uses the same hash for MGF1 and a salt of the digest length */
+enum {
+    IOP_SHA1,
+    IOP_SHA256,
+    IOP_SHA384,
+    IOP_SHA512
+};
+
+/* key types and curves */
+enum {
+    IOP_KEY_RSA,
+    IOP_KEY_EC
+};
+enum {
+    IOP_P256,
+    IOP_P384,
+    IOP_P521
+};
+
+/* Key material is created once by OpenSSL and exchanged as DER: the private
+ * key in its traditional form (PKCS#1 / SEC1) and the public key as
+ * SubjectPublicKeyInfo. */
+typedef struct IopKey {
+    const char*   name;
+    int           type;    /* IOP_KEY_RSA or IOP_KEY_EC */
+    int           bits;    /* RSA modulus size */
+    int           curve;   /* IOP_P256 ... */
+    const char*   pem;     /* optional fixed private key, else generated */
+    unsigned char priv[IOP_MAX_DER_SZ];
+    int           privSz;
+    unsigned char pub[IOP_MAX_DER_SZ];
+    int           pubSz;
+} IopKey;
+
+/* One backend per library. A handle binds a key (private for signing, public
+ * for verifying) to a scheme and hash so per operation setup isn't timed.
+ * All functions return 0 on success, verify returns 0 only for a valid
+ * signature. */
+typedef struct IopLib {
+    const char* name;
+    int         (*init)(void);
+    void        (*cleanup)(void);
+    const char* (*version)(void);
+    int         (*digest)(int hash, const unsigned char* msg, int msgSz,
+                    unsigned char* out, int* outSz);
+    void*       (*open)(const IopKey* key, int priv, int sig, int hash);
+    void        (*close)(void* handle);
+    int         (*sign)(void* handle, const unsigned char* dgst, int dgstSz,
+                    unsigned char* sig, int* sigSz);
+    int         (*verify)(void* handle, const unsigned char* dgst, int dgstSz,
+                    const unsigned char* sig, int sigSz);
+} IopLib;
+
+extern const IopLib iop_wolfssl;
+extern const IopLib iop_openssl;
+
+int iop_openssl_make_key(IopKey* key);
+
+#endif /* SIGTEST_INTEROP_H */
@@ -0,0 +1,252 @@
+/* interop_ossl.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* OpenSSL backend for interopsigtest. Also creates the keys both libraries
+ * use. */
+
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/objects.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "interop.h"
+
+typedef struct OsslHandle {
+    EVP_PKEY*     pkey;
+    EVP_PKEY_CTX* ctx;
+} OsslHandle;
+
+static const EVP_MD* ossl_md(int hash)
+{
+    switch (hash) {
+        case IOP_SHA1:
+            return EVP_sha1();
+        case IOP_SHA256:
+            return EVP_sha256();
+        case IOP_SHA384:
+            return EVP_sha384();
+        case IOP_SHA512:
+            return EVP_sha512();
+        default:
+            return NULL;
+    }
+}
+
+static int ossl_curve_nid(int curve)
+{
+    switch (curve) {
+        case IOP_P256:
+            return NID_X9_62_prime256v1;
+        case IOP_P384:
+            return NID_secp384r1;
+        case IOP_P521:
+            return NID_secp521r1;
+        default:
+            return NID_undef;
+    }
+}
+
+static int ossl_init(void)
+{
+    return 0;
+}
+
+static void ossl_cleanup(void)
+{
+}
+
+static const char* ossl_version(void)
+{
+    return OpenSSL_version(OPENSSL_VERSION);
+}
+
+static int ossl_digest(int hash, const unsigned char* msg, int msgSz,
+    unsigned char* out, int* outSz)
+{
+    unsigned int len = 0;
+    const EVP_MD* md = ossl_md(hash);
+
+    if (md == NULL || EVP_Digest(msg, (size_t)msgSz, out, &len, md,
+            NULL) != 1) {
+        return -1;
+    }
+    *outSz = (int)len;
+    return 0;
+}
+
+static void ossl_close(void* handle)
+{
+    OsslHandle* h = (OsslHandle*)handle;
+
+    if (h == NULL)
+        return;
+    EVP_PKEY_CTX_free(h->ctx);
+    EVP_PKEY_free(h->pkey);
+    free(h);
+}
+
+static void* ossl_open(const IopKey* key, int priv, int sig, int hash)
+{
+    int ret;
+    const unsigned char* p;
+    const EVP_MD* md = ossl_md(hash);
+    OsslHandle* h;
+
+    h = (OsslHandle*)calloc(1, sizeof(OsslHandle));
+    if (h == NULL || md == NULL) {
+        free(h);
+        return NULL;
+    }
+
+    if (priv) {
+        p = key->priv;
+        h->pkey = d2i_AutoPrivateKey(NULL, &p, key->privSz);
+    }
+    else {
+        p = key->pub;
+        h->pkey = d2i_PUBKEY(NULL, &p, key->pubSz);
+    }
+    if (h->pkey != NULL)
+        h->ctx = EVP_PKEY_CTX_new(h->pkey, NULL);
+    ret = (h->ctx != NULL);
+
+    /* The context is configured once and reused for every operation */
+    if (ret == 1)
+        ret = priv ? EVP_PKEY_sign_init(h->ctx) : EVP_PKEY_verify_init(h->ctx);
+    if (ret == 1 && sig != IOP_ECDSA) {
+        ret = EVP_PKEY_CTX_set_rsa_padding(h->ctx,
+            (sig == IOP_RSA_PSS) ? RSA_PKCS1_PSS_PADDING : RSA_PKCS1_PADDING);
+    }
+    if (ret == 1)
+        ret = EVP_PKEY_CTX_set_signature_md(h->ctx, md);
+    if (ret == 1 && sig == IOP_RSA_PSS) {
+        ret = EVP_PKEY_CTX_set_rsa_pss_saltlen(h->ctx, RSA_PSS_SALTLEN_DIGEST);
+        if (ret == 1)
+            ret = EVP_PKEY_CTX_set_rsa_mgf1_md(h->ctx, md);
+    }
+
+    if (ret != 1) {
+        ERR_print_errors_fp(stderr);
+        ossl_close(h);
+        return NULL;
+    }
+    return h;
+}
+
+static int ossl_sign(void* handle, const unsigned char* dgst, int dgstSz,
+    unsigned char* sig, int* sigSz)
+{
+    OsslHandle* h = (OsslHandle*)handle;
+    size_t len = (size_t)*sigSz;
+
+    if (EVP_PKEY_sign(h->ctx, sig, &len, dgst, (size_t)dgstSz) != 1) {
+        ERR_clear_error();
+        return -1;
+    }
+    *sigSz = (int)len;
+    return 0;
+}
+
+static int ossl_verify(void* handle, const unsigned char* dgst, int dgstSz,
+    const unsigned char* sig, int sigSz)
+{
+    OsslHandle* h = (OsslHandle*)handle;
+
+    if (EVP_PKEY_verify(h->ctx, sig, (size_t)sigSz, dgst,
+            (size_t)dgstSz) != 1) {
+        /* expected for the tampered signatures, don't let errors queue up */
+        ERR_clear_error();
+        return -1;
+    }
+    return 0;
+}
+
+/* Load the fixed PEM key or generate one, then export it as DER */
+int iop_openssl_make_key(IopKey* key)
+{
+    int ret = -1;
+    int len;
+    unsigned char* p;
+    BIO* bio;
+    EVP_PKEY* pkey = NULL;
+    EVP_PKEY_CTX* ctx = NULL;
+
+    if (key->pem != NULL) {
+        bio = BIO_new_mem_buf((void*)key->pem, -1);
+        if (bio != NULL) {
+            pkey = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+            BIO_free(bio);
+        }
+    }
+    else {
+        ctx = EVP_PKEY_CTX_new_id((key->type == IOP_KEY_RSA) ? EVP_PKEY_RSA :
+            EVP_PKEY_EC, NULL);
+        if (ctx != NULL && EVP_PKEY_keygen_init(ctx) == 1) {
+            if (key->type == IOP_KEY_RSA)
+                ret = EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, key->bits);
+            else
+                ret = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx,
+                    ossl_curve_nid(key->curve));
+            if (ret == 1)
+                EVP_PKEY_keygen(ctx, &pkey);
+        }
+        EVP_PKEY_CTX_free(ctx);
+    }
+    if (pkey == NULL) {
+        ERR_print_errors_fp(stderr);
+        return -1;
+    }
+
+    ret = -1;
+    len = i2d_PrivateKey(pkey, NULL);
+    if (len > 0 && len <= (int)sizeof(key->priv)) {
+        p = key->priv;
+        key->privSz = i2d_PrivateKey(pkey, &p);
+        len = i2d_PUBKEY(pkey, NULL);
+        if (len > 0 && len <= (int)sizeof(key->pub)) {
+            p = key->pub;
+            key->pubSz = i2d_PUBKEY(pkey, &p);
+            ret = 0;
+        }
+    }
+    EVP_PKEY_free(pkey);
+
+    return ret;
+}
+
+const IopLib iop_openssl = {
+    "OpenSSL",
+    ossl_init,
+    ossl_cleanup,
+    ossl_version,
+    ossl_digest,
+    ossl_open,
+    ossl_close,
+    ossl_sign,
+    ossl_verify
+};
@@ -0,0 +1,293 @@
+/* interop_wolf.c
+ *
+ * Copyright (C) 2006-2020 wolfSSL Inc.
+ *
+ * This file is part of wolfSSL. (formerly known as CyaSSL)
+ *
+ * wolfSSL is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfSSL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* wolfSSL backend for interopsigtest */
+
+#include <wolfssl/options.h>
+
+#include <wolfssl/version.h>
+#include <wolfssl/wolfcrypt/hash.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/rsa.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/asn.h>
+#include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "interop.h"
+
+typedef struct WolfHandle {
+    int              sig;
+    enum wc_HashType hashType;
+    int              mgf;
+    int              oid;
+    int              keyInit;
+    RsaKey           rsa;
+#ifdef HAVE_ECC
+    ecc_key          ecc;
+#endif
+} WolfHandle;
+
+static WC_RNG rng;
+
+static int wolf_hash_info(int hash, enum wc_HashType* hashType, int* mgf,
+    int* oid)
+{
+    switch (hash) {
+        case IOP_SHA1:
+            *hashType = WC_HASH_TYPE_SHA;
+            *mgf = WC_MGF1SHA1;
+            *oid = SHAh;
+            break;
+        case IOP_SHA256:
+            *hashType = WC_HASH_TYPE_SHA256;
+            *mgf = WC_MGF1SHA256;
+            *oid = SHA256h;
+            break;
+        case IOP_SHA384:
+            *hashType = WC_HASH_TYPE_SHA384;
+            *mgf = WC_MGF1SHA384;
+            *oid = SHA384h;
+            break;
+        case IOP_SHA512:
+            *hashType = WC_HASH_TYPE_SHA512;
+            *mgf = WC_MGF1SHA512;
+            *oid = SHA512h;
+            break;
+        default:
+            return BAD_FUNC_ARG;
+    }
+    return 0;
+}
+
+static int wolf_init(void)
+{
+    return wc_InitRng(&rng);
+}
+
+static void wolf_cleanup(void)
+{
+    wc_FreeRng(&rng);
+}
+
+static const char* wolf_version(void)
+{
+    return LIBWOLFSSL_VERSION_STRING;
+}
+
+static int wolf_digest(int hash, const unsigned char* msg, int msgSz,
+    unsigned char* out, int* outSz)
+{
+    int ret;
+    int mgf, oid;
+    enum wc_HashType hashType;
+
+    ret = wolf_hash_info(hash, &hashType, &mgf, &oid);
+    if (ret == 0) {
+        ret = wc_HashGetDigestSize(hashType);
+    }
+    if (ret > 0) {
+        *outSz = ret;
+        ret = wc_Hash(hashType, msg, (word32)msgSz, out, (word32)*outSz);
+    }
+    return ret;
+}
+
+static void wolf_close(void* handle)
+{
+    WolfHandle* h = (WolfHandle*)handle;
+
+    if (h == NULL)
+        return;
+    if (h->keyInit) {
+    #ifdef HAVE_ECC
+        if (h->sig == IOP_ECDSA)
+            wc_ecc_free(&h->ecc);
+        else
+    #endif
+            wc_FreeRsaKey(&h->rsa);
+    }
+    free(h);
+}
+
+static void* wolf_open(const IopKey* key, int priv, int sig, int hash)
+{
+    int ret;
+    word32 idx = 0;
+    WolfHandle* h;
+
+    h = (WolfHandle*)malloc(sizeof(WolfHandle));
+    if (h == NULL)
+        return NULL;
+    XMEMSET(h, 0, sizeof(WolfHandle));
+    h->sig = sig;
+
+    ret = wolf_hash_info(hash, &h->hashType, &h->mgf, &h->oid);
+    if (ret == 0 && sig == IOP_ECDSA) {
+    #ifdef HAVE_ECC
+        ret = wc_ecc_init(&h->ecc);
+        if (ret == 0) {
+            h->keyInit = 1;
+            if (priv)
+                ret = wc_EccPrivateKeyDecode(key->priv, &idx, &h->ecc,
+                    (word32)key->privSz);
+            else
+                ret = wc_EccPublicKeyDecode(key->pub, &idx, &h->ecc,
+                    (word32)key->pubSz);
+        }
+    #else
+        ret = NOT_COMPILED_IN;
+    #endif
+    }
+    else if (ret == 0) {
+        ret = wc_InitRsaKey(&h->rsa, NULL);
+        if (ret == 0) {
+            h->keyInit = 1;
+            if (priv)
+                ret = wc_RsaPrivateKeyDecode(key->priv, &idx, &h->rsa,
+                    (word32)key->privSz);
+            else
+                ret = wc_RsaPublicKeyDecode(key->pub, &idx, &h->rsa,
+                    (word32)key->pubSz);
+        }
+    #ifdef WC_RSA_BLINDING
+        if (ret == 0 && priv)
+            ret = wc_RsaSetRNG(&h->rsa, &rng);
+    #endif
+    }
+
+    if (ret != 0) {
+        wolf_close(h);
+        return NULL;
+    }
+    return h;
+}
+
+static int wolf_sign(void* handle, const unsigned char* dgst, int dgstSz,
+    unsigned char* sig, int* sigSz)
+{
+    int ret;
+    word32 outSz = (word32)*sigSz;
+    WolfHandle* h = (WolfHandle*)handle;
+    byte enc[WC_MAX_DIGEST_SIZE + MAX_ENC_ALG_SZ];
+    word32 encSz;
+
+    switch (h->sig) {
+        case IOP_RSA_PKCS1:
+            encSz = wc_EncodeSignature(enc, dgst, (word32)dgstSz, h->oid);
+            ret = wc_RsaSSL_Sign(enc, encSz, sig, outSz, &h->rsa, &rng);
+            break;
+    #ifdef WC_RSA_PSS
+        case IOP_RSA_PSS:
+            ret = wc_RsaPSS_Sign(dgst, (word32)dgstSz, sig, outSz,
+                h->hashType, h->mgf, &h->rsa, &rng);
+            break;
+    #endif
+    #ifdef HAVE_ECC
+        case IOP_ECDSA:
+            ret = wc_ecc_sign_hash(dgst, (word32)dgstSz, sig, &outSz, &rng,
+                &h->ecc);
+            if (ret == 0)
+                ret = (int)outSz;
+            break;
+    #endif
+        default:
+            ret = NOT_COMPILED_IN;
+    }
+    if (ret < 0)
+        return ret;
+
+    *sigSz = ret;
+    return 0;
+}
+
+static int wolf_verify(void* handle, const unsigned char* dgst, int dgstSz,
+    const unsigned char* sig, int sigSz)
+{
+    int ret;
+    WolfHandle* h = (WolfHandle*)handle;
+    byte tmp[IOP_MAX_SIG_SZ];
+    byte* out = NULL;
+    byte enc[WC_MAX_DIGEST_SIZE + MAX_ENC_ALG_SZ];
+    word32 encSz;
+#ifdef HAVE_ECC
+    int res = 0;
+#endif
+
+    if (h->sig != IOP_ECDSA) {
+        /* RSA verifies in place */
+        if (sigSz > (int)sizeof(tmp))
+            return BUFFER_E;
+        XMEMCPY(tmp, sig, sigSz);
+    }
+
+    switch (h->sig) {
+        case IOP_RSA_PKCS1:
+            ret = wc_RsaSSL_VerifyInline(tmp, (word32)sigSz, &out, &h->rsa);
+            if (ret > 0) {
+                encSz = wc_EncodeSignature(enc, dgst, (word32)dgstSz, h->oid);
+                if ((word32)ret == encSz && XMEMCMP(out, enc, encSz) == 0)
+                    ret = 0;
+                else
+                    ret = SIG_VERIFY_E;
+            }
+            break;
+    #ifdef WC_RSA_PSS
+        case IOP_RSA_PSS:
+            ret = wc_RsaPSS_VerifyInline(tmp, (word32)sigSz, &out,
+                h->hashType, h->mgf, &h->rsa);
+            if (ret > 0) {
+                ret = wc_RsaPSS_CheckPadding(dgst, (word32)dgstSz, out,
+                    (word32)ret, h->hashType);
+            }
+            break;
+    #endif
+    #ifdef HAVE_ECC
+        case IOP_ECDSA:
+            ret = wc_ecc_verify_hash(sig, (word32)sigSz, dgst, (word32)dgstSz,
+                &res, &h->ecc);
+            if (ret == 0 && res != 1)
+                ret = SIG_VERIFY_E;
+            break;
+    #endif
+        default:
+            ret = NOT_COMPILED_IN;
+    }
+    if (ret > 0)
+        ret = SIG_VERIFY_E;
+
+    return ret;
+}
+
+const IopLib iop_wolfssl = {
+    "wolfSSL",
+    wolf_init,
+    wolf_cleanup,
+    wolf_version,
+    wolf_digest,
+    wolf_open,
+    wolf_close,
+    wolf_sign,
+    wolf_verify
+};